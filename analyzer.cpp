@@ -0,0 +1,2786 @@
+// The analyzer itself, built as a library: the command line tool and the C interface sit on top
+
+#include "etc/include.h"
+
+constexpr static int EIGHT = 8;
+constexpr static size_t OUTPUT_FLUSH_SIZE = 1 << 20;
+constexpr static size_t FILTER_READ_SIZE = 64 << 10;
+constexpr static size_t FILTER_LOOKAHEAD = 64 << 10; // input held back while waiting for an architecture marker
+constexpr static size_t BLOCK_LINES = 1024; // lines tokenized before the passes over them run
+constexpr static size_t MEMO_SAMPLE = 4096; // lines the memo's hit rate is measured over
+constexpr static size_t MEMO_PAUSE = 16; // samples the memo sits out when it doesn't pay
+
+// the passes that depend on the instruction set, instantiated once per backend (etc/isa.hpp)
+template <typename Isa> static auto tokenizeLine(const scan::LineMap& map, ir::Block& block) -> size_t;
+template <typename Isa> static auto tokenizeOperands(const scan::LineMap& map, ir::Block& block, size_t from, size_t to) -> void;
+template <typename Isa> static auto annotateLine(const ir::Block& block, size_t line, OutputBuffer& comment) -> void;
+// next to the streaming filter, whose annotateStream it shares
+template <typename Output> static auto annotateCompressed(compression::Reader& inflated, const std::filesystem::path& source, const Options& options, ThreadPool* pool,
+    Output& newFile, Output& recordFile, symbols::Index* xref, FileResult& result) -> void;
+
+auto getAnalyzedPath(const std::filesystem::path& path) -> std::filesystem::path {
+    // a compressed file's copy is named after what it holds: foo.s.gz -> foo_analyzed.s
+    std::filesystem::path source = compression::uncompressedPath(path);
+    std::filesystem::path analyzed = source;
+    analyzed.replace_filename(source.stem().string() + "_analyzed" + source.extension().string());
+    return analyzed;
+}
+
+auto getSidecarPath(const std::filesystem::path& path) -> std::filesystem::path {
+    std::filesystem::path sidecarPath = path;
+    sidecarPath += sidecar::EXTENSION;
+    return sidecarPath;
+}
+
+auto writeHeader(OutputBuffer& out, std::string_view architecture) -> void {
+    auto now = std::chrono::system_clock::now();
+    std::time_t currentTime = std::chrono::system_clock::to_time_t(now);
+    struct tm localTime {};
+#ifdef _WIN32
+    localtime_s(&localTime, &currentTime);
+#else
+    localtime_r(&currentTime, &localTime);
+#endif
+    std::array<char, 32> date{};
+    size_t dateLength = std::strftime(date.data(), date.size(), "%Y-%m-%d %H:%M:%S", &localTime);
+
+    out.append("; INFORMATION:\n");
+    out.append("; \tAssembly Analyzer Version: ").append(VERSION).push_back('\n');
+    out.append("; \tAnalyzed on: ").append({ date.data(), dateLength }).push_back('\n');
+    out.append("; \tInstruction Set Architecture: ").append(architecture).append("\n\n");
+}
+
+template <typename Isa>
+static auto formatLine(const ir::Block& block, size_t line, OutputBuffer& out) -> void {
+    out.append(block.line(line));
+    size_t mark = out.size();
+    out.append("\t\t; ");
+    annotateLine<Isa>(block, line, out);
+    if (out.size() == mark + 4) { out.resize(mark); }
+    out.push_back('\n');
+    stats::mark(stats::FORMAT);
+}
+
+auto formatLine(const ir::Block& block, size_t line, OutputBuffer& out) -> void {
+    formatLine<isa::X86>(block, line, out);
+}
+
+auto formatLine(const scan::LineMap& map, OutputBuffer& out) -> void {
+    thread_local ir::Block block;
+    block.reset(map.text());
+    tokenizeLine(map, block);
+    formatLine(block, 0, out);
+}
+
+auto formatLine(std::string_view line, OutputBuffer& out) -> void {
+    thread_local scan::TextMap map;
+    map.build(line);
+    formatLine(scan::LineMap(map, line, 0), out);
+}
+
+/**
+  A worker's memo of analyzed lines (etc/memo.hpp) and the comments it has for the block being
+  tokenized: a line found in it gets its comment from there, a line about to go into it is
+  annotated as it's tokenized. Other lines are annotated by the passes over the block, as without
+  the memo.
+ */
+struct LineMemo {
+    /**
+      Where a line's comment is in `comments`, `at` is LATE for lines annotated later.
+     */
+    struct Comment {
+        size_t at = 0;
+        size_t length = 0;
+    };
+    static constexpr size_t LATE = SIZE_MAX;
+
+    memo::Table table;
+    OutputBuffer comments;
+    std::vector<Comment> lines; // one per line of the block
+    size_t sampled = 0;
+    size_t sampleHits = 0;
+    size_t paused = 0;
+
+    [[nodiscard]] auto enabled() const -> bool { return table.capacity() != 0; }
+    [[nodiscard]] auto late(size_t line) const -> bool { return !enabled() || lines[line].at == LATE; }
+    [[nodiscard]] auto comment(size_t line) const -> std::string_view { return comments.view().substr(lines[line].at, lines[line].length); }
+
+    /**
+      @return Whether the next line is looked up. Looking lines up and remembering them costs
+      about as much as a hit saves, so while fewer than half the lines of a sample hit (code that
+      doesn't repeat itself) the memo sits out a while before trying again. It isn't judged before
+      it's full: lines only go in the second time they're missed, so it starts out missing.
+     */
+    auto consult() -> bool {
+        if (paused == 0) { return true; }
+        --paused;
+        return false;
+    }
+
+    void record(bool hit) {
+        sampleHits += hit ? 1 : 0;
+        if (++sampled == MEMO_SAMPLE) {
+            if (sampleHits * 2 < MEMO_SAMPLE && table.full()) { paused = MEMO_SAMPLE * MEMO_PAUSE; }
+            sampled = sampleHits = 0;
+        }
+    }
+
+    /**
+      Forgets the comments, with the block they belong to.
+     */
+    void reset() {
+        comments.clear();
+        lines.clear();
+    }
+};
+
+/**
+  @return The calling thread's memo for a backend (lines tokenize differently in each), sized to
+  `lines` and without comments.
+ */
+template <typename Isa>
+static auto threadMemo(size_t lines) -> LineMemo& {
+    thread_local LineMemo memo;
+    if (memo.table.capacity() != lines) { memo.table.resize(lines); }
+    memo.reset();
+    return memo;
+}
+
+/**
+  Tokenizes a line into a block, or copies it and its comment from the memo when the line was
+  seen before.
+ *
+  @return The index of the line in the block.
+ */
+template <typename Isa>
+static auto tokenizeLine(const scan::LineMap& map, ir::Block& block, LineMemo& memo) -> size_t {
+    if (!memo.enabled()) { return tokenizeLine<Isa>(map, block); }
+    std::string_view text = map.text();
+    if (!memo.consult()) {
+        memo.lines.push_back({ LineMemo::LATE, 0 });
+        stats::count(stats::MEMO_SKIPPED);
+        return tokenizeLine<Isa>(map, block);
+    }
+    uint64_t hash = memo::hash(text);
+    if (const memo::Entry* entry = memo.table.find(text, hash)) {
+        entry->addTo(block, text);
+        memo.lines.push_back({ memo.comments.size(), entry->comment().size() });
+        memo.comments.append(entry->comment());
+        memo.record(true);
+        stats::count(stats::MEMO_HITS);
+        stats::mark(stats::TOKENIZE);
+        return block.lines() - 1;
+    }
+
+    size_t index = tokenizeLine<Isa>(map, block);
+    memo.record(false);
+    stats::count(stats::MEMO_MISSES);
+    // blank lines cost nothing to tokenize, labels are hardly ever repeated
+    records::LineKind kind = block.kind[index];
+    if (kind == records::LineKind::BLANK || kind == records::LineKind::LABEL || !memo.table.admit(hash)) {
+        memo.lines.push_back({ LineMemo::LATE, 0 });
+        return index;
+    }
+    size_t at = memo.comments.size();
+    annotateLine<Isa>(block, index, memo.comments);
+    memo.lines.push_back({ at, memo.comments.size() - at });
+    bool evicted = false;
+    memo.table.insert(block, index, hash, memo.comment(index), evicted);
+    if (evicted) { stats::count(stats::MEMO_EVICTIONS); }
+    stats::mark(stats::FORMAT);
+    return index;
+}
+
+/**
+  Appends a line's comment: the memo's, or worked out now.
+ */
+template <typename Isa>
+static auto commentLine(const ir::Block& block, size_t line, const LineMemo& memo, OutputBuffer& comment) -> void {
+    if (memo.late(line)) {
+        annotateLine<Isa>(block, line, comment);
+    } else {
+        comment.append(memo.comment(line));
+    }
+}
+
+/**
+  Appends a line of the annotated copy, with its comment from the memo when it has it.
+ */
+template <typename Isa>
+static auto formatLine(const ir::Block& block, size_t line, const LineMemo& memo, OutputBuffer& out) -> void {
+    if (memo.late(line)) {
+        formatLine<Isa>(block, line, out);
+        return;
+    }
+    out.append(block.line(line));
+    std::string_view comment = memo.comment(line);
+    if (!comment.empty()) { out.append("\t\t; ").append(comment); }
+    out.push_back('\n');
+    stats::mark(stats::FORMAT);
+}
+
+/**
+  Annotates a text in chunks analyzed in parallel (Output is an OutputFile or a MemoryOutput).
+ *
+  @param text The whole input.
+  @param options The chunk size.
+  @param pool Runs the chunks (the calling thread takes part).
+  @param newFile Receives the annotated copy.
+  @param result Receives the line count.
+ */
+template <typename Isa, typename Output>
+static auto analyzeChunked(std::string_view text, const Options& options, ThreadPool& pool, Output& newFile, FileResult& result) -> void {
+    size_t chunkSize = options.chunkSize;
+    // newline aligned chunk boundaries
+    std::vector<size_t> bounds{ 0 };
+    while (bounds.back() < text.size()) {
+        size_t end = bounds.back() + chunkSize;
+        if (end >= text.size()) {
+            end = text.size();
+        } else {
+            size_t eol = text.find('\n', end);
+            end = eol == std::string_view::npos ? text.size() : eol + 1;
+        }
+        bounds.push_back(end);
+    }
+
+    /**
+      One chunk being analyzed, a chunk's line count travels with its output.
+     */
+    struct Slot {
+        OutputBuffer out;
+        size_t lines = 0;
+        bool done = false;
+    };
+
+    /**
+      Shared with the helper tasks, which may only get to run after this function returned (they
+      then find nothing left to claim and leave without touching anything else).
+     */
+    struct State {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<Slot> slots;
+        size_t count = 0;
+        size_t nextClaim = 0;
+        size_t nextWrite = 0;
+    };
+
+    auto state = std::make_shared<State>();
+    state->count = bounds.size() - 1;
+    // bounded number of chunks in flight, so memory doesn't grow with the file
+    size_t window = std::min(state->count, pool.size() * 2);
+    state->slots.resize(window);
+
+    // chunks share no state: the architecture was settled before, and lines only need counting
+    size_t lines = 0;
+
+    // called with the lock held, writes every finished chunk that is next in file order
+    auto writeReady = [&]() {
+        while (state->nextWrite < state->count && state->slots[state->nextWrite % window].done) {
+            Slot& slot = state->slots[state->nextWrite % window];
+            newFile.write(slot.out.view());
+            slot.out.clear();
+            slot.done = false;
+            lines += slot.lines;
+            ++state->nextWrite;
+            state->cv.notify_all();
+        }
+    };
+
+    std::function<void()> work = [state, text, &bounds, &writeReady, window, memoLines = options.memoLines] {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        while (true) {
+            state->cv.wait(lock, [&] { return state->nextClaim >= state->count || state->nextClaim < state->nextWrite + window; });
+            if (state->nextClaim >= state->count) { break; }
+            size_t index = state->nextClaim++;
+            Slot& slot = state->slots[index % window];
+            lock.unlock();
+
+            stats::start();
+            slot.lines = 0;
+            std::string_view chunk = text.substr(bounds[index], bounds[index + 1] - bounds[index]);
+            thread_local ir::Block block;
+            block.reset(chunk);
+            LineMemo& memo = threadMemo<Isa>(memoLines);
+            auto drain = [&] {
+                for (size_t i = 0; i < block.lines(); ++i) {
+                    formatLine<Isa>(block, i, memo, slot.out);
+                }
+                slot.lines += block.lines();
+                if (stats::COMPILED && stats::enabled) { countLines(block); }
+                block.reset(chunk);
+                memo.reset();
+            };
+
+            scan::LineScanner lines(chunk);
+            scan::LineMap line;
+            while (lines.next(line)) {
+                tokenizeLine<Isa>(line, block, memo);
+                if (block.lines() == BLOCK_LINES) { drain(); }
+            }
+            drain();
+
+            lock.lock();
+            slot.done = true;
+            stats::start();
+            writeReady();
+            stats::mark(stats::WRITE);
+        }
+    };
+
+    for (size_t i = 1; i < std::min(window, pool.size()); ++i) {
+        pool.submit(work);
+    }
+    work();
+
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->cv.wait(lock, [&] { return state->nextWrite == state->count; });
+    }
+    result.lines = lines;
+}
+
+/**
+  What --cfg adds to a text: its basic blocks and loops, with their cost estimates and register
+  dependencies.
+ */
+struct FlowSummary {
+    cfg::Graph graph;
+    deps::Analysis dependencies;
+    const cost::Model* model = nullptr;
+    std::vector<cost::Estimate> blockCosts;
+    std::vector<cost::Estimate> loopCosts; // every block of the loop, those of nested loops included
+    std::vector<uint32_t> numbers;         // blocks holding instructions are numbered from 1, the others are 0
+    size_t next = 0;                       // first block whose summary hasn't been written
+};
+
+/**
+  Builds the control flow graph of a whole text, estimates its blocks and loops and follows their
+  register dependencies.
+ *
+  @param block The tokenized text.
+  @param options The processor model.
+  @param summary Receives the graph and the estimates.
+ */
+template <typename Isa>
+static auto summarizeFlow(const ir::Block& block, const Options& options, FlowSummary& summary) -> void {
+    cfg::Graph& graph = summary.graph;
+    graph.build<Isa>(block);
+    const cost::Model& model = cost::select(Isa::NAME, options.cpu);
+    summary.model = &model;
+
+    summary.blockCosts.resize(graph.blocks.size());
+    summary.numbers.resize(graph.blocks.size());
+    summary.loopCosts.assign(graph.loops.size(), {});
+    uint32_t number = 0;
+    for (size_t b = 0; b < graph.blocks.size(); ++b) {
+        const cfg::BasicBlock& basic = graph.blocks[b];
+        summary.blockCosts[b] = cost::estimate<Isa>(block, basic.first, basic.end, model);
+        summary.numbers[b] = basic.instructions == 0 ? 0 : ++number;
+        if (basic.loop != cfg::NONE) { summary.loopCosts[basic.loop] += summary.blockCosts[b]; }
+    }
+    // inner loops come first, so they're complete when added to the loop around them
+    for (size_t l = 0; l < graph.loops.size(); ++l) {
+        if (uint32_t parent = graph.loops[l].parent; parent != cfg::NONE) { summary.loopCosts[parent] += summary.loopCosts[l]; }
+    }
+    summary.dependencies.run<Isa>(block, graph, model);
+    summary.next = 0;
+    stats::mark(stats::CFG);
+}
+
+// cycles, to two decimals
+static auto appendCycles(double cycles, OutputBuffer& out) -> void {
+    auto hundredths = static_cast<uint64_t>(std::llround(cycles * 100));
+    records::appendNumber(hundredths / 100, out);
+    out.push_back('.');
+    out.push_back(static_cast<char>('0' + hundredths / 10 % 10));
+    out.push_back(static_cast<char>('0' + hundredths % 10));
+}
+
+// " (bound by p1)" or " (bound by the issue width)"
+static auto appendBottleneck(const cost::Estimate& estimate, const cost::Model& model, OutputBuffer& out) -> void {
+    int port = estimate.bottleneck(model);
+    out.append(" (bound by ").append(port < 0 ? std::string_view("the issue width") : model.ports[static_cast<size_t>(port)]).push_back(')');
+}
+
+// ", up to 5 registers live"
+static auto appendPressure(uint32_t pressure, OutputBuffer& out) -> void {
+    out.append(", up to ");
+    records::appendNumber(pressure, out);
+    out.append(pressure == 1 ? " register live" : " registers live");
+}
+
+/**
+  Writes the summaries of the basic block starting at a line, if one does, as comment lines: the
+  loop it heads first, then the block.
+ *
+  @param summary The graph and estimates, advanced past the block.
+  @param block The tokenized text.
+  @param line The line about to be written.
+  @param out Receives the comment lines.
+ */
+static auto writeFlowSummary(FlowSummary& summary, const ir::Block& block, size_t line, OutputBuffer& out) -> void {
+    const cfg::Graph& graph = summary.graph;
+    if (summary.next >= graph.blocks.size() || graph.blocks[summary.next].first != line) { return; }
+    auto index = static_cast<uint32_t>(summary.next++);
+    const cfg::BasicBlock& basic = graph.blocks[index];
+    if (basic.instructions == 0) { return; }
+    const cost::Model& model = *summary.model;
+    using records::appendNumber;
+
+    if (basic.loop != cfg::NONE && graph.loops[basic.loop].header == index) {
+        const cfg::Loop& loop = graph.loops[basic.loop];
+        const cost::Estimate& estimate = summary.loopCosts[basic.loop];
+        out.append("; Loop at ");
+        // a function's name rather than the labels around it (compilers put the .LFE and .LC labels of what came before
+        // in front of it, its .LFB after it), otherwise the first label
+        size_t label = basic.end;
+        for (size_t i = basic.first; i < basic.end; ++i) {
+            if (block.kind[i] != records::LineKind::LABEL) { continue; }
+            if (label == basic.end || (symbols::isLocal(block.view(label, block.name[label])) && !symbols::isLocal(block.view(i, block.name[i])))) {
+                label = i;
+            }
+        }
+        if (label != basic.end) {
+            out.append(block.view(label, block.name[label]));
+        } else {
+            out.append("line ");
+            appendNumber(basic.first + 1, out);
+        }
+        out.append(", lines ");
+        appendNumber(graph.blocks[loop.firstBlock].first + 1, out);
+        out.push_back('-');
+        appendNumber(graph.blocks[loop.lastBlock].end, out);
+        out.append(" (depth ");
+        appendNumber(loop.depth, out);
+        out.append(", ");
+        appendNumber(loop.blocks, out);
+        out.append(loop.blocks == 1 ? " block): " : " blocks): ");
+        appendNumber(estimate.instructions, out);
+        out.append(" instructions, ");
+
+        // an iteration can't start before the values the last one hands it are ready, however free the ports are (what
+        // unknown instructions read and write isn't, so their loops and blocks go without dependencies)
+        const deps::LoopDependencies& dependencies = summary.dependencies.loops[basic.loop];
+        bool known = estimate.unknown == 0;
+        double throughput = estimate.throughput(model);
+        if (known && dependencies.recurrence > throughput) {
+            appendCycles(dependencies.recurrence, out);
+            out.append(" cycles per iteration on ").append(model.name).append(" (bound by the loop-carried chain through ");
+            out.append(summary.dependencies.names[dependencies.through]).append(", the ports allow ");
+            appendCycles(throughput, out);
+            out.push_back(')');
+        } else {
+            appendCycles(throughput, out);
+            out.append(" cycles per iteration on ").append(model.name);
+            appendBottleneck(estimate, model, out);
+        }
+        if (!known) {
+            out.append(", dependencies unknown");
+        } else {
+            if (dependencies.carried.any()) {
+                out.append(", carried:");
+                for (size_t id = 0; id < isa::MAX_REGISTERS; ++id) {
+                    if (dependencies.carried[id]) { out.append(" ").append(summary.dependencies.names[id]); }
+                }
+            }
+            appendPressure(dependencies.pressure, out);
+        }
+        out.push_back('\n');
+    }
+
+    const cost::Estimate& estimate = summary.blockCosts[index];
+    out.append("; Block ");
+    appendNumber(summary.numbers[index], out);
+    if (uint32_t depth = graph.depth(index); depth != 0) {
+        out.append(" (loop depth ");
+        appendNumber(depth, out);
+        out.push_back(')');
+    }
+    out.append(": ");
+    appendNumber(estimate.instructions, out);
+    out.append(estimate.instructions == 1 ? " instruction" : " instructions");
+    if (estimate.unknown != 0) {
+        out.append(" (");
+        appendNumber(estimate.unknown, out);
+        out.append(" unknown, costed as simple ones)");
+    }
+    out.append(", ");
+    appendNumber(estimate.uops, out);
+    const deps::BlockDependencies& dependencies = summary.dependencies.blocks[index];
+    out.append(" uops, critical path ");
+    if (estimate.unknown != 0) {
+        out.append("unknown");
+    } else {
+        appendNumber(dependencies.critical.cycles, out);
+        out.append(dependencies.critical.cycles == 1 ? " cycle" : " cycles");
+    }
+    if (estimate.unknown == 0 && dependencies.critical.instructions > 1) {
+        out.append(" (");
+        appendNumber(dependencies.critical.instructions, out);
+        out.append(" instructions, lines ");
+        appendNumber(dependencies.critical.first + 1, out);
+        out.push_back('-');
+        appendNumber(dependencies.critical.last + 1, out);
+        out.push_back(')');
+    }
+    out.append(", throughput ");
+    appendCycles(estimate.throughput(model), out);
+    out.append(" cycles");
+    appendBottleneck(estimate, model, out);
+    if (estimate.unknown == 0) { appendPressure(dependencies.pressure, out); }
+
+    // successors by number, past blocks without instructions (a label on its own falls through)
+    out.append(", next: ");
+    size_t written = 0;
+    for (uint32_t next : basic.successors) {
+        for (size_t hops = 0; next != cfg::NONE && graph.blocks[next].instructions == 0 && hops < graph.blocks.size(); ++hops) {
+            next = graph.blocks[next].successors[0];
+        }
+        if (next == cfg::NONE || summary.numbers[next] == 0) { continue; }
+        if (written++ != 0) { out.append(", "); }
+        appendNumber(summary.numbers[next], out);
+    }
+    if (written == 0) { out.append("none"); }
+    out.push_back('\n');
+}
+
+/**
+  Collects what an included file defines: labels, constants (.equ, .set, %define, %assign and
+  NASM's `name equ value`), macros (.macro, %macro) and the files it includes in turn.
+ *
+  @param text The file.
+  @param parsed Receives the names.
+ */
+template <typename Isa>
+static auto parseInclude(std::string_view text, includes::Parsed& parsed) -> void {
+    ir::Block block;
+    block.reset(text);
+    scan::LineScanner lines(text);
+    scan::LineMap line;
+    while (lines.next(line)) { tokenizeLine<Isa>(line, block); }
+    parsed.lines = block.lines();
+
+    // `name` of `name value`, `name, value` or `name(arguments) value`
+    auto firstWord = [](std::string_view operands) {
+        operands = trim(operands);
+        return operands.substr(0, operands.find_first_of(" \t,("));
+    };
+    auto add = [](std::vector<std::string>& names, std::string_view name) {
+        if (!name.empty()) { names.emplace_back(name); }
+    };
+    for (size_t i = 0; i < block.lines(); ++i) {
+        std::string_view name = block.view(i, block.name[i]);
+        std::string_view operands = block.view(i, block.operands[i]);
+        switch (block.kind[i]) {
+        case records::LineKind::LABEL:
+            add(parsed.labels, name);
+            break;
+        case records::LineKind::DIRECTIVE:
+            switch (static_cast<Directive>(block.opcode[i])) {
+            case Directive::INCLUDE:
+            case Directive::NASM_INCLUDE: add(parsed.includes, includes::unquote(operands)); break;
+            case Directive::EQU:
+            case Directive::SET: add(parsed.constants, firstWord(operands)); break;
+            default:
+                if (name == ".macro") { add(parsed.macros, firstWord(operands)); }
+                break;
+            }
+            break;
+        default:
+            if (name == "%macro") {
+                add(parsed.macros, firstWord(operands));
+            } else if (name == "%define" || name == "%xdefine" || name == "%assign") {
+                add(parsed.constants, firstWord(operands));
+            } else if (firstWord(operands) == "equ") {
+                add(parsed.constants, name);
+            }
+            break;
+        }
+    }
+}
+
+/**
+  Writes what the file an include directive pulls in defines, if the line is one, as a comment
+  line: where the file was found, then its lines, labels, constants and macros together with
+  those of the files it includes in turn.
+ *
+  @param block The tokenized text.
+  @param line The line about to be written.
+  @param source The file being analyzed (empty for the current directory).
+  @param options The include directories.
+  @param xref Receives the labels and constants defined, may be null.
+  @param out Receives the comment line.
+ */
+template <typename Isa>
+static auto writeIncludeSummary(const ir::Block& block, size_t line, const std::filesystem::path& source, const Options& options,
+    symbols::Index* xref, OutputBuffer& out) -> void {
+    if (block.kind[line] != records::LineKind::DIRECTIVE) { return; }
+    if (auto id = static_cast<Directive>(block.opcode[line]); id != Directive::INCLUDE && id != Directive::NASM_INCLUDE) { return; }
+    using records::appendNumber;
+
+    includes::Cache& cache = includes::Cache::get();
+    auto load = [&](std::string_view name, const std::filesystem::path& from) -> std::shared_ptr<const includes::Parsed> {
+        std::filesystem::path path = includes::resolve(name, from, options.includeDirs);
+        bool parsed = false;
+        std::shared_ptr<const includes::Parsed> found = path.empty() ? nullptr : cache.find(path, Isa::NAME, parseInclude<Isa>, parsed);
+        stats::count(found == nullptr ? stats::INCLUDES_MISSING : parsed ? stats::INCLUDES_PARSED : stats::INCLUDES_REUSED);
+        return found;
+    };
+
+    std::string_view name = includes::unquote(block.view(line, block.operands[line]));
+    out.append("; Include ").append(name);
+    std::shared_ptr<const includes::Parsed> first = load(name, source.parent_path());
+    if (first == nullptr) {
+        out.append(": not found\n");
+        return;
+    }
+
+    // every file it includes, once however often (or circularly) it's included
+    std::vector<std::shared_ptr<const includes::Parsed>> pending{ first };
+    std::unordered_set<std::string> seen{ first->path.string() };
+    std::vector<std::string> missing;
+    size_t files = 0;
+    size_t lines = 0;
+    size_t labels = 0;
+    size_t constants = 0;
+    size_t macros = 0;
+    while (!pending.empty()) {
+        std::shared_ptr<const includes::Parsed> parsed = std::move(pending.back());
+        pending.pop_back();
+        ++files;
+        lines += parsed->lines;
+        labels += parsed->labels.size();
+        constants += parsed->constants.size();
+        macros += parsed->macros.size();
+        if (xref != nullptr) {
+            for (const std::string& name : parsed->labels) { xref->define(name, symbols::INCLUDED, 0); }
+            for (const std::string& name : parsed->constants) { xref->define(name, symbols::INCLUDED, 0); }
+        }
+        for (const std::string& nested : parsed->includes) {
+            if (std::shared_ptr<const includes::Parsed> found = load(nested, parsed->path.parent_path()); found == nullptr) {
+                missing.push_back(nested);
+            } else if (seen.insert(found->path.string()).second) {
+                pending.push_back(std::move(found));
+            }
+        }
+    }
+
+    auto count = [&](size_t n, std::string_view one, std::string_view many) {
+        appendNumber(n, out);
+        out.append(n == 1 ? one : many);
+    };
+    out.append(" (").append(first->path.string()).append("): ");
+    count(lines, " line", " lines");
+    if (files > 1) {
+        out.append(" in ");
+        count(files, " file", " files");
+    }
+    out.append(", ");
+    count(labels, " label, ", " labels, ");
+    count(constants, " constant, ", " constants, ");
+    count(macros, " macro", " macros");
+    if (!missing.empty()) {
+        out.append(", not found:");
+        for (const std::string& nested : missing) { out.append(" ").append(nested); }
+    }
+    out.push_back('\n');
+}
+
+/**
+  Calls `f` with every symbol an operand or expression names: `sym`, `sym+8(%rip)`, `$sym`,
+  `[rel sym]`, `.L3-.L2`, but not registers, shifts and extensions (lsl, uxtw), numbers,
+  strings, relocation operators (%hi, :lo12:) or what follows an @ (@PLT).
+ */
+template <typename Isa, typename F>
+static auto forEachSymbol(std::string_view text, F&& f) -> void {
+    auto starts = [](char c) { return std::isalpha(static_cast<unsigned char>(c)) != 0 || c == '_' || c == '.' || c == '$'; };
+    auto continues = [&](char c) { return starts(c) || std::isdigit(static_cast<unsigned char>(c)) != 0; };
+    for (size_t i = 0; i < text.size();) {
+        char c = text[i];
+        if (c == '"' || c == '\'') {
+            size_t close = text.find(c, i + 1);
+            i = close == std::string_view::npos ? text.size() : close + 1;
+            continue;
+        }
+        if (!continues(c)) {
+            ++i;
+            continue;
+        }
+        size_t begin = i;
+        while (i < text.size() && continues(text[i])) { ++i; }
+        std::string_view word = text.substr(begin, i - begin);
+        char before = begin == 0 ? ' ' : text[begin - 1];
+        char after = i == text.size() ? ' ' : text[i];
+        if (!starts(word[0]) || before == '%' || before == '@' || after == ':' || Isa::isRegister(word) || Isa::isModifier(word)) { continue; }
+        if (word[0] == '$') { word.remove_prefix(1); } // an immediate address in AT&T syntax
+        if (word.empty() || word == "." || !starts(word[0]) || word[0] == '$') { continue; }
+        if constexpr (std::is_same_v<Isa, isa::X86> || std::is_same_v<Isa, isa::X86Analysis>) {
+            // Intel syntax's size and addressing keywords, in either case (NASM writes them in lower case, compilers in upper)
+            static constexpr std::array<std::string_view, 13> KEYWORDS = { "rel", "abs", "ptr", "offset", "flat", "byte", "word", "dword",
+                "qword", "tword", "oword", "xmmword", "ymmword" };
+            auto keyword = [&](std::string_view k) {
+                return k.size() == word.size() &&
+                    std::equal(k.begin(), k.end(), word.begin(), [](char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); });
+            };
+            if (std::any_of(KEYWORDS.begin(), KEYWORDS.end(), keyword)) { continue; }
+        }
+        f(word);
+    }
+}
+
+/**
+  Records the symbols a line defines, declares and uses.
+ *
+  @param block The tokenized text.
+  @param line The line.
+  @param number Its number in the file (1-based).
+  @param function The function the line is in, moved on by labels that aren't local.
+  @param xref Receives the symbols.
+ */
+template <typename Isa>
+static auto collectSymbols(const ir::Block& block, size_t line, uint32_t number, uint32_t& function, symbols::Index& xref) -> void {
+    std::string_view name = block.view(line, block.name[line]);
+    size_t first = block.firstOperand[line];
+    size_t end = first + block.operandCount(line);
+    auto operand = [&](size_t o) { return block.view(line, block.operand[o]); };
+    auto declareAll = [&](uint32_t flag) {
+        for (size_t o = first; o < end; ++o) {
+            forEachSymbol<Isa>(operand(o), [&](std::string_view symbol) { xref.declare(symbol, flag); });
+        }
+    };
+    auto referenceAll = [&](size_t from) {
+        for (size_t o = from; o < end; ++o) {
+            forEachSymbol<Isa>(operand(o), [&](std::string_view symbol) { xref.use(symbol, symbols::Use(number, function, symbols::UseKind::REFERENCE)); });
+        }
+    };
+
+    switch (block.kind[line]) {
+    case records::LineKind::LABEL: {
+        uint32_t id = xref.define(name, symbols::LABEL, number);
+        if (!symbols::isLocal(name)) { function = id; }
+        return;
+    }
+    case records::LineKind::INSTRUCTION: {
+        isa::Operation operation = Isa::operation(block.opcode[line]);
+        if (operation == isa::Operation::PSEUDO && name == "global") {
+            declareAll(symbols::GLOBAL);
+            return;
+        }
+        // the target is the label operand, the last one if several (*%rax and *table(,%rax,8) go through memory)
+        size_t target = end;
+        if (operation == isa::Operation::CALL || operation == isa::Operation::JUMP || operation == isa::Operation::BRANCH) {
+            for (size_t o = first; o < end; ++o) {
+                if (block.operandKind[o] == records::OperandKind::LABEL && operand(o)[0] != '*') { target = o; }
+            }
+        }
+        symbols::UseKind kind = operation == isa::Operation::CALL ? symbols::UseKind::CALL
+            : operation == isa::Operation::JUMP                   ? symbols::UseKind::JUMP
+                                                                  : symbols::UseKind::BRANCH;
+        for (size_t o = first; o < end; ++o) {
+            forEachSymbol<Isa>(operand(o), [&](std::string_view symbol) {
+                xref.use(symbol, symbols::Use(number, function, o == target ? kind : symbols::UseKind::REFERENCE));
+            });
+        }
+        return;
+    }
+    case records::LineKind::DIRECTIVE: {
+        uint16_t id = block.opcode[line];
+        switch (id == records::NO_OPCODE ? Directive::NONE : static_cast<Directive>(id)) {
+        case Directive::GLOBL:
+        case Directive::GLOBAL: declareAll(symbols::GLOBAL); return;
+        case Directive::EQU:
+        case Directive::SET:
+        case Directive::COMM:
+            if (first == end) { return; }
+            xref.define(operand(first), static_cast<Directive>(id) == Directive::COMM ? symbols::COMMON : symbols::CONSTANT, number);
+            if (static_cast<Directive>(id) != Directive::COMM) { referenceAll(first + 1); }
+            return;
+        case Directive::BYTE:
+        case Directive::WORD:
+        case Directive::DWORD:
+        case Directive::QUAD: referenceAll(first); return;
+        default: break;
+        }
+        // data directives a jump table or an exception table is made of, and where the unwinder finds the latter
+        static constexpr std::array<std::string_view, 15> DATA = { ".long", ".int", ".short", ".hword", ".value", ".2byte", ".4byte", ".8byte",
+            ".xword", ".dc.a", ".dc.l", ".uleb128", ".sleb128", ".cfi_lsda", ".cfi_personality" };
+        if (name == ".weak") {
+            declareAll(symbols::GLOBAL);
+        } else if (name == ".extern") {
+            declareAll(symbols::EXTERNAL);
+        } else if (std::find(DATA.begin(), DATA.end(), name) != DATA.end()) {
+            referenceAll(first);
+        }
+        return;
+    }
+    case records::LineKind::UNKNOWN: {
+        // NASM's extern and `name equ value`, otherwise mnemonics the backend doesn't know, whose
+        // operands may still name labels
+        std::string_view operands = trim(block.view(line, block.operands[line]));
+        if (name == "extern") {
+            declareAll(symbols::EXTERNAL);
+        } else if (operands.substr(0, operands.find_first_of(" \t")) == "equ") {
+            xref.define(name, symbols::CONSTANT, number);
+        } else {
+            referenceAll(first);
+        }
+        return;
+    }
+    case records::LineKind::BLANK: return;
+    }
+}
+
+/**
+  Where --profile's samples land in a text: the function the lines are in (the last label that
+  isn't local, null when the profile has no samples of it) and how many of its instructions came
+  before.
+ */
+struct ProfileOverlay {
+    const profile::Profile* profile = nullptr;
+    const profile::Function* function = nullptr;
+    size_t next = 0;
+};
+
+// a share, in percent to two decimals
+static auto appendPercent(uint64_t part, uint64_t whole, OutputBuffer& out) -> void {
+    auto hundredths = static_cast<uint64_t>(std::llround(10000.0 * static_cast<double>(part) / static_cast<double>(whole)));
+    records::appendNumber(hundredths / 100, out);
+    out.push_back('.');
+    out.push_back(static_cast<char>('0' + hundredths / 10 % 10));
+    out.push_back(static_cast<char>('0' + hundredths % 10));
+    out.push_back('%');
+}
+
+/**
+  Writes a function's share of the samples as a comment line, if the line is the label of one the
+  profile has samples of, and starts counting its instructions.
+ *
+  @param overlay The profile, moved on to the function.
+  @param block The tokenized text.
+  @param line The line about to be written.
+  @param out Receives the comment line.
+ */
+template <typename Isa>
+static auto writeProfileSummary(ProfileOverlay& overlay, const ir::Block& block, size_t line, OutputBuffer& out) -> void {
+    if (block.kind[line] != records::LineKind::LABEL) { return; }
+    std::string_view name = block.view(line, block.name[line]);
+    if (symbols::isLocal(name)) { return; }
+    const profile::Function* function = overlay.profile->find(name);
+    overlay.function = function == nullptr || function->samples == 0 ? nullptr : function;
+    overlay.next = 0;
+    if (overlay.function == nullptr) { return; }
+    using records::appendNumber;
+
+    out.append("; Profile of ").append(name).append(": ");
+    appendPercent(function->samples, overlay.profile->total(), out);
+    out.append(" of the samples (");
+    appendNumber(function->samples, out);
+    out.append(" of ");
+    appendNumber(overlay.profile->total(), out);
+    out.push_back(')');
+    if (!function->byLine(Isa::INSTRUCTION_BYTES)) {
+        out.append(", not by line: ").append(Isa::NAME).append(" instructions vary in size, perf annotate lists their addresses");
+    }
+    out.push_back('\n');
+}
+
+/**
+  Gets the samples of a line, moving on to the next instruction of the function when it's one.
+  Mnemonics the backend doesn't know are instructions too, unless they look like directives or
+  NASM's keywords.
+ *
+  @param overlay The profile and function, moved past the line.
+  @param block The tokenized text.
+  @param line The line.
+  @return The line's samples, 0 for lines that aren't instructions.
+ */
+template <typename Isa>
+static auto lineSamples(ProfileOverlay& overlay, const ir::Block& block, size_t line) -> uint64_t {
+    if (overlay.function == nullptr) { return 0; }
+    bool nop = false;
+    if (block.kind[line] == records::LineKind::INSTRUCTION) {
+        isa::Operation operation = Isa::operation(block.opcode[line]);
+        if (operation == isa::Operation::PSEUDO) { return 0; }
+        nop = operation == isa::Operation::NOP;
+    } else if (block.kind[line] == records::LineKind::UNKNOWN) {
+        static constexpr std::array<std::string_view, 18> KEYWORDS = { "global", "extern", "section", "segment", "bits", "default", "align", "times",
+            "db", "dw", "dd", "dq", "dt", "resb", "resw", "resd", "resq", "equ" };
+        std::string_view mnemonic = block.view(line, block.name[line]);
+        std::string_view operands = block.view(line, block.operands[line]);
+        std::string_view next = operands.substr(0, operands.find_first_of(" \t"));
+        if (std::string_view(".%#;/@").find(mnemonic[0]) != std::string_view::npos || mnemonic.back() == ':' ||
+            std::find(KEYWORDS.begin(), KEYWORDS.end(), mnemonic) != KEYWORDS.end() || next == "equ") {
+            return 0;
+        }
+        nop = mnemonic.substr(0, 3) == "nop";
+    } else {
+        return 0;
+    }
+    return overlay.function->step(overlay.next, nop, Isa::INSTRUCTION_BYTES);
+}
+
+// "12.50% of the samples, 29.00% of main's"
+static auto appendSamples(const ProfileOverlay& overlay, uint64_t samples, OutputBuffer& out) -> void {
+    appendPercent(samples, overlay.profile->total(), out);
+    out.append(" of the samples, ");
+    appendPercent(samples, overlay.function->samples, out);
+    out.append(" of ").append(overlay.function->name).append("'s");
+}
+
+/**
+  Adds a line's share of the samples to the line just formatted, to its comment if it got one.
+ *
+  @param overlay The profile and function.
+  @param samples The line's samples (nothing is added for none).
+  @param end Where the text of the line ends in `out`.
+  @param out Holds the line, its comment and the newline.
+ */
+static auto addSamples(const ProfileOverlay& overlay, uint64_t samples, size_t end, OutputBuffer& out) -> void {
+    if (samples == 0) { return; }
+    out.resize(out.size() - 1);
+    out.append(out.size() == end ? "\t\t; " : ", ");
+    appendSamples(overlay, samples, out);
+    out.push_back('\n');
+}
+
+/**
+  Writes the annotated lines of a text and their records with one backend (Output is an OutputFile
+  or a MemoryOutput).
+ *
+  @param text The whole input (ignored when reading from `stream`).
+  @param stream When not null, the input is read from it line by line instead.
+  @param head What was already read from `stream`, it goes before the rest.
+  @param source The file the text comes from (empty for the current directory).
+  @param options The options.
+  @param newFile Receives the annotated copy.
+  @param recordFile Receives the records, if any were requested.
+  @param xref Receives the symbols, may be null.
+  @param result Receives the line and byte counts.
+ */
+template <typename Isa, typename Output>
+static auto annotateLines(std::string_view text, std::istream* stream, std::string_view head, const std::filesystem::path& source, const Options& options,
+    Output& newFile, Output& recordFile, symbols::Index* xref, FileResult& result) -> void {
+    // every worker thread formats into its own buffer, kept across files so it only grows once
+    thread_local OutputBuffer out(OUTPUT_FLUSH_SIZE * 2);
+    out.clear();
+
+    thread_local OutputBuffer recordOut;
+    recordOut.clear();
+    if (options.records != records::Format::NONE) { records::begin(options.records, recordOut); }
+
+    // with --cfg the whole text is tokenized before the passes run: control flow may cross any line,
+    // and a sidecar or symbol index hashes the source once it's done
+    std::string whole;
+    if ((options.cfg || options.sidecar || xref != nullptr) && stream != nullptr) {
+        whole.assign(head);
+        whole.append(std::istreambuf_iterator<char>(*stream), std::istreambuf_iterator<char>());
+        stats::mark(stats::READ);
+        text = whole;
+        stream = nullptr;
+    }
+    FlowSummary flow;
+
+    // a sidecar takes the place of the annotated copy: only the comments are kept, by line
+    sidecar::Writer annotations;
+    thread_local OutputBuffer comment;
+    thread_local OutputBuffer prefix;
+    if (options.sidecar) {
+        annotations.begin(out);
+        if (options.header) {
+            comment.clear();
+            writeHeader(comment, result.architecture);
+            annotations.setHeader(comment.view());
+        }
+    }
+
+    // lines are tokenized a block at a time, then every pass runs over the block in line order; the
+    // passes over what the code means read it as their own backend tokenizes it, line for line
+    using Analysis = typename Isa::Analysis;
+    constexpr bool SEPARATE = !std::is_same_v<Isa, Analysis>;
+    bool analyzed = SEPARATE && (options.cfg || xref != nullptr || options.profile != nullptr);
+    thread_local ir::Block block;
+    thread_local ir::Block separate;
+    ir::Block& analysis = SEPARATE ? separate : block;
+    LineMemo& memo = threadMemo<Isa>(options.memoLines);
+    uint32_t function = symbols::NONE;
+    ProfileOverlay overlay{ options.profile.get() };
+    auto drain = [&](uint64_t base) {
+        if (options.cfg) { summarizeFlow<Analysis>(analysis, options, flow); }
+        for (size_t i = 0; i < block.lines(); ++i) {
+            if (options.sidecar) {
+                prefix.clear();
+                comment.clear();
+                if (options.cfg) { writeFlowSummary(flow, analysis, i, prefix); }
+                if (options.includes) { writeIncludeSummary<Isa>(block, i, source, options, xref, prefix); }
+                if (overlay.profile != nullptr) { writeProfileSummary<Isa>(overlay, block, i, prefix); }
+                commentLine<Isa>(block, i, memo, comment);
+                if (uint64_t samples = overlay.profile == nullptr ? 0 : lineSamples<Analysis>(overlay, analysis, i); samples != 0) {
+                    if (!comment.empty()) { comment.append(", "); }
+                    appendSamples(overlay, samples, comment);
+                }
+                annotations.add(base + block.start[i], comment.view(), prefix.view(), out);
+                stats::mark(stats::FORMAT);
+            } else {
+                if (options.cfg) { writeFlowSummary(flow, analysis, i, out); }
+                if (options.includes) { writeIncludeSummary<Isa>(block, i, source, options, xref, out); }
+                if (overlay.profile != nullptr) { writeProfileSummary<Isa>(overlay, block, i, out); }
+                size_t end = out.size() + block.line(i).size();
+                formatLine<Isa>(block, i, memo, out);
+                if (overlay.profile != nullptr) { addSamples(overlay, lineSamples<Analysis>(overlay, analysis, i), end, out); }
+            }
+            ++result.lines;
+            if (xref != nullptr) { collectSymbols<Analysis>(analysis, i, static_cast<uint32_t>(result.lines), function, *xref); }
+
+            if (options.records != records::Format::NONE) {
+                records::Record record;
+                record.offset = base + block.start[i];
+                record.line = static_cast<uint32_t>(result.lines);
+                std::string_view name = describeLine(block, i, record);
+                records::append(options.records, record, name, recordOut);
+                stats::mark(stats::FORMAT);
+                if (recordOut.size() >= OUTPUT_FLUSH_SIZE) {
+                    recordFile.write(recordOut.view());
+                    recordOut.clear();
+                    stats::mark(stats::WRITE);
+                }
+            }
+
+            if (out.size() >= OUTPUT_FLUSH_SIZE) {
+                newFile.write(out.view());
+                out.clear();
+                stats::mark(stats::WRITE);
+            }
+        }
+        if (stats::COMPILED && stats::enabled) { countLines(block); }
+        block.reset(block.source());
+        if (analyzed) { separate.reset(block.source()); }
+        memo.reset();
+    };
+    auto tokenize = [&](const scan::LineMap& line) {
+        tokenizeLine<Isa>(line, block, memo);
+        if (analyzed) { tokenizeLine<Analysis>(line, separate); }
+    };
+
+    if (stream == nullptr) {
+        result.bytes = text.size();
+        block.reset(text);
+        if (analyzed) { separate.reset(text); }
+        scan::LineScanner lines(text);
+        scan::LineMap line;
+        while (lines.next(line)) {
+            tokenize(line);
+            if (block.lines() == BLOCK_LINES && !options.cfg) { drain(0); }
+        }
+        drain(0);
+    } else {
+        // every line is a string of its own, so blocks of one line; the lines read ahead come first
+        std::string line;
+        scan::TextMap map;
+        size_t pending = 0;
+        auto next = [&]() -> bool {
+            if (pending < head.size()) {
+                size_t eol = std::min(head.find('\n', pending), head.size());
+                line.assign(head.substr(pending, eol - pending));
+                pending = eol + 1;
+                return true;
+            }
+            return static_cast<bool>(getline(*stream, line));
+        };
+        while (next()) {
+            stats::mark(stats::READ);
+            map.build(line);
+            block.reset(line);
+            if (analyzed) { separate.reset(line); }
+            tokenize(scan::LineMap(map, line, 0));
+            drain(result.bytes);
+            result.bytes += line.size() + 1;
+        }
+    }
+
+    if (options.records != records::Format::NONE) {
+        recordFile.write(recordOut.view());
+        recordOut.clear();
+        if (options.records == records::Format::BINARY) {
+            uint64_t count = result.lines;
+            recordFile.writeAt(records::COUNT_OFFSET, { reinterpret_cast<const char*>(&count), sizeof(count) });
+        }
+    }
+    if (options.sidecar) { annotations.finish(text, out); }
+    if (xref != nullptr) { xref->finish(text); }
+    newFile.write(out.view());
+    out.clear();
+    if (options.sidecar) { newFile.writeAt(0, annotations.finalHeader()); }
+}
+
+/**
+  Writes the annotated copy of a text and its records, the part shared by files and in-memory
+  buffers (Output is an OutputFile or a MemoryOutput).
+ *
+  @param text The whole input (ignored when reading from `stream`).
+  @param stream When not null, the input is read from it line by line instead (once: what the
+  detection reads is held until the annotation gets to it).
+  @param source The file the text comes from, included files are looked for next to it (empty
+  for the current directory).
+  @param options The options.
+  @param pool Helps with big texts, may be null.
+  @param newFile Receives the annotated copy.
+  @param recordFile Receives the records, if any were requested.
+  @param xref Receives the symbols, may be null.
+  @param result Receives the line and byte counts and the architecture.
+ */
+template <typename Output>
+static auto annotateText(std::string_view text, std::istream* stream, const std::filesystem::path& source, const Options& options,
+    ThreadPool* pool, Output& newFile, Output& recordFile, symbols::Index* xref, FileResult& result) -> void {
+    // the architecture picks the backend every line goes through, so it's settled first
+    ArchDetector detector;
+    std::string head;
+    if (!options.architecture.empty()) {
+        result.architecture = options.architecture;
+    } else if (stream == nullptr) {
+        detector.feedText(text);
+    } else {
+        // the lines read until the marker are kept for the annotation, the stream isn't rewound
+        std::string line;
+        while (!detector.detected() && getline(*stream, line)) {
+            head += line;
+            if (!stream->eof()) { head.push_back('\n'); }
+            detector.feed(line);
+        }
+    }
+    stats::mark(stats::DETECT);
+    if (options.architecture.empty()) { result.architecture = detector.name(); }
+
+    // a sidecar keeps the header with the comments
+    if (options.header && !options.sidecar) {
+        OutputBuffer header;
+        writeHeader(header, result.architecture);
+        newFile.write(header.view());
+    }
+
+    isa::dispatch(result.architecture, [&](auto backend) {
+        using Isa = decltype(backend);
+        // records, sidecars and symbols are numbered by line, which chunks analyzed in parallel don't know yet, and control flow and
+        // functions cross chunks
+        if (stream == nullptr && options.records == records::Format::NONE && !options.cfg && !options.sidecar && !options.includes && xref == nullptr &&
+            options.profile == nullptr && pool != nullptr && pool->size() > 1 && options.chunkSize != 0 && text.size() >= options.chunkSize * 2) {
+            result.bytes = text.size();
+            analyzeChunked<Isa>(text, options, *pool, newFile, result);
+        } else {
+            annotateLines<Isa>(text, stream, head, source, options, newFile, recordFile, xref, result);
+        }
+    });
+}
+
+auto analyzeFile(const std::filesystem::path& path, const Options& options, ThreadPool* pool) -> FileResult {
+    FileResult result;
+    auto begin = std::chrono::steady_clock::now();
+    std::string filename = path.string();
+
+    stats::start();
+    compression::Codec codec = compression::codecOf(path);
+    compression::Reader inflated;
+    MappedFile mapped;
+    std::ifstream originalFile;
+    if (codec != compression::Codec::NONE) {
+        // view maps the source next to the sidecar
+        if (options.sidecar) {
+            result.error = "--sidecar needs an uncompressed source";
+            return result;
+        }
+        if (!inflated.open(filename, codec, result.error)) {
+            return result;
+        }
+    } else if (options.mmap) {
+        if (!mapped.open(filename, result.error)) {
+            return result;
+        }
+    } else {
+        originalFile.open(path);
+        if (!originalFile) {
+            result.error = "File not found!";
+            return result;
+        }
+    }
+
+    stats::mark(stats::READ);
+
+    std::filesystem::path npath = options.sidecar ? getSidecarPath(path) : getAnalyzedPath(path);
+    npath += compression::extension(options.compress); // never set with --sidecar
+    compression::Writer newFile;
+    if (!newFile.open(npath.string(), options.compress)) {
+        result.error = "Cannot open " + npath.string();
+        return result;
+    }
+
+    compression::Writer recordFile;
+    std::filesystem::path rpath = getAnalyzedPath(path);
+    if (options.records != records::Format::NONE) {
+        rpath += records::extension(options.records);
+        if (!recordFile.open(rpath.string(), compression::Codec::NONE)) {
+            result.error = "Cannot open " + rpath.string();
+            return result;
+        }
+    }
+    symbols::Index xref;
+
+    if (codec != compression::Codec::NONE) {
+        annotateCompressed(inflated, path, options, pool, newFile, recordFile, options.xref ? &xref : nullptr, result);
+        if (!result.error.empty()) {
+            // the data broke off or went bad: what was written is only part of a copy
+            newFile.close();
+            recordFile.close();
+            std::error_code ec;
+            std::filesystem::remove(npath, ec);
+            if (options.records != records::Format::NONE) { std::filesystem::remove(rpath, ec); }
+            return result;
+        }
+    } else {
+        annotateText(mapped.view(), options.mmap ? nullptr : &originalFile, path, options, pool, newFile, recordFile, options.xref ? &xref : nullptr,
+            result);
+    }
+    stats::count(stats::FILES);
+    stats::count(stats::BYTES_IN, result.bytes);
+    stats::count(stats::BYTES_OUT, newFile.written());
+
+    if (options.records != records::Format::NONE && !recordFile.close()) {
+        result.error = "Cannot write " + rpath.string();
+        return result;
+    }
+    if (options.xref) {
+        // written whole once the lines are done: it's grouped by symbol
+        std::filesystem::path xpath = getAnalyzedPath(path);
+        xpath += symbols::EXTENSION;
+        OutputBuffer index;
+        xref.write(index);
+        OutputFile xrefFile;
+        if (!xrefFile.open(xpath.string())) {
+            result.error = "Cannot open " + xpath.string();
+            return result;
+        }
+        xrefFile.write(index.view());
+        if (!xrefFile.close()) {
+            result.error = "Cannot write " + xpath.string();
+            return result;
+        }
+    }
+    if (!newFile.close()) {
+        result.error = "Cannot write " + npath.string();
+        return result;
+    }
+    stats::mark(stats::WRITE);
+
+    result.ok = true;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return result;
+}
+
+auto analyzeBuffer(std::string_view text, const Options& options, ThreadPool* pool, std::string& output, std::string& records) -> FileResult {
+    FileResult result;
+    auto begin = std::chrono::steady_clock::now();
+    stats::start();
+
+    MemoryOutput newFile;
+    MemoryOutput recordFile;
+    annotateText(text, nullptr, {}, options, pool, newFile, recordFile, nullptr, result);
+    stats::count(stats::FILES);
+    stats::count(stats::BYTES_IN, result.bytes);
+    stats::count(stats::BYTES_OUT, newFile.written());
+    output = newFile.take();
+    records = recordFile.take();
+
+    result.ok = true;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return result;
+}
+
+auto analyzeCached(const std::filesystem::path& path, const Options& options, ThreadPool* pool, ResultCache& cache) -> FileResult {
+    auto begin = std::chrono::steady_clock::now();
+
+    // the version is part of the key: a new release must not reuse older output
+    static const uint64_t version = xxhash::hash64(VERSION);
+    // and so are the options that change the output
+    uint64_t seed = options.cfg ? xxhash::hash64("cfg " + options.cpu, version) : version;
+    if (options.compress != compression::Codec::NONE) { seed = xxhash::hash64(compression::extension(options.compress), seed); }
+    uint64_t key = 0;
+    {
+        MappedFile mapped;
+        std::string error;
+        if (!mapped.open(path.string(), error)) {
+            return analyzeFile(path, options, pool); // reports the error
+        }
+        key = xxhash::hash64(mapped.view(), seed);
+    }
+    stats::mark(stats::READ);
+
+    std::filesystem::path npath = getAnalyzedPath(path);
+    npath += compression::extension(options.compress);
+    ResultCache::Entry entry;
+    if (cache.fetch(key, npath, entry)) {
+        FileResult result;
+        result.ok = true;
+        result.cached = true;
+        result.bytes = entry.inputBytes;
+        result.lines = entry.lines;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        return result;
+    }
+
+    FileResult result = analyzeFile(path, options, pool);
+    if (result.ok) {
+        entry = { key, 0, result.bytes, result.lines, 0, result.seconds };
+        cache.store(entry, npath);
+    }
+    return result;
+}
+
+#if ASM_ANALYZE_HAS_URING
+/**
+  A file on its way through the io_uring pipeline: open, read, close, analyze (on a worker), then
+  open, write and close each output.
+ */
+struct IoJob {
+    enum Step : uint8_t { OPEN_INPUT, READ, CLOSE_INPUT, ANALYZED, OPEN_OUTPUT, WRITE, CLOSE_OUTPUT, STEP_COUNT };
+
+    std::string path;
+    std::chrono::steady_clock::time_point begin;
+    int fd = -1;
+    std::unique_ptr<char[]> input;
+    size_t size = 0;
+    size_t filled = 0;
+    std::array<std::string, 2> outputs;     // the annotated copy, then the records (if any)
+    std::array<std::string, 2> outputPaths;
+    size_t output = 0;                      // the one being written
+    size_t written = 0;
+    bool inPlace = false;                   // big enough to be mapped and analyzed by analyzeFile instead
+    FileResult result;
+};
+
+/**
+  Runs a batch through io_uring: the thread calling this keeps up to options.queueDepth files
+  in flight, reading them into memory while the pool analyzes the ones that have arrived.
+ *
+  @return False, with the reason in `error`, when the ring can't be set up (nothing was done then).
+ */
+static auto analyzeFilesUring(const std::vector<std::filesystem::path>& files, const Options& options, ThreadPool& pool,
+    const std::function<void(size_t, const FileResult&)>& done, std::vector<FileResult>& results, std::string& error) -> bool {
+    uring::Ring ring;
+    if (!ring.open(options.queueDepth, error)) { return false; }
+
+    // bigger files are mapped and annotated straight into their output, copying them through the ring
+    // costs more than the open/read/write latency it hides; the input bytes held at once are bounded
+    constexpr uint64_t SMALL_FILE = uint64_t{ 64 } << 10;
+    constexpr uint64_t READ_BUDGET = uint64_t{ 64 } << 20;
+    constexpr uint32_t MAX_REQUEST = 1U << 30;
+
+    std::vector<IoJob> jobs(files.size());
+    std::mutex mutex;                   // the submission queue is shared with the workers
+    std::deque<size_t> waiting;         // opened, waiting for room in the read budget
+    size_t admitted = 0;
+    size_t finished = 0;
+    size_t inFlight = 0;
+    uint64_t reading = 0;
+    bool broken = false;
+    auto tag = [](size_t index, IoJob::Step step) { return static_cast<uint64_t>(index) * IoJob::STEP_COUNT + step; };
+
+    auto finish = [&](size_t index) {
+        IoJob& job = jobs[index];
+        if (job.size != 0 && !job.inPlace) { reading -= job.size; }
+        job.result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - job.begin).count();
+        job.input.reset();
+        job.outputs = {};
+        results[index] = std::move(job.result);
+        done(index, results[index]);
+        --inFlight;
+        ++finished;
+    };
+    auto fail = [&](size_t index, std::string reason) {
+        IoJob& job = jobs[index];
+        job.result.ok = false;
+        job.result.error = std::move(reason);
+        if (job.fd >= 0) { ::close(job.fd); }
+        job.fd = -1;
+        finish(index);
+    };
+    auto startRead = [&](size_t index) {
+        IoJob& job = jobs[index];
+        reading += job.size;
+        job.input.reset(new char[job.size]);
+        ring.read(job.fd, job.input.get(), static_cast<uint32_t>(std::min<size_t>(job.size, MAX_REQUEST)), 0, tag(index, IoJob::READ));
+    };
+    auto startOutput = [&](size_t index) {
+        IoJob& job = jobs[index];
+        job.written = 0;
+        ring.openAt(job.outputPaths[job.output].c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644, tag(index, IoJob::OPEN_OUTPUT));
+    };
+    auto analyze = [&](size_t index) {
+        pool.submit([&, index] {
+            IoJob& job = jobs[index];
+            if (job.inPlace) {
+                job.result = analyzeFile(files[index], options, &pool);
+                std::lock_guard<std::mutex> lock(mutex);
+                ring.nop(tag(index, IoJob::ANALYZED));
+                ring.submit();
+                return;
+            }
+            std::string& records = job.outputs[1];
+            job.result = analyzeBuffer({ job.input.get(), job.filled }, options, &pool, job.outputs[0], records);
+            job.input.reset();
+            std::lock_guard<std::mutex> lock(mutex);
+            reading -= job.size;
+            job.size = 0;
+            startOutput(index);
+            ring.submit();
+        });
+    };
+
+    auto complete = [&](uint64_t data, int32_t result) {
+        auto index = static_cast<size_t>(data / IoJob::STEP_COUNT);
+        IoJob& job = jobs[index];
+        switch (static_cast<IoJob::Step>(data % IoJob::STEP_COUNT)) {
+        case IoJob::OPEN_INPUT: {
+            if (result < 0) { return fail(index, "File not found!"); }
+            job.fd = result;
+            struct stat st {};
+            if (::fstat(job.fd, &st) != 0 || !S_ISREG(st.st_mode)) { return fail(index, job.path + " is not a regular file"); }
+            job.size = static_cast<size_t>(st.st_size);
+            // compressed inputs and outputs are streamed through analyzeFile as well, and so are files
+            // whose includes are looked for next to them or whose symbols are indexed
+            job.inPlace = job.size > SMALL_FILE || compression::codecOf(files[index]) != compression::Codec::NONE ||
+                options.compress != compression::Codec::NONE || options.includes || options.xref;
+            if (job.size == 0 || job.inPlace) {
+                ring.closeFile(job.fd, tag(index, IoJob::CLOSE_INPUT));
+                job.fd = -1;
+                if (job.inPlace) { job.size = 0; }
+                return analyze(index);
+            }
+            if (reading != 0 && reading + job.size > READ_BUDGET) { return waiting.push_back(index); }
+            return startRead(index);
+        }
+        case IoJob::READ:
+            if (result < 0) { return fail(index, "Cannot read " + job.path + ": " + std::strerror(-result)); }
+            job.filled += static_cast<size_t>(result);
+            // short reads go on where they stopped, until the end of what was there when it was opened
+            if (result != 0 && job.filled < job.size) {
+                ring.read(job.fd, job.input.get() + job.filled, static_cast<uint32_t>(std::min<size_t>(job.size - job.filled, MAX_REQUEST)), job.filled,
+                    tag(index, IoJob::READ));
+                return;
+            }
+            ring.closeFile(job.fd, tag(index, IoJob::CLOSE_INPUT));
+            job.fd = -1;
+            return analyze(index);
+        case IoJob::CLOSE_INPUT:
+            return;
+        case IoJob::ANALYZED:
+            return finish(index);
+        case IoJob::OPEN_OUTPUT: {
+            if (result < 0) { return fail(index, "Cannot open " + job.outputPaths[job.output]); }
+            job.fd = result;
+            [[fallthrough]];
+        }
+        case IoJob::WRITE: {
+            const std::string& bytes = job.outputs[job.output];
+            if (data % IoJob::STEP_COUNT == IoJob::WRITE) {
+                if (result <= 0) { return fail(index, "Cannot write " + job.outputPaths[job.output]); }
+                job.written += static_cast<size_t>(result);
+            }
+            if (job.written < bytes.size()) {
+                ring.write(job.fd, bytes.data() + job.written, static_cast<uint32_t>(std::min<size_t>(bytes.size() - job.written, MAX_REQUEST)),
+                    job.written, tag(index, IoJob::WRITE));
+                return;
+            }
+            ring.closeFile(job.fd, tag(index, IoJob::CLOSE_OUTPUT));
+            job.fd = -1;
+            return;
+        }
+        case IoJob::CLOSE_OUTPUT:
+            if (result < 0) { return fail(index, "Cannot write " + job.outputPaths[job.output]); }
+            if (++job.output < job.outputPaths.size() && !job.outputPaths[job.output].empty()) { return startOutput(index); }
+            return finish(index);
+        case IoJob::STEP_COUNT:
+            return;
+        }
+    };
+
+    auto admit = [&] {
+        // reads waiting for the budget go first, they already hold a descriptor
+        while (!waiting.empty() && (reading == 0 || reading + jobs[waiting.front()].size <= READ_BUDGET)) {
+            startRead(waiting.front());
+            waiting.pop_front();
+        }
+        for (; admitted < files.size() && inFlight < options.queueDepth; ++admitted, ++inFlight) {
+            IoJob& job = jobs[admitted];
+            job.path = files[admitted].string();
+            job.begin = std::chrono::steady_clock::now();
+            std::filesystem::path npath = getAnalyzedPath(files[admitted]);
+            job.outputPaths[0] = options.sidecar ? getSidecarPath(files[admitted]).string() : npath.string();
+            if (options.records != records::Format::NONE) {
+                npath += records::extension(options.records);
+                job.outputPaths[1] = npath.string();
+            }
+            // a FIFO mustn't block the open, it is refused once fstat sees what it is
+            ring.openAt(job.path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC, 0, tag(admitted, IoJob::OPEN_INPUT));
+        }
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        admit();
+        broken = !ring.submit();
+    }
+    while (!broken && finished < files.size()) {
+        if (!ring.wait()) { break; }
+        std::lock_guard<std::mutex> lock(mutex);
+        ring.reap(complete);
+        admit();
+        broken = !ring.submit();
+    }
+    // the workers may still hand work over to the ring, which is about to go away
+    pool.wait();
+    if (finished < files.size()) {
+        dbg::Macros::error(std::string("io_uring failed: ") + std::strerror(errno));
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (!results[i].ok && results[i].error.empty()) { results[i].error = "Not analyzed, the I/O failed"; }
+        }
+    }
+    return true;
+}
+#endif
+
+auto analyzeFiles(const std::vector<std::filesystem::path>& files, const Options& options, ThreadPool& pool, ResultCache& cache,
+    const std::function<void(size_t, const FileResult&)>& done) -> std::vector<FileResult> {
+    std::vector<FileResult> results(files.size());
+#if ASM_ANALYZE_HAS_URING
+    // the cache reads the files on its own, and a single file has nothing to overlap with
+    if (options.io != IoEngine::THREADS && !cache.enabled() && files.size() > 1) {
+        std::string error;
+        if (analyzeFilesUring(files, options, pool, done, results, error)) { return results; }
+        if (options.io == IoEngine::URING) { dbg::Macros::warn(error + ", using threads"); }
+    }
+#else
+    if (options.io == IoEngine::URING) { dbg::Macros::warn("io_uring is unavailable in this build, using threads"); }
+#endif
+
+    // every worker opens, reads and writes its own files
+    for (size_t i = 0; i < files.size(); ++i) {
+        pool.submit([&, i] {
+            results[i] = cache.enabled() ? analyzeCached(files[i], options, &pool, cache) : analyzeFile(files[i], options, &pool);
+            done(i, results[i]);
+        });
+    }
+    pool.wait();
+    return results;
+}
+
+auto viewFile(const std::filesystem::path& path, const Options& options, OutputFile& output) -> FileResult {
+    FileResult result;
+    auto begin = std::chrono::steady_clock::now();
+
+    MappedFile source;
+    if (!source.open(path.string(), result.error)) { return result; }
+    std::string spath = getSidecarPath(path).string();
+    MappedFile mapped;
+    std::string error;
+    if (!mapped.open(spath, error)) {
+        result.error = "No sidecar (" + spath + "), analyze it with --sidecar first";
+        return result;
+    }
+    sidecar::Reader annotations;
+    if (!annotations.open(mapped.view(), error)) {
+        result.error = spath + " " + error;
+        return result;
+    }
+
+    std::string_view text = source.view();
+    const sidecar::Header& info = annotations.info();
+    uint64_t first = options.firstLine;
+    uint64_t last = std::min(options.lastLine, info.lines);
+    if (info.lines != 0 && first > info.lines) {
+        result.error = "There are only " + std::to_string(info.lines) + " lines";
+        return result;
+    }
+
+    thread_local OutputBuffer out(OUTPUT_FLUSH_SIZE * 2);
+    out.clear();
+    if (first == 1) { out.append(annotations.string(info.header)); }
+
+    // straight to the group holding the first line, then line by line from there
+    uint64_t line = first - (first - 1) % info.groupLines;
+    size_t pos = info.lines == 0 ? text.size() : static_cast<size_t>(annotations.group(first).offset);
+    uint64_t prefix = info.lines == 0 ? 0 : annotations.group(first).prefix;
+    for (; line <= last && pos <= text.size(); ++line) {
+        if ((line - 1) % info.groupLines == 0 && !annotations.matches(text, line)) {
+            result.error = "Changed since " + spath + " was written, analyze it again";
+            return result;
+        }
+        size_t eol = text.find('\n', pos);
+        size_t end = eol == std::string_view::npos ? text.size() : eol;
+        size_t length = end - pos;
+#ifdef _WIN32
+        if (length != 0 && text[end - 1] == '\r') { --length; }
+#endif
+        if (line >= first) {
+            annotations.merge(line, text.substr(pos, length), prefix, out);
+            ++result.lines;
+            result.bytes += length + 1;
+        }
+        pos = end + 1;
+
+        if (out.size() >= OUTPUT_FLUSH_SIZE) {
+            output.write(out.view());
+            out.clear();
+        }
+    }
+    output.write(out.view());
+    out.clear();
+    if (!output.good()) {
+        result.error = "Cannot write the output";
+        return result;
+    }
+
+    result.ok = true;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return result;
+}
+
+auto queryXref(const std::filesystem::path& path, const Options& options, OutputFile& output) -> FileResult {
+    FileResult result;
+    auto begin = std::chrono::steady_clock::now();
+
+    std::filesystem::path xpath = getAnalyzedPath(path);
+    xpath += symbols::EXTENSION;
+    std::string spath = xpath.string();
+    MappedFile mapped;
+    std::string error;
+    if (!mapped.open(spath, error)) {
+        result.error = "No symbol index (" + spath + "), analyze it with --xref first";
+        return result;
+    }
+    symbols::Reader index;
+    if (!index.open(mapped.view(), error)) {
+        result.error = spath + " " + error;
+        return result;
+    }
+    const symbols::Header& info = index.info();
+    // line numbers only mean something for the text they were taken from (a compressed source
+    // would have to be decompressed to tell)
+    if (compression::codecOf(path) == compression::Codec::NONE) {
+        MappedFile source;
+        if (!source.open(path.string(), result.error)) { return result; }
+        if (source.view().size() != info.sourceBytes || xxhash::hash64(source.view()) != info.sourceHash) {
+            result.error = "Changed since " + spath + " was written, analyze it again";
+            return result;
+        }
+    }
+
+    using records::appendNumber;
+    thread_local OutputBuffer out;
+    out.clear();
+    std::string name = path.string();
+    auto where = [&](uint32_t line) {
+        out.append(name).push_back(':');
+        appendNumber(line, out);
+        out.append(": ");
+    };
+    auto next = [&]() {
+        ++result.lines;
+        if (out.size() >= OUTPUT_FLUSH_SIZE) {
+            output.write(out.view());
+            out.clear();
+        }
+    };
+    auto functionOf = [&](const symbols::Use& use) -> std::string_view {
+        return use.from < info.symbolCount ? index.name(use.from) : std::string_view("the top level");
+    };
+
+    switch (options.query) {
+    case XrefQuery::CALLERS:
+    case XrefQuery::USES: {
+        uint32_t id = index.find(options.symbol);
+        if (id == symbols::NONE) { break; }
+        bool uses = options.query == XrefQuery::USES;
+        if (uses && (index.symbol(id).flags & symbols::INCLUDED) != 0) {
+            out.append(name).append(": defined in an included file\n");
+            next();
+        }
+        for (uint32_t i = 0; uses && i < index.definitions(id); ++i) {
+            where(index.definition(id, i));
+            out.append("defined\n");
+            next();
+        }
+        for (uint32_t i = 0; i < index.useCount(id); ++i) {
+            const symbols::Use& use = index.use(id, i);
+            if (!uses && use.kind() != symbols::UseKind::CALL) { continue; }
+            where(use.line());
+            if (uses) {
+                out.append(symbols::USE_KIND_NAMES[static_cast<size_t>(use.kind())]).append(" in ");
+            } else {
+                out.append("called from ");
+            }
+            out.append(functionOf(use)).push_back('\n');
+            next();
+        }
+        break;
+    }
+    case XrefQuery::UNUSED:
+    case XrefQuery::UNDEFINED: {
+        // by line, as the file has them
+        std::vector<std::pair<uint32_t, uint32_t>> found;
+        for (uint32_t id = 0; id < info.symbolCount; ++id) {
+            const symbols::Symbol& symbol = index.symbol(id);
+            if (options.query == XrefQuery::UNUSED) {
+                // numbered labels are used as 1f or 1b, which aren't told apart
+                std::string_view label = index.name(id);
+                if ((symbol.flags & symbols::LABEL) == 0 || (symbol.flags & symbols::GLOBAL) != 0 || index.useCount(id) != 0 ||
+                    index.definitions(id) == 0 || label.empty() || std::isdigit(static_cast<unsigned char>(label[0])) != 0 || symbols::isMarker(label)) {
+                    continue;
+                }
+                found.emplace_back(index.definition(id, 0), id);
+            } else if ((symbol.flags & (symbols::DEFINED | symbols::EXTERNAL)) == 0) {
+                for (uint32_t i = 0; i < index.useCount(id); ++i) {
+                    if (index.use(id, i).kind() != symbols::UseKind::REFERENCE) {
+                        found.emplace_back(index.use(id, i).line(), id);
+                        break;
+                    }
+                }
+            }
+        }
+        std::sort(found.begin(), found.end());
+        for (const auto& [line, id] : found) {
+            where(line);
+            out.append(index.name(id));
+            if (options.query == XrefQuery::UNDEFINED) {
+                uint32_t targets = 0;
+                for (uint32_t i = 0; i < index.useCount(id); ++i) { targets += index.use(id, i).kind() != symbols::UseKind::REFERENCE ? 1 : 0; }
+                out.append(" (");
+                appendNumber(targets, out);
+                out.append(targets == 1 ? " call or jump)" : " calls or jumps)");
+            }
+            out.push_back('\n');
+            next();
+        }
+        break;
+    }
+    case XrefQuery::NONE: break;
+    }
+    output.write(out.view());
+    out.clear();
+    if (!output.good()) {
+        result.error = "Cannot write the output";
+        return result;
+    }
+
+    result.ok = true;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return result;
+}
+
+// appends what the next read of the input brings to the buffer, false if reading failed
+static auto readInput(int input, std::vector<char>& buffer, size_t& filled, bool& eof) -> bool {
+    if (buffer.size() - filled < FILTER_READ_SIZE) { buffer.resize(filled + FILTER_READ_SIZE); }
+    while (true) {
+#ifdef _WIN32
+        int count = _read(input, buffer.data() + filled, static_cast<unsigned>(FILTER_READ_SIZE));
+#else
+        ssize_t count = ::read(input, buffer.data() + filled, FILTER_READ_SIZE);
+        if (count < 0 && errno == EINTR) { continue; }
+#endif
+        if (count < 0) { return false; }
+        stats::mark(stats::READ);
+        eof = count == 0;
+        filled += static_cast<size_t>(count);
+        return true;
+    }
+}
+
+/**
+  Annotates a stream with one backend, from what was read while looking for the architecture on
+  (Output is an OutputFile or a compression::Writer). Returns early when the output fails.
+ *
+  @param read Appends what comes next to the buffer: read(buffer, filled, eof), false (with the
+  error in `result`) when reading failed.
+  @param buffer Holds the `filled` bytes read but not annotated yet.
+  @param eof Whether the input already ended.
+  @param options The size of the memo and the profile.
+  @param output Receives the annotated lines.
+  @param result Receives the line and byte counts, or the error.
+ */
+template <typename Isa, typename Output, typename Read>
+static auto annotateStream(Read& read, std::vector<char>& buffer, size_t filled, bool eof, const Options& options, Output& output,
+    FileResult& result) -> void {
+    OutputBuffer out(FILTER_READ_SIZE * 2);
+    using Analysis = typename Isa::Analysis;
+    ir::Block block;
+    ir::Block separate; // the profile's samples go by the lines as Analysis tokenizes them
+    ir::Block& analysis = std::is_same_v<Isa, Analysis> ? block : separate;
+    bool analyzed = !std::is_same_v<Isa, Analysis> && options.profile != nullptr;
+    LineMemo& memo = threadMemo<Isa>(options.memoLines);
+    ProfileOverlay overlay{ options.profile.get() };
+    auto drain = [&] {
+        for (size_t i = 0; i < block.lines(); ++i) {
+            if (overlay.profile == nullptr) {
+                formatLine<Isa>(block, i, memo, out);
+                continue;
+            }
+            writeProfileSummary<Isa>(overlay, block, i, out);
+            size_t end = out.size() + block.line(i).size();
+            formatLine<Isa>(block, i, memo, out);
+            addSamples(overlay, lineSamples<Analysis>(overlay, analysis, i), end, out);
+        }
+        result.lines += block.lines();
+        if (stats::COMPILED && stats::enabled) { countLines(block); }
+        block.reset(block.source());
+        if (analyzed) { separate.reset(block.source()); }
+        memo.reset();
+    };
+
+    while (true) {
+        // complete lines only, the last one may still be arriving
+        std::string_view text(buffer.data(), filled);
+        size_t complete = eof ? text.size() : text.rfind('\n') + 1;
+
+        // the buffer moves below, so every block is drained before that
+        block.reset(text);
+        if (analyzed) { separate.reset(text); }
+        scan::LineScanner lines(text.substr(0, complete));
+        scan::LineMap line;
+        while (lines.next(line)) {
+            tokenizeLine<Isa>(line, block, memo);
+            if (analyzed) { tokenizeLine<Analysis>(line, separate); }
+            if (block.lines() == BLOCK_LINES) { drain(); }
+        }
+        drain();
+        std::memmove(buffer.data(), buffer.data() + complete, filled - complete);
+        filled -= complete;
+
+        if (!out.empty()) {
+            output.write(out.view());
+            out.clear();
+            stats::mark(stats::WRITE);
+        }
+        if (!output.good() || eof) { return; }
+
+        size_t before = filled;
+        if (!read(buffer, filled, eof)) { return; }
+        result.bytes += filled - before;
+    }
+}
+
+/**
+  Writes the annotated copy of a compressed file and its records while it's being decompressed,
+  a chunk at a time as it comes out (Output is a compression::Writer).
+ *
+  @param inflated The file, being decompressed.
+  @param source Its path, included files are looked for next to it.
+  @param options The options.
+  @param pool Helps with big texts, may be null.
+  @param newFile Receives the annotated copy.
+  @param recordFile Receives the records, if any were requested.
+  @param xref Receives the symbols, may be null.
+  @param result Receives the line and byte counts and the architecture, or the error.
+ */
+template <typename Output>
+static auto annotateCompressed(compression::Reader& inflated, const std::filesystem::path& source, const Options& options, ThreadPool* pool,
+    Output& newFile, Output& recordFile, symbols::Index* xref, FileResult& result) -> void {
+    // records, flow and include summaries and symbols go through the text as a whole, it's collected first
+    if (options.records != records::Format::NONE || options.cfg || options.includes || xref != nullptr) {
+        std::string text;
+        if (!inflated.readAll(text)) {
+            result.error = inflated.error();
+            return;
+        }
+        stats::mark(stats::READ);
+        annotateText(text, nullptr, source, options, pool, newFile, recordFile, xref, result);
+        return;
+    }
+
+    std::vector<char> buffer;
+    size_t filled = 0;
+    bool eof = false;
+    std::string chunk;
+    auto read = [&](std::vector<char>& into, size_t& used, bool& end) {
+        end = !inflated.next(chunk);
+        if (end) {
+            result.error = inflated.error();
+            return result.error.empty();
+        }
+        if (into.size() - used < chunk.size()) { into.resize(used + chunk.size()); }
+        std::memcpy(into.data() + used, chunk.data(), chunk.size());
+        used += chunk.size();
+        stats::mark(stats::READ);
+        return true;
+    };
+
+    // the header names the architecture, so the text is held until a marker shows up: it's the
+    // same as scanning the whole text, which a file without one ends up doing
+    ArchDetector detector;
+    size_t scanned = 0;
+    while (options.architecture.empty() && !eof && !detector.detected()) {
+        if (!read(buffer, filled, eof)) { return; }
+        std::string_view text(buffer.data(), filled);
+        size_t complete = eof ? text.size() : text.rfind('\n') + 1;
+        if (complete > scanned) {
+            detector.feedText(text.substr(scanned, complete - scanned));
+            scanned = complete;
+        }
+        stats::mark(stats::DETECT);
+    }
+    result.bytes = filled;
+    result.architecture = options.architecture.empty() ? detector.name() : options.architecture;
+
+    if (options.header) {
+        OutputBuffer header;
+        writeHeader(header, result.architecture);
+        newFile.write(header.view());
+    }
+    isa::dispatch(result.architecture, [&](auto backend) {
+        annotateStream<decltype(backend)>(read, buffer, filled, eof, options, newFile, result);
+    });
+}
+
+auto analyzeStream(int input, const Options& options, OutputFile& output) -> FileResult {
+    FileResult result;
+    auto begin = std::chrono::steady_clock::now();
+    stats::start();
+#ifdef _WIN32
+    _setmode(input, _O_BINARY);
+#endif
+
+    // input is read as it arrives and everything complete is annotated and written right away, so
+    // memory stays at about one read plus the longest line
+    std::vector<char> buffer(FILTER_READ_SIZE);
+    size_t filled = 0;
+    bool eof = false;
+
+    // except at the start: the header names the architecture and a pipe can't be patched
+    // afterwards, and the backend depends on it too, so input is held until a marker shows up, for
+    // at most FILTER_LOOKAHEAD bytes or until the producer stalls
+    ArchDetector detector;
+    size_t scanned = 0;
+    while (!eof && !detector.detected() && filled < FILTER_LOOKAHEAD) {
+#ifndef _WIN32
+        if (scanned != 0) {
+            pollfd ready{ input, POLLIN, 0 };
+            if (poll(&ready, 1, 0) == 0) { break; }
+        }
+#endif
+        if (!readInput(input, buffer, filled, eof)) {
+            result.error = "Cannot read stdin";
+            return result;
+        }
+        std::string_view text(buffer.data(), filled);
+        size_t complete = eof ? text.size() : text.rfind('\n') + 1;
+        if (complete > scanned) {
+            detector.feedText(text.substr(scanned, complete - scanned));
+            scanned = complete;
+        }
+        stats::mark(stats::DETECT);
+    }
+    result.bytes = filled;
+    result.architecture = detector.name();
+
+    OutputBuffer header;
+    writeHeader(header, detector.name());
+    output.write(header.view());
+    auto read = [&](std::vector<char>& into, size_t& used, bool& end) {
+        if (readInput(input, into, used, end)) { return true; }
+        result.error = "Cannot read stdin";
+        return false;
+    };
+    isa::dispatch(detector.name(), [&](auto backend) {
+        annotateStream<decltype(backend)>(read, buffer, filled, eof, options, output, result);
+    });
+    if (result.error.empty() && !output.good()) { result.error = "Cannot write stdout"; }
+    if (!result.error.empty()) { return result; }
+    stats::count(stats::FILES);
+    stats::count(stats::BYTES_IN, result.bytes);
+    stats::count(stats::BYTES_OUT, output.written());
+
+    result.ok = true;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return result;
+}
+
+auto isDirective(std::string_view opcode) -> bool {
+    return !opcode.empty() && opcode[0] == '.';
+}
+
+auto isMemoryAddressingMode(std::string_view operand) -> bool {
+    return !operand.empty() && isa::X86::isMemory(operand);
+}
+
+auto getOperand(std::string_view line) -> std::string_view {
+    size_t wPos = line.find(' ');
+    if (wPos == std::string_view::npos) {
+        return {};
+    }
+
+    std::string_view operand = line.substr(wPos + 1);
+    size_t trailingWPos = operand.find_last_not_of(' ');
+    if (trailingWPos != std::string_view::npos) {
+        operand = operand.substr(0, trailingWPos + 1);
+    }
+
+    return operand;
+}
+
+/**
+  How a directive is described: `before`, then (depending on `value`) the operand, then `after`.
+ */
+struct DirectiveFormat {
+    enum Value : std::uint8_t { NOTHING, OPERAND, STRING };
+    std::string_view before;
+    std::string_view after;
+    Value value = NOTHING;
+};
+
+constexpr static auto DIRECTIVE_FORMATS = [] {
+    std::array<DirectiveFormat, DIRECTIVE_COUNT> formats{};
+    auto set = [&](Directive id, DirectiveFormat format) { formats[static_cast<size_t>(id)] = format; };
+    set(Directive::STRING, { "string constant ", " declared", DirectiveFormat::STRING });
+    set(Directive::DATA, { "Data section declared", "" });
+    set(Directive::BSS, { "BSS (uninitialized data) section declared", "" });
+    set(Directive::TEXT, { "Text (code) section declared", "" });
+    set(Directive::GLOBL, { "Global symbol ", " declared", DirectiveFormat::OPERAND });
+    set(Directive::GLOBAL, { "Global symbol ", " declared", DirectiveFormat::OPERAND });
+    set(Directive::ALIGN, { "Align to ", " bytes", DirectiveFormat::OPERAND });
+    set(Directive::BYTE, { "Byte value ", " declared", DirectiveFormat::OPERAND });
+    set(Directive::WORD, { "Word value ", " declared", DirectiveFormat::OPERAND });
+    set(Directive::DWORD, { "Double word value ", " declared", DirectiveFormat::OPERAND });
+    set(Directive::QUAD, { "Quad word (64-bit) value ", " declared", DirectiveFormat::OPERAND });
+    set(Directive::SECTION, { "Section ", " declared", DirectiveFormat::OPERAND });
+    set(Directive::EQU, { "Constant ", " defined", DirectiveFormat::OPERAND });
+    set(Directive::SET, { "Constant ", " defined", DirectiveFormat::OPERAND });
+    set(Directive::ORG, { "Set origin to address ", "", DirectiveFormat::OPERAND });
+    set(Directive::RESERVE, { "Reserve ", " bytes", DirectiveFormat::OPERAND });
+    set(Directive::SPACE, { "Reserve ", " bytes", DirectiveFormat::OPERAND });
+    set(Directive::FILE, { "File name set to ", "", DirectiveFormat::OPERAND });
+    set(Directive::COMM, { "Common block ", " declared", DirectiveFormat::OPERAND });
+    set(Directive::END, { "End of assembly", "" });
+    set(Directive::INCBIN, { "Include binary file ", "", DirectiveFormat::OPERAND });
+    set(Directive::INCLUDE, { "Include source file ", "", DirectiveFormat::OPERAND });
+    set(Directive::NASM_INCLUDE, { "Include source file ", "", DirectiveFormat::OPERAND });
+    return formats;
+}();
+
+auto analyzeDirective(Directive id, std::string_view directive, std::string_view operand, OutputBuffer& comment) -> void {
+    if (id == Directive::NONE) {
+        comment.append("Unknown directive: ").append(directive);
+        return;
+    }
+
+    const DirectiveFormat& format = DIRECTIVE_FORMATS[static_cast<size_t>(id)];
+    comment.append(format.before);
+    if (format.value == DirectiveFormat::OPERAND) {
+        comment.append(operand);
+    } else if (format.value == DirectiveFormat::STRING) {
+        std::string_view value = trim(operand);
+        comment.append(value.size() >= EIGHT ? value.substr(EIGHT) : value);
+    }
+    comment.append(format.after);
+}
+
+auto analyzeLine(std::string_view line, OutputBuffer& comment) -> void {
+    thread_local scan::TextMap map;
+    map.build(line);
+    analyzeLine(scan::LineMap(map, line, 0), comment);
+}
+
+auto analyzeLine(const scan::LineMap& map, OutputBuffer& comment) -> void {
+    thread_local ir::Block block;
+    block.reset(map.text());
+    tokenizeLine(map, block);
+    annotateLine(block, 0, comment);
+}
+
+auto countLines(const ir::Block& block) -> void {
+    for (size_t i = 0; i < block.lines(); ++i) {
+        uint16_t id = block.opcode[i];
+        switch (block.kind[i]) {
+        case records::LineKind::BLANK: stats::count(stats::BLANK_LINES); break;
+        case records::LineKind::LABEL: stats::count(stats::LABELS); break;
+        case records::LineKind::INSTRUCTION: stats::count(static_cast<Instruction>(id)); break;
+        case records::LineKind::DIRECTIVE: stats::count(id == records::NO_OPCODE ? Directive::NONE : static_cast<Directive>(id)); break;
+        case records::LineKind::UNKNOWN: stats::count(stats::UNKNOWN_INSTRUCTIONS); break;
+        }
+    }
+}
+
+auto describeLine(const ir::Block& block, size_t line, records::Record& record) -> std::string_view {
+    record.kind = block.kind[line];
+    record.length = block.length[line];
+    record.opcode = block.opcode[line];
+    size_t count = block.operandCount(line);
+    record.operandCount = static_cast<uint8_t>(std::min<size_t>(count, UINT8_MAX));
+    for (size_t i = 0; i < count && i < records::MAX_OPERANDS; ++i) {
+        record.operands[i] = block.operandKind[block.firstOperand[line] + i];
+    }
+    return block.view(line, block.name[line]);
+}
+
+/**
+  Appends the description of an instruction, returns false when it can't describe this form of
+  it (the caller then reports it as unknown).
+ */
+struct InstructionFormat;
+using InstructionHandler = auto (*)(const InstructionContext& context, const InstructionFormat& format, OutputBuffer& comment) -> bool;
+
+/**
+  An instruction handler and the text it wraps around the operand.
+ */
+struct InstructionFormat {
+    InstructionHandler handler = nullptr;
+    std::string_view before;
+    std::string_view after;
+    scan::Class separator = scan::NEWLINE; // what the tokenizer splits the operands on (no line holds a newline: nothing)
+};
+
+// before + everything after the mnemonic + after
+static auto describeOperands(const InstructionContext& context, const InstructionFormat& format, OutputBuffer& comment) -> bool {
+    comment.append(format.before).append(context.operands).append(format.after);
+    return true;
+}
+
+// before + everything after the first space of the raw line + after
+static auto describeLineOperand(const InstructionContext& context, const InstructionFormat& format, OutputBuffer& comment) -> bool {
+    comment.append(format.before).append(context.lineOperand).append(format.after);
+    return true;
+}
+
+static auto describeFixed(const InstructionContext& /*context*/, const InstructionFormat& format, OutputBuffer& comment) -> bool {
+    comment.append(format.before);
+    return true;
+}
+
+static auto describeInterrupt(const InstructionContext& context, const InstructionFormat& /*format*/, OutputBuffer& comment) -> bool {
+    std::string_view operand = context.operands.substr(0, context.split);
+    if (operand.find("0x") != 0) { return false; }
+    comment.append("Instruction: int | Interrupt: ").append(operand);
+    return true;
+}
+
+// mov/add/sub: destination and source separated by a comma
+static auto describeCommaPair(const InstructionContext& context, const InstructionFormat& /*format*/, OutputBuffer& comment) -> bool {
+    size_t comma = context.split;
+    if (comma == std::string_view::npos) { return false; }
+    std::string_view destOperand = context.operands.substr(0, comma);
+    std::string_view srcOperand = context.operands.substr(comma + 1);
+
+    comment.append("Instruction: ").append(context.opcode).append(" | Destination: ");
+    analyzeOperand(destOperand, context.kindOf(destOperand), comment, true);
+    comment.append(" | Source:");
+    analyzeOperand(srcOperand, context.kindOf(srcOperand), comment, true);
+    return true;
+}
+
+// cmp/mul/div: destination and source split on the first space
+static auto describeSpacedPair(const InstructionContext& context, const InstructionFormat& /*format*/, OutputBuffer& comment) -> bool {
+    size_t space = context.split;
+    std::string_view destOperand = context.operands.substr(0, space);
+    std::string_view srcOperand = space == std::string_view::npos ? context.operands : context.operands.substr(space + 1);
+
+    comment.append("Instruction: ").append(context.opcode).append(" | Destination: ");
+    analyzeOperand(destOperand, context.kindOf(destOperand), comment, true);
+    comment.append(" | Source: ");
+    analyzeOperand(srcOperand, context.kindOf(srcOperand), comment, true);
+    return true;
+}
+
+// operands [from, to) of the line, as "x0 (Register), 16 (Immediate)"
+static auto describeOperandList(const InstructionContext& context, size_t from, size_t to, OutputBuffer& comment) -> void {
+    for (size_t i = from; i < to; ++i) {
+        if (i != from) { comment.append(", "); }
+        analyzeOperand(context.operand(i), context.operandKind(i), comment, true);
+    }
+}
+
+// the first operand is written, the others are read: add x0, x1, x2 and loads
+static auto describeDestinationFirst(const InstructionContext& context, const InstructionFormat& /*format*/, OutputBuffer& comment) -> bool {
+    size_t count = context.operandCount();
+    if (count == 0) { return false; }
+    comment.append("Instruction: ").append(context.opcode).append(" | Destination: ");
+    describeOperandList(context, 0, 1, comment);
+    if (count > 1) {
+        comment.append(count == 2 ? " | Source: " : " | Sources: ");
+        describeOperandList(context, 1, count, comment);
+    }
+    return true;
+}
+
+// the first two operands are written: paired loads (ldp x29, x30, [sp], 16)
+static auto describeDestinationPair(const InstructionContext& context, const InstructionFormat& format, OutputBuffer& comment) -> bool {
+    size_t count = context.operandCount();
+    if (count < 3) { return describeDestinationFirst(context, format, comment); }
+    comment.append("Instruction: ").append(context.opcode).append(" | Destinations: ");
+    describeOperandList(context, 0, 2, comment);
+    comment.append(count == 3 ? " | Source: " : " | Sources: ");
+    describeOperandList(context, 2, count, comment);
+    return true;
+}
+
+// the last operand is written: stores (str x0, [sp, 8]) and everything on SPARC
+static auto describeDestinationLast(const InstructionContext& context, const InstructionFormat& /*format*/, OutputBuffer& comment) -> bool {
+    size_t count = context.operandCount();
+    if (count == 0) { return false; }
+    comment.append("Instruction: ").append(context.opcode);
+    if (count > 1) {
+        comment.append(count == 2 ? " | Source: " : " | Sources: ");
+        describeOperandList(context, 0, count - 1, comment);
+    }
+    comment.append(" | Destination: ");
+    describeOperandList(context, count - 1, count, comment);
+    return true;
+}
+
+// no operand is written (MIPS mult, the results go to hi and lo)
+static auto describeOperation(const InstructionContext& context, const InstructionFormat& /*format*/, OutputBuffer& comment) -> bool {
+    size_t count = context.operandCount();
+    if (count == 0) { return false; }
+    comment.append("Instruction: ").append(context.opcode).append(" | Operands: ");
+    describeOperandList(context, 0, count, comment);
+    return true;
+}
+
+static auto describeCompare(const InstructionContext& context, const InstructionFormat& /*format*/, OutputBuffer& comment) -> bool {
+    size_t count = context.operandCount();
+    if (count == 0) { return false; }
+    comment.append("Instruction: ").append(context.opcode).append(" | Compared: ");
+    describeOperandList(context, 0, count, comment);
+    return true;
+}
+
+// jump to the last operand + after, and what the others are (cbz x0, .L2 or beq a0,a1,.L2)
+static auto describeBranch(const InstructionContext& context, const InstructionFormat& format, OutputBuffer& comment) -> bool {
+    size_t count = context.operandCount();
+    if (count == 0) { return false; }
+    comment.append(context.opcode).append(" instruction: jumped to ").append(context.operand(count - 1)).append(format.after);
+    if (count > 1) {
+        comment.append(" | Compared: ");
+        describeOperandList(context, 0, count - 1, comment);
+    }
+    return true;
+}
+
+// call of the last operand (bl puts, jal ra,puts)
+static auto describeCall(const InstructionContext& context, const InstructionFormat& /*format*/, OutputBuffer& comment) -> bool {
+    size_t count = context.operandCount();
+    if (count == 0) { return false; }
+    // the target is the symbol (SPARC's "call puts, 0" puts it first), else the last operand
+    size_t target = count - 1;
+    for (size_t i = 0; i < count; ++i) {
+        if (context.operandKind(i) == records::OperandKind::LABEL) { target = i; break; }
+    }
+    comment.append(context.opcode).append(" instruction: called ").append(context.operand(target));
+    return true;
+}
+
+// the formats of the instructions of a backend, by id (mnemonics it doesn't have stay empty)
+template <typename Isa>
+constexpr std::array<InstructionFormat, INSTRUCTION_COUNT> INSTRUCTION_FORMATS{};
+
+template <>
+constexpr std::array<InstructionFormat, INSTRUCTION_COUNT> INSTRUCTION_FORMATS<isa::X86> = [] {
+    std::array<InstructionFormat, INSTRUCTION_COUNT> formats{};
+    auto set = [&](Instruction id, InstructionFormat format) { formats[static_cast<size_t>(id)] = format; };
+    set(Instruction::GLOBAL, { describeOperands, "Declare global symbol ", "" });
+    set(Instruction::LEN, { describeOperands, "Calculate length of ", "" });
+    set(Instruction::INT, { describeInterrupt, "", "", scan::SPACE });
+    set(Instruction::PUSH, { describeLineOperand, "push instruction: pushed ", " into stack" });
+    for (Instruction id : { Instruction::MOV, Instruction::MOVQ, Instruction::ADD, Instruction::ADDQ, Instruction::SUB, Instruction::SUBQ }) {
+        set(id, { describeCommaPair, "", "", scan::COMMA });
+    }
+    set(Instruction::JMP, { describeLineOperand, "jmp instruction: jumped to ", "" });
+    set(Instruction::CALL, { describeLineOperand, "call instruction: called ", "" });
+    set(Instruction::RET, { describeFixed, "ret instruction: returned from function", "" });
+    set(Instruction::NOP, { describeFixed, "no operation", "" });
+    for (Instruction id : { Instruction::CMP, Instruction::MUL, Instruction::DIV }) {
+        set(id, { describeSpacedPair, "", "", scan::SPACE });
+    }
+    set(Instruction::JE, { describeLineOperand, "je instruction: jumped to ", " if equal" });
+    set(Instruction::JNE, { describeLineOperand, "jne instruction: jumped to ", " if not equal" });
+    set(Instruction::JG, { describeLineOperand, "jg instruction: jumped to ", " if greater" });
+    set(Instruction::JGE, { describeLineOperand, "jge instruction: jumped to ", " if greater or equal" });
+    set(Instruction::JL, { describeLineOperand, "jl instruction: jumped to ", " if less" });
+    set(Instruction::JLE, { describeLineOperand, "jle instruction: jumped to ", " if less or equal" });
+    set(Instruction::JA, { describeLineOperand, "ja instruction: jumped to ", " if above (unsigned)" });
+    set(Instruction::JAE, { describeLineOperand, "jae instruction: jumped to ", " if above or equal (unsigned)" });
+    set(Instruction::JB, { describeLineOperand, "jb instruction: jumped to ", " if below (unsigned)" });
+    set(Instruction::JBE, { describeLineOperand, "jbe instruction: jumped to ", " if below or equal (unsigned)" });
+    set(Instruction::JZ, { describeLineOperand, "jz instruction: jumped to ", " if zero" });
+    set(Instruction::JNZ, { describeLineOperand, "jnz instruction: jumped to ", " if not zero" });
+    set(Instruction::JS, { describeLineOperand, "js instruction: jumped to ", " if negative" });
+    set(Instruction::JNS, { describeLineOperand, "jns instruction: jumped to ", " if not negative" });
+    set(Instruction::LOOP, { describeLineOperand, "loop instruction: decremented the count and jumped to ", " if it isn't zero" });
+    set(Instruction::INC, { describeLineOperand, "inc instruction: incremented ", "" });
+    set(Instruction::DEC, { describeLineOperand, "dec instruction: decremented ", "" });
+    return formats;
+}();
+
+template <>
+constexpr std::array<InstructionFormat, INSTRUCTION_COUNT> INSTRUCTION_FORMATS<isa::Arm> = [] {
+    std::array<InstructionFormat, INSTRUCTION_COUNT> formats{};
+    auto set = [&](Instruction id, InstructionFormat format) { formats[static_cast<size_t>(id)] = format; };
+    for (Instruction id : { Instruction::MOV, Instruction::MOVK, Instruction::MOVZ, Instruction::MVN, Instruction::ADD, Instruction::ADDS,
+             Instruction::SUB, Instruction::SUBS, Instruction::MUL, Instruction::MADD, Instruction::MSUB, Instruction::SDIV, Instruction::UDIV,
+             Instruction::NEG, Instruction::AND, Instruction::ORR, Instruction::EOR, Instruction::LSL, Instruction::LSR, Instruction::ASR,
+             Instruction::CSEL, Instruction::CSET, Instruction::LDR, Instruction::LDRB, Instruction::LDRH, Instruction::LDRSW, Instruction::LDUR,
+             Instruction::ADRP, Instruction::ADR, Instruction::SXTW, Instruction::UXTW, Instruction::FMOV, Instruction::FADD, Instruction::FSUB,
+             Instruction::FMUL, Instruction::FDIV, Instruction::SCVTF, Instruction::FCVTZS }) {
+        set(id, { describeDestinationFirst, "", "" });
+    }
+    for (Instruction id : { Instruction::LDP, Instruction::LDNP }) {
+        set(id, { describeDestinationPair, "", "" });
+    }
+    for (Instruction id : { Instruction::STR, Instruction::STRB, Instruction::STRH, Instruction::STP, Instruction::STNP, Instruction::STUR }) {
+        set(id, { describeDestinationLast, "", "" });
+    }
+    for (Instruction id : { Instruction::CMP, Instruction::CMN, Instruction::TST }) {
+        set(id, { describeCompare, "", "" });
+    }
+    for (Instruction id : { Instruction::B, Instruction::BR, Instruction::BX }) {
+        set(id, { describeBranch, "", "" });
+    }
+    set(Instruction::B_EQ, { describeBranch, "", " if equal" });
+    set(Instruction::B_NE, { describeBranch, "", " if not equal" });
+    set(Instruction::B_LT, { describeBranch, "", " if less" });
+    set(Instruction::B_LE, { describeBranch, "", " if less or equal" });
+    set(Instruction::B_GT, { describeBranch, "", " if greater" });
+    set(Instruction::B_GE, { describeBranch, "", " if greater or equal" });
+    set(Instruction::B_HI, { describeBranch, "", " if higher (unsigned)" });
+    set(Instruction::B_LS, { describeBranch, "", " if lower or same (unsigned)" });
+    set(Instruction::B_CS, { describeBranch, "", " if carry set" });
+    set(Instruction::B_CC, { describeBranch, "", " if carry clear" });
+    set(Instruction::B_MI, { describeBranch, "", " if negative" });
+    set(Instruction::B_PL, { describeBranch, "", " if positive or zero" });
+    // the A32 spellings
+    set(Instruction::BEQ, { describeBranch, "", " if equal" });
+    set(Instruction::BNE, { describeBranch, "", " if not equal" });
+    set(Instruction::BLT, { describeBranch, "", " if less" });
+    set(Instruction::BLE, { describeBranch, "", " if less or equal" });
+    set(Instruction::BGT, { describeBranch, "", " if greater" });
+    set(Instruction::BGE, { describeBranch, "", " if greater or equal" });
+    set(Instruction::CBZ, { describeBranch, "", " if zero" });
+    set(Instruction::CBNZ, { describeBranch, "", " if not zero" });
+    set(Instruction::TBZ, { describeBranch, "", " if the bit is clear" });
+    set(Instruction::TBNZ, { describeBranch, "", " if the bit is set" });
+    set(Instruction::BL, { describeCall, "", "" });
+    set(Instruction::BLR, { describeCall, "", "" });
+    set(Instruction::RET, { describeFixed, "ret instruction: returned from function", "" });
+    set(Instruction::PUSH, { describeOperands, "push instruction: pushed ", " into stack" });
+    set(Instruction::POP, { describeOperands, "pop instruction: popped ", " from stack" });
+    set(Instruction::NOP, { describeFixed, "no operation", "" });
+    set(Instruction::SVC, { describeOperands, "Supervisor call ", "" });
+    return formats;
+}();
+
+template <>
+constexpr std::array<InstructionFormat, INSTRUCTION_COUNT> INSTRUCTION_FORMATS<isa::Mips> = [] {
+    std::array<InstructionFormat, INSTRUCTION_COUNT> formats{};
+    auto set = [&](Instruction id, InstructionFormat format) { formats[static_cast<size_t>(id)] = format; };
+    for (Instruction id : { Instruction::MOVE, Instruction::LI, Instruction::LA, Instruction::LUI, Instruction::ADD, Instruction::ADDU,
+             Instruction::ADDIU, Instruction::SUB, Instruction::SUBU, Instruction::DADDIU, Instruction::DADDU, Instruction::MUL,
+             Instruction::MFLO, Instruction::MFHI, Instruction::NEG, Instruction::NEGU, Instruction::NOT, Instruction::AND, Instruction::ANDI,
+             Instruction::OR, Instruction::ORI, Instruction::XOR, Instruction::XORI, Instruction::NOR, Instruction::SLL, Instruction::SRL,
+             Instruction::SRA, Instruction::SLT, Instruction::SLTI, Instruction::SLTU, Instruction::SLTIU, Instruction::LW, Instruction::LB,
+             Instruction::LBU, Instruction::LH, Instruction::LHU, Instruction::LD, Instruction::LWC1 }) {
+        set(id, { describeDestinationFirst, "", "" });
+    }
+    for (Instruction id : { Instruction::SW, Instruction::SB, Instruction::SH, Instruction::SD, Instruction::SWC1 }) {
+        set(id, { describeDestinationLast, "", "" });
+    }
+    for (Instruction id : { Instruction::MULT, Instruction::MULTU, Instruction::DIV, Instruction::DIVU }) {
+        set(id, { describeOperation, "", "" });
+    }
+    for (Instruction id : { Instruction::B, Instruction::J, Instruction::JR }) {
+        set(id, { describeBranch, "", "" });
+    }
+    set(Instruction::BEQ, { describeBranch, "", " if equal" });
+    set(Instruction::BNE, { describeBranch, "", " if not equal" });
+    set(Instruction::BEQZ, { describeBranch, "", " if zero" });
+    set(Instruction::BNEZ, { describeBranch, "", " if not zero" });
+    set(Instruction::BLTZ, { describeBranch, "", " if negative" });
+    set(Instruction::BGEZ, { describeBranch, "", " if positive or zero" });
+    set(Instruction::BLEZ, { describeBranch, "", " if negative or zero" });
+    set(Instruction::BGTZ, { describeBranch, "", " if positive" });
+    set(Instruction::JAL, { describeCall, "", "" });
+    set(Instruction::JALR, { describeCall, "", "" });
+    set(Instruction::NOP, { describeFixed, "no operation", "" });
+    set(Instruction::SYSCALL, { describeFixed, "System call", "" });
+    return formats;
+}();
+
+template <>
+constexpr std::array<InstructionFormat, INSTRUCTION_COUNT> INSTRUCTION_FORMATS<isa::PowerPc> = [] {
+    std::array<InstructionFormat, INSTRUCTION_COUNT> formats{};
+    auto set = [&](Instruction id, InstructionFormat format) { formats[static_cast<size_t>(id)] = format; };
+    for (Instruction id : { Instruction::LI, Instruction::LIS, Instruction::LA, Instruction::MR, Instruction::ADDI, Instruction::ADDIS,
+             Instruction::ADD, Instruction::SUBF, Instruction::SUBFIC, Instruction::NEG, Instruction::MULLW, Instruction::MULLD,
+             Instruction::MULLI, Instruction::DIVW, Instruction::DIVWU, Instruction::DIVD, Instruction::AND, Instruction::OR, Instruction::ORI,
+             Instruction::XOR, Instruction::XORI, Instruction::NOR, Instruction::SLWI, Instruction::SRWI, Instruction::SLDI, Instruction::SRDI,
+             Instruction::SRAW, Instruction::SRAWI, Instruction::EXTSW, Instruction::RLWINM, Instruction::LWZ, Instruction::LBZ,
+             Instruction::LHZ, Instruction::LHA, Instruction::LWA, Instruction::LD, Instruction::LFD, Instruction::LFS }) {
+        set(id, { describeDestinationFirst, "", "" });
+    }
+    for (Instruction id : { Instruction::STW, Instruction::STB, Instruction::STH, Instruction::STD, Instruction::STWU, Instruction::STDU,
+             Instruction::STFD, Instruction::STFS }) {
+        set(id, { describeDestinationLast, "", "" });
+    }
+    for (Instruction id : { Instruction::CMPW, Instruction::CMPWI, Instruction::CMPLW, Instruction::CMPLWI, Instruction::CMPD, Instruction::CMPDI }) {
+        set(id, { describeCompare, "", "" });
+    }
+    set(Instruction::MFLR, { describeOperands, "Move the link register to ", "" });
+    set(Instruction::MTLR, { describeOperands, "Move ", " to the link register" });
+    set(Instruction::MTCTR, { describeOperands, "Move ", " to the count register" });
+    set(Instruction::B, { describeBranch, "", "" });
+    set(Instruction::BEQ, { describeBranch, "", " if equal" });
+    set(Instruction::BNE, { describeBranch, "", " if not equal" });
+    set(Instruction::BLT, { describeBranch, "", " if less" });
+    set(Instruction::BGT, { describeBranch, "", " if greater" });
+    set(Instruction::BLE, { describeBranch, "", " if less or equal" });
+    set(Instruction::BGE, { describeBranch, "", " if greater or equal" });
+    set(Instruction::BL, { describeCall, "", "" });
+    set(Instruction::BLR, { describeFixed, "blr instruction: returned from function", "" });
+    set(Instruction::BCTR, { describeFixed, "bctr instruction: jumped to the count register", "" });
+    set(Instruction::BCTRL, { describeFixed, "bctrl instruction: called the count register", "" });
+    set(Instruction::NOP, { describeFixed, "no operation", "" });
+    set(Instruction::SC, { describeFixed, "System call", "" });
+    return formats;
+}();
+
+template <>
+constexpr std::array<InstructionFormat, INSTRUCTION_COUNT> INSTRUCTION_FORMATS<isa::RiscV> = [] {
+    std::array<InstructionFormat, INSTRUCTION_COUNT> formats{};
+    auto set = [&](Instruction id, InstructionFormat format) { formats[static_cast<size_t>(id)] = format; };
+    for (Instruction id : { Instruction::LI, Instruction::LA, Instruction::LUI, Instruction::AUIPC, Instruction::MV, Instruction::ADD,
+             Instruction::ADDI, Instruction::ADDW, Instruction::ADDIW, Instruction::SUB, Instruction::SUBW, Instruction::NEG, Instruction::NEGW,
+             Instruction::MUL, Instruction::MULW, Instruction::DIV, Instruction::DIVU, Instruction::DIVW, Instruction::REM, Instruction::REMU,
+             Instruction::REMW, Instruction::AND, Instruction::ANDI, Instruction::OR, Instruction::ORI, Instruction::XOR, Instruction::XORI,
+             Instruction::NOT, Instruction::SLL, Instruction::SLLI, Instruction::SLLW, Instruction::SRL, Instruction::SRLI, Instruction::SRLW,
+             Instruction::SRA, Instruction::SRAI, Instruction::SRAW, Instruction::SLT, Instruction::SLTI, Instruction::SLTU, Instruction::SLTIU,
+             Instruction::SEQZ, Instruction::SNEZ, Instruction::SEXT_W, Instruction::LB, Instruction::LBU, Instruction::LH, Instruction::LHU,
+             Instruction::LW, Instruction::LWU, Instruction::LD, Instruction::FLW, Instruction::FLD, Instruction::FMV_S, Instruction::FMV_D,
+             Instruction::FADD_D, Instruction::FSUB_D, Instruction::FMUL_D, Instruction::FDIV_D, Instruction::FCVT_D_W }) {
+        set(id, { describeDestinationFirst, "", "" });
+    }
+    for (Instruction id : { Instruction::SB, Instruction::SH, Instruction::SW, Instruction::SD, Instruction::FSW, Instruction::FSD }) {
+        set(id, { describeDestinationLast, "", "" });
+    }
+    for (Instruction id : { Instruction::J, Instruction::JR }) {
+        set(id, { describeBranch, "", "" });
+    }
+    set(Instruction::TAIL, { describeBranch, "", " (tail call)" });
+    set(Instruction::BEQ, { describeBranch, "", " if equal" });
+    set(Instruction::BNE, { describeBranch, "", " if not equal" });
+    set(Instruction::BLT, { describeBranch, "", " if less" });
+    set(Instruction::BGE, { describeBranch, "", " if greater or equal" });
+    set(Instruction::BGT, { describeBranch, "", " if greater" });
+    set(Instruction::BLE, { describeBranch, "", " if less or equal" });
+    set(Instruction::BLTU, { describeBranch, "", " if less (unsigned)" });
+    set(Instruction::BGEU, { describeBranch, "", " if greater or equal (unsigned)" });
+    set(Instruction::BGTU, { describeBranch, "", " if greater (unsigned)" });
+    set(Instruction::BLEU, { describeBranch, "", " if less or equal (unsigned)" });
+    set(Instruction::BEQZ, { describeBranch, "", " if zero" });
+    set(Instruction::BNEZ, { describeBranch, "", " if not zero" });
+    set(Instruction::BLTZ, { describeBranch, "", " if negative" });
+    set(Instruction::BGEZ, { describeBranch, "", " if positive or zero" });
+    set(Instruction::BLEZ, { describeBranch, "", " if negative or zero" });
+    set(Instruction::BGTZ, { describeBranch, "", " if positive" });
+    for (Instruction id : { Instruction::JAL, Instruction::JALR, Instruction::CALL }) {
+        set(id, { describeCall, "", "" });
+    }
+    set(Instruction::RET, { describeFixed, "ret instruction: returned from function", "" });
+    set(Instruction::NOP, { describeFixed, "no operation", "" });
+    set(Instruction::ECALL, { describeFixed, "System call", "" });
+    set(Instruction::EBREAK, { describeFixed, "Breakpoint", "" });
+    return formats;
+}();
+
+template <>
+constexpr std::array<InstructionFormat, INSTRUCTION_COUNT> INSTRUCTION_FORMATS<isa::Sparc> = [] {
+    std::array<InstructionFormat, INSTRUCTION_COUNT> formats{};
+    auto set = [&](Instruction id, InstructionFormat format) { formats[static_cast<size_t>(id)] = format; };
+    for (Instruction id : { Instruction::SAVE, Instruction::MOV, Instruction::SET, Instruction::SETHI, Instruction::CLR, Instruction::ADD,
+             Instruction::SUB, Instruction::SMUL, Instruction::UMUL, Instruction::SDIV, Instruction::UDIV, Instruction::AND, Instruction::OR,
+             Instruction::XOR, Instruction::SLL, Instruction::SRL, Instruction::SRA, Instruction::NEG, Instruction::NOT, Instruction::INC,
+             Instruction::DEC, Instruction::LD, Instruction::LDUB, Instruction::LDUH, Instruction::LDSB, Instruction::LDSH, Instruction::LDX,
+             Instruction::ST, Instruction::STB, Instruction::STH, Instruction::STX }) {
+        set(id, { describeDestinationLast, "", "" });
+    }
+    for (Instruction id : { Instruction::CMP, Instruction::TST }) {
+        set(id, { describeCompare, "", "" });
+    }
+    for (Instruction id : { Instruction::BA, Instruction::B, Instruction::JMP }) {
+        set(id, { describeBranch, "", "" });
+    }
+    set(Instruction::BE, { describeBranch, "", " if equal" });
+    set(Instruction::BNE, { describeBranch, "", " if not equal" });
+    set(Instruction::BG, { describeBranch, "", " if greater" });
+    set(Instruction::BL, { describeBranch, "", " if less" });
+    set(Instruction::BGE, { describeBranch, "", " if greater or equal" });
+    set(Instruction::BLE, { describeBranch, "", " if less or equal" });
+    set(Instruction::BGU, { describeBranch, "", " if greater (unsigned)" });
+    set(Instruction::BLEU, { describeBranch, "", " if less or equal (unsigned)" });
+    set(Instruction::BCS, { describeBranch, "", " if carry set" });
+    set(Instruction::BCC, { describeBranch, "", " if carry clear" });
+    set(Instruction::CALL, { describeCall, "", "" });
+    set(Instruction::JMPL, { describeCall, "", "" });
+    set(Instruction::RESTORE, { describeFixed, "restore instruction: restored the caller's register window", "" });
+    set(Instruction::RET, { describeFixed, "ret instruction: returned from function", "" });
+    set(Instruction::RETL, { describeFixed, "retl instruction: returned from leaf function", "" });
+    set(Instruction::NOP, { describeFixed, "no operation", "" });
+    set(Instruction::TA, { describeOperands, "Trap ", "" });
+    return formats;
+}();
+
+static auto describeInstruction(const InstructionFormat& format, const InstructionContext& context, OutputBuffer& comment) -> void {
+    if (format.handler == nullptr || !format.handler(context, format, comment)) {
+        comment.append("Unknown instruction: ").append(context.opcode);
+    }
+}
+
+template <typename Isa>
+static auto annotateLine(const ir::Block& block, size_t line, OutputBuffer& comment) -> void {
+    std::string_view name = block.view(line, block.name[line]);
+    switch (block.kind[line]) {
+    case records::LineKind::BLANK:
+        return;
+    case records::LineKind::LABEL:
+        comment.append("Label: ").append(name);
+        return;
+    case records::LineKind::INSTRUCTION: {
+        // handlers of bare mnemonics get the mnemonic as operand, as they always have
+        std::string_view operands = block.view(line, block.operands[line]);
+        uint32_t split = block.split[line];
+        InstructionContext context{ &block, line, name, operands.empty() ? name : operands, block.view(line, block.lineOperand[line]),
+            split == ir::NO_SPLIT ? std::string_view::npos : split, &Isa::classify };
+        describeInstruction(INSTRUCTION_FORMATS<Isa>[block.opcode[line]], context, comment);
+        return;
+    }
+    case records::LineKind::DIRECTIVE: {
+        uint16_t id = block.opcode[line];
+        analyzeDirective(id == records::NO_OPCODE ? Directive::NONE : static_cast<Directive>(id), name,
+            block.view(line, block.lineOperand[line]), comment);
+        return;
+    }
+    case records::LineKind::UNKNOWN:
+        comment.append("Unknown instruction");
+        return;
+    }
+}
+
+auto annotateLine(const ir::Block& block, size_t line, OutputBuffer& comment) -> void {
+    annotateLine<isa::X86>(block, line, comment);
+}
+
+template <typename Isa>
+static auto tokenizeLine(const scan::LineMap& map, ir::Block& block) -> size_t {
+    std::string_view line = map.text();
+    constexpr size_t npos = scan::LineMap::npos;
+    constexpr scan::Class separator = Isa::SPACES_ONLY ? scan::SPACE : scan::BLANK;
+    auto span = [](size_t at, size_t length) { return ir::Span{ static_cast<uint32_t>(at), static_cast<uint32_t>(length) }; };
+    ir::Line fields;
+
+    size_t first = map.findNot(separator);
+    if (first == npos) {
+        stats::mark(stats::TOKENIZE);
+        return block.add(line, fields);
+    }
+    size_t last = map.findLastNot(separator);
+
+    // blank lines: only worth a look when both ends are tabs or CRs (never, when they separate)
+    auto isBlank = [](char c) { return c == '\t' || c == '\r'; };
+    if (isBlank(line[first]) && isBlank(line[last]) && map.findNot(scan::BLANK, first) == npos) {
+        stats::mark(stats::TOKENIZE);
+        return block.add(line, fields);
+    }
+
+    if (line[last] == ':') {
+        fields.kind = records::LineKind::LABEL;
+        fields.name = span(first, last - first);
+        stats::mark(stats::TOKENIZE);
+        return block.add(line, fields);
+    }
+
+    // a space past `last` is trailing, it doesn't split anything
+    size_t rawSpace = map.find(separator, first);
+    size_t spacePos = rawSpace > last ? npos : rawSpace;
+    fields.name = spacePos == npos ? span(first, last - first + 1) : span(first, spacePos - first);
+    if constexpr (Isa::SPACES_ONLY) {
+        if (spacePos != npos) { fields.operands = span(spacePos + 1, last - spacePos); }
+
+        // what getOperand() would return: after the first space of the raw line, minus trailing spaces
+        // (that space is either the leading one or the one found above, past `last` or not)
+        if (size_t lineSpace = first != 0 ? 0 : rawSpace; lineSpace != npos) {
+            fields.lineOperand = span(lineSpace + 1, last > lineSpace ? last - lineSpace : line.size() - lineSpace - 1);
+        }
+    } else if (spacePos != npos) {
+        // operands start at the first non-blank after the mnemonic, and are all there is to a line's operand
+        spacePos = map.findNot(separator, spacePos) - 1;
+        fields.operands = span(spacePos + 1, last - spacePos);
+        fields.lineOperand = fields.operands;
+    }
+
+    std::string_view opcode = line.substr(fields.name.at, fields.name.length);
+    if (Instruction id = Isa::lookup(opcode); id != Instruction::NONE) {
+        fields.kind = records::LineKind::INSTRUCTION;
+        fields.opcode = static_cast<uint16_t>(id);
+        // found here while the bitmap is at hand, the handler only gets the position
+        scan::Class split = INSTRUCTION_FORMATS<Isa>[static_cast<size_t>(id)].separator;
+        if (split != scan::NEWLINE && spacePos != npos) {
+            if (size_t pos = map.find(split, spacePos + 1); pos <= last) { fields.split = static_cast<uint32_t>(pos - spacePos - 1); }
+        }
+    } else if (Directive id = lookupDirective(opcode); id != Directive::NONE || isDirective(opcode)) {
+        // %include is the only NASM preprocessor directive known, the others stay unknown instructions
+        fields.kind = records::LineKind::DIRECTIVE;
+        if (id != Directive::NONE) { fields.opcode = static_cast<uint16_t>(id); }
+    } else {
+        fields.kind = records::LineKind::UNKNOWN;
+    }
+    size_t index = block.add(line, fields);
+    stats::mark(stats::TOKENIZE);
+
+    if (fields.split != ir::NO_SPLIT) {
+        // the two sides the handler describes, as it sees them (untrimmed), so the records say what the annotation does
+        size_t at = spacePos + 1 + fields.split;
+        block.addOperand(span(spacePos + 1, fields.split), Isa::classify(line.substr(spacePos + 1, fields.split)));
+        block.addOperand(span(at + 1, last - at), Isa::classify(line.substr(at + 1, last - at)));
+    } else if (spacePos != npos) {
+        tokenizeOperands<Isa>(map, block, spacePos + 1, last + 1);
+    }
+    stats::mark(stats::CLASSIFY);
+    return index;
+}
+
+auto tokenizeLine(const scan::LineMap& map, ir::Block& block) -> size_t {
+    return tokenizeLine<isa::X86>(map, block);
+}
+
+template <typename Isa>
+static auto tokenizeOperands(const scan::LineMap& map, ir::Block& block, size_t from, size_t to) -> void {
+    std::string_view line = map.text();
+    auto add = [&](size_t begin, size_t end) {
+        auto isBlank = [](char c) { return c == ' ' || c == '\t'; };
+        while (begin < end && isBlank(line[begin])) { ++begin; }
+        while (end > begin && isBlank(line[end - 1])) { --end; }
+        if (begin == end) { return; }
+        block.addOperand({ static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin) }, Isa::classify(line.substr(begin, end - begin)));
+    };
+
+    // without brackets or parentheses every comma separates, and the bitmap has them all
+    if (map.find(scan::OPEN, from) >= to) {
+        for (size_t comma = map.find(scan::COMMA, from); comma < to; comma = map.find(scan::COMMA, from)) {
+            add(from, comma);
+            from = comma + 1;
+        }
+        add(from, to);
+        return;
+    }
+
+    // otherwise only the commas outside of them: 8(%rbp,%rax,4) is one operand
+    int depth = 0;
+    for (size_t i = from; i < to; ++i) {
+        char c = line[i];
+        if (c == '[' || c == '(') {
+            ++depth;
+        } else if ((c == ']' || c == ')') && depth > 0) {
+            --depth;
+        } else if (c == ',' && depth == 0) {
+            add(from, i);
+            from = i + 1;
+        }
+    }
+    add(from, to);
+}
+
+auto tokenizeOperands(const scan::LineMap& map, ir::Block& block, size_t from, size_t to) -> void {
+    tokenizeOperands<isa::X86>(map, block, from, to);
+}
+
+auto InstructionContext::kindOf(std::string_view operand) const -> records::OperandKind {
+    for (size_t i = block->firstOperand[line]; i < block->firstOperand[line + 1]; ++i) {
+        std::string_view tokenized = block->view(line, block->operand[i]);
+        if (tokenized.data() == operand.data() && tokenized.size() == operand.size()) { return block->operandKind[i]; }
+    }
+    return classify(operand);
+}
+
+auto analyzeInstruction(Instruction id, const InstructionContext& context, OutputBuffer& comment) -> void {
+    describeInstruction(INSTRUCTION_FORMATS<isa::X86>[static_cast<size_t>(id)], context, comment);
+}
+
+auto analyzeOperands(std::string_view operands, OutputBuffer& comment) -> void {
+    size_t pos = 0;
+    while ((pos = operands.find(' ')) != std::string_view::npos) {
+        analyzeOperand(operands.substr(0, pos), comment);
+        comment.push_back(' ');
+        operands.remove_prefix(pos + 1);
+    }
+
+    analyzeOperand(operands, comment);
+}
+
+auto analyzeOperand(std::string_view operand, OutputBuffer& comment, bool appendType) -> void {
+    analyzeOperand(operand, classifyOperand(operand), comment, appendType);
+}
+
+auto analyzeOperand(std::string_view operand, records::OperandKind kind, OutputBuffer& comment, bool appendType) -> void {
+    if (operand.empty()) {
+        comment.append("Empty operand");
+        return;
+    }
+
+    constexpr std::array<std::string_view, 6> TYPE_NAMES = { "", "Register", "Immediate", "Memory Address", "Label/Identifier", "Shift/Extend" };
+    std::string_view type = TYPE_NAMES[static_cast<size_t>(kind)];
+    std::string_view value = operand;
+
+    if (kind == records::OperandKind::IMMEDIATE && (operand[0] == '$' || operand[0] == '#')) {
+        value.remove_prefix(1);
+    } else if (kind == records::OperandKind::MEMORY && operand[0] == '[' && operand.back() == ']') {
+        value = operand.substr(1, operand.size() - 2);
+    }
+
+    if (appendType) {
+        comment.append(value).append(" (").append(type).push_back(')');
+    } else {
+        comment.append(type).append(": ").append(value);
+    }
+}
+
+auto classifyOperand(std::string_view operand) -> records::OperandKind {
+    return isa::X86::classify(operand);
+}
+
+auto trim(std::string_view str) -> std::string_view {
+    size_t first = str.find_first_not_of(' ');
+    if (std::string_view::npos == first) { return str; }
+
+    size_t last = str.find_last_not_of(' ');
+    return str.substr(first, (last - first + 1));
+}
+
+auto isInstruction(std::string_view opcode) -> bool {
+    return lookupInstruction(opcode) != Instruction::NONE;
+}
+
+/**
+  Detects the instruction set of a file.
+ *
+  @param filename The file.
+  @param error Receives the reason when the file can't be read.
+  @return The architecture (ArchDetector::UNKNOWN without a marker), empty on error.
+ */
+auto getArchitecture(const std::string& filename, std::string& error) -> std::string {
+    std::ifstream file(filename);
+    if (!file) {
+        error = "Cannot open " + filename;
+        return {};
+    }
+
+    ArchDetector detector;
+    std::string line;
+    while (getline(file, line) && !detector.feed(line)) {}
+
+    file.close();
+    return std::string(detector.name());
+}
\ No newline at end of file
@@ -0,0 +1,259 @@
+// Throughput benchmarks of the analyzer, on a generated corpus
+
+#include "include.h"
+#include "corpus.hpp"
+#include <cstdio>
+#include <atomic>
+#include <new>
+
+constexpr static size_t BUFFER_SIZE = 1 << 22;
+constexpr static size_t BLOCK_LINES = 1024;
+
+// every allocation of the process is counted, to report allocations per line
+static std::atomic<size_t> allocations{ 0 };
+
+auto operator new(size_t size) -> void* {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) { return memory; }
+    throw std::bad_alloc();
+}
+
+auto operator new[](size_t size) -> void* {
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t /*size*/) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, size_t /*size*/) noexcept {
+    std::free(memory);
+}
+
+/**
+  Settings of a benchmark run.
+ */
+struct BenchOptions {
+    size_t size = size_t{ 16 } << 20;
+    unsigned repeat = 3;
+    std::string only;
+    std::string write;
+    CorpusGenerator generator;
+    bool help = false;
+    std::string error;
+
+    static auto parse(int argc, char** argv) -> BenchOptions {
+        BenchOptions options;
+        std::vector<std::string> args(argv + 1, argv + argc);
+        for (size_t i = 0; i < args.size() && options.error.empty(); ++i) {
+            const std::string& arg = args[i];
+            if (arg == "-h" || arg == "--help") {
+                options.help = true;
+            } else if (arg == "--tabs") {
+                options.generator.tabs = true;
+            } else if (i + 1 == args.size()) {
+                options.error = "Unknown option or missing value: " + arg;
+            } else if (arg == "--size") {
+                options.size = static_cast<size_t>(std::strtod(args[++i].c_str(), nullptr) * 1024 * 1024);
+            } else if (arg == "--seed") {
+                options.generator.seed = std::strtoull(args[++i].c_str(), nullptr, 10);
+            } else if (arg == "--repeat") {
+                options.repeat = std::max(1U, static_cast<unsigned>(std::strtoul(args[++i].c_str(), nullptr, 10)));
+            } else if (arg == "--syntax") {
+                const std::string& syntax = args[++i];
+                options.generator.syntax = syntax == "intel" ? CorpusGenerator::INTEL : CorpusGenerator::ATT;
+                if (syntax != "intel" && syntax != "att") { options.error = "Unknown syntax " + syntax; }
+            } else if (arg == "--mix") {
+                options.generator.mix = CorpusGenerator::parseMix(args[++i], options.error);
+            } else if (arg == "--only") {
+                options.only = args[++i];
+            } else if (arg == "--write") {
+                options.write = args[++i];
+            } else {
+                options.error = "Unknown option " + arg;
+            }
+        }
+        return options;
+    }
+
+    static auto usage() -> std::string {
+        return
+            "Usage: asm-analyze-bench [options]\n"
+            "\n"
+            "Generates a corpus and measures the analyzer on it (best of --repeat runs).\n"
+            "\n"
+            "Options:\n"
+            "  --size <MiB>       corpus size (default: 16)\n"
+            "  --seed <n>         generator seed (default: 1)\n"
+            "  --syntax <att|intel>\n"
+            "  --tabs             separate like gcc does (tabs) instead of spaces\n"
+            "  --mix <spec>       opcode mix, e.g. mov=5,add=2,.quad=1,label=1,blank=1,unknown=1\n"
+            "  --repeat <n>       runs per benchmark (default: 3)\n"
+            "  --only <name>      only run benchmarks whose name contains this\n"
+            "  --write <file>     also save the corpus\n";
+    }
+};
+
+/**
+  Result of one benchmark.
+ */
+struct Measurement {
+    double seconds = 0;      // best run
+    size_t allocations = 0;  // per run
+};
+
+template <typename Body>
+static auto measure(unsigned repeat, Body&& body) -> Measurement {
+    Measurement best{ 1e300, 0 };
+    for (unsigned run = 0; run < repeat; ++run) {
+        size_t before = allocations.load(std::memory_order_relaxed);
+        auto begin = std::chrono::steady_clock::now();
+        body();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        best.seconds = std::min(best.seconds, seconds);
+        best.allocations = allocations.load(std::memory_order_relaxed) - before;
+    }
+    return best;
+}
+
+static void report(std::string_view name, size_t lines, size_t bytes, const Measurement& m) {
+    double seconds = std::max(m.seconds, 1e-9);
+    std::printf("%-24.*s %12.0f lines/s %9.2f MB/s %9.5f allocs/line (%zu) %9.4f s\n",
+        static_cast<int>(name.size()), name.data(),
+        static_cast<double>(lines) / seconds, static_cast<double>(bytes) / 1e6 / seconds,
+        lines == 0 ? 0.0 : static_cast<double>(m.allocations) / static_cast<double>(lines), m.allocations, m.seconds);
+}
+
+auto main(int argc, char** argv) -> int {
+    BenchOptions options = BenchOptions::parse(argc, argv);
+    if (options.help) {
+        std::printf("%s", BenchOptions::usage().c_str());
+        return 0;
+    }
+    if (!options.error.empty()) {
+        dbg::Macros::error(options.error);
+        std::fprintf(stderr, "%s", BenchOptions::usage().c_str());
+        return 2;
+    }
+
+    std::string text = options.generator.generate(options.size);
+    std::vector<std::string_view> lines;
+    for (std::string_view rest = text; !rest.empty();) {
+        size_t eol = rest.find('\n');
+        lines.push_back(rest.substr(0, eol));
+        rest.remove_prefix(eol == std::string_view::npos ? rest.size() : eol + 1);
+    }
+    std::printf("corpus: %zu lines, %.2f MB, seed %llu, kernel %s\n\n", lines.size(), static_cast<double>(text.size()) / 1e6,
+        static_cast<unsigned long long>(options.generator.seed), scan::kernels().name);
+
+    // files for the benchmarks that go through the file system
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / ("asm-analyze-bench-" + std::to_string(options.generator.seed));
+    std::filesystem::create_directories(dir);
+    std::filesystem::path corpus = dir / "corpus.s";
+    std::filesystem::path late = dir / "late.s";
+    {
+        std::ofstream(corpus, std::ios::binary) << text;
+        // nothing before the last line may give the architecture away (.quad does, for one)
+        CorpusGenerator lateGenerator = options.generator;
+        lateGenerator.marker = CorpusGenerator::END;
+        std::erase_if(lateGenerator.mix, [](const CorpusGenerator::Weighted& entry) { return ArchDetector().feed(entry.token); });
+        std::ofstream(late, std::ios::binary) << lateGenerator.generate(options.size);
+    }
+    if (!options.write.empty()) {
+        std::filesystem::copy_file(corpus, options.write, std::filesystem::copy_options::overwrite_existing);
+    }
+
+    auto selected = [&](std::string_view name) {
+        return options.only.empty() || name.find(options.only) != std::string_view::npos;
+    };
+    OutputBuffer out(BUFFER_SIZE);
+
+    if (selected("analyzeLine")) {
+        report("analyzeLine", lines.size(), text.size(), measure(options.repeat, [&] {
+            for (std::string_view line : lines) {
+                analyzeLine(line, out);
+                if (out.size() > BUFFER_SIZE / 2) { out.clear(); }
+            }
+        }));
+    }
+
+    if (selected("scan+formatLine")) {
+        report("scan+formatLine", lines.size(), text.size(), measure(options.repeat, [&] {
+            scan::LineScanner scanner(text);
+            scan::LineMap line;
+            while (scanner.next(line)) {
+                formatLine(line, out);
+                if (out.size() > BUFFER_SIZE / 2) { out.clear(); }
+            }
+        }));
+    }
+
+    if (selected("tokenize")) {
+        // the IR on its own, in blocks of the size analyzeFile uses
+        ir::Block block;
+        report("tokenize", lines.size(), text.size(), measure(options.repeat, [&] {
+            block.reset(text);
+            scan::LineScanner scanner(text);
+            scan::LineMap line;
+            while (scanner.next(line)) {
+                tokenizeLine(line, block);
+                if (block.lines() == BLOCK_LINES) { block.reset(text); }
+            }
+        }));
+    }
+
+    if (selected("analyzeOperand")) {
+        std::vector<std::string> operands = options.generator.operands(lines.size());
+        size_t bytes = 0;
+        for (const std::string& operand : operands) { bytes += operand.size(); }
+        report("analyzeOperand", operands.size(), bytes, measure(options.repeat, [&] {
+            for (const std::string& operand : operands) {
+                analyzeOperand(operand, out, true);
+                if (out.size() > BUFFER_SIZE / 2) { out.clear(); }
+            }
+        }));
+    }
+
+    if (selected("getArchitecture")) {
+        // the marker is on the last line: the whole file gets scanned
+        report("getArchitecture (late)", lines.size(), text.size(), measure(options.repeat, [&] {
+            std::string error;
+            std::string architecture = getArchitecture(late.string(), error);
+            if (!error.empty()) {
+                dbg::Macros::warn(error);
+            } else if (architecture == ArchDetector::UNKNOWN) {
+                dbg::Macros::warn("no architecture found");
+            }
+        }));
+    }
+
+    Options analyzeOptions;
+    analyzeOptions.quiet = true;
+    auto endToEnd = [&](std::string_view name, ThreadPool* pool) {
+        if (!selected(name)) { return; }
+        report(name, lines.size(), text.size(), measure(options.repeat, [&] {
+            FileResult result = analyzeFile(corpus, analyzeOptions, pool);
+            if (!result.ok) { dbg::Macros::error(result.error); }
+        }));
+    };
+    endToEnd("analyzeFile", nullptr);
+    {
+        ThreadPool pool(0);
+        if (pool.size() > 1) {
+            analyzeOptions.chunkSize = size_t{ 1 } << 20;
+            endToEnd("analyzeFile (chunked)", &pool);
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "opcodes.hpp"
+#include <string_view>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+  A seeded generator of assembly listings for benchmarking.
+
+  The same seed and settings always give the same text, so numbers from different builds are
+  comparable. Lines are drawn from a weighted mix of mnemonics, directives, labels, blank lines and
+  unknown instructions, with operands in AT&T or Intel syntax.
+ */
+class CorpusGenerator {
+public:
+    enum Syntax : uint8_t { ATT, INTEL };
+
+    /**
+      Where the architecture marker goes.
+     */
+    enum Marker : uint8_t { START, END, NONE };
+
+    /**
+      One entry of the mix: a mnemonic, a directive, or one of "label", "blank" and "unknown".
+     */
+    struct Weighted {
+        std::string token;
+        double weight = 0;
+    };
+
+    uint64_t seed = 1;
+    Syntax syntax = ATT;
+    Marker marker = START;
+    bool tabs = false;          // gcc style "\tmov\t..." instead of "    mov ..."
+    std::vector<Weighted> mix = defaultMix();
+
+    /**
+      A mix roughly like compiler output: mostly moves and arithmetic, some control flow, a
+      sprinkle of directives and labels.
+     */
+    static auto defaultMix() -> std::vector<Weighted> {
+        return {
+            { "mov", 20 }, { "movq", 10 }, { "add", 6 }, { "addq", 3 }, { "sub", 5 }, { "subq", 2 },
+            { "cmp", 5 }, { "jmp", 3 }, { "je", 3 }, { "jne", 3 }, { "call", 4 }, { "ret", 2 },
+            { "push", 4 }, { "pop", 4 }, { "inc", 1 }, { "dec", 1 }, { "mul", 1 }, { "div", 1 },
+            { "nop", 1 }, { "int", 0.5 },
+            { ".quad", 2 }, { ".string", 1 }, { ".globl", 1 }, { ".align", 1 }, { ".section", 0.5 },
+            { ".text", 0.3 }, { ".data", 0.3 }, { ".byte", 1 },
+            { "label", 6 }, { "blank", 4 }, { "unknown", 4 }
+        };
+    }
+
+    /**
+      Parses a mix like "mov=5,add=2,.quad=1,label=1".
+     *
+      @param spec The mix.
+      @param error Receives the reason when it can't be parsed.
+      @return The mix (empty on error).
+     */
+    static auto parseMix(std::string_view spec, std::string& error) -> std::vector<Weighted> {
+        std::vector<Weighted> mix;
+        while (!spec.empty()) {
+            size_t comma = spec.find(',');
+            std::string_view item = spec.substr(0, comma);
+            spec = comma == std::string_view::npos ? std::string_view{} : spec.substr(comma + 1);
+
+            size_t equals = item.find('=');
+            std::string token(item.substr(0, equals));
+            double weight = equals == std::string_view::npos ? 1.0 : std::strtod(std::string(item.substr(equals + 1)).c_str(), nullptr);
+            bool known = token == "label" || token == "blank" || token == "unknown" ||
+                lookupInstruction(token) != Instruction::NONE || lookupDirective(token) != Directive::NONE;
+            if (!known || weight <= 0) {
+                error = "Bad mix entry " + std::string(item);
+                return {};
+            }
+            mix.push_back({ token, weight });
+        }
+        return mix;
+    }
+
+    /**
+      Generates about `bytes` bytes of text (whole lines).
+     */
+    auto generate(size_t bytes) const -> std::string {
+        std::mt19937_64 random(seed);
+        std::vector<double> weights;
+        for (const Weighted& entry : mix) { weights.push_back(entry.weight); }
+        std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+
+        std::string text;
+        text.reserve(bytes + 256);
+        std::string_view markerLine = syntax == ATT ? ".code64\n" : "BITS 64\n";
+        if (marker == START) { text += markerLine; }
+        size_t labels = 0;
+        while (text.size() < bytes) {
+            line(mix[pick(random)].token, random, labels, text);
+        }
+        if (marker == END) { text += markerLine; }
+        return text;
+    }
+
+    /**
+      Generates `count` operands of all kinds (for operand level benchmarks).
+     */
+    auto operands(size_t count) const -> std::vector<std::string> {
+        std::mt19937_64 random(seed);
+        std::vector<std::string> result;
+        result.reserve(count);
+        for (size_t i = 0; i < count; ++i) { result.push_back(operand(random)); }
+        return result;
+    }
+
+private:
+    static constexpr std::string_view REGISTERS[] = {
+        "rax", "rbx", "rcx", "rdx", "rsi", "rdi", "rbp", "rsp", "eax", "ebx", "ecx", "edx",
+        "r8", "r9", "r10", "r11", "r12d", "r13d", "al", "bl", "cl", "dl"
+    };
+    static constexpr std::string_view UNKNOWN_MNEMONICS[] = { "lea", "xor", "test", "leave" };
+
+    template <typename T>
+    static auto choose(std::mt19937_64& random, const T& items) -> decltype(items[0]) {
+        return items[random() % std::size(items)];
+    }
+
+    auto reg(std::mt19937_64& random) const -> std::string {
+        std::string name(choose(random, REGISTERS));
+        return syntax == ATT ? "%" + name : name;
+    }
+
+    auto immediate(std::mt19937_64& random) const -> std::string {
+        std::string value = random() % 4 == 0 ? "0x" + std::to_string(random() % 4096) : std::to_string(random() % 1024);
+        return syntax == ATT ? "$" + value : value;
+    }
+
+    auto memory(std::mt19937_64& random) const -> std::string {
+        std::string displacement = std::to_string(8 * (random() % 32));
+        if (syntax == INTEL) {
+            return "[" + std::string(choose(random, REGISTERS)) + "-" + displacement + "]";
+        }
+        // AT&T mostly as compilers write it, sometimes in the bracket form
+        if (random() % 4 == 0) { return "[" + reg(random) + "]"; }
+        return "-" + displacement + "(" + reg(random) + ")";
+    }
+
+    auto operand(std::mt19937_64& random) const -> std::string {
+        switch (random() % 4) {
+        case 0: return immediate(random);
+        case 1: return memory(random);
+        case 2: return ".L" + std::to_string(random() % 1000);
+        default: return reg(random);
+        }
+    }
+
+    void line(const std::string& token, std::mt19937_64& random, size_t& labels, std::string& text) const {
+        std::string_view indent = tabs ? "\t" : "    ";
+        char separator = tabs ? '\t' : ' ';
+
+        if (token == "blank") {
+            text += '\n';
+            return;
+        }
+        if (token == "label") {
+            text += random() % 2 == 0 ? ".L" + std::to_string(labels++) : "func_" + std::to_string(labels++);
+            text += ":\n";
+            return;
+        }
+        if (token == "unknown") {
+            text += indent;
+            text += choose(random, UNKNOWN_MNEMONICS);
+            text += separator;
+            text += reg(random) + ", " + reg(random) + "\n";
+            return;
+        }
+
+        text += indent;
+        text += token;
+        if (token[0] == '.') {
+            if (token == ".quad" || token == ".byte" || token == ".align") {
+                text += separator + std::to_string(random() % 256);
+            } else if (token == ".string") {
+                text += separator + std::string("\"generated string ") + std::to_string(random() % 100) + "\"";
+            } else if (token == ".globl") {
+                text += separator + std::string("func_") + std::to_string(random() % 100);
+            } else if (token == ".section") {
+                text += separator + std::string(".rodata");
+            }
+            text += '\n';
+            return;
+        }
+
+        Instruction id = lookupInstruction(token);
+        switch (id) {
+        case Instruction::RET: case Instruction::NOP:
+            break;
+        case Instruction::INT:
+            text += separator + std::string("0x80");
+            break;
+        case Instruction::JMP: case Instruction::JE: case Instruction::JNE: case Instruction::CALL:
+            text += separator + std::string(".L") + std::to_string(random() % 1000);
+            break;
+        case Instruction::PUSH: case Instruction::POP: case Instruction::INC: case Instruction::DEC:
+            text += separator + reg(random);
+            break;
+        default:
+            text += separator + operand(random) + ", " + reg(random);
+            break;
+        }
+        text += '\n';
+    }
+};
\ No newline at end of file
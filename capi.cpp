@@ -0,0 +1,159 @@
+// The C interface of the library (etc/asmanalyze.h), a thin layer over analyzeBuffer and analyzeFile
+
+#include "etc/include.h"
+#include "etc/asmanalyze.h"
+#include <cstddef>
+#include <new>
+
+struct asm_analyze_result {
+    std::string output;
+    std::string records;
+    std::string architecture;
+    std::string error;
+    uint64_t lines = 0;
+    uint64_t bytes = 0;
+};
+
+// C options to C++ ones, false when they don't make sense
+static auto toOptions(const asm_analyze_options* from, Options& options, std::string& error) -> bool {
+    options.quiet = true;
+    if (from == nullptr) { return true; }
+    // fields past the size the caller knows about keep their defaults
+    if (from->size < offsetof(asm_analyze_options, cfg)) {
+        error = "asm_analyze_options wasn't initialized with asm_analyze_options_init";
+        return false;
+    }
+    switch (from->records) {
+    case ASM_ANALYZE_RECORDS_NONE: options.records = records::Format::NONE; break;
+    case ASM_ANALYZE_RECORDS_JSONL: options.records = records::Format::JSONL; break;
+    case ASM_ANALYZE_RECORDS_BINARY: options.records = records::Format::BINARY; break;
+    default:
+        error = "Unknown record format " + std::to_string(static_cast<int>(from->records));
+        return false;
+    }
+    options.header = from->header != 0;
+    if (from->size < sizeof(asm_analyze_options)) { return true; }
+    options.cfg = from->cfg != 0;
+    if (from->cpu != nullptr) {
+        if (cost::find(from->cpu) == nullptr) {
+            error = "Unknown processor model " + std::string(from->cpu);
+            return false;
+        }
+        options.cpu = from->cpu;
+        options.cfg = true;
+    }
+    return true;
+}
+
+// allocates the result and runs the analysis, nothing may unwind into C
+template <typename Body>
+static auto run(asm_analyze_result** result, Body&& body) -> asm_analyze_status {
+    if (result == nullptr) { return ASM_ANALYZE_INVALID_ARGUMENT; }
+    *result = new (std::nothrow) asm_analyze_result();
+    if (*result == nullptr) { return ASM_ANALYZE_OUT_OF_MEMORY; }
+
+    asm_analyze_result& into = **result;
+    try {
+        return body(into);
+    } catch (const std::bad_alloc&) {
+        into.output = std::string();
+        into.records = std::string();
+        into.error = "Out of memory";
+        return ASM_ANALYZE_OUT_OF_MEMORY;
+    } catch (const std::exception& e) {
+        into.error = e.what();
+        return ASM_ANALYZE_INTERNAL_ERROR;
+    }
+}
+
+extern "C" {
+
+void asm_analyze_options_init(asm_analyze_options* options) {
+    if (options == nullptr) { return; }
+    options->size = sizeof(asm_analyze_options);
+    options->records = ASM_ANALYZE_RECORDS_NONE;
+    options->header = 1;
+    options->cfg = 0;
+    options->cpu = nullptr;
+}
+
+asm_analyze_status asm_analyze_buffer(const char* data, size_t size, const asm_analyze_options* options, asm_analyze_result** result) {
+    return run(result, [&](asm_analyze_result& into) {
+        Options settings;
+        if ((data == nullptr && size != 0) || !toOptions(options, settings, into.error)) {
+            if (into.error.empty()) { into.error = "No data"; }
+            return ASM_ANALYZE_INVALID_ARGUMENT;
+        }
+        FileResult analyzed = analyzeBuffer({ data, size }, settings, nullptr, into.output, into.records);
+        into.architecture = analyzed.architecture;
+        into.lines = analyzed.lines;
+        into.bytes = analyzed.bytes;
+        return ASM_ANALYZE_OK;
+    });
+}
+
+asm_analyze_status asm_analyze_file(const char* path, const asm_analyze_options* options, asm_analyze_result** result) {
+    return run(result, [&](asm_analyze_result& into) {
+        Options settings;
+        if (path == nullptr || !toOptions(options, settings, into.error)) {
+            if (into.error.empty()) { into.error = "No path"; }
+            return ASM_ANALYZE_INVALID_ARGUMENT;
+        }
+        FileResult analyzed = analyzeFile(path, settings, nullptr);
+        if (!analyzed.ok) {
+            into.error = analyzed.error;
+            return ASM_ANALYZE_IO_ERROR;
+        }
+        into.architecture = analyzed.architecture;
+        into.lines = analyzed.lines;
+        into.bytes = analyzed.bytes;
+        return ASM_ANALYZE_OK;
+    });
+}
+
+const char* asm_analyze_result_output(const asm_analyze_result* result, size_t* size) {
+    if (size != nullptr) { *size = result == nullptr ? 0 : result->output.size(); }
+    return result == nullptr ? "" : result->output.c_str();
+}
+
+const char* asm_analyze_result_records(const asm_analyze_result* result, size_t* size) {
+    if (size != nullptr) { *size = result == nullptr ? 0 : result->records.size(); }
+    return result == nullptr ? "" : result->records.c_str();
+}
+
+const char* asm_analyze_result_architecture(const asm_analyze_result* result) {
+    return result == nullptr ? "" : result->architecture.c_str();
+}
+
+uint64_t asm_analyze_result_lines(const asm_analyze_result* result) {
+    return result == nullptr ? 0 : result->lines;
+}
+
+uint64_t asm_analyze_result_bytes(const asm_analyze_result* result) {
+    return result == nullptr ? 0 : result->bytes;
+}
+
+const char* asm_analyze_result_error(const asm_analyze_result* result) {
+    return result == nullptr ? "" : result->error.c_str();
+}
+
+void asm_analyze_result_free(asm_analyze_result* result) {
+    delete result;
+}
+
+const char* asm_analyze_status_string(asm_analyze_status status) {
+    switch (status) {
+    case ASM_ANALYZE_OK: return "ok";
+    case ASM_ANALYZE_INVALID_ARGUMENT: return "invalid argument";
+    case ASM_ANALYZE_IO_ERROR: return "I/O error";
+    case ASM_ANALYZE_OUT_OF_MEMORY: return "out of memory";
+    case ASM_ANALYZE_INTERNAL_ERROR: return "internal error";
+    }
+    return "unknown status";
+}
+
+const char* asm_analyze_version(void) {
+    return VERSION.c_str();
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,610 @@
+// The resident mode: sources watched with inotify, annotations kept in memory and served over a Unix socket
+
+#include "etc/include.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unordered_map>
+#include <csignal>
+
+constexpr static size_t EVENT_BUFFER_SIZE = 64 << 10;
+constexpr static size_t REQUEST_READ_SIZE = 4 << 10;
+constexpr static size_t MAX_REQUEST_SIZE = 64 << 10;
+constexpr static uint32_t DIRECTORY_EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE | IN_DELETE_SELF | IN_ONLYDIR;
+
+static volatile std::sig_atomic_t stopping = 0;
+
+/**
+  What the daemon keeps of a file: its text and its annotated copy (without the header), with
+  where the output of every line starts.
+ */
+struct Annotated {
+    std::string source;
+    std::string_view architecture;
+    std::string output;
+    std::vector<size_t> lines; // offset in `output` of every source line (its summaries included), then the end
+    std::vector<size_t> starts; // offset in `source` of every line, then the end (as lineStarts() has it)
+    bool known = false;        // analyzed at least once
+};
+
+/**
+  A connection to the socket, requests end with a newline.
+ */
+struct Client {
+    int fd = -1;
+    std::string pending;
+};
+
+// where every line starts, then one past the end of the last one (as if it had a newline)
+static auto lineStarts(std::string_view text) -> std::vector<size_t> {
+    std::vector<size_t> starts;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        starts.push_back(pos);
+        size_t eol = text.find('\n', pos);
+        pos = eol == std::string_view::npos ? text.size() + 1 : eol + 1;
+    }
+    starts.push_back(std::max(pos, text.size()));
+    return starts;
+}
+
+static auto lineOf(std::string_view text, const std::vector<size_t>& starts, size_t index) -> std::string_view {
+    return text.substr(starts[index], starts[index + 1] - starts[index] - 1);
+}
+
+/**
+  Annotates a text into the form the daemon keeps: the lines come from a sidecar built in memory,
+  which says exactly which output belongs to which source line.
+ *
+  @param text The text.
+  @param options The options (options.architecture set when it's a part of a file).
+  @param pool Helps with big texts.
+  @param output Receives the annotated text.
+  @param lines Receives where the output of every line starts, then the end.
+  @param starts Receives where every line of the text starts, then the end.
+  @return The outcome (the architecture, or an error).
+ */
+static auto annotate(std::string_view text, const Options& options, ThreadPool* pool, std::string& output, std::vector<size_t>& lines,
+    std::vector<size_t>& starts) -> FileResult {
+    Options sidecarOptions = options;
+    sidecarOptions.sidecar = true;
+    sidecarOptions.header = false;
+    std::string blob;
+    std::string records;
+    FileResult result = analyzeBuffer(text, sidecarOptions, pool, blob, records);
+
+    sidecar::Reader annotations;
+    starts = lineStarts(text);
+    if (!annotations.open(blob, result.error) || annotations.info().lines != starts.size() - 1) {
+        result.ok = false;
+        if (result.error.empty()) { result.error = "The annotations don't match the lines"; }
+        return result;
+    }
+    thread_local OutputBuffer out;
+    out.clear();
+    lines.clear();
+    uint64_t prefix = 0;
+    for (size_t i = 0; i + 1 < starts.size(); ++i) {
+        lines.push_back(out.size());
+        annotations.merge(i + 1, lineOf(text, starts, i), prefix, out);
+    }
+    lines.push_back(out.size());
+    output.assign(out.view());
+    return result;
+}
+
+// bytes two texts share at their start, compared a block at a time
+static auto commonPrefix(std::string_view a, std::string_view b) -> size_t {
+    constexpr size_t BLOCK = 4096;
+    size_t limit = std::min(a.size(), b.size());
+    size_t at = 0;
+    while (at + BLOCK <= limit && std::memcmp(a.data() + at, b.data() + at, BLOCK) == 0) { at += BLOCK; }
+    while (at < limit && a[at] == b[at]) { ++at; }
+    return at;
+}
+
+// the same at their end, looking at no more than `limit` bytes
+static auto commonSuffix(std::string_view a, std::string_view b, size_t limit) -> size_t {
+    constexpr size_t BLOCK = 4096;
+    size_t at = 0;
+    while (at + BLOCK <= limit && std::memcmp(a.data() + a.size() - at - BLOCK, b.data() + b.size() - at - BLOCK, BLOCK) == 0) { at += BLOCK; }
+    while (at < limit && a[a.size() - at - 1] == b[b.size() - at - 1]) { ++at; }
+    return at;
+}
+
+// replaces entries [from, to) of an index by `part` (offsets from `base`), shifting the ones after by `shift`
+static void splice(std::vector<size_t>& index, size_t from, size_t to, const std::vector<size_t>& part, size_t base, size_t shift) {
+    index.erase(index.begin() + static_cast<std::ptrdiff_t>(from), index.begin() + static_cast<std::ptrdiff_t>(to));
+    index.insert(index.begin() + static_cast<std::ptrdiff_t>(from), part.begin(), part.end());
+    for (size_t i = from; i < from + part.size(); ++i) { index[i] += base; }
+    for (size_t i = from + part.size(); i < index.size(); ++i) { index[i] += shift; }
+}
+
+/**
+  Brings a file up to date with its new text. Lines are annotated on their own, so when the
+  architecture stays and nothing spans lines (--cfg does), only the lines between the unchanged
+  start and end are annotated again and spliced in between the old output of those.
+ *
+  @param file The file, replaced on success.
+  @param text Its new text.
+  @param options The options.
+  @param pool Helps with big texts.
+  @param from Receives the first line annotated again (1-based).
+  @param count Receives how many lines that was.
+  @return The outcome.
+ */
+static auto update(Annotated& file, std::string text, const Options& options, ThreadPool* pool, size_t& from, size_t& count) -> FileResult {
+    ArchDetector detector;
+    detector.feedText(text);
+    if (!file.known || options.cfg || detector.name() != file.architecture) {
+        Annotated fresh;
+        FileResult result = annotate(text, options, pool, fresh.output, fresh.lines, fresh.starts);
+        if (!result.ok) { return result; }
+        fresh.source = std::move(text);
+        fresh.architecture = result.architecture;
+        fresh.known = true;
+        file = std::move(fresh);
+        from = 1;
+        count = file.lines.size() - 1;
+        return result;
+    }
+
+    // the lines whose bytes (newline included) lie in the common start or end are kept
+    std::string_view before = file.source;
+    size_t headBytes = commonPrefix(before, text);
+    size_t tailBytes = commonSuffix(before, text, std::min(before.size(), text.size()) - headBytes);
+    const std::vector<size_t>& starts = file.starts;
+    size_t oldCount = starts.size() - 1;
+    size_t same = static_cast<size_t>(std::upper_bound(starts.begin() + 1, starts.end(), headBytes) - (starts.begin() + 1));
+    // a line is in the common end when the newline before it is
+    auto search = starts.begin() + static_cast<std::ptrdiff_t>(std::min(std::max<size_t>(same, 1), oldCount));
+    auto firstTail = static_cast<size_t>(std::lower_bound(search, starts.end() - 1, before.size() - tailBytes + 1) - starts.begin());
+
+    size_t shift = text.size() - before.size(); // wraps around when the text got shorter, as does the sum it goes into
+    size_t begin = std::min(starts[same], text.size());
+    size_t end = firstTail < oldCount ? starts[firstTail] + shift : text.size();
+    Options partOptions = options;
+    partOptions.architecture = file.architecture;
+    std::string output;
+    std::vector<size_t> lines;
+    std::vector<size_t> partStarts;
+    FileResult result = annotate(std::string_view(text).substr(begin, end - begin), partOptions, pool, output, lines, partStarts);
+    if (!result.ok) { return result; }
+
+    // the ends of both indexes come from the part when nothing is kept after it
+    if (firstTail == oldCount) {
+        ++firstTail;
+    } else {
+        lines.pop_back();
+        partStarts.pop_back();
+    }
+    size_t head = file.lines[same];
+    size_t oldTail = firstTail <= oldCount ? file.lines[firstTail] : file.output.size();
+    file.output.replace(head, oldTail - head, output);
+    splice(file.lines, same, firstTail, lines, head, head + output.size() - oldTail);
+    splice(file.starts, same, firstTail, partStarts, begin, shift);
+    file.source = std::move(text);
+    from = same + 1;
+    count = partStarts.size() - (firstTail > oldCount ? 1 : 0);
+    return result;
+}
+
+/**
+  The resident analyzer: one thread waits on inotify and the socket, the pool analyzes.
+ */
+class Daemon {
+public:
+    explicit Daemon(const Options& options) : options(options), pool(options.jobs) {}
+
+    Daemon(const Daemon&) = delete;
+    auto operator=(const Daemon&) -> Daemon& = delete;
+
+    ~Daemon() {
+        for (const Client& client : clients) { ::close(client.fd); }
+        if (listener >= 0) {
+            ::close(listener);
+            ::unlink(socketPath.c_str());
+        }
+        if (inotify >= 0) { ::close(inotify); }
+    }
+
+    auto run() -> int {
+        std::string error;
+        if (!listen(error)) {
+            dbg::Macros::error(error);
+            return 1;
+        }
+        inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify < 0) {
+            dbg::Macros::error(std::string("inotify is unavailable: ") + std::strerror(errno));
+            return 1;
+        }
+
+        // directories are watched before the first analysis, so nothing written meanwhile is missed
+        std::error_code ec;
+        for (const std::string& argument : options.paths) {
+            std::filesystem::path path = absolutePath(argument);
+            if (std::filesystem::is_directory(path, ec)) {
+                watch(path, true, options.recursive);
+            } else {
+                explicitFiles.insert(path.string());
+                watch(path.parent_path(), false, false);
+            }
+        }
+        size_t failed = 0;
+        std::vector<std::string> initial;
+        for (const std::filesystem::path& file : collectFiles(options, failed)) { initial.push_back(absolutePath(file).string()); }
+        refresh(initial);
+        if (!options.quiet) {
+            dbg::Macros::info("Watching " + std::to_string(files.size()) + " file(s) in " + std::to_string(watches.size()) +
+                " director(ies), listening on " + socketPath);
+        }
+
+        struct sigaction action {};
+        action.sa_handler = [](int) { stopping = 1; };
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+
+        std::vector<pollfd> ready;
+        while (stopping == 0) {
+            ready.assign({ { inotify, POLLIN, 0 }, { listener, POLLIN, 0 } });
+            for (const Client& client : clients) { ready.push_back({ client.fd, POLLIN, 0 }); }
+            if (::poll(ready.data(), ready.size(), -1) < 0) {
+                if (errno == EINTR) { continue; }
+                dbg::Macros::error(std::string("poll failed: ") + std::strerror(errno));
+                return 1;
+            }
+            if ((ready[0].revents & POLLIN) != 0) { readEvents(); }
+            // clients first: accepting may add to the list being walked
+            for (size_t i = ready.size(); i-- > 2;) {
+                if (ready[i].revents != 0 && !serve(clients[i - 2])) {
+                    ::close(clients[i - 2].fd);
+                    clients.erase(clients.begin() + static_cast<std::ptrdiff_t>(i - 2));
+                }
+            }
+            if ((ready[1].revents & POLLIN) != 0) {
+                int fd = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+                if (fd >= 0) { clients.push_back({ fd, {} }); }
+            }
+        }
+        if (!options.quiet) { dbg::Macros::info("Stopped"); }
+        return 0;
+    }
+
+private:
+    /**
+      A watched directory.
+     */
+    struct Watch {
+        std::filesystem::path path;
+        bool all = false;       // every input file in it counts, not just the ones named on the command line
+        bool recursive = false; // directories created in it get watched too
+    };
+
+    Options options;
+    ThreadPool pool;
+    std::string socketPath;
+    int listener = -1;
+    int inotify = -1;
+    std::unordered_map<int, Watch> watches;
+    std::unordered_set<std::string> explicitFiles;
+    std::unordered_map<std::string, Annotated> files;
+    std::vector<Client> clients;
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    uint64_t analyses = 0;
+    uint64_t incremental = 0;
+    uint64_t reannotated = 0;
+    uint64_t queries = 0;
+
+    static auto absolutePath(const std::filesystem::path& path) -> std::filesystem::path {
+        std::error_code ec;
+        std::filesystem::path absolute = std::filesystem::absolute(path, ec);
+        return (ec ? path : absolute).lexically_normal();
+    }
+
+    auto listen(std::string& error) -> bool {
+        socketPath = options.socketPath;
+        if (socketPath.empty()) {
+            const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+            socketPath = runtime != nullptr && *runtime != '\0' ? std::string(runtime) + "/asm-analyze.sock"
+                                                                 : "/tmp/asm-analyze-" + std::to_string(::getuid()) + ".sock";
+        }
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            error = "The socket path " + socketPath + " is too long";
+            return false;
+        }
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+        // a socket left behind by a daemon that died is taken over, a live one is not
+        struct stat st {};
+        if (::lstat(socketPath.c_str(), &st) == 0) {
+            int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            bool live = probe >= 0 && ::connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+            if (probe >= 0) { ::close(probe); }
+            if (live) {
+                error = "Another daemon is listening on " + socketPath;
+                return false;
+            }
+            if (!S_ISSOCK(st.st_mode)) {
+                error = socketPath + " exists and is not a socket";
+                return false;
+            }
+            ::unlink(socketPath.c_str());
+        }
+
+        // the annotations are the user's sources, so only the user gets to ask: the socket is created
+        // without access for anyone else, rather than opened up for a moment until a chmod
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        mode_t mask = ::umask(0077);
+        bool bound = fd >= 0 && ::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+        int bindError = errno;
+        ::umask(mask);
+        if (!bound || ::listen(fd, 64) != 0) {
+            error = "Cannot listen on " + socketPath + ": " + std::strerror(bound ? errno : bindError);
+            if (fd >= 0) { ::close(fd); }
+            return false;
+        }
+        listener = fd;
+        return true;
+    }
+
+    // watches a directory (and with `recursive` the ones below it), returns the input files found under new ones
+    auto watch(const std::filesystem::path& directory, bool all, bool recursive) -> std::vector<std::string> {
+        std::vector<std::string> found;
+        int wd = inotify_add_watch(inotify, directory.c_str(), DIRECTORY_EVENTS);
+        if (wd < 0) {
+            dbg::Macros::warn("Cannot watch " + directory.string() + ": " + std::strerror(errno));
+            return found;
+        }
+        // the same directory may be given directly and hold a file that is named too
+        Watch& entry = watches[wd];
+        entry.path = directory;
+        entry.all = entry.all || all;
+        entry.recursive = entry.recursive || recursive;
+        if (!all) { return found; }
+
+        std::error_code ec;
+        for (auto it = std::filesystem::directory_iterator(directory, std::filesystem::directory_options::skip_permission_denied, ec);
+             !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            if (recursive && it->is_directory(ec) && !it->is_symlink(ec)) {
+                std::vector<std::string> below = watch(it->path(), true, true);
+                found.insert(found.end(), below.begin(), below.end());
+            } else if (it->is_regular_file(ec) && isInputFile(it->path())) {
+                found.push_back(it->path().string());
+            }
+        }
+        return found;
+    }
+
+    // whether a file in a watched directory is one the daemon keeps
+    auto tracked(const Watch& watched, const std::filesystem::path& path) const -> bool {
+        return explicitFiles.count(path.string()) != 0 || (watched.all && isInputFile(path));
+    }
+
+    void readEvents() {
+        std::vector<std::string> changed;
+        alignas(inotify_event) static char buffer[EVENT_BUFFER_SIZE];
+        while (true) {
+            ssize_t length = ::read(inotify, buffer, sizeof(buffer));
+            if (length <= 0) { break; }
+            for (ssize_t at = 0; at < length;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer + at);
+                at += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+                handle(*event, changed);
+            }
+        }
+        refresh(changed);
+    }
+
+    void handle(const inotify_event& event, std::vector<std::string>& changed) {
+        if ((event.mask & IN_Q_OVERFLOW) != 0) {
+            // events were lost: look at everything again, refresh() skips what didn't change
+            for (const auto& [path, file] : files) { changed.push_back(path); }
+            for (const auto& [wd, watched] : watches) {
+                if (!watched.all) { continue; }
+                std::error_code ec;
+                for (auto it = std::filesystem::directory_iterator(watched.path, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+                    if (it->is_regular_file(ec) && isInputFile(it->path())) { changed.push_back(it->path().string()); }
+                }
+            }
+            return;
+        }
+        auto found = watches.find(event.wd);
+        if (found == watches.end()) { return; }
+        if ((event.mask & IN_IGNORED) != 0) {
+            watches.erase(found);
+            return;
+        }
+        if (event.len == 0) { return; }
+        const Watch watched = found->second;
+        std::filesystem::path path = watched.path / event.name;
+
+        if ((event.mask & IN_ISDIR) != 0) {
+            if ((event.mask & (IN_CREATE | IN_MOVED_TO)) != 0 && watched.all && watched.recursive) {
+                std::vector<std::string> below = watch(path, true, true);
+                changed.insert(changed.end(), below.begin(), below.end());
+            } else if ((event.mask & (IN_DELETE | IN_MOVED_FROM)) != 0) {
+                std::string prefix = path.string() + '/';
+                std::erase_if(files, [&](const auto& entry) { return entry.first.rfind(prefix, 0) == 0; });
+            }
+            return;
+        }
+        if (!tracked(watched, path)) { return; }
+        if ((event.mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0) {
+            changed.push_back(path.string());
+        } else if ((event.mask & (IN_DELETE | IN_MOVED_FROM)) != 0) {
+            files.erase(path.string());
+            std::erase(changed, path.string());
+        }
+    }
+
+    // reads the files again and analyzes the ones whose text changed, in parallel
+    void refresh(std::vector<std::string>& paths) {
+        std::sort(paths.begin(), paths.end());
+        paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+        struct Job {
+            Annotated* file;
+            std::string path;
+            std::string text;
+            FileResult result;
+            size_t from = 0;
+            size_t count = 0;
+        };
+        std::vector<Job> jobs;
+        for (const std::string& path : paths) {
+            MappedFile mapped;
+            std::string inflated;
+            std::string error;
+            // compressed files are kept (and diffed) as the text they hold
+            compression::Codec codec = compression::codecOf(path);
+            compression::Reader reader;
+            bool readable = codec == compression::Codec::NONE ? mapped.open(path, error) : reader.open(path, codec, error) && reader.readAll(inflated);
+            if (!readable) {
+                // gone again (or never readable), it'll come back with an event if it returns
+                files.erase(path);
+                continue;
+            }
+            std::string_view text = codec == compression::Codec::NONE ? mapped.view() : std::string_view(inflated);
+            // references to the entries stay valid while the pool fills them in
+            Annotated& file = files[path];
+            if (file.known && file.source == text) { continue; }
+            jobs.push_back({ &file, path, std::string(text), {}, 0, 0 });
+        }
+        for (Job& job : jobs) {
+            pool.submit([&job, this] {
+                auto begin = std::chrono::steady_clock::now();
+                bool known = job.file->known;
+                job.result = update(*job.file, std::move(job.text), options, &pool, job.from, job.count);
+                job.result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+                if (!job.result.ok) {
+                    dbg::Macros::error(job.path + ": " + job.result.error);
+                } else if (!options.quiet && known) {
+                    dbg::Macros::info("Re-analyzed " + job.path + " (" + std::to_string(job.count) + " line(s) from line " + std::to_string(job.from) +
+                        ") in " + std::to_string(job.result.seconds) + "s");
+                }
+            });
+        }
+        pool.wait();
+
+        for (const Job& job : jobs) {
+            if (!job.file->known) {
+                files.erase(job.path);
+                continue;
+            }
+            ++analyses;
+            if (job.count + 1 < job.file->lines.size()) { ++incremental; }
+            reannotated += job.count;
+        }
+    }
+
+    // reads what the client sent and answers every complete request, false once it's gone
+    auto serve(Client& client) -> bool {
+        char buffer[REQUEST_READ_SIZE];
+        ssize_t length = ::recv(client.fd, buffer, sizeof(buffer), 0);
+        if (length <= 0) { return length < 0 && errno == EINTR; }
+        client.pending.append(buffer, static_cast<size_t>(length));
+        size_t eol = 0;
+        while ((eol = client.pending.find('\n')) != std::string::npos) {
+            std::string request = client.pending.substr(0, eol);
+            client.pending.erase(0, eol + 1);
+            if (!request.empty() && request.back() == '\r') { request.pop_back(); }
+            ++queries;
+            // answers go out with blocking sends, a client that doesn't read stalls the daemon (it's local)
+            if (!send(client.fd, answer(request))) { return false; }
+        }
+        return client.pending.size() <= MAX_REQUEST_SIZE;
+    }
+
+    static auto send(int fd, std::string_view data) -> bool {
+        while (!data.empty()) {
+            ssize_t sent = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR) { continue; }
+            if (sent <= 0) { return false; }
+            data.remove_prefix(static_cast<size_t>(sent));
+        }
+        return true;
+    }
+
+    static auto reply(std::string_view payload) -> std::string {
+        return "ok " + std::to_string(payload.size()) + '\n' + std::string(payload);
+    }
+
+    auto answer(std::string_view request) -> std::string {
+        size_t space = request.find(' ');
+        std::string_view command = request.substr(0, space);
+        std::string_view argument = space == std::string_view::npos ? std::string_view() : request.substr(space + 1);
+
+        if (command == "get" || command == "lines") {
+            uint64_t first = 1;
+            uint64_t last = UINT64_MAX;
+            std::string path(argument);
+            if (command == "lines") {
+                // lines <from> <to> <file>
+                std::istringstream in(path);
+                in >> first >> last;
+                if (!in || first == 0 || last < first) { return "error lines needs <from> <to> <file>\n"; }
+                in.get();
+                std::getline(in, path);
+            }
+            if (path.empty()) { return "error " + std::string(command) + " needs a file\n"; }
+            auto found = files.find(absolutePath(path).string());
+            if (found == files.end()) { return "error Not watched: " + path + '\n'; }
+            const Annotated& file = found->second;
+            uint64_t count = file.lines.size() - 1;
+            if (count == 0 || first > count) {
+                return first == 1 ? reply({}) : "error There are only " + std::to_string(count) + " lines\n";
+            }
+            last = std::min(last, count);
+            return reply(std::string_view(file.output).substr(file.lines[first - 1], file.lines[last] - file.lines[first - 1]));
+        }
+        if (command == "files") {
+            std::string list;
+            std::vector<const std::pair<const std::string, Annotated>*> sorted;
+            for (const auto& entry : files) { sorted.push_back(&entry); }
+            std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+            for (const auto* entry : sorted) {
+                list.append(entry->first).append("\t").append(std::to_string(entry->second.lines.size() - 1)).append("\t");
+                list.append(entry->second.architecture).append("\n");
+            }
+            return reply(list);
+        }
+        if (command == "status") {
+            size_t lines = 0;
+            size_t bytes = 0;
+            for (const auto& [path, file] : files) {
+                lines += file.lines.size() - 1;
+                bytes += file.source.size() + file.output.size() + file.lines.size() * sizeof(size_t);
+            }
+            double uptime = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+            std::ostringstream status;
+            status << std::fixed << std::setprecision(1) << files.size() << " file(s), " << lines << " lines, "
+                << static_cast<double>(bytes) / (1024.0 * 1024.0) << " MiB held; " << analyses << " analyses (" << incremental
+                << " incremental, " << reannotated << " lines annotated), " << queries << " requests, up " << uptime << "s\n";
+            return reply(status.str());
+        }
+        if (command == "stop") {
+            stopping = 1;
+            return reply({});
+        }
+        return "error Unknown request " + std::string(command) + '\n';
+    }
+};
+
+auto runDaemon(const Options& options) -> int {
+    // the log is how a daemon is followed, so it can't sit in a buffer while the daemon idles
+    std::cout << std::unitbuf;
+    Daemon daemon(options);
+    return daemon.run();
+}
+#else
+auto runDaemon(const Options& /*options*/) -> int {
+    dbg::Macros::error("daemon needs inotify, it is only available on Linux");
+    return 1;
+}
+#endif
\ No newline at end of file
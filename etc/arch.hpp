@@ -0,0 +1,205 @@
+#pragma once
+
+#include "scan.hpp"
+#include <string_view>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <queue>
+
+/**
+  Streaming instruction set detection.
+
+  All architecture markers are compiled into one Aho-Corasick automaton, so a line is scanned once
+  no matter how many markers there are. Lines (or a whole text) are fed until one of them contains
+  a marker; the analyzer settles this before annotating, since the marker picks the backend.
+ */
+class ArchDetector {
+public:
+    /**
+      Name reported when no marker was found.
+     */
+    static constexpr std::string_view UNKNOWN = "Unknown";
+
+    /**
+      Architectures in priority order: when one line holds markers of several architectures,
+      the first one listed wins.
+     */
+    static constexpr std::array<std::string_view, 7> NAMES = {
+        "x86-64", "x86", "ARM", "MIPS", "PowerPC", "RISC-V", "SPARC"
+    };
+
+    /**
+      Scans one line.
+     *
+      @param line The line to scan (markers never span lines).
+      @return Whether the architecture is known now.
+     */
+    auto feed(std::string_view line) -> bool {
+        return feedText(line);
+    }
+
+    /**
+      Scans a whole text up to the end of the first line that holds a marker, the same as feeding
+      its lines one by one.
+     *
+      @param text The text.
+      @return Whether the architecture is known now.
+     */
+    auto feedText(std::string_view text) -> bool {
+        if (found != NONE) { return true; }
+
+        // every marker starts with one of a few characters: the automaton only runs from those on,
+        // what lies between is skimmed by the kernels. No marker holds a newline, so the automaton
+        // is back at its root at every line start
+        const Automaton& automaton = Automaton::get();
+        scan::FindAnyFn findAny = scan::kernels().findAny;
+        uint16_t state = 0;
+        uint8_t best = NONE;
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (state == 0 && best == NONE) {
+                i = findAny(text, i, automaton.leads);
+                if (i == std::string_view::npos) { break; }
+            }
+            char c = text[i];
+            if (c == '\n' && best != NONE) { break; }
+            state = automaton.next(state, c);
+            best = std::min(best, automaton.output[state]);
+        }
+        found = best;
+        return found != NONE;
+    }
+
+    /**
+      @return Whether a marker has been seen.
+     */
+    [[nodiscard]] auto detected() const -> bool {
+        return found != NONE;
+    }
+
+    /**
+      @return The detected architecture, or UNKNOWN.
+     */
+    [[nodiscard]] auto name() const -> std::string_view {
+        return found == NONE ? UNKNOWN : NAMES[found];
+    }
+
+private:
+    static constexpr uint8_t NONE = 0xFF;
+
+    struct Marker {
+        std::string_view text;
+        uint8_t arch;
+    };
+
+    // arch is an index into NAMES
+    static constexpr std::array<Marker, 38> MARKERS = { {
+        { ".code64", 0 }, { ".x64", 0 }, { ".quad", 0 }, { "BITS 64", 0 },
+        { "__x86_64__", 0 }, { "__amd64__", 0 },
+        { ".code32", 1 }, { ".x86", 1 }, { "BITS 32", 1 }, { "__i386__", 1 },
+        { ".arm", 2 }, { ".thumb", 2 }, { "__ARM_ARCH", 2 }, { "__arm__", 2 }, { "__aarch64__", 2 },
+        { ".arch armv", 2 }, { ".eabi_attribute", 2 }, { ".syntax unified", 2 },
+        { ".mips", 3 }, { ".mips64", 3 }, { "__mips__", 3 }, { ".abicalls", 3 }, { ".mdebug.abi", 3 },
+        { ".ppc", 4 }, { "__powerpc__", 4 }, { "__ppc__", 4 }, { ".abiversion", 4 }, { ".localentry", 4 }, { "@ha", 4 },
+        { ".riscv", 5 }, { "__riscv", 5 }, { "rv32i", 5 }, { "rv64i", 5 }, { ".option pic", 5 }, { ".option nopic", 5 },
+        { ".sparc", 6 }, { "__sparc__", 6 }, { "#function", 6 }
+    } };
+
+    // the first characters of the markers have to fit one scan::CharSet
+    static constexpr auto leadCount() -> size_t {
+        size_t count = 0;
+        for (size_t i = 0; i < MARKERS.size(); ++i) {
+            bool seen = false;
+            for (size_t j = 0; j < i; ++j) { seen = seen || MARKERS[j].text[0] == MARKERS[i].text[0]; }
+            if (!seen) { ++count; }
+        }
+        return count;
+    }
+
+    /**
+      The compiled automaton, a full DFA over the characters that occur in the markers.
+     */
+    struct Automaton {
+        std::array<uint8_t, 256> classes{};
+        size_t width = 1;                // number of character classes, class 0 is "anything else"
+        std::vector<uint16_t> delta;     // state * width + class -> state
+        std::vector<uint8_t> output;     // best architecture matched when entering the state
+        scan::CharSet leads{};           // the first characters of the markers
+
+        [[nodiscard]] auto next(uint16_t state, char c) const -> uint16_t {
+            return delta[state * width + classes[static_cast<unsigned char>(c)]];
+        }
+
+        static auto get() -> const Automaton& {
+            static const Automaton automaton = build();
+            return automaton;
+        }
+
+        static auto build() -> Automaton {
+            static_assert(leadCount() <= std::tuple_size_v<scan::CharSet>);
+            Automaton a;
+            size_t leads = 0;
+            for (const Marker& marker : MARKERS) {
+                if (std::find(a.leads.begin(), a.leads.begin() + leads, marker.text[0]) == a.leads.begin() + leads) {
+                    a.leads[leads++] = marker.text[0];
+                }
+            }
+            std::fill(a.leads.begin() + leads, a.leads.end(), a.leads[0]);
+            for (const Marker& marker : MARKERS) {
+                for (char c : marker.text) {
+                    uint8_t& cls = a.classes[static_cast<unsigned char>(c)];
+                    if (cls == 0) { cls = static_cast<uint8_t>(a.width++); }
+                }
+            }
+
+            // trie (0 = no edge, the root can't be a target)
+            std::vector<uint16_t> trie(a.width, 0);
+            a.output.assign(1, NONE);
+            for (const Marker& marker : MARKERS) {
+                size_t state = 0;
+                for (char c : marker.text) {
+                    size_t slot = state * a.width + a.classes[static_cast<unsigned char>(c)];
+                    if (trie[slot] == 0) {
+                        trie[slot] = static_cast<uint16_t>(a.output.size());
+                        a.output.push_back(NONE);
+                        trie.resize(a.output.size() * a.width, 0);
+                    }
+                    state = trie[slot];
+                }
+                a.output[state] = std::min(a.output[state], marker.arch);
+            }
+
+            // breadth first: fill missing edges from the failure state and inherit its output
+            size_t states = a.output.size();
+            a.delta.assign(states * a.width, 0);
+            std::vector<uint16_t> fail(states, 0);
+            std::queue<uint16_t> queue;
+            for (size_t cls = 0; cls < a.width; ++cls) {
+                if (uint16_t child = trie[cls]; child != 0) {
+                    a.delta[cls] = child;
+                    queue.push(child);
+                }
+            }
+            while (!queue.empty()) {
+                uint16_t state = queue.front();
+                queue.pop();
+                a.output[state] = std::min(a.output[state], a.output[fail[state]]);
+                for (size_t cls = 0; cls < a.width; ++cls) {
+                    uint16_t child = trie[state * a.width + cls];
+                    uint16_t fallback = a.delta[fail[state] * a.width + cls];
+                    if (child != 0) {
+                        fail[child] = fallback;
+                        a.delta[state * a.width + cls] = child;
+                        queue.push(child);
+                    } else {
+                        a.delta[state * a.width + cls] = fallback;
+                    }
+                }
+            }
+            return a;
+        }
+    };
+
+    uint8_t found = NONE;
+};
\ No newline at end of file
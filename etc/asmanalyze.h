@@ -0,0 +1,106 @@
+/*
+  C interface of libasmanalyze.
+
+  Every function is reentrant and may be called from any number of threads at once; nothing in
+  the library exits the process, prompts or prints, failures come back as a status and a message.
+  Results are owned by the caller and released with asm_analyze_result_free.
+
+    asm_analyze_result* result = NULL;
+    if (asm_analyze_buffer(text, length, NULL, &result) == ASM_ANALYZE_OK) {
+        size_t size = 0;
+        const char* annotated = asm_analyze_result_output(result, &size);
+        ...
+    } else if (result != NULL) {
+        fprintf(stderr, "%s\n", asm_analyze_result_error(result));
+    }
+    asm_analyze_result_free(result);
+ */
+
+#ifndef ASM_ANALYZE_H
+#define ASM_ANALYZE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(ASM_ANALYZE_SHARED)
+#ifdef ASM_ANALYZE_EXPORTS
+#define ASM_ANALYZE_API __declspec(dllexport)
+#else
+#define ASM_ANALYZE_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define ASM_ANALYZE_API __attribute__((visibility("default")))
+#else
+#define ASM_ANALYZE_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum asm_analyze_status {
+    ASM_ANALYZE_OK = 0,
+    ASM_ANALYZE_INVALID_ARGUMENT = 1,
+    ASM_ANALYZE_IO_ERROR = 2,
+    ASM_ANALYZE_OUT_OF_MEMORY = 3,
+    ASM_ANALYZE_INTERNAL_ERROR = 4
+} asm_analyze_status;
+
+typedef enum asm_analyze_records {
+    ASM_ANALYZE_RECORDS_NONE = 0,
+    ASM_ANALYZE_RECORDS_JSONL = 1,  /* one JSON object per line */
+    ASM_ANALYZE_RECORDS_BINARY = 2  /* the mappable format of etc/records.hpp */
+} asm_analyze_records;
+
+/*
+  Settings of an analysis, fill them in with asm_analyze_options_init (passing NULL instead means
+  the defaults).
+ */
+typedef struct asm_analyze_options {
+    uint32_t size;                /* sizeof(asm_analyze_options), set by asm_analyze_options_init */
+    asm_analyze_records records;  /* default: none */
+    int header;                   /* nonzero starts the output with the information header (default: 1) */
+    /* later additions: callers built against an older header pass a smaller size and get the defaults */
+    int cfg;                      /* nonzero adds basic block, loop and cost summaries (default: 0) */
+    const char* cpu;              /* processor model for the costs, implies cfg; NULL: the instruction set's default */
+} asm_analyze_options;
+
+/* Outcome of an analysis (opaque). */
+typedef struct asm_analyze_result asm_analyze_result;
+
+ASM_ANALYZE_API void asm_analyze_options_init(asm_analyze_options* options);
+
+/*
+  Analyzes text in memory.
+
+  On success *result holds the annotated copy (and the records, if requested). On failure it
+  holds the reason, unless memory for it couldn't be allocated (then it's NULL).
+ */
+ASM_ANALYZE_API asm_analyze_status asm_analyze_buffer(const char* data, size_t size, const asm_analyze_options* options, asm_analyze_result** result);
+
+/*
+  Analyzes a file the way the command line tool does: the annotated copy (and the records) are
+  written next to it, *result only holds the counts and the architecture.
+ */
+ASM_ANALYZE_API asm_analyze_status asm_analyze_file(const char* path, const asm_analyze_options* options, asm_analyze_result** result);
+
+/* The annotated copy (empty after asm_analyze_file), not NUL terminated: *size receives its length. */
+ASM_ANALYZE_API const char* asm_analyze_result_output(const asm_analyze_result* result, size_t* size);
+/* The records (empty unless requested). */
+ASM_ANALYZE_API const char* asm_analyze_result_records(const asm_analyze_result* result, size_t* size);
+/* The detected instruction set, "Unknown" without a marker. */
+ASM_ANALYZE_API const char* asm_analyze_result_architecture(const asm_analyze_result* result);
+ASM_ANALYZE_API uint64_t asm_analyze_result_lines(const asm_analyze_result* result);
+ASM_ANALYZE_API uint64_t asm_analyze_result_bytes(const asm_analyze_result* result);
+/* Why the analysis failed, "" if it didn't. */
+ASM_ANALYZE_API const char* asm_analyze_result_error(const asm_analyze_result* result);
+ASM_ANALYZE_API void asm_analyze_result_free(asm_analyze_result* result);
+
+ASM_ANALYZE_API const char* asm_analyze_status_string(asm_analyze_status status);
+ASM_ANALYZE_API const char* asm_analyze_version(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <unordered_map>
+#include <system_error>
+#include <type_traits>
+#include <filesystem>
+#include <algorithm>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <set>
+
+/**
+  A persistent, content-addressed store of analyzed files.
+
+  Every entry is one `<key>.out` file holding an `_analyzed` output, the key being a hash of the
+  input (seeded with the tool version). A binary index with the metadata of all entries is read
+  with a single read at startup and rewritten by save(). When the entries outgrow the capacity,
+  the least recently used ones are evicted.
+ */
+class ResultCache {
+public:
+    /**
+      What the index remembers about an entry.
+     */
+    struct Entry {
+        uint64_t key = 0;
+        uint64_t outputBytes = 0;
+        uint64_t inputBytes = 0;
+        uint64_t lines = 0;
+        uint64_t lastUsed = 0;  // value of the use counter, higher is more recent
+        double seconds = 0;     // how long the analysis took, i.e. what a hit saves
+    };
+
+    /**
+      Opens (or creates) a cache directory.
+     *
+      @param dir The directory holding the entries and the index.
+      @param bytes Capacity, the outputs are evicted down to this size.
+      @param error Receives the reason on failure.
+      @return Whether the cache can be used.
+     */
+    auto open(const std::filesystem::path& dir, uint64_t bytes, std::string& error) -> bool {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if (ec) {
+            error = "Cannot create " + dir.string() + ": " + ec.message();
+            return false;
+        }
+        root = dir;
+        capacity = bytes;
+        load();
+        return true;
+    }
+
+    /**
+      @return Whether open() succeeded.
+     */
+    [[nodiscard]] auto enabled() const -> bool {
+        return !root.empty();
+    }
+
+    /**
+      Copies the output stored under a key to a file.
+     *
+      @param key Hash of the input.
+      @param to Where the output goes.
+      @param entry Receives the metadata of the entry.
+      @return Whether it was a hit.
+     */
+    auto fetch(uint64_t key, const std::filesystem::path& to, Entry& entry) -> bool {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(key);
+            if (it == entries.end()) {
+                ++missCount;
+                return false;
+            }
+            recency.erase({ it->second.lastUsed, key });
+            it->second.lastUsed = ++clock;
+            recency.emplace(it->second.lastUsed, key);
+            entry = it->second;
+            dirty = true;
+        }
+
+        std::error_code ec;
+        std::filesystem::copy_file(pathOf(key), to, std::filesystem::copy_options::overwrite_existing, ec);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ec) {
+            // the file went missing (or another process evicted it), forget the entry
+            if (auto it = entries.find(key); it != entries.end()) {
+                total -= it->second.outputBytes;
+                recency.erase({ it->second.lastUsed, key });
+                entries.erase(it);
+            }
+            ++missCount;
+            return false;
+        }
+        ++hitCount;
+        savedSeconds += entry.seconds;
+        return true;
+    }
+
+    /**
+      Stores an output, evicting old entries if that goes over capacity.
+     *
+      @param entry Its metadata (outputBytes and lastUsed are filled in).
+      @param from The output file to store.
+      @return Whether it was stored.
+     */
+    auto store(Entry entry, const std::filesystem::path& from) -> bool {
+        std::error_code ec;
+        entry.outputBytes = std::filesystem::file_size(from, ec);
+        if (ec || entry.outputBytes > capacity) { return false; }
+
+        // copy next to the entry and rename, a reader never sees a partial file
+        std::filesystem::path temporary = pathOf(entry.key);
+        temporary += ".tmp" + std::to_string(++temporaries);
+        std::filesystem::copy_file(from, temporary, std::filesystem::copy_options::overwrite_existing, ec);
+        if (!ec) { std::filesystem::rename(temporary, pathOf(entry.key), ec); }
+        if (ec) {
+            std::filesystem::remove(temporary, ec);
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        entry.lastUsed = ++clock;
+        auto [it, inserted] = entries.try_emplace(entry.key, entry);
+        if (!inserted) {
+            total -= it->second.outputBytes;
+            recency.erase({ it->second.lastUsed, entry.key });
+            it->second = entry;
+        }
+        recency.emplace(entry.lastUsed, entry.key);
+        total += entry.outputBytes;
+        dirty = true;
+        evict();
+        return true;
+    }
+
+    /**
+      Writes the index if anything changed.
+     *
+      @return Whether the index is on disk.
+     */
+    auto save() -> bool {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!enabled() || !dirty) { return true; }
+
+        std::vector<Entry> records;
+        records.reserve(entries.size());
+        for (const auto& [key, entry] : entries) { records.push_back(entry); }
+
+        Header header;
+        header.count = records.size();
+        std::filesystem::path index = root / INDEX;
+        std::filesystem::path temporary = root / (std::string(INDEX) + ".tmp");
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(Entry)));
+            if (!file) { return false; }
+        }
+        std::error_code ec;
+        std::filesystem::rename(temporary, index, ec);
+        dirty = static_cast<bool>(ec);
+        return !ec;
+    }
+
+    [[nodiscard]] auto hits() const -> size_t { return hitCount; }
+    [[nodiscard]] auto misses() const -> size_t { return missCount; }
+    [[nodiscard]] auto saved() const -> double { return savedSeconds; }
+
+private:
+    static constexpr const char* INDEX = "index.bin";
+    static constexpr uint32_t FORMAT = 1;
+
+    struct Header {
+        char magic[8] = { 'a', 's', 'm', 'c', 'a', 'c', 'h', 'e' };
+        uint32_t format = FORMAT;
+        uint32_t entrySize = sizeof(Entry);
+        uint64_t count = 0;
+    };
+    static_assert(std::is_trivially_copyable_v<Entry> && std::is_trivially_copyable_v<Header>);
+
+    std::filesystem::path root;
+    uint64_t capacity = 0;
+    std::unordered_map<uint64_t, Entry> entries;
+    std::set<std::pair<uint64_t, uint64_t>> recency; // (lastUsed, key) of every entry, least recently used first
+    uint64_t total = 0;
+    uint64_t clock = 0;
+    bool dirty = false;
+    size_t hitCount = 0;
+    size_t missCount = 0;
+    double savedSeconds = 0;
+    std::atomic<uint64_t> temporaries{ 0 };
+    std::mutex mutex;
+
+    [[nodiscard]] auto pathOf(uint64_t key) const -> std::filesystem::path {
+        char name[17];
+        for (int i = 15; i >= 0; --i, key >>= 4) { name[i] = "0123456789abcdef"[key & 15]; }
+        name[16] = '\0';
+        return root / (std::string(name) + ".out");
+    }
+
+    // an unreadable or foreign index is treated as empty, its entries simply get re-analyzed
+    void load() {
+        std::error_code ec;
+        uint64_t size = std::filesystem::file_size(root / INDEX, ec);
+        std::ifstream file(root / INDEX, std::ios::binary);
+        Header header;
+        Header expected;
+        if (ec || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+            header.format != FORMAT || header.entrySize != sizeof(Entry) ||
+            header.count != (size - sizeof(Header)) / sizeof(Entry)) {
+            return;
+        }
+
+        std::vector<Entry> records(header.count);
+        if (!file.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(Entry)))) {
+            return;
+        }
+        entries.reserve(records.size());
+        for (const Entry& entry : records) {
+            if (!entries.emplace(entry.key, entry).second) { continue; }
+            recency.emplace(entry.lastUsed, entry.key);
+            total += entry.outputBytes;
+            clock = std::max(clock, entry.lastUsed);
+        }
+        evict();
+    }
+
+    // least recently used first, callers hold the mutex
+    void evict() {
+        while (total > capacity && !recency.empty()) {
+            uint64_t key = recency.begin()->second;
+            recency.erase(recency.begin());
+            auto oldest = entries.find(key);
+            std::error_code ec;
+            std::filesystem::remove(pathOf(key), ec);
+            total -= oldest->second.outputBytes;
+            entries.erase(oldest);
+            dirty = true;
+        }
+    }
+};
\ No newline at end of file
@@ -0,0 +1,256 @@
+#pragma once
+
+#include "ir.hpp"
+#include "isa.hpp"
+#include <unordered_map>
+#include <string_view>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <array>
+
+/**
+  Basic blocks, control flow and loops of a tokenized text.
+
+  A basic block is a run of lines entered only at its first line and left only after its last
+  instruction: blocks start at labels and after jumps, branches and returns (past the delay slot on
+  instruction sets that have one). Calls don't end blocks, the callee is assumed to return. Lines
+  that aren't instructions (directives, blank lines) belong to the block they're in, so the blocks
+  cover the whole text.
+
+  Loops are the natural loops of the back edges a depth-first search finds. Headers are visited
+  innermost first and every loop found is collapsed into its header (Havlak's approach), so an
+  outer loop walks each inner one as a single node and building the whole loop forest stays
+  linear in the number of blocks and edges.
+ */
+namespace cfg {
+    /**
+      No block, no loop.
+     */
+    constexpr uint32_t NONE = UINT32_MAX;
+
+    struct BasicBlock {
+        uint32_t first = 0;         // first line
+        uint32_t end = 0;           // one past the last line
+        uint32_t instructions = 0;
+        std::array<uint32_t, 2> successors{ NONE, NONE }; // the next block when it falls through, then the jump target
+        uint32_t loop = NONE;       // innermost loop it belongs to
+    };
+
+    struct Loop {
+        uint32_t header = 0;        // block
+        uint32_t parent = NONE;     // enclosing loop
+        uint32_t depth = 1;         // 1 for loops that aren't nested
+        uint32_t blocks = 0;        // including those of nested loops
+        uint32_t firstBlock = NONE; // lowest and highest block index in it
+        uint32_t lastBlock = 0;
+    };
+
+    class Graph {
+    public:
+        std::vector<BasicBlock> blocks;  // in line order
+        std::vector<Loop> loops;         // inner loops before the loops around them
+
+        /**
+          Splits a tokenized text into basic blocks, links them and finds its loops.
+         *
+          @param block The whole text (control flow may cross any point of it).
+         */
+        template <typename Isa>
+        void build(const ir::Block& block) {
+            blocks.clear();
+            loops.clear();
+            std::unordered_map<std::string_view, uint32_t> labels;
+            std::vector<uint32_t> exits; // per block: the line of the jump, branch or return ending it
+            auto open = [&](size_t line) {
+                if (!blocks.empty()) { blocks.back().end = static_cast<uint32_t>(line); }
+                blocks.push_back({ static_cast<uint32_t>(line) });
+                exits.push_back(NONE);
+            };
+
+            open(0);
+            bool ended = false;  // the current block can't take more instructions
+            bool delay = false;  // its exit has been seen, the delay slot hasn't
+            for (size_t i = 0; i < block.lines(); ++i) {
+                records::LineKind kind = block.kind[i];
+                if (kind == records::LineKind::LABEL) {
+                    // consecutive labels (and what's between them) name the same block
+                    if (blocks.back().instructions != 0 || ended || delay) { open(i); }
+                    ended = false;
+                    delay = false;
+                    labels.emplace(block.view(i, block.name[i]), static_cast<uint32_t>(blocks.size() - 1));
+                    continue;
+                }
+                if (kind != records::LineKind::INSTRUCTION && kind != records::LineKind::UNKNOWN) { continue; }
+
+                isa::Operation operation = kind == records::LineKind::UNKNOWN ? isa::Operation::UNKNOWN : Isa::operation(block.opcode[i]);
+                if (operation == isa::Operation::PSEUDO) { continue; }
+                if (ended) {
+                    open(i);
+                    ended = false;
+                }
+                ++blocks.back().instructions;
+                if (delay) {
+                    delay = false;
+                    ended = true;
+                } else if (isa::endsBlock(operation)) {
+                    exits.back() = static_cast<uint32_t>(i);
+                    (Isa::DELAY_SLOTS ? delay : ended) = true;
+                }
+            }
+            blocks.back().end = static_cast<uint32_t>(block.lines());
+
+            for (size_t b = 0; b < blocks.size(); ++b) {
+                uint32_t next = b + 1 < blocks.size() ? static_cast<uint32_t>(b + 1) : NONE;
+                uint32_t exit = exits[b];
+                if (exit == NONE) {
+                    blocks[b].successors[0] = next;
+                    continue;
+                }
+                isa::Operation operation = Isa::operation(block.opcode[exit]);
+                if (operation == isa::Operation::BRANCH) { blocks[b].successors[0] = next; }
+                if (operation == isa::Operation::RETURN) { continue; }
+
+                // the target is the label operand (the last one if several), jumps elsewhere leave the text
+                size_t count = block.operandCount(exit);
+                if (count == 0) { continue; }
+                size_t target = block.firstOperand[exit] + count - 1;
+                for (size_t o = block.firstOperand[exit]; o < block.firstOperand[exit + 1]; ++o) {
+                    if (block.operandKind[o] == records::OperandKind::LABEL) { target = o; }
+                }
+                auto found = labels.find(block.view(exit, block.operand[target]));
+                if (found != labels.end() && found->second != blocks[b].successors[0]) { blocks[b].successors[1] = found->second; }
+            }
+
+            findLoops();
+        }
+
+        /**
+          @return How many loops a block is in.
+         */
+        [[nodiscard]] auto depth(uint32_t block) const -> uint32_t {
+            return blocks[block].loop == NONE ? 0 : loops[blocks[block].loop].depth;
+        }
+
+    private:
+        void findLoops() {
+            auto count = static_cast<uint32_t>(blocks.size());
+
+            // predecessors, flattened
+            std::vector<uint32_t> firstPredecessor(count + 1, 0);
+            for (const BasicBlock& block : blocks) {
+                for (uint32_t next : block.successors) {
+                    if (next != NONE) { ++firstPredecessor[next + 1]; }
+                }
+            }
+            for (uint32_t b = 0; b < count; ++b) { firstPredecessor[b + 1] += firstPredecessor[b]; }
+            std::vector<uint32_t> predecessors(firstPredecessor[count]);
+            {
+                std::vector<uint32_t> fill(firstPredecessor.begin(), firstPredecessor.end() - 1);
+                for (uint32_t b = 0; b < count; ++b) {
+                    for (uint32_t next : blocks[b].successors) {
+                        if (next != NONE) { predecessors[fill[next]++] = b; }
+                    }
+                }
+            }
+
+            // depth-first numbering; an edge to a block still on the stack is a back edge
+            std::vector<uint32_t> preorder(count, NONE);
+            std::vector<uint32_t> last(count, 0);    // highest preorder number in the block's subtree
+            std::vector<uint8_t> onStack(count, 0);
+            std::vector<std::pair<uint32_t, uint32_t>> backEdges; // header, latch
+            std::vector<std::pair<uint32_t, uint32_t>> stack;     // block, next successor to follow
+            uint32_t number = 0;
+            for (uint32_t root = 0; root < count; ++root) {
+                if (preorder[root] != NONE) { continue; }
+                auto enter = [&](uint32_t b) {
+                    preorder[b] = number++;
+                    onStack[b] = 1;
+                    stack.emplace_back(b, 0);
+                };
+                enter(root);
+                while (!stack.empty()) {
+                    auto& [b, next] = stack.back();
+                    if (next == blocks[b].successors.size()) {
+                        last[b] = number - 1;
+                        onStack[b] = 0;
+                        stack.pop_back();
+                        continue;
+                    }
+                    uint32_t successor = blocks[b].successors[next++];
+                    if (successor == NONE) { continue; }
+                    if (preorder[successor] == NONE) {
+                        enter(successor);
+                    } else if (onStack[successor] != 0) {
+                        backEdges.emplace_back(successor, b);
+                    }
+                }
+            }
+
+            // innermost (highest numbered) headers first
+            std::sort(backEdges.begin(), backEdges.end(), [&](const auto& a, const auto& b) { return preorder[a.first] > preorder[b.first]; });
+            std::vector<uint32_t> representative(count); // the header of the outermost loop found so far around a block
+            for (uint32_t b = 0; b < count; ++b) { representative[b] = b; }
+            auto find = [&](uint32_t b) {
+                uint32_t root = b;
+                while (representative[root] != root) { root = representative[root]; }
+                while (representative[b] != root) { b = std::exchange(representative[b], root); }
+                return root;
+            };
+            std::vector<uint32_t> loopOf(count, NONE); // loop headed by a block
+            std::vector<uint32_t> seen(count, NONE);   // header whose body search reached the block last
+            std::vector<uint32_t> work;
+            std::vector<uint32_t> body;
+            for (size_t e = 0; e < backEdges.size();) {
+                uint32_t header = backEdges[e].first;
+                auto inside = [&](uint32_t b) { return preorder[b] >= preorder[header] && preorder[b] <= last[header]; };
+                body.clear();
+                for (; e < backEdges.size() && backEdges[e].first == header; ++e) {
+                    uint32_t latch = find(backEdges[e].second);
+                    if (latch != header && seen[latch] != header) {
+                        seen[latch] = header;
+                        work.push_back(latch);
+                    }
+                }
+                while (!work.empty()) {
+                    uint32_t b = work.back();
+                    work.pop_back();
+                    body.push_back(b);
+                    for (uint32_t p = firstPredecessor[b]; p < firstPredecessor[b + 1]; ++p) {
+                        uint32_t from = find(predecessors[p]);
+                        // entries from outside the header's subtree would make the loop irreducible, they're left out
+                        if (from == header || seen[from] == header || !inside(from)) { continue; }
+                        seen[from] = header;
+                        work.push_back(from);
+                    }
+                }
+
+                auto id = static_cast<uint32_t>(loops.size());
+                Loop loop{ header, NONE, 1, 1, header, header };
+                blocks[header].loop = id;
+                for (uint32_t b : body) {
+                    representative[b] = header;
+                    if (uint32_t inner = loopOf[b]; inner != NONE) {
+                        loops[inner].parent = id;
+                        loop.blocks += loops[inner].blocks;
+                        loop.firstBlock = std::min(loop.firstBlock, loops[inner].firstBlock);
+                        loop.lastBlock = std::max(loop.lastBlock, loops[inner].lastBlock);
+                    } else {
+                        blocks[b].loop = id;
+                        ++loop.blocks;
+                        loop.firstBlock = std::min(loop.firstBlock, b);
+                        loop.lastBlock = std::max(loop.lastBlock, b);
+                    }
+                }
+                loopOf[header] = id;
+                loops.push_back(loop);
+            }
+
+            // parents come after their children
+            for (size_t l = loops.size(); l-- > 0;) {
+                if (loops[l].parent != NONE) { loops[l].depth = loops[loops[l].parent].depth + 1; }
+            }
+        }
+    };
+}
\ No newline at end of file
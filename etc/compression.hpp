@@ -0,0 +1,514 @@
+#pragma once
+
+#include "output.hpp"
+#include <condition_variable>
+#include <string_view>
+#include <filesystem>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// 1 reads and writes .gz files through zlib, and .zst files through libzstd: the build links them
+#ifndef ASM_ANALYZE_ZLIB
+#define ASM_ANALYZE_ZLIB 0
+#endif
+#ifndef ASM_ANALYZE_ZSTD
+#define ASM_ANALYZE_ZSTD 0
+#endif
+
+#if ASM_ANALYZE_ZLIB && __has_include(<zlib.h>)
+#define ASM_ANALYZE_HAS_ZLIB 1
+#include <zlib.h>
+#else
+#define ASM_ANALYZE_HAS_ZLIB 0
+#endif
+
+#if ASM_ANALYZE_ZSTD && __has_include(<zstd.h>)
+#define ASM_ANALYZE_HAS_ZSTD 1
+#include <zstd.h>
+#else
+#define ASM_ANALYZE_HAS_ZSTD 0
+#endif
+
+/**
+  Compressed inputs (<name>.<ext>.gz and .zst) and compressed annotated copies.
+
+  A compressed file is inflated on a thread of its own, in chunks handed to the analysis through
+  a short queue: inflating the next chunk overlaps with analyzing the last one, and the decompressed
+  text never has to be held (or written to a temporary file) all at once.
+ */
+namespace compression {
+    enum class Codec : uint8_t { NONE, GZIP, ZSTD };
+
+    /**
+      @return The file extension of a codec, with its dot (empty for NONE).
+     */
+    inline auto extension(Codec codec) -> std::string_view {
+        switch (codec) {
+        case Codec::GZIP: return ".gz";
+        case Codec::ZSTD: return ".zst";
+        case Codec::NONE: break;
+        }
+        return "";
+    }
+
+    inline auto name(Codec codec) -> std::string_view {
+        switch (codec) {
+        case Codec::GZIP: return "gzip";
+        case Codec::ZSTD: return "zstd";
+        case Codec::NONE: break;
+        }
+        return "plain";
+    }
+
+    /**
+      @return Whether this build reads and writes a codec.
+     */
+    inline auto compiled(Codec codec) -> bool {
+        switch (codec) {
+        case Codec::GZIP: return ASM_ANALYZE_HAS_ZLIB != 0;
+        case Codec::ZSTD: return ASM_ANALYZE_HAS_ZSTD != 0;
+        case Codec::NONE: break;
+        }
+        return true;
+    }
+
+    /**
+      @return The codec a file is compressed with, going by its last extension (NONE for any other).
+     */
+    inline auto codecOf(const std::filesystem::path& path) -> Codec {
+        std::string extension = path.extension().string();
+        for (char& c : extension) {
+            c = static_cast<char>(tolower(c));
+        }
+        if (extension == ".gz") { return Codec::GZIP; }
+        if (extension == ".zst") { return Codec::ZSTD; }
+        return Codec::NONE;
+    }
+
+    /**
+      @return The name of what a file holds, without the compression's extension (foo.s.gz -> foo.s).
+     */
+    inline auto uncompressedPath(const std::filesystem::path& path) -> std::filesystem::path {
+        std::filesystem::path source = path;
+        if (codecOf(path) != Codec::NONE) { source.replace_extension(); }
+        return source;
+    }
+
+    /**
+      @return The codec a --compress value names, NONE for an unknown one.
+     */
+    inline auto parse(std::string_view value) -> Codec {
+        if (value == "gz" || value == "gzip") { return Codec::GZIP; }
+        if (value == "zst" || value == "zstd") { return Codec::ZSTD; }
+        return Codec::NONE;
+    }
+
+    /**
+      Decompresses a file on a thread of its own, into chunks taken in order with next().
+     */
+    class Reader {
+    public:
+        static constexpr size_t CHUNK_SIZE = 1 << 20;   // decompressed bytes handed over at once
+        static constexpr size_t QUEUE_CHUNKS = 4;       // chunks decompressed ahead of the reader at most
+        static constexpr size_t INPUT_SIZE = 256 << 10; // compressed bytes read at once
+
+        Reader() = default;
+        Reader(const Reader&) = delete;
+        auto operator=(const Reader&) -> Reader& = delete;
+
+        ~Reader() {
+            close();
+        }
+
+        /**
+          Opens a file and starts decompressing it.
+         *
+          @param filename The file.
+          @param codec What it's compressed with.
+          @param error Receives the reason it can't be read.
+          @return Whether the file is being decompressed.
+         */
+        auto open(const std::string& filename, Codec codec, std::string& error) -> bool {
+            close();
+            if (codec == Codec::NONE || !compiled(codec)) {
+                error = "This build can't read " + std::string(name(codec)) + " files";
+                return false;
+            }
+#ifdef _WIN32
+            fd = _open(filename.c_str(), _O_RDONLY | _O_BINARY);
+#else
+            fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+            if (fd < 0) {
+                error = "File not found!";
+                return false;
+            }
+            stopping = false;
+            finished = false;
+            failure.clear();
+            worker = std::thread([this, codec] { run(codec); });
+            return true;
+        }
+
+        /**
+          Takes the next chunk, waiting for it to be decompressed.
+         *
+          @param chunk Replaced by the chunk (the buffer it held is reused for a later one).
+          @return False once the file has been read, or when reading it failed (error() tells).
+         */
+        auto next(std::string& chunk) -> bool {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return !ready.empty() || finished; });
+            if (ready.empty()) { return false; }
+            spare.push_back(std::move(chunk));
+            chunk = std::move(ready.front());
+            ready.pop_front();
+            changed.notify_all();
+            return true;
+        }
+
+        /**
+          Appends the rest of the file to a text.
+         *
+          @return Whether it was read to the end (error() tells otherwise).
+         */
+        auto readAll(std::string& text) -> bool {
+            std::string chunk;
+            while (next(chunk)) { text += chunk; }
+            return error().empty();
+        }
+
+        /**
+          @return Why decompressing failed, empty while it hasn't.
+         */
+        [[nodiscard]] auto error() -> std::string {
+            std::lock_guard<std::mutex> lock(mutex);
+            return failure;
+        }
+
+        /**
+          Stops decompressing (if it's still going) and closes the file.
+         */
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            changed.notify_all();
+            if (worker.joinable()) { worker.join(); }
+            if (fd >= 0) {
+#ifdef _WIN32
+                _close(fd);
+#else
+                ::close(fd);
+#endif
+            }
+            fd = -1;
+            ready.clear();
+            spare.clear();
+        }
+
+    private:
+        int fd = -1;
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable changed; // both ways: a chunk is ready, or one was taken
+        std::deque<std::string> ready;
+        std::vector<std::string> spare;  // buffers of chunks taken, for the next ones
+        bool stopping = false;
+        bool finished = false;
+        std::string failure;
+
+        void run([[maybe_unused]] Codec codec) {
+            std::string reason;
+#if ASM_ANALYZE_HAS_ZLIB
+            if (codec == Codec::GZIP) { inflateGzip(reason); }
+#endif
+#if ASM_ANALYZE_HAS_ZSTD
+            if (codec == Codec::ZSTD) { decompressZstd(reason); }
+#endif
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = true;
+            failure = std::move(reason);
+            changed.notify_all();
+        }
+
+        // the next bytes of the file, -1 if reading failed
+        auto readInput(std::vector<char>& input) -> long {
+            while (true) {
+#ifdef _WIN32
+                long count = _read(fd, input.data(), static_cast<unsigned>(input.size()));
+#else
+                long count = ::read(fd, input.data(), input.size());
+                if (count < 0 && errno == EINTR) { continue; }
+#endif
+                return count;
+            }
+        }
+
+        // queues a full chunk, waiting for room, and gives it a spare buffer; false when closing
+        auto push(std::string& chunk, size_t used) -> bool {
+            chunk.resize(used);
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return ready.size() < QUEUE_CHUNKS || stopping; });
+            if (stopping) { return false; }
+            ready.push_back(std::move(chunk));
+            chunk.clear();
+            if (!spare.empty()) {
+                chunk = std::move(spare.back());
+                spare.pop_back();
+            }
+            changed.notify_all();
+            lock.unlock();
+            chunk.resize(CHUNK_SIZE);
+            return true;
+        }
+
+#if ASM_ANALYZE_HAS_ZLIB
+        void inflateGzip(std::string& reason) {
+            z_stream stream{};
+            // 15 + 32: a window of any size, behind a gzip (or zlib) header
+            if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+                reason = "Cannot set up zlib";
+                return;
+            }
+            std::vector<char> input(INPUT_SIZE);
+            std::string chunk(CHUNK_SIZE, '\0');
+            size_t used = 0;
+            bool eof = false;
+            while (true) {
+                if (stream.avail_in == 0 && !eof) {
+                    long count = readInput(input);
+                    if (count < 0) {
+                        reason = std::string("Cannot read the file: ") + std::strerror(errno);
+                        break;
+                    }
+                    eof = count == 0;
+                    stream.next_in = reinterpret_cast<Bytef*>(input.data());
+                    stream.avail_in = static_cast<uInt>(count);
+                }
+                stream.next_out = reinterpret_cast<Bytef*>(chunk.data() + used);
+                stream.avail_out = static_cast<uInt>(CHUNK_SIZE - used);
+                int status = inflate(&stream, Z_NO_FLUSH);
+                used = CHUNK_SIZE - stream.avail_out;
+                if (status == Z_STREAM_END) {
+                    // gzip files may hold several members, one after the other (cat a.gz b.gz)
+                    inflateReset(&stream);
+                } else if (status != Z_OK && status != Z_BUF_ERROR) {
+                    reason = std::string("Corrupt gzip data") + (stream.msg != nullptr ? std::string(": ") + stream.msg : "");
+                    break;
+                }
+                if (used == CHUNK_SIZE) {
+                    if (!push(chunk, used)) { break; }
+                    used = 0;
+                } else if (stream.avail_in == 0 && eof) {
+                    // a member started but not finished (total_in restarts with every member)
+                    if (stream.total_in != 0) { reason = "Truncated gzip data"; }
+                    if (used != 0) { push(chunk, used); }
+                    break;
+                }
+            }
+            inflateEnd(&stream);
+        }
+#endif
+
+#if ASM_ANALYZE_HAS_ZSTD
+        void decompressZstd(std::string& reason) {
+            ZSTD_DCtx* stream = ZSTD_createDCtx();
+            if (stream == nullptr) {
+                reason = "Cannot set up zstd";
+                return;
+            }
+            std::vector<char> input(INPUT_SIZE);
+            std::string chunk(CHUNK_SIZE, '\0');
+            ZSTD_inBuffer in{ input.data(), 0, 0 };
+            size_t used = 0;
+            size_t left = 0; // bytes of the current frame still to come (0 between frames)
+            bool eof = false;
+            while (true) {
+                if (in.pos == in.size && !eof) {
+                    long count = readInput(input);
+                    if (count < 0) {
+                        reason = std::string("Cannot read the file: ") + std::strerror(errno);
+                        break;
+                    }
+                    eof = count == 0;
+                    in = { input.data(), static_cast<size_t>(count), 0 };
+                }
+                ZSTD_outBuffer out{ chunk.data(), CHUNK_SIZE, used };
+                size_t status = ZSTD_decompressStream(stream, &out, &in);
+                if (ZSTD_isError(status) != 0U) {
+                    reason = std::string("Corrupt zstd data: ") + ZSTD_getErrorName(status);
+                    break;
+                }
+                // without input, a decoder between frames asks for the next header: that's the end
+                if (in.size != 0 || left != 0) { left = status; }
+                used = out.pos;
+                if (used == CHUNK_SIZE) {
+                    if (!push(chunk, used)) { break; }
+                    used = 0;
+                } else if (in.pos == in.size && eof) {
+                    if (left != 0) { reason = "Truncated zstd data"; }
+                    if (used != 0) { push(chunk, used); }
+                    break;
+                }
+            }
+            ZSTD_freeDCtx(stream);
+        }
+#endif
+    };
+
+    /**
+      An OutputFile that compresses what's written to it (NONE writes it as it is). Compressed
+      files can't be patched: writeAt() only works on plain ones.
+     */
+    class Writer {
+    public:
+        static constexpr size_t BUFFER_SIZE = 256 << 10; // compressed bytes written at once
+
+        Writer() = default;
+        Writer(const Writer&) = delete;
+        auto operator=(const Writer&) -> Writer& = delete;
+
+        ~Writer() {
+            release();
+        }
+
+        /**
+          Creates (or truncates) a file.
+         *
+          @param filename The file to write.
+          @param codec What to compress it with.
+          @return Whether the file is open.
+         */
+        auto open(const std::string& filename, Codec codec) -> bool {
+            release();
+            total = 0;
+            if (!file.open(filename)) { return false; }
+            type = compiled(codec) ? codec : Codec::NONE;
+            buffer.resize(type == Codec::NONE ? 0 : BUFFER_SIZE);
+#if ASM_ANALYZE_HAS_ZLIB
+            // 15 + 16: the biggest window, behind a gzip header; level 1, the copy is two to three times
+            // the size of the source and compressing it mustn't take longer than annotating it
+            if (type == Codec::GZIP && deflateInit2(&gzip, 1, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) { type = Codec::NONE; }
+#endif
+#if ASM_ANALYZE_HAS_ZSTD
+            if (type == Codec::ZSTD) {
+                zstd = ZSTD_createCCtx();
+                if (zstd == nullptr) { type = Codec::NONE; }
+            }
+#endif
+            if (type != codec) {
+                file.close();
+                return false;
+            }
+            return true;
+        }
+
+        /**
+          Appends bytes to the file, compressed.
+         */
+        auto write(std::string_view data) -> bool {
+            total += data.size();
+            return encode(data, false);
+        }
+
+        /**
+          Overwrites bytes at an absolute offset, which only a plain file can do.
+         */
+        auto writeAt(uint64_t offset, std::string_view data) -> bool {
+            return type == Codec::NONE && file.writeAt(offset, data);
+        }
+
+        /**
+          Ends the compressed stream and closes the file.
+         *
+          @return Whether every write (and the close) succeeded.
+         */
+        auto close() -> bool {
+            bool ended = encode({}, true);
+            release();
+            return file.close() && ended;
+        }
+
+        [[nodiscard]] auto good() const -> bool { return file.good(); }
+        /**
+          @return Bytes appended by write() so far, before compression.
+         */
+        [[nodiscard]] auto written() const -> uint64_t { return total; }
+
+    private:
+        OutputFile file;
+        Codec type = Codec::NONE;
+        std::vector<char> buffer;
+        uint64_t total = 0;
+#if ASM_ANALYZE_HAS_ZLIB
+        z_stream gzip{};
+#endif
+#if ASM_ANALYZE_HAS_ZSTD
+        ZSTD_CCtx* zstd = nullptr;
+#endif
+
+        // compresses bytes into the buffer, writing it out whenever it fills (and at the end)
+        auto encode(std::string_view data, [[maybe_unused]] bool end) -> bool {
+            if (!file.good()) { return false; }
+            switch (type) {
+            case Codec::NONE:
+                return file.write(data);
+#if ASM_ANALYZE_HAS_ZLIB
+            case Codec::GZIP: {
+                gzip.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+                gzip.avail_in = static_cast<uInt>(data.size()); // writes are flushed buffers, far below 4 GiB
+                int status = Z_OK;
+                do {
+                    gzip.next_out = reinterpret_cast<Bytef*>(buffer.data());
+                    gzip.avail_out = static_cast<uInt>(buffer.size());
+                    status = deflate(&gzip, end ? Z_FINISH : Z_NO_FLUSH);
+                    if (status == Z_STREAM_ERROR || !file.write({ buffer.data(), buffer.size() - gzip.avail_out })) { return false; }
+                } while (gzip.avail_out == 0 || (end && status != Z_STREAM_END));
+                return true;
+            }
+#endif
+#if ASM_ANALYZE_HAS_ZSTD
+            case Codec::ZSTD: {
+                ZSTD_inBuffer in{ data.data(), data.size(), 0 };
+                size_t left = 0;
+                do {
+                    ZSTD_outBuffer out{ buffer.data(), buffer.size(), 0 };
+                    left = ZSTD_compressStream2(zstd, &out, &in, end ? ZSTD_e_end : ZSTD_e_continue);
+                    if (ZSTD_isError(left) != 0U || !file.write({ buffer.data(), out.pos })) { return false; }
+                } while (in.pos < in.size || (end && left != 0));
+                return true;
+            }
+#endif
+            default:
+                return false;
+            }
+        }
+
+        void release() {
+#if ASM_ANALYZE_HAS_ZLIB
+            if (type == Codec::GZIP) { deflateEnd(&gzip); }
+#endif
+#if ASM_ANALYZE_HAS_ZSTD
+            if (type == Codec::ZSTD) { ZSTD_freeCCtx(zstd); }
+            zstd = nullptr;
+#endif
+            type = Codec::NONE;
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,391 @@
+#pragma once
+
+#include "ir.hpp"
+#include "isa.hpp"
+#include <initializer_list>
+#include <string_view>
+#include <algorithm>
+#include <cstdint>
+#include <array>
+#include <bit>
+
+/**
+  Static cost estimates, in the spirit of llvm-mca's summary view.
+
+  A processor model gives every kind of operation a latency, a number of micro-ops and the ports
+  that may execute them. Adding up what a run of instructions puts on each port bounds how fast the
+  run can repeat: neither the issue width nor the busiest port can be exceeded. The numbers are
+  rounded values from vendor optimization manuals and published measurements, by operation kind
+  rather than per instruction form: good enough to tell which loop is bound by what, not to
+  predict cycle counts.
+ */
+namespace cost {
+    /**
+      Most execution ports a model can have.
+     */
+    constexpr size_t MAX_PORTS = 12;
+
+    /**
+      What one instruction takes.
+     */
+    struct Cost {
+        uint8_t latency = 1;   // cycles until its result can be used
+        uint8_t uops = 1;      // micro-ops issued
+        uint8_t cycles = 1;    // cycles each micro-op keeps its port busy (more than 1: not pipelined)
+        uint16_t ports = 0;    // ports each micro-op may go to (bit i: port i), none for the ones that only take an issue slot
+    };
+
+    /**
+      @return The port mask of a list of port numbers.
+     */
+    constexpr auto on(std::initializer_list<unsigned> ports) -> uint16_t {
+        uint16_t mask = 0;
+        for (unsigned port : ports) { mask = static_cast<uint16_t>(mask | (1U << port)); }
+        return mask;
+    }
+
+    struct Entry {
+        isa::Operation operation;
+        Cost cost;
+    };
+
+    struct Model {
+        std::string_view name;
+        std::string_view architecture;          // NAME of the backend it's for
+        unsigned width = 1;                     // micro-ops issued per cycle
+        std::array<std::string_view, MAX_PORTS> ports{};
+        std::array<Cost, isa::OPERATION_COUNT> costs{};
+        bool memoryOperands = false;            // memory operands of other instructions add loads and stores (x86)
+
+        constexpr Model(std::string_view name, std::string_view architecture, unsigned width, std::initializer_list<std::string_view> portNames,
+            std::initializer_list<Entry> entries, bool memoryOperands = false) :
+            name(name), architecture(architecture), width(width), memoryOperands(memoryOperands) {
+            std::copy(portNames.begin(), portNames.end(), ports.begin());
+            for (const Entry& entry : entries) { costs[static_cast<size_t>(entry.operation)] = entry.cost; }
+            // mnemonics without a cost of their own run like simple arithmetic, pseudo instructions take nothing
+            costs[static_cast<size_t>(isa::Operation::UNKNOWN)] = costs[static_cast<size_t>(isa::Operation::ALU)];
+            costs[static_cast<size_t>(isa::Operation::PSEUDO)] = { 0, 0, 0, 0 };
+        }
+
+        [[nodiscard]] constexpr auto portCount() const -> size_t {
+            size_t count = 0;
+            while (count < ports.size() && !ports[count].empty()) { ++count; }
+            return count;
+        }
+
+        [[nodiscard]] constexpr auto operator[](isa::Operation operation) const -> const Cost& {
+            return costs[static_cast<size_t>(operation)];
+        }
+    };
+
+    using isa::Operation;
+
+    /**
+      Known processors, the first one of every instruction set is its default.
+     */
+    inline constexpr std::array<Model, 8> MODELS = { {
+        // Intel Skylake: 4-wide, ALUs on 0 1 5 6, loads on 2 3, store data on 4, store addresses on 7
+        { "skylake", isa::X86::NAME, 4, { "p0", "p1", "p2", "p3", "p4", "p5", "p6", "p7" }, {
+            { Operation::ALU, { 1, 1, 1, on({ 0, 1, 5, 6 }) } },
+            { Operation::MULTIPLY, { 3, 2, 1, on({ 1, 5 }) } },
+            { Operation::DIVIDE, { 26, 10, 1, on({ 0, 1, 5, 6 }) } },
+            { Operation::LOAD, { 5, 1, 1, on({ 2, 3 }) } },
+            { Operation::STORE, { 1, 2, 1, on({ 4, 7 }) } },
+            { Operation::FLOAT, { 4, 1, 1, on({ 0, 1 }) } },
+            { Operation::FLOAT_MULTIPLY, { 4, 1, 1, on({ 0, 1 }) } },
+            { Operation::FLOAT_DIVIDE, { 14, 1, 4, on({ 0 }) } },
+            { Operation::JUMP, { 1, 1, 1, on({ 6 }) } },
+            { Operation::BRANCH, { 1, 1, 1, on({ 0, 6 }) } },
+            { Operation::CALL, { 3, 3, 1, on({ 4, 6, 7 }) } },
+            { Operation::RETURN, { 2, 2, 1, on({ 2, 6 }) } },
+            { Operation::NOP, { 1, 1, 1, 0 } },
+            { Operation::SYSTEM, { 100, 1, 1, 0 } }
+        }, true },
+        // AMD Zen 3: 6-wide dispatch, 4 ALUs, 3 AGUs (at most 2 stores), branches on ALU 0 and 3
+        { "zen3", isa::X86::NAME, 6, { "alu0", "alu1", "alu2", "alu3", "agu0", "agu1", "agu2", "fp0", "fp1", "fp2", "fp3" }, {
+            { Operation::ALU, { 1, 1, 1, on({ 0, 1, 2, 3 }) } },
+            { Operation::MULTIPLY, { 3, 2, 1, on({ 1 }) } },
+            { Operation::DIVIDE, { 14, 2, 7, on({ 2 }) } },
+            { Operation::LOAD, { 4, 1, 1, on({ 4, 5, 6 }) } },
+            { Operation::STORE, { 1, 1, 1, on({ 4, 5 }) } },
+            { Operation::FLOAT, { 3, 1, 1, on({ 9, 10 }) } },
+            { Operation::FLOAT_MULTIPLY, { 3, 1, 1, on({ 7, 8 }) } },
+            { Operation::FLOAT_DIVIDE, { 13, 1, 5, on({ 8 }) } },
+            { Operation::JUMP, { 1, 1, 1, on({ 0, 3 }) } },
+            { Operation::BRANCH, { 1, 1, 1, on({ 0, 3 }) } },
+            { Operation::CALL, { 2, 2, 1, on({ 0, 3, 4, 5 }) } },
+            { Operation::RETURN, { 2, 2, 1, on({ 0, 3, 4, 5, 6 }) } },
+            { Operation::NOP, { 1, 1, 1, 0 } },
+            { Operation::SYSTEM, { 100, 1, 1, 0 } }
+        }, true },
+        // Arm Cortex-A72: 3-wide, branch, 2 integer, multi-cycle, load, store and 2 FP/SIMD pipelines
+        { "cortex-a72", isa::Arm::NAME, 3, { "B", "I0", "I1", "M", "L", "S", "F0", "F1" }, {
+            { Operation::ALU, { 1, 1, 1, on({ 1, 2 }) } },
+            { Operation::MULTIPLY, { 3, 1, 1, on({ 3 }) } },
+            { Operation::DIVIDE, { 12, 1, 8, on({ 3 }) } },
+            { Operation::LOAD, { 4, 1, 1, on({ 4 }) } },
+            { Operation::LOAD_PAIR, { 4, 2, 1, on({ 4 }) } },
+            { Operation::STORE, { 1, 1, 1, on({ 5 }) } },
+            { Operation::STORE_PAIR, { 1, 2, 1, on({ 5 }) } },
+            { Operation::FLOAT, { 3, 1, 1, on({ 6, 7 }) } },
+            { Operation::FLOAT_MULTIPLY, { 4, 1, 1, on({ 6 }) } },
+            { Operation::FLOAT_DIVIDE, { 11, 1, 6, on({ 6 }) } },
+            { Operation::JUMP, { 1, 1, 1, on({ 0 }) } },
+            { Operation::BRANCH, { 1, 1, 1, on({ 0 }) } },
+            { Operation::CALL, { 1, 2, 1, on({ 0, 1 }) } },
+            { Operation::RETURN, { 1, 1, 1, on({ 0 }) } },
+            { Operation::NOP, { 1, 1, 1, 0 } },
+            { Operation::SYSTEM, { 50, 1, 1, 0 } }
+        } },
+        // Arm Neoverse N1: 4-wide, 3 single-cycle and 1 multi-cycle integer, 2 load/store, 2 FP/SIMD
+        { "neoverse-n1", isa::Arm::NAME, 4, { "B", "S0", "S1", "S2", "M", "L0", "L1", "V0", "V1" }, {
+            { Operation::ALU, { 1, 1, 1, on({ 1, 2, 3, 4 }) } },
+            { Operation::MULTIPLY, { 2, 1, 1, on({ 4 }) } },
+            { Operation::DIVIDE, { 12, 1, 10, on({ 4 }) } },
+            { Operation::LOAD, { 4, 1, 1, on({ 5, 6 }) } },
+            { Operation::LOAD_PAIR, { 4, 2, 1, on({ 5, 6 }) } },
+            { Operation::STORE, { 1, 1, 1, on({ 5, 6 }) } },
+            { Operation::STORE_PAIR, { 1, 2, 1, on({ 5, 6 }) } },
+            { Operation::FLOAT, { 2, 1, 1, on({ 7, 8 }) } },
+            { Operation::FLOAT_MULTIPLY, { 3, 1, 1, on({ 7, 8 }) } },
+            { Operation::FLOAT_DIVIDE, { 10, 1, 7, on({ 7 }) } },
+            { Operation::JUMP, { 1, 1, 1, on({ 0 }) } },
+            { Operation::BRANCH, { 1, 1, 1, on({ 0 }) } },
+            { Operation::CALL, { 1, 2, 1, on({ 0, 1 }) } },
+            { Operation::RETURN, { 1, 1, 1, on({ 0 }) } },
+            { Operation::NOP, { 1, 1, 1, 0 } },
+            { Operation::SYSTEM, { 50, 1, 1, 0 } }
+        } },
+        // MIPS 24K: single issue, one integer pipeline (loads and stores included) and a multiply/divide unit
+        { "mips-24k", isa::Mips::NAME, 1, { "alu", "mdu", "fpu" }, {
+            { Operation::ALU, { 1, 1, 1, on({ 0 }) } },
+            { Operation::MULTIPLY, { 4, 1, 1, on({ 1 }) } },
+            { Operation::DIVIDE, { 35, 1, 33, on({ 1 }) } },
+            { Operation::LOAD, { 2, 1, 1, on({ 0 }) } },
+            { Operation::STORE, { 1, 1, 1, on({ 0 }) } },
+            { Operation::FLOAT, { 4, 1, 1, on({ 2 }) } },
+            { Operation::FLOAT_MULTIPLY, { 5, 1, 1, on({ 2 }) } },
+            { Operation::FLOAT_DIVIDE, { 17, 1, 14, on({ 2 }) } },
+            { Operation::JUMP, { 1, 1, 1, on({ 0 }) } },
+            { Operation::BRANCH, { 1, 1, 1, on({ 0 }) } },
+            { Operation::CALL, { 1, 1, 1, on({ 0 }) } },
+            { Operation::RETURN, { 1, 1, 1, on({ 0 }) } },
+            { Operation::NOP, { 1, 1, 1, on({ 0 }) } },
+            { Operation::SYSTEM, { 20, 1, 1, on({ 0 }) } }
+        } },
+        // IBM POWER9 (one SMT4 core): 6-wide, 4 execution slices, 4 load/store ports, a branch unit
+        { "power9", isa::PowerPc::NAME, 6, { "ex0", "ex1", "ex2", "ex3", "ls0", "ls1", "ls2", "ls3", "br" }, {
+            { Operation::ALU, { 2, 1, 1, on({ 0, 1, 2, 3 }) } },
+            { Operation::MULTIPLY, { 5, 1, 1, on({ 0, 1, 2, 3 }) } },
+            { Operation::DIVIDE, { 20, 1, 12, on({ 0, 1 }) } },
+            { Operation::LOAD, { 4, 1, 1, on({ 4, 5, 6, 7 }) } },
+            { Operation::STORE, { 1, 1, 1, on({ 4, 5, 6, 7 }) } },
+            { Operation::FLOAT, { 7, 1, 1, on({ 0, 1, 2, 3 }) } },
+            { Operation::FLOAT_MULTIPLY, { 7, 1, 1, on({ 0, 1, 2, 3 }) } },
+            { Operation::FLOAT_DIVIDE, { 27, 1, 13, on({ 0, 1 }) } },
+            { Operation::JUMP, { 1, 1, 1, on({ 8 }) } },
+            { Operation::BRANCH, { 1, 1, 1, on({ 8 }) } },
+            { Operation::CALL, { 1, 1, 1, on({ 8 }) } },
+            { Operation::RETURN, { 1, 1, 1, on({ 8 }) } },
+            { Operation::NOP, { 1, 1, 1, 0 } },
+            { Operation::SYSTEM, { 50, 1, 1, 0 } }
+        } },
+        // SiFive U74: dual issue in order, two integer pipelines, loads and stores on the first, multiply and divide on the second
+        { "sifive-u74", isa::RiscV::NAME, 2, { "pipe0", "pipe1", "fpu" }, {
+            { Operation::ALU, { 1, 1, 1, on({ 0, 1 }) } },
+            { Operation::MULTIPLY, { 3, 1, 1, on({ 1 }) } },
+            { Operation::DIVIDE, { 20, 1, 20, on({ 1 }) } },
+            { Operation::LOAD, { 3, 1, 1, on({ 0 }) } },
+            { Operation::STORE, { 1, 1, 1, on({ 0 }) } },
+            { Operation::FLOAT, { 5, 1, 1, on({ 2 }) } },
+            { Operation::FLOAT_MULTIPLY, { 5, 1, 1, on({ 2 }) } },
+            { Operation::FLOAT_DIVIDE, { 20, 1, 20, on({ 2 }) } },
+            { Operation::JUMP, { 1, 1, 1, on({ 0, 1 }) } },
+            { Operation::BRANCH, { 1, 1, 1, on({ 0, 1 }) } },
+            { Operation::CALL, { 1, 1, 1, on({ 0, 1 }) } },
+            { Operation::RETURN, { 1, 1, 1, on({ 0, 1 }) } },
+            { Operation::NOP, { 1, 1, 1, 0 } },
+            { Operation::SYSTEM, { 20, 1, 1, on({ 0 }) } }
+        } },
+        // UltraSPARC T2 (one strand): single issue, integer, load/store and floating point units
+        { "ultrasparc-t2", isa::Sparc::NAME, 1, { "exu", "lsu", "fgu" }, {
+            { Operation::ALU, { 1, 1, 1, on({ 0 }) } },
+            { Operation::MULTIPLY, { 5, 1, 1, on({ 0 }) } },
+            { Operation::DIVIDE, { 26, 1, 26, on({ 0 }) } },
+            { Operation::LOAD, { 3, 1, 1, on({ 1 }) } },
+            { Operation::STORE, { 1, 1, 1, on({ 1 }) } },
+            { Operation::FLOAT, { 6, 1, 1, on({ 2 }) } },
+            { Operation::FLOAT_MULTIPLY, { 6, 1, 1, on({ 2 }) } },
+            { Operation::FLOAT_DIVIDE, { 19, 1, 19, on({ 2 }) } },
+            { Operation::JUMP, { 1, 1, 1, on({ 0 }) } },
+            { Operation::BRANCH, { 1, 1, 1, on({ 0 }) } },
+            { Operation::CALL, { 1, 1, 1, on({ 0 }) } },
+            { Operation::RETURN, { 1, 1, 1, on({ 0 }) } },
+            { Operation::NOP, { 1, 1, 1, 0 } },
+            { Operation::SYSTEM, { 20, 1, 1, on({ 0 }) } }
+        } }
+    } };
+
+    constexpr auto portsNamed() -> bool {
+        for (const Model& model : MODELS) {
+            if (model.width == 0 || model.portCount() == 0) { return false; }
+            for (const Cost& c : model.costs) {
+                if (c.ports >> model.portCount() != 0) { return false; }
+            }
+        }
+        return true;
+    }
+
+    static_assert(portsNamed(), "every port a cost uses needs a name");
+
+    /**
+      @return The model called `name`, null if there's none.
+     */
+    constexpr auto find(std::string_view name) -> const Model* {
+        for (const Model& model : MODELS) {
+            if (model.name == name) { return &model; }
+        }
+        return nullptr;
+    }
+
+    /**
+      @param architecture NAME of a backend.
+      @param preferred The model asked for (may be empty).
+      @return `preferred` if it is a model of that instruction set, its default model otherwise.
+     */
+    constexpr auto select(std::string_view architecture, std::string_view preferred) -> const Model& {
+        const Model* model = find(preferred);
+        if (model != nullptr && model->architecture == architecture) { return *model; }
+        return *std::find_if(MODELS.begin(), MODELS.end(), [&](const Model& m) { return m.architecture == architecture; });
+    }
+
+    static_assert(select(isa::X86::NAME, "").architecture == isa::X86::NAME && select(isa::Arm::NAME, "").architecture == isa::Arm::NAME &&
+        select(isa::Mips::NAME, "").architecture == isa::Mips::NAME && select(isa::PowerPc::NAME, "").architecture == isa::PowerPc::NAME &&
+        select(isa::RiscV::NAME, "").architecture == isa::RiscV::NAME && select(isa::Sparc::NAME, "").architecture == isa::Sparc::NAME,
+        "every backend needs a model");
+
+    /**
+      What a run of instructions puts on the processor.
+     */
+    class Estimate {
+    public:
+        uint32_t instructions = 0;
+        uint32_t unknown = 0;    // of which without a cost of their own
+        uint32_t uops = 0;
+        std::array<double, MAX_PORTS> pressure{}; // cycles each port is busy
+
+        void add(const Cost& cost) {
+            uops += cost.uops;
+            int ports = std::popcount(cost.ports);
+            if (ports == 0) { return; }
+            // like llvm-mca, micro-ops that may go to several ports are spread evenly over them
+            double share = static_cast<double>(cost.uops) * cost.cycles / ports;
+            for (size_t port = 0; port < MAX_PORTS; ++port) {
+                if ((cost.ports >> port & 1U) != 0) { pressure[port] += share; }
+            }
+        }
+
+        auto operator+=(const Estimate& other) -> Estimate& {
+            instructions += other.instructions;
+            unknown += other.unknown;
+            uops += other.uops;
+            for (size_t port = 0; port < MAX_PORTS; ++port) { pressure[port] += other.pressure[port]; }
+            return *this;
+        }
+
+        /**
+          @return The port bounding the throughput, or -1 when it's the issue width.
+         */
+        [[nodiscard]] auto bottleneck(const Model& model) const -> int {
+            int busiest = -1;
+            double bound = static_cast<double>(uops) / model.width;
+            for (size_t port = 0; port < model.portCount(); ++port) {
+                if (pressure[port] > bound) {
+                    bound = pressure[port];
+                    busiest = static_cast<int>(port);
+                }
+            }
+            return busiest;
+        }
+
+        /**
+          @return Cycles per run when runs follow each other without waiting on results (the
+          reciprocal throughput).
+         */
+        [[nodiscard]] auto throughput(const Model& model) const -> double {
+            int port = bottleneck(model);
+            return port < 0 ? static_cast<double>(uops) / model.width : pressure[static_cast<size_t>(port)];
+        }
+    };
+
+    /**
+      Loads and stores an instruction makes through its memory operands, where arithmetic takes
+      them (x86).
+     */
+    struct MemoryOperands {
+        uint8_t loads = 0;
+        uint8_t stores = 0;
+    };
+
+    /**
+      Finds the loads and stores behind an instruction's memory operands: a source is loaded, a
+      destination stored (and loaded first when the instruction updates it). Loads and stores of
+      their own and instructions that only compute an address (lea) take nothing more.
+     *
+      @param block The tokenized text.
+      @param line The instruction's line.
+      @param operation What it does.
+      @return Its loads and stores.
+     */
+    template <typename Isa>
+    auto memoryOperands(const ir::Block& block, size_t line, Operation operation) -> MemoryOperands {
+        MemoryOperands memory;
+        if (operation == Operation::LOAD || operation == Operation::STORE || operation == Operation::LOAD_PAIR ||
+            operation == Operation::STORE_PAIR || Isa::addressOnly(block.opcode[line])) {
+            return memory;
+        }
+        isa::Writes writes = Isa::writes(block.opcode[line]);
+        bool writesOne = writes != isa::Writes::NOTHING && operation != Operation::JUMP && operation != Operation::BRANCH &&
+            operation != Operation::CALL && operation != Operation::RETURN && operation != Operation::NOP &&
+            operation != Operation::SYSTEM && operation != Operation::PSEUDO;
+        size_t first = block.firstOperand[line];
+        size_t count = block.operandCount(line);
+        size_t destination = !writesOne || count == 0 ? count : Isa::destinationLast(block.view(line, block.operands[line])) ? count - 1 : 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (block.operandKind[first + i] != records::OperandKind::MEMORY) { continue; }
+            if (i != destination || writes == isa::Writes::UPDATES) { ++memory.loads; }
+            if (i == destination) { ++memory.stores; }
+        }
+        return memory;
+    }
+
+    /**
+      Estimates the instructions of some lines.
+     *
+      @param block The tokenized text.
+      @param from First line.
+      @param to One past the last line.
+      @param model The processor.
+      @return What they take.
+     */
+    template <typename Isa>
+    auto estimate(const ir::Block& block, size_t from, size_t to, const Model& model) -> Estimate {
+        Estimate estimate;
+        for (size_t line = from; line < to; ++line) {
+            records::LineKind kind = block.kind[line];
+            if (kind != records::LineKind::INSTRUCTION && kind != records::LineKind::UNKNOWN) { continue; }
+            Operation operation = kind == records::LineKind::UNKNOWN ? Operation::UNKNOWN : Isa::operation(block.opcode[line]);
+            if (operation == Operation::PSEUDO) { continue; }
+
+            ++estimate.instructions;
+            if (operation == Operation::UNKNOWN) { ++estimate.unknown; }
+            estimate.add(model[operation]);
+            if (model.memoryOperands) {
+                MemoryOperands memory = memoryOperands<Isa>(block, line, operation);
+                for (uint8_t i = 0; i < memory.loads; ++i) { estimate.add(model[Operation::LOAD]); }
+                for (uint8_t i = 0; i < memory.stores; ++i) { estimate.add(model[Operation::STORE]); }
+            }
+        }
+        return estimate;
+    }
+}
\ No newline at end of file
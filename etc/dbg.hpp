@@ -3,6 +3,7 @@
 #include "color.hpp"
 #include <iostream>
 #include <cstdlib>
+#include <mutex>
 
 /**
   A namespace for debugging-related functionality.
@@ -62,10 +63,21 @@ namespace dbg {
                 break;
             }
 
-            std::string colored = Color::colorize(l, cc);
+            std::string colored = "[" + Color::colorize(l, cc) + "] " + message + '\n';
 
-            std::cout << "[" << colored << "] ";
-            std::cout << message << '\n';
+            // one write per message so lines from worker threads don't interleave
+            static std::mutex mutex;
+            std::lock_guard<std::mutex> lock(mutex);
+            *target() << colored;
+        }
+
+        /**
+          Sends log messages to another stream (they go to stdout by default).
+         *
+          @param stream The stream to log to, it must outlive all logging.
+         */
+        static void redirect(std::ostream& stream) {
+            target() = &stream;
         }
 
         /**
@@ -103,6 +115,12 @@ namespace dbg {
         static void fatal(const std::string& message) {
             log(message, FATAL);
         }
+
+    private:
+        static auto target() -> std::ostream*& {
+            static std::ostream* stream = &std::cout;
+            return stream;
+        }
     };
 
     /**
@@ -124,7 +142,8 @@ namespace dbg {
 
         static void prefexit() {
             std::cout << "Press Enter to exit...";
-            while (std::cin.get() != '\n') {}
+            int c = 0;
+            while ((c = std::cin.get()) != '\n' && c != EOF) {}
         }
     };
 
@@ -0,0 +1,338 @@
+#pragma once
+
+#include "cfg.hpp"
+#include "cost.hpp"
+#include "ir.hpp"
+#include "isa.hpp"
+#include <string_view>
+#include <algorithm>
+#include <cstdint>
+#include <bitset>
+#include <vector>
+#include <array>
+
+/**
+  Register dependencies of basic blocks and loops.
+
+  Every instruction's register operands are split into the ones it reads and the ones it writes
+  (by its operation, the backend's WRITES exceptions and where the destination goes), with
+  registers in memory operands read. Registers are the backend's dense ids, so the values in
+  flight are a few small arrays indexed by id and the sets of registers are bitsets: one forward
+  pass per block finds its critical path, one backward pass its register pressure, and liveness
+  between blocks is the usual bitset dataflow, which settles in a few passes on reducible code.
+
+  What isn't tracked: dependencies through memory and flags, registers an instruction uses
+  without naming them (x86's mul and div, the stack pointer of push and pop), and what calls read
+  and clobber.
+ */
+namespace deps {
+    using RegisterSet = std::bitset<isa::MAX_REGISTERS>;
+
+    /**
+      Longest chain of dependent instructions.
+     */
+    struct Chain {
+        uint32_t cycles = 0;
+        uint32_t instructions = 0;
+        uint32_t first = 0;     // line of its first instruction
+        uint32_t last = 0;      // and of its last one
+    };
+
+    struct BlockDependencies {
+        Chain critical;
+        uint32_t pressure = 0;  // most registers live at once
+        RegisterSet uses;       // read before being written in the block
+        RegisterSet defs;       // written in the block
+        RegisterSet liveIn;
+        RegisterSet liveOut;
+    };
+
+    struct LoopDependencies {
+        RegisterSet carried;    // live when the loop is entered and written in it: values one iteration hands the next
+        uint32_t recurrence = 0; // cycles an iteration waits on carried values, 0 when unknown (loops of several blocks)
+        uint8_t through = isa::NO_REGISTER; // the carried register of the longest recurrence
+        uint32_t pressure = 0;
+    };
+
+    /**
+      Registers an instruction reads and writes, ids with WRITTEN set for writes.
+     */
+    struct Accesses {
+        static constexpr uint8_t WRITTEN = 0x80;
+        std::array<uint8_t, 16> ids{};
+        size_t count = 0;
+        uint8_t writeBack = isa::NO_REGISTER; // base register an address writes back (read too, ready as soon as an ALU result)
+
+        void add(uint8_t id, bool written) {
+            if (id != isa::NO_REGISTER && count < ids.size()) { ids[count++] = static_cast<uint8_t>(id | (written ? WRITTEN : 0)); }
+        }
+    };
+
+    static_assert(isa::MAX_REGISTERS <= Accesses::WRITTEN, "register ids leave the top bit for writes");
+
+    class Analysis {
+    public:
+        std::vector<BlockDependencies> blocks;
+        std::vector<LoopDependencies> loops;
+        std::array<std::string_view, isa::MAX_REGISTERS> names{}; // how each register was first written in the text
+
+        /**
+          Analyzes every block and loop of a graph.
+         *
+          @param block The tokenized text.
+          @param graph Its basic blocks and loops.
+          @param model Latencies.
+         */
+        template <typename Isa>
+        void run(const ir::Block& block, const cfg::Graph& graph, const cost::Model& model) {
+            blocks.assign(graph.blocks.size(), {});
+            loops.assign(graph.loops.size(), {});
+            names.fill({});
+            for (size_t b = 0; b < graph.blocks.size(); ++b) { forward<Isa>(block, graph.blocks[b], model, blocks[b]); }
+            liveness(graph);
+            for (size_t b = 0; b < graph.blocks.size(); ++b) { backward<Isa>(block, graph.blocks[b], blocks[b]); }
+
+            // a loop's own blocks, then its inner loops (which come first)
+            std::vector<RegisterSet> defs(graph.loops.size());
+            for (size_t b = 0; b < graph.blocks.size(); ++b) {
+                if (uint32_t loop = graph.blocks[b].loop; loop != cfg::NONE) {
+                    defs[loop] |= blocks[b].defs;
+                    loops[loop].pressure = std::max(loops[loop].pressure, blocks[b].pressure);
+                }
+            }
+            for (size_t l = 0; l < graph.loops.size(); ++l) {
+                if (uint32_t parent = graph.loops[l].parent; parent != cfg::NONE) {
+                    defs[parent] |= defs[l];
+                    loops[parent].pressure = std::max(loops[parent].pressure, loops[l].pressure);
+                }
+                const cfg::Loop& loop = graph.loops[l];
+                LoopDependencies& dependencies = loops[l];
+                dependencies.carried = blocks[loop.header].liveIn & defs[l];
+                if (loop.blocks == 1 && dependencies.carried.any()) { recurrence<Isa>(block, graph.blocks[loop.header], model, dependencies); }
+            }
+        }
+
+    private:
+        // per register: cycle its value is ready, and the chain that produced it
+        std::array<uint32_t, isa::MAX_REGISTERS> ready{};
+        std::array<uint32_t, isa::MAX_REGISTERS> length{};
+        std::array<uint32_t, isa::MAX_REGISTERS> origin{};
+        std::vector<Accesses> accessed;     // a loop's instructions, decoded once for all its carried registers
+        std::vector<uint32_t> latencies;
+
+        /**
+          @return The registers an instruction reads and writes.
+         */
+        template <typename Isa>
+        auto decode(const ir::Block& block, size_t line, isa::Operation operation) -> Accesses {
+            using isa::Operation;
+            Accesses accesses;
+            size_t first = block.firstOperand[line];
+            size_t count = block.operandCount(line);
+            if (count == 0) { return accesses; }
+
+            isa::Writes writes = Isa::writes(block.opcode[line]);
+            bool writesNothing = writes == isa::Writes::NOTHING || operation == Operation::STORE || operation == Operation::STORE_PAIR ||
+                operation == Operation::JUMP || operation == Operation::BRANCH || operation == Operation::CALL || operation == Operation::RETURN ||
+                operation == Operation::NOP || operation == Operation::SYSTEM || operation == Operation::PSEUDO;
+            size_t destinations = writesNothing ? 0 : operation == Operation::LOAD_PAIR ? std::min<size_t>(2, count) : 1;
+            bool last = Isa::destinationLast(block.view(line, block.operands[line]));
+            for (size_t i = 0; i < count; ++i) {
+                size_t o = first + i;
+                std::string_view text = block.view(line, block.operand[o]);
+                bool destination = last ? count - i <= destinations : i < destinations;
+                if (block.operandKind[o] == records::OperandKind::REGISTER) {
+                    uint8_t id = Isa::registerId(text);
+                    if (id != isa::NO_REGISTER && names[id].empty()) { names[id] = text; }
+                    if (!destination || writes == isa::Writes::UPDATES) { accesses.add(id, false); }
+                    if (destination) { accesses.add(id, true); }
+                    continue;
+                }
+                if (block.operandKind[o] != records::OperandKind::MEMORY && text.find_first_of("[(") == std::string_view::npos) { continue; }
+
+                // the registers of an address are read ([rbp-8], 16(sp), [x0, x1, lsl 3]); [sp, -16]! and the post-indexed
+                // [x1], 8 of a load or store write their base back
+                bool memoryAccess = operation == Operation::LOAD || operation == Operation::STORE || operation == Operation::LOAD_PAIR ||
+                    operation == Operation::STORE_PAIR;
+                bool writeBack = text.back() == '!' || (memoryAccess && i != 0 && i + 1 < count && text[0] == '[' &&
+                    block.operandKind[o + 1] == records::OperandKind::IMMEDIATE);
+                bool base = true;
+                for (size_t at = 0; at < text.size();) {
+                    auto word = [](char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '%' || c == '$' || c == '.'; };
+                    size_t end = at;
+                    while (end < text.size() && word(text[end])) { ++end; }
+                    if (end == at) {
+                        ++at;
+                        continue;
+                    }
+                    uint8_t id = Isa::registerId(text.substr(at, end - at));
+                    if (id != isa::NO_REGISTER) {
+                        if (names[id].empty()) { names[id] = text.substr(at, end - at); }
+                        accesses.add(id, false);
+                        if (writeBack && base) { accesses.writeBack = id; }
+                        base = false;
+                    }
+                    at = end;
+                }
+            }
+            return accesses;
+        }
+
+        /**
+          @return The operation of an instruction line, PSEUDO for lines that aren't instructions.
+         */
+        template <typename Isa>
+        static auto operationOf(const ir::Block& block, size_t line) -> isa::Operation {
+            records::LineKind kind = block.kind[line];
+            if (kind == records::LineKind::UNKNOWN) { return isa::Operation::UNKNOWN; }
+            return kind == records::LineKind::INSTRUCTION ? Isa::operation(block.opcode[line]) : isa::Operation::PSEUDO;
+        }
+
+        /**
+          @return Cycles until an instruction's result is ready (a memory source of x86 arithmetic is loaded first, a
+          memory destination only stored).
+         */
+        template <typename Isa>
+        static auto latencyOf(const ir::Block& block, size_t line, isa::Operation operation, const cost::Model& model) -> uint32_t {
+            uint32_t latency = model[operation].latency;
+            if (model.memoryOperands) { latency += cost::memoryOperands<Isa>(block, line, operation).loads * model[isa::Operation::LOAD].latency; }
+            return latency;
+        }
+
+        /**
+          Walks a block's instructions in order: its critical path, uses and defs.
+         */
+        template <typename Isa>
+        void forward(const ir::Block& block, const cfg::BasicBlock& basic, const cost::Model& model, BlockDependencies& out) {
+            ready.fill(0);
+            length.fill(0);
+            for (size_t line = basic.first; line < basic.end; ++line) {
+                isa::Operation operation = operationOf<Isa>(block, line);
+                if (operation == isa::Operation::PSEUDO) { continue; }
+                Accesses accesses = decode<Isa>(block, line, operation);
+
+                // it starts when the last of its sources is ready
+                uint32_t start = 0;
+                uint32_t chain = 0;
+                uint32_t chainOrigin = static_cast<uint32_t>(line);
+                for (size_t a = 0; a < accesses.count; ++a) {
+                    if ((accesses.ids[a] & Accesses::WRITTEN) != 0) { continue; }
+                    uint8_t id = accesses.ids[a];
+                    if (!out.defs[id]) { out.uses[id] = true; }
+                    if (ready[id] > start || (ready[id] == start && length[id] > chain)) {
+                        start = ready[id];
+                        chain = length[id];
+                        chainOrigin = chain == 0 ? static_cast<uint32_t>(line) : origin[id];
+                    }
+                }
+                uint32_t latency = latencyOf<Isa>(block, line, operation, model);
+                uint32_t finish = start + latency;
+                if (finish > out.critical.cycles || (finish == out.critical.cycles && chain + 1 > out.critical.instructions)) {
+                    out.critical = { finish, chain + 1, chainOrigin, static_cast<uint32_t>(line) };
+                }
+                for (size_t a = 0; a < accesses.count; ++a) {
+                    if ((accesses.ids[a] & Accesses::WRITTEN) == 0) { continue; }
+                    uint8_t id = accesses.ids[a] & static_cast<uint8_t>(~Accesses::WRITTEN);
+                    out.defs[id] = true;
+                    ready[id] = finish;
+                    length[id] = chain + 1;
+                    origin[id] = chainOrigin;
+                }
+                if (uint8_t id = accesses.writeBack; id != isa::NO_REGISTER) {
+                    out.defs[id] = true;
+                    ready[id] += model[isa::Operation::ALU].latency;
+                    origin[id] = length[id] == 0 ? static_cast<uint32_t>(line) : origin[id];
+                    ++length[id];
+                }
+            }
+        }
+
+        /**
+          Finds how long an iteration of a loop of one block waits on the last one: for every
+          carried register, the longest chain from its value at the top of the body to its value
+          at the bottom (a register rewritten from something else, say reloaded, doesn't wait).
+          Cycles through several registers count for each of them, so they're overestimated.
+         */
+        template <typename Isa>
+        void recurrence(const ir::Block& block, const cfg::BasicBlock& basic, const cost::Model& model, LoopDependencies& loop) {
+            accessed.clear();
+            latencies.clear();
+            for (size_t line = basic.first; line < basic.end; ++line) {
+                isa::Operation operation = operationOf<Isa>(block, line);
+                if (operation == isa::Operation::PSEUDO) { continue; }
+                accessed.push_back(decode<Isa>(block, line, operation));
+                latencies.push_back(latencyOf<Isa>(block, line, operation, model));
+            }
+            uint32_t addressLatency = model[isa::Operation::ALU].latency;
+
+            // ready, here, is the cycles since the carried value was read, +1 (0: doesn't depend on it)
+            for (size_t carried = 0; carried < isa::MAX_REGISTERS; ++carried) {
+                if (!loop.carried[carried]) { continue; }
+                ready.fill(0);
+                ready[carried] = 1;
+                for (size_t i = 0; i < accessed.size(); ++i) {
+                    const Accesses& accesses = accessed[i];
+                    uint32_t start = 0;
+                    for (size_t a = 0; a < accesses.count; ++a) {
+                        if ((accesses.ids[a] & Accesses::WRITTEN) == 0) { start = std::max(start, ready[accesses.ids[a]]); }
+                    }
+                    for (size_t a = 0; a < accesses.count; ++a) {
+                        if ((accesses.ids[a] & Accesses::WRITTEN) != 0) {
+                            ready[accesses.ids[a] & static_cast<uint8_t>(~Accesses::WRITTEN)] = start == 0 ? 0 : start + latencies[i];
+                        }
+                    }
+                    if (uint8_t id = accesses.writeBack; id != isa::NO_REGISTER && ready[id] != 0) { ready[id] += addressLatency; }
+                }
+                if (ready[carried] > 1 && ready[carried] - 1 > loop.recurrence) {
+                    loop.recurrence = ready[carried] - 1;
+                    loop.through = static_cast<uint8_t>(carried);
+                }
+            }
+        }
+
+        /**
+          Walks a block's instructions backwards from what's live after it: its register pressure.
+         */
+        template <typename Isa>
+        void backward(const ir::Block& block, const cfg::BasicBlock& basic, BlockDependencies& out) {
+            RegisterSet live = out.liveOut;
+            size_t pressure = live.count();
+            for (size_t line = basic.end; line-- > basic.first;) {
+                isa::Operation operation = operationOf<Isa>(block, line);
+                if (operation == isa::Operation::PSEUDO) { continue; }
+                Accesses accesses = decode<Isa>(block, line, operation);
+                for (size_t a = 0; a < accesses.count; ++a) {
+                    if ((accesses.ids[a] & Accesses::WRITTEN) != 0) { live[accesses.ids[a] & static_cast<uint8_t>(~Accesses::WRITTEN)] = false; }
+                }
+                for (size_t a = 0; a < accesses.count; ++a) {
+                    if ((accesses.ids[a] & Accesses::WRITTEN) == 0) { live[accesses.ids[a]] = true; }
+                }
+                pressure = std::max(pressure, live.count());
+            }
+            out.pressure = static_cast<uint32_t>(pressure);
+        }
+
+        /**
+          Registers live into and out of every block, iterated to a fixed point (blocks in reverse
+          order, so straight code settles in one pass and each loop level costs one more).
+         */
+        void liveness(const cfg::Graph& graph) {
+            for (bool changed = true; changed;) {
+                changed = false;
+                for (size_t b = graph.blocks.size(); b-- > 0;) {
+                    BlockDependencies& dependencies = blocks[b];
+                    RegisterSet out;
+                    for (uint32_t next : graph.blocks[b].successors) {
+                        if (next != cfg::NONE) { out |= blocks[next].liveIn; }
+                    }
+                    RegisterSet in = dependencies.uses | (out & ~dependencies.defs);
+                    if (in != dependencies.liveIn || out != dependencies.liveOut) {
+                        dependencies.liveIn = in;
+                        dependencies.liveOut = out;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    };
+}
\ No newline at end of file
@@ -1,27 +1,141 @@
-// Include libraries and define functions to use them in main.cpp
+// Include libraries and define functions to use them in the analyzer (analyzer.cpp, capi.cpp) and main.cpp
 
 #pragma once
 
 #include "dbg.hpp"
+#include "pool.hpp"
+#include "options.hpp"
+#include "mmap.hpp"
+#include "uring.hpp"
+#include "arch.hpp"
+#include "opcodes.hpp"
+#include "output.hpp"
+#include "compression.hpp"
+#include "scan.hpp"
+#include "xxhash.hpp"
+#include "cache.hpp"
+#include "records.hpp"
+#include "sidecar.hpp"
+#include "ir.hpp"
+#include "isa.hpp"
+#include "cfg.hpp"
+#include "cost.hpp"
+#include "deps.hpp"
+#include "stats.hpp"
+#include "memo.hpp"
+#include "includes.hpp"
+#include "symbols.hpp"
+#include "profile.hpp"
 
 #include <unordered_set>
+#include <string_view>
 #include <algorithm>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
+#include <filesystem>
 #include <vector>
+#include <array>
 #include <chrono>
+#include <functional>
+#include <deque>
+#include <memory>
 #include <cctype>
+#include <cmath>
 #include <ctime>
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+const inline std::string VERSION = "0.1.0"; // it's better to store this as a string, rather than a double
+
+/**
+  Outcome of analyzing a single file (or buffer).
+ */
+struct FileResult {
+    bool ok = false;
+    bool cached = false; // the output came from the result cache
+    uintmax_t bytes = 0;
+    size_t lines = 0;
+    double seconds = 0;
+    std::string_view architecture; // one of ArchDetector's names (empty for cached results)
+    std::string error;
+};
+
+/**
+  The pieces of an instruction line its handler works with, cut out of the tokenized block.
+ */
+struct InstructionContext {
+    const ir::Block* block = nullptr;
+    size_t line = 0;
+    std::string_view opcode;
+    std::string_view operands;
+    std::string_view lineOperand; // after the first space of the raw line, trailing spaces cut
+    size_t split = std::string_view::npos; // position in `operands` of the separator the instruction splits on
+    auto (*classify)(std::string_view operand) -> records::OperandKind = nullptr; // the backend's
+
+    /**
+      @return The kind the tokenizer gave an operand, classifying it if it isn't one of the tokenized ones.
+     */
+    [[nodiscard]] auto kindOf(std::string_view operand) const -> records::OperandKind;
+
+    /**
+      @return How many operands the tokenizer found.
+     */
+    [[nodiscard]] auto operandCount() const -> size_t { return block->operandCount(line); }
+
+    /**
+      @return A tokenized operand.
+     */
+    [[nodiscard]] auto operand(size_t index) const -> std::string_view {
+        return block->view(line, block->operand[block->firstOperand[line] + index]);
+    }
+
+    /**
+      @return The kind of a tokenized operand.
+     */
+    [[nodiscard]] auto operandKind(size_t index) const -> records::OperandKind {
+        return block->operandKind[block->firstOperand[line] + index];
+    }
+};
 
 // function prototypes (sorted)
-auto isInstruction(std::string& opcode) -> bool;
-auto trim(const std::string& str) -> std::string;
-auto isDirective(const std::string& opcode) -> bool;
-auto getOperand(const std::string& line) -> std::string;
-auto analyzeLine(const std::string& line) -> std::string;
-auto analyzeOperands(std::string& operands) -> std::string;
-auto isMemoryAddressingMode(const std::string& operand) -> bool;
-auto getArchitecture(const std::string& filename) -> std::string;
-auto analyzeOperand(const std::string& operand, bool appendType = false) -> std::string;
-auto analyzeDirective(const std::string& opcode, const std::string& operand) -> std::string;
-auto analyzeInstruction(const std::string& opcode, const std::string& operands, const std::string& line) -> std::string;
\ No newline at end of file
+auto loadProfiles(Options& options) -> bool;
+auto runDaemon(const Options& options) -> int;
+auto countLines(const ir::Block& block) -> void;
+auto reportStats(const Options& options) -> void;
+auto isDirective(std::string_view opcode) -> bool;
+auto isInstruction(std::string_view opcode) -> bool;
+auto trim(std::string_view str) -> std::string_view;
+auto getOperand(std::string_view line) -> std::string_view;
+auto isInputFile(const std::filesystem::path& path) -> bool;
+auto isMemoryAddressingMode(std::string_view operand) -> bool;
+auto isForbiddenPath(const std::filesystem::path& path) -> bool;
+auto isSupportedFile(const std::filesystem::path& path) -> bool;
+auto formatLine(std::string_view line, OutputBuffer& out) -> void;
+auto formatLine(const scan::LineMap& map, OutputBuffer& out) -> void;
+auto analyzeLine(std::string_view line, OutputBuffer& comment) -> void;
+auto classifyOperand(std::string_view operand) -> records::OperandKind;
+auto tokenizeLine(const scan::LineMap& map, ir::Block& block) -> size_t;
+auto analyzeLine(const scan::LineMap& map, OutputBuffer& comment) -> void;
+auto writeHeader(OutputBuffer& out, std::string_view architecture) -> void;
+auto analyzeOperands(std::string_view operands, OutputBuffer& comment) -> void;
+auto formatLine(const ir::Block& block, size_t line, OutputBuffer& out) -> void;
+auto getSidecarPath(const std::filesystem::path& path) -> std::filesystem::path;
+auto getAnalyzedPath(const std::filesystem::path& path) -> std::filesystem::path;
+auto getArchitecture(const std::string& filename, std::string& error) -> std::string;
+auto annotateLine(const ir::Block& block, size_t line, OutputBuffer& comment) -> void;
+auto analyzeStream(int input, const Options& options, OutputFile& output) -> FileResult;
+auto collectFiles(const Options& options, size_t& failed) -> std::vector<std::filesystem::path>;
+auto tokenizeOperands(const scan::LineMap& map, ir::Block& block, size_t from, size_t to) -> void;
+auto describeLine(const ir::Block& block, size_t line, records::Record& record) -> std::string_view;
+auto analyzeOperand(std::string_view operand, OutputBuffer& comment, bool appendType = false) -> void;
+auto analyzeInstruction(Instruction id, const InstructionContext& context, OutputBuffer& comment) -> void;
+auto viewFile(const std::filesystem::path& path, const Options& options, OutputFile& output) -> FileResult;
+auto analyzeFile(const std::filesystem::path& path, const Options& options, ThreadPool* pool) -> FileResult;
+auto queryXref(const std::filesystem::path& path, const Options& options, OutputFile& output) -> FileResult;
+auto analyzeDirective(Directive id, std::string_view directive, std::string_view operand, OutputBuffer& comment) -> void;
+auto analyzeOperand(std::string_view operand, records::OperandKind kind, OutputBuffer& comment, bool appendType) -> void;
+auto analyzeCached(const std::filesystem::path& path, const Options& options, ThreadPool* pool, ResultCache& cache) -> FileResult;
+auto analyzeBuffer(std::string_view text, const Options& options, ThreadPool* pool, std::string& output, std::string& records) -> FileResult;
+auto analyzeFiles(const std::vector<std::filesystem::path>& files, const Options& options, ThreadPool& pool, ResultCache& cache, const std::function<void(size_t, const FileResult&)>& done) -> std::vector<FileResult>;
\ No newline at end of file
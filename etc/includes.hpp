@@ -0,0 +1,143 @@
+#pragma once
+
+#include "mmap.hpp"
+#include "xxhash.hpp"
+#include <unordered_map>
+#include <system_error>
+#include <string_view>
+#include <filesystem>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+
+/**
+  Files pulled in by .include and %include, parsed once per run.
+
+  A tree of sources tends to include the same few headers of macros and constants from every
+  file. What a header defines depends on its bytes and the instruction set it's tokenized for,
+  not on who includes it, so the cache keeps one parse per header and instruction set, shared
+  read-only by every worker: the first file to include a header parses it while the others that
+  want it wait, and from then on it costs a stat. A header whose modification time or size
+  changed is hashed again and only parsed again when its content did.
+ */
+namespace includes {
+    /**
+      What an included file defines, as written in it.
+     */
+    struct Parsed {
+        std::filesystem::path path;
+        uint64_t hash = 0;
+        size_t lines = 0;
+        std::vector<std::string> labels;
+        std::vector<std::string> constants;
+        std::vector<std::string> macros;
+        std::vector<std::string> includes; // nested ones, as named by the directives
+    };
+
+    /**
+      @return The file an include directive names: its operand without quotes or angle brackets.
+     */
+    inline auto unquote(std::string_view operand) -> std::string_view {
+        size_t first = operand.find_first_not_of(" \t");
+        if (first == std::string_view::npos) { return {}; }
+        size_t last = operand.find_last_not_of(" \t\r");
+        operand = operand.substr(first, last - first + 1);
+        if (operand.size() >= 2 && ((operand.front() == '"' && operand.back() == '"') || (operand.front() == '\'' && operand.back() == '\'') ||
+            (operand.front() == '<' && operand.back() == '>'))) {
+            operand = operand.substr(1, operand.size() - 2);
+        }
+        return operand;
+    }
+
+    /**
+      Finds an included file: next to the file including it, then in the include directories,
+      then in the current directory.
+     *
+      @param name The name the directive gives.
+      @param from Directory of the including file (empty for the current one).
+      @param dirs The include directories (-I).
+      @return The file, or an empty path when none exists.
+     */
+    inline auto resolve(std::string_view name, const std::filesystem::path& from, const std::vector<std::string>& dirs) -> std::filesystem::path {
+        std::filesystem::path file(name);
+        std::error_code ec;
+        if (name.empty()) { return {}; }
+        if (file.is_absolute()) { return std::filesystem::is_regular_file(file, ec) ? file : std::filesystem::path(); }
+        if (std::filesystem::path candidate = from / file; std::filesystem::is_regular_file(candidate, ec)) { return candidate; }
+        for (const std::string& dir : dirs) {
+            if (std::filesystem::path candidate = std::filesystem::path(dir) / file; std::filesystem::is_regular_file(candidate, ec)) { return candidate; }
+        }
+        return !from.empty() && std::filesystem::is_regular_file(file, ec) ? file : std::filesystem::path();
+    }
+
+    class Cache {
+    public:
+        static auto get() -> Cache& {
+            static Cache cache;
+            return cache;
+        }
+
+        /**
+          Gets what a file defines, parsing it unless it was parsed before and hasn't changed.
+         *
+          @param path The file (resolve()).
+          @param flavour Name of the instruction set it's tokenized for.
+          @param parse Fills a Parsed from the text, parse(text, parsed).
+          @param parsed Set when the file had to be parsed.
+          @return The parse, or null when the file can't be read.
+         */
+        template <typename Parse>
+        auto find(const std::filesystem::path& path, std::string_view flavour, Parse&& parse, bool& parsed) -> std::shared_ptr<const Parsed> {
+            parsed = false;
+            std::error_code ec;
+            std::filesystem::path absolute = std::filesystem::absolute(path, ec).lexically_normal();
+            auto mtime = std::filesystem::last_write_time(absolute, ec);
+            if (ec) { return nullptr; }
+            uintmax_t size = std::filesystem::file_size(absolute, ec);
+            if (ec) { return nullptr; }
+
+            std::shared_ptr<Slot> slot;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::shared_ptr<Slot>& found = slots[std::string(flavour).append(1, '\n').append(absolute.string())];
+                if (!found) { found = std::make_shared<Slot>(); }
+                slot = found;
+            }
+
+            // one parse per file: whoever else wants it meanwhile waits for it
+            std::lock_guard<std::mutex> lock(slot->mutex);
+            if (slot->parsed && slot->mtime == mtime && slot->size == size) { return slot->parsed; }
+
+            MappedFile mapped;
+            std::string error;
+            if (size != 0 && !mapped.open(absolute.string(), error)) { return nullptr; }
+            std::string_view text = size != 0 ? mapped.view() : std::string_view();
+            uint64_t hash = xxhash::hash64(text);
+            slot->mtime = mtime;
+            slot->size = size;
+            // touched but the same
+            if (slot->parsed && slot->parsed->hash == hash) { return slot->parsed; }
+
+            auto fresh = std::make_shared<Parsed>();
+            fresh->path = absolute;
+            fresh->hash = hash;
+            parse(text, *fresh);
+            slot->parsed = std::move(fresh);
+            parsed = true;
+            return slot->parsed;
+        }
+
+    private:
+        struct Slot {
+            std::mutex mutex;
+            std::shared_ptr<const Parsed> parsed;
+            std::filesystem::file_time_type mtime;
+            uintmax_t size = 0;
+        };
+
+        std::mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<Slot>> slots; // by instruction set and absolute path
+    };
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "records.hpp"
+#include <string_view>
+#include <cstdint>
+#include <vector>
+
+/**
+  Tokenized lines, the form every pass after the tokenizer works on.
+
+  A block is filled by one pass over the text (tokenizeLine) and then read by annotation, records,
+  statistics and whatever analysis comes later, none of which look at the raw bytes for structure
+  again. Fields are stored column by column (struct of arrays): a pass over, say, line kinds and
+  opcode ids only pulls those two arrays through the cache. Text is referenced, never copied: a
+  line is an offset into the text the block was reset to, and its pieces are spans relative to
+  the start of the line.
+ */
+namespace ir {
+    /**
+      Part of a line, relative to the line's start.
+     */
+    struct Span {
+        uint32_t at = 0;
+        uint32_t length = 0;
+    };
+
+    /**
+      Value of Block::split when the operands aren't split.
+     */
+    constexpr uint32_t NO_SPLIT = UINT32_MAX;
+
+    /**
+      The fields of one line, as the tokenizer hands them to Block::add.
+     */
+    struct Line {
+        records::LineKind kind = records::LineKind::BLANK;
+        uint16_t opcode = records::NO_OPCODE;
+        Span name;
+        Span operands;
+        Span lineOperand;
+        uint32_t split = NO_SPLIT;
+    };
+
+    class Block {
+    public:
+        // one entry per line
+        std::vector<uint64_t> start;            // offset of the line in the text
+        std::vector<uint32_t> length;           // without the newline
+        std::vector<records::LineKind> kind;
+        std::vector<uint16_t> opcode;           // Instruction or Directive id (by kind), records::NO_OPCODE otherwise
+        std::vector<Span> name;                 // mnemonic or directive, the label without its colon
+        std::vector<Span> operands;             // after the mnemonic, trailing spaces cut
+        std::vector<Span> lineOperand;          // after the first space of the raw line, trailing spaces cut
+        std::vector<uint32_t> split;            // separator the instruction's operands are split on, in `operands`
+        std::vector<uint32_t> firstOperand;     // one more entry than lines: operands of line i are [firstOperand[i], firstOperand[i + 1])
+
+        // one entry per operand (split on the commas outside brackets and parentheses, trimmed; the
+        // two sides of `split` as they are when there is one)
+        std::vector<Span> operand;
+        std::vector<records::OperandKind> operandKind;
+
+        Block() { firstOperand.push_back(0); }
+
+        /**
+          Empties the block, keeping its capacity.
+         *
+          @param source The text the lines will be views of.
+         */
+        void reset(std::string_view source) {
+            text = source;
+            start.clear();
+            length.clear();
+            kind.clear();
+            opcode.clear();
+            name.clear();
+            operands.clear();
+            lineOperand.clear();
+            split.clear();
+            firstOperand.assign(1, 0);
+            operand.clear();
+            operandKind.clear();
+        }
+
+        /**
+          Appends a line, its operands follow through addOperand().
+         *
+          @param line The line, a view of the text.
+          @param fields What the tokenizer found in it.
+          @return Its index.
+         */
+        auto add(std::string_view line, const Line& fields) -> size_t {
+            start.push_back(static_cast<uint64_t>(line.data() - text.data()));
+            length.push_back(static_cast<uint32_t>(line.size()));
+            kind.push_back(fields.kind);
+            opcode.push_back(fields.opcode);
+            name.push_back(fields.name);
+            operands.push_back(fields.operands);
+            lineOperand.push_back(fields.lineOperand);
+            split.push_back(fields.split);
+            firstOperand.push_back(firstOperand.back());
+            return start.size() - 1;
+        }
+
+        /**
+          Appends an operand to the last line.
+         */
+        void addOperand(Span span, records::OperandKind operandKind) {
+            operand.push_back(span);
+            this->operandKind.push_back(operandKind);
+            ++firstOperand.back();
+        }
+
+        [[nodiscard]] auto lines() const -> size_t { return start.size(); }
+        [[nodiscard]] auto source() const -> std::string_view { return text; }
+
+        /**
+          @return The text of a line.
+         */
+        [[nodiscard]] auto line(size_t index) const -> std::string_view {
+            return text.substr(static_cast<size_t>(start[index]), length[index]);
+        }
+
+        /**
+          @return The text of a span of a line.
+         */
+        [[nodiscard]] auto view(size_t index, Span span) const -> std::string_view {
+            return text.substr(static_cast<size_t>(start[index]) + span.at, span.length);
+        }
+
+        /**
+          @return How many operands a line has.
+         */
+        [[nodiscard]] auto operandCount(size_t index) const -> size_t {
+            return firstOperand[index + 1] - firstOperand[index];
+        }
+
+    private:
+        std::string_view text;
+    };
+}
\ No newline at end of file
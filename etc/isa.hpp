@@ -0,0 +1,922 @@
+#pragma once
+
+#include "opcodes.hpp"
+#include "records.hpp"
+#include "arch.hpp"
+#include <string_view>
+#include <algorithm>
+#include <initializer_list>
+#include <cstdint>
+#include <array>
+
+/**
+  Instruction set backends.
+
+  One backend per architecture ArchDetector knows, with its own mnemonics, registers and way of
+  writing immediates and memory operands. A file's backend is picked once, from its detected
+  architecture (dispatch), and the tokenizer and annotator are instantiated for every backend, so
+  the per-line loop never asks which instruction set it is working on.
+
+  Backends derive from Backend<Self> and provide MNEMONICS, OPERATIONS, isRegister/isMemory/
+  isImmediate and registerId (dense register numbers, aliases such as eax and rax share one), the
+  base class turns those into lookup(), operation() and classify().
+
+  A backend whose annotations follow rules of their own names another one, Analysis, that the
+  passes over the meaning of the code (control flow, costs, dependencies, symbols, profiles)
+  tokenize the text with instead: X86's annotations split on spaces only, so compiler output,
+  indented and separated with tabs, is read by X86Analysis for those.
+ */
+namespace isa {
+    /**
+      What an instruction does, as far as control flow and cost estimates are concerned.
+     */
+    enum class Operation : uint8_t {
+        UNKNOWN,        // not a mnemonic of the backend
+        PSEUDO,         // assembled into nothing (x86's global and len)
+        ALU, MULTIPLY, DIVIDE, LOAD, STORE, LOAD_PAIR, STORE_PAIR,
+        FLOAT, FLOAT_MULTIPLY, FLOAT_DIVIDE,
+        JUMP,           // unconditional, to its label operand (indirect without one)
+        BRANCH,         // conditional, to its last label operand
+        CALL, RETURN, NOP, SYSTEM,
+        COUNT
+    };
+
+    constexpr size_t OPERATION_COUNT = static_cast<size_t>(Operation::COUNT);
+
+    /**
+      @return Whether an instruction ends a basic block.
+     */
+    constexpr auto endsBlock(Operation operation) -> bool {
+        return operation == Operation::JUMP || operation == Operation::BRANCH || operation == Operation::RETURN;
+    }
+
+    /**
+      Which register operands an instruction writes, where its operation alone doesn't tell.
+     */
+    enum class Writes : uint8_t {
+        DEFAULT,        // arithmetic and loads write their destination (two for paired loads), the rest nothing
+        NOTHING,        // compares and the like: every register operand is read
+        UPDATES         // the destination is read as well (x86's two-operand arithmetic, inc, dec)
+    };
+
+    /**
+      Value of registerId for operands that aren't registers, and for registers that always read
+      as zero (writing those doesn't make anything wait).
+     */
+    constexpr uint8_t NO_REGISTER = 0xFF;
+
+    /**
+      Mnemonics that share a property, to write a backend's tables with.
+     */
+    template <typename T>
+    struct Group {
+        T value;
+        std::initializer_list<std::string_view> mnemonics;
+    };
+
+    /**
+      @return The value of every instruction id (T{} for ids the groups don't name).
+     */
+    template <typename T>
+    constexpr auto byMnemonic(std::initializer_list<Group<T>> groups) -> std::array<T, INSTRUCTION_COUNT> {
+        std::array<T, INSTRUCTION_COUNT> table{};
+        for (const Group<T>& group : groups) {
+            for (std::string_view mnemonic : group.mnemonics) {
+                Instruction id = lookupInstruction(mnemonic);
+                if (id == Instruction::NONE) { throw "not a mnemonic of opcodes.hpp"; }
+                table[static_cast<size_t>(id)] = group.value;
+            }
+        }
+        return table;
+    }
+
+    /**
+      @return The operation of every instruction id (UNKNOWN for ids the groups don't name).
+     */
+    constexpr auto operations(std::initializer_list<Group<Operation>> groups) -> std::array<Operation, INSTRUCTION_COUNT> {
+        return byMnemonic(groups);
+    }
+
+    /**
+      @return Which operands every instruction id writes (DEFAULT for ids the groups don't name).
+     */
+    constexpr auto writeRules(std::initializer_list<Group<Writes>> groups) -> std::array<Writes, INSTRUCTION_COUNT> {
+        return byMnemonic(groups);
+    }
+
+    /**
+      The mnemonics of a backend, looked up through a perfect hash built at compile time.
+     */
+    template <size_t N>
+    class MnemonicTable {
+    public:
+        constexpr explicit MnemonicTable(const std::array<std::string_view, N>& names) : hash(names) {
+            for (size_t i = 0; i < N; ++i) { ids[i] = lookupInstruction(names[i]); }
+        }
+
+        /**
+          @return Whether every mnemonic has an id in opcodes.hpp.
+         */
+        [[nodiscard]] constexpr auto valid() const -> bool {
+            return std::find(ids.begin(), ids.end(), Instruction::NONE) == ids.end();
+        }
+
+        /**
+          @return Whether every mnemonic has an operation in `table`.
+         */
+        [[nodiscard]] constexpr auto covered(const std::array<Operation, INSTRUCTION_COUNT>& table) const -> bool {
+            return std::none_of(ids.begin(), ids.end(), [&](Instruction id) { return table[static_cast<size_t>(id)] == Operation::UNKNOWN; });
+        }
+
+        /**
+          @return The id of a mnemonic, Instruction::NONE if this instruction set doesn't have it.
+         */
+        [[nodiscard]] constexpr auto find(std::string_view mnemonic) const -> Instruction {
+            size_t index = hash.find(mnemonic);
+            return index == hash.NOT_FOUND ? Instruction::NONE : ids[index];
+        }
+
+    private:
+        PerfectHash<N> hash;
+        std::array<Instruction, N> ids{};
+    };
+
+    template <typename Self>
+    class Backend {
+    public:
+        /**
+          The backend the analysis passes tokenize the text with, this one unless its annotations
+          need a tokenization of their own.
+         */
+        using Analysis = Self;
+
+        /**
+          Whether only spaces separate the mnemonic from its operands and a line's operand starts
+          after the first space of the raw line (tabs are part of the tokens then).
+         */
+        static constexpr bool SPACES_ONLY = false;
+
+        /**
+          Whether the instruction after a branch (its delay slot) runs before the branch is taken.
+         */
+        static constexpr bool DELAY_SLOTS = false;
+
+        /**
+          Whether the destination is the last operand (SPARC) rather than the first.
+         */
+        static constexpr bool DESTINATION_LAST = false;
+
+        /**
+          Size of every instruction in bytes, 0 when it varies.
+         */
+        static constexpr unsigned INSTRUCTION_BYTES = 0;
+
+        /**
+          Exceptions to the operands an instruction's operation writes.
+         */
+        static constexpr std::array<Writes, INSTRUCTION_COUNT> WRITES{};
+
+        /**
+          @return The id of a mnemonic, Instruction::NONE if it isn't one of this instruction set.
+         */
+        static auto lookup(std::string_view mnemonic) -> Instruction {
+            return Self::MNEMONICS.find(mnemonic);
+        }
+
+        /**
+          @return What an operand (trimmed) is.
+         */
+        static auto classify(std::string_view operand) -> records::OperandKind {
+            if (operand.empty()) {
+                return records::OperandKind::NONE;
+            }
+            if (Self::isRegister(operand)) {
+                return records::OperandKind::REGISTER;
+            }
+            if (Self::isMemory(operand)) {
+                return records::OperandKind::MEMORY;
+            }
+            if (Self::isImmediate(operand)) {
+                return records::OperandKind::IMMEDIATE;
+            }
+            if (Self::isModifier(operand)) {
+                return records::OperandKind::MODIFIER;
+            }
+            // Assume other operands are labels or identifiers
+            return records::OperandKind::LABEL;
+        }
+
+        /**
+          @return Whether an operand modifies the one before it (ARM's lsl 3 and uxtw), none by default.
+         */
+        static constexpr auto isModifier([[maybe_unused]] std::string_view operand) -> bool {
+            return false;
+        }
+
+        /**
+          @return Whether an instruction only computes the address of its memory operand (x86's lea),
+          none by default.
+         */
+        static constexpr auto addressOnly([[maybe_unused]] uint16_t id) -> bool {
+            return false;
+        }
+
+        /**
+          @return Whether an instruction's destination is its last operand, given its operands
+          (DESTINATION_LAST unless the syntax tells it per line).
+         */
+        static constexpr auto destinationLast([[maybe_unused]] std::string_view operands) -> bool {
+            return Self::DESTINATION_LAST;
+        }
+
+        /**
+          @return What an instruction does (UNKNOWN for ids that aren't mnemonics of this instruction set).
+         */
+        static constexpr auto operation(uint16_t id) -> Operation {
+            return id < INSTRUCTION_COUNT ? Self::OPERATIONS[id] : Operation::UNKNOWN;
+        }
+
+        /**
+          @return Which operands an instruction writes (DEFAULT for ids that aren't mnemonics of this instruction set).
+         */
+        static constexpr auto writes(uint16_t id) -> Writes {
+            return id < INSTRUCTION_COUNT ? Self::WRITES[id] : Writes::DEFAULT;
+        }
+
+    protected:
+        static constexpr auto isDigit(char c) -> bool {
+            return c >= '0' && c <= '9';
+        }
+
+        /**
+          @return Whether an operand is a plain number, possibly negative (4, -16, 0x10).
+         */
+        static constexpr auto isNumber(std::string_view operand) -> bool {
+            return isDigit(operand[0]) || (operand.size() > 1 && operand[0] == '-' && isDigit(operand[1]));
+        }
+
+        /**
+          @return Whether a name is `prefix` followed by a number below `count` (x0 to x30: "x", 31).
+         */
+        static constexpr auto isNumbered(std::string_view name, std::string_view prefix, unsigned count) -> bool {
+            return numbered(name, prefix, count) != NO_NUMBER;
+        }
+
+        static constexpr unsigned NO_NUMBER = UINT32_MAX;
+
+        /**
+          @return The number after `prefix` if it is below `count`, NO_NUMBER if the name isn't numbered that way.
+         */
+        static constexpr auto numbered(std::string_view name, std::string_view prefix, unsigned count) -> unsigned {
+            if (name.size() <= prefix.size() || name.size() > prefix.size() + 2 || name.substr(0, prefix.size()) != prefix) {
+                return NO_NUMBER;
+            }
+            std::string_view digits = name.substr(prefix.size());
+            if (!isDigit(digits[0]) || (digits.size() == 2 && (digits[0] == '0' || !isDigit(digits[1])))) {
+                return NO_NUMBER;
+            }
+            unsigned value = digits.size() == 1 ? static_cast<unsigned>(digits[0] - '0') : static_cast<unsigned>((digits[0] - '0') * 10 + (digits[1] - '0'));
+            return value < count ? value : NO_NUMBER;
+        }
+
+        /**
+          @return `base` plus the number after the first prefix of `prefixes` the name has, NO_REGISTER if it has none.
+         */
+        static constexpr auto numberedId(std::string_view name, std::initializer_list<std::string_view> prefixes, unsigned count, unsigned base) -> uint8_t {
+            for (std::string_view prefix : prefixes) {
+                if (unsigned n = numbered(name, prefix, count); n != NO_NUMBER) { return static_cast<uint8_t>(base + n); }
+            }
+            return NO_REGISTER;
+        }
+
+        /**
+          @return The register of an `offset(register)` operand, empty if it isn't one.
+         */
+        static constexpr auto baseOf(std::string_view operand) -> std::string_view {
+            size_t open = operand.rfind('(');
+            if (operand.back() != ')' || open == std::string_view::npos) { return {}; }
+            return operand.substr(open + 1, operand.size() - open - 2);
+        }
+    };
+
+    class X86Analysis;
+
+    /**
+      x86 and x86-64 (AT&T or Intel syntax), also used when no marker was found.
+     */
+    class X86 : public Backend<X86> {
+    public:
+        using Analysis = X86Analysis;
+
+        static constexpr std::string_view NAME = "x86";
+        static constexpr bool SPACES_ONLY = true; // the rules every x86 annotation was written against
+
+        static constexpr MnemonicTable MNEMONICS{ std::to_array<std::string_view>({
+            "int", "push", "pop", "mov", "movq", "add", "addq", "sub", "subq",
+            "jmp", "call", "ret", "cmp", "je", "jne", "inc", "dec", "mul", "div",
+            "global", "len", "nop",
+            "jg", "jge", "jl", "jle", "ja", "jae", "jb", "jbe", "jz", "jnz", "js", "jns", "loop"
+        }) };
+
+        static constexpr auto OPERATIONS = operations({
+            { Operation::ALU, { "mov", "movq", "add", "addq", "sub", "subq", "cmp", "inc", "dec" } },
+            { Operation::MULTIPLY, { "mul" } },
+            { Operation::DIVIDE, { "div" } },
+            { Operation::STORE, { "push" } },
+            { Operation::LOAD, { "pop" } },
+            { Operation::JUMP, { "jmp" } },
+            { Operation::BRANCH, { "je", "jne", "jg", "jge", "jl", "jle", "ja", "jae", "jb", "jbe", "jz", "jnz", "js", "jns", "loop" } },
+            { Operation::CALL, { "call" } },
+            { Operation::RETURN, { "ret" } },
+            { Operation::NOP, { "nop" } },
+            { Operation::SYSTEM, { "int" } },
+            { Operation::PSEUDO, { "global", "len" } }
+        });
+
+        // mul and div work on rax and rdx, which aren't operands: only their operand is tracked
+        static constexpr auto WRITES = writeRules({
+            { Writes::UPDATES, { "add", "addq", "sub", "subq", "inc", "dec" } },
+            { Writes::NOTHING, { "cmp", "mul", "div" } }
+        });
+
+        static constexpr size_t REGISTERS = 16;
+
+        static auto isRegister(std::string_view operand) -> bool {
+            // most operands ($1, -8(%rbp), .L3, ...) are turned away before hashing
+            return isRegisterLike(operand) && REGISTER_HASH.find(operand) != REGISTER_HASH.NOT_FOUND;
+        }
+
+        static auto isImmediate(std::string_view operand) -> bool {
+            return operand[0] == '$' || isDigit(operand[0]);
+        }
+
+        static auto isMemory(std::string_view operand) -> bool {
+            return operand[0] == '[' && operand.back() == ']' && operand.find('%') != std::string_view::npos;
+        }
+
+        // rax, eax, al and ah are one register (so are r8 to r8b)
+        static auto registerId(std::string_view operand) -> uint8_t {
+            if (!isRegisterLike(operand)) { return NO_REGISTER; }
+            size_t index = REGISTER_HASH.find(operand);
+            return index == REGISTER_HASH.NOT_FOUND ? NO_REGISTER : REGISTER_IDS[index];
+        }
+
+    private:
+        static constexpr std::array<std::string_view, 60> REGISTER_NAMES = {
+            "eax", "ebx", "ecx", "edx", "esi", "edi", "esp", "ebp",
+            "rax", "rbx", "rcx", "rdx", "rsi", "rdi", "rsp", "rbp",
+            "ah", "bh", "ch", "dh", "al", "bl", "cl", "dl",
+            "spl", "bpl", "sil", "dil",
+            "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15",
+            "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d",
+            "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w",
+            "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"
+        };
+        static constexpr PerfectHash<REGISTER_NAMES.size()> REGISTER_HASH{ REGISTER_NAMES };
+        static constexpr std::array<uint8_t, REGISTER_NAMES.size()> REGISTER_IDS = {
+            0, 1, 2, 3, 4, 5, 6, 7,
+            0, 1, 2, 3, 4, 5, 6, 7,
+            0, 1, 2, 3, 0, 1, 2, 3,
+            6, 7, 4, 5,
+            8, 9, 10, 11, 12, 13, 14, 15,
+            8, 9, 10, 11, 12, 13, 14, 15,
+            8, 9, 10, 11, 12, 13, 14, 15,
+            8, 9, 10, 11, 12, 13, 14, 15
+        };
+
+        static constexpr auto isRegisterLike = [](std::string_view name) {
+            return name.size() >= 2 && name.size() <= 4 && name[0] >= 'a' && name[0] <= 'z';
+        };
+        static_assert(std::all_of(REGISTER_NAMES.begin(), REGISTER_NAMES.end(), isRegisterLike));
+    };
+
+    /**
+      x86 as compilers write it, for the analysis passes: mnemonics and operands separated by any
+      blank, AT&T syntax (%rax, -8(%rbp), $1, size suffixes, the destination last) or Intel syntax
+      (DWORD PTR [rbp-8]), and the scalar SSE instructions. The annotations keep X86's rules.
+     */
+    class X86Analysis : public Backend<X86Analysis> {
+    public:
+        static constexpr std::string_view NAME = X86::NAME;
+
+        static constexpr MnemonicTable MNEMONICS{ std::to_array<std::string_view>({
+            "int", "push", "pop", "mov", "movq", "add", "addq", "sub", "subq", "jmp", "call", "ret", "cmp", "je", "jne",
+            "inc", "dec", "mul", "div", "global", "len", "nop",
+            "jg", "jge", "jl", "jle", "ja", "jae", "jb", "jbe", "jz", "jnz", "js", "jns", "loop",
+            "jnb", "jnae", "jna", "jnbe", "jnl", "jnge", "jng", "jnle", "jc", "jnc", "jo", "jno", "jp", "jnp",
+            "lea", "and", "or", "xor", "not", "neg", "test", "imul", "idiv", "shl", "sal", "shr", "sar", "rol", "ror", "adc", "sbb",
+            "xchg", "bt", "movzx", "movsx", "movsxd", "movabs", "cltq", "cltd", "cqto", "cdq", "cqo", "cdqe",
+            "leave", "endbr64", "hlt", "ud2", "syscall",
+            "sete", "setne", "setg", "setge", "setl", "setle", "seta", "setae", "setb", "setbe",
+            "cmove", "cmovne", "cmovg", "cmovge", "cmovl", "cmovle", "cmova", "cmovae", "cmovb", "cmovbe", "cmovs", "cmovns",
+            "movss", "movsd", "movaps", "movapd", "movups", "movd", "movdqa", "movdqu", "addss", "addsd", "subss", "subsd",
+            "mulss", "mulsd", "divss", "divsd", "sqrtss", "sqrtsd", "cvtsi2sd", "cvtsi2ss", "cvttsd2si", "cvttss2si",
+            "cvtss2sd", "cvtsd2ss", "pxor", "xorps", "xorpd", "ucomisd", "ucomiss", "comisd", "comiss"
+        }) };
+
+        static constexpr auto OPERATIONS = operations({
+            { Operation::ALU, { "mov", "movq", "add", "addq", "sub", "subq", "cmp", "inc", "dec", "lea", "and", "or", "xor", "not", "neg", "test",
+                "shl", "sal", "shr", "sar", "rol", "ror", "adc", "sbb", "xchg", "bt", "movzx", "movsx", "movsxd", "movabs",
+                "cltq", "cltd", "cqto", "cdq", "cqo", "cdqe", "sete", "setne", "setg", "setge", "setl", "setle", "seta", "setae", "setb", "setbe",
+                "cmove", "cmovne", "cmovg", "cmovge", "cmovl", "cmovle", "cmova", "cmovae", "cmovb", "cmovbe", "cmovs", "cmovns" } },
+            { Operation::MULTIPLY, { "mul", "imul" } },
+            { Operation::DIVIDE, { "div", "idiv" } },
+            { Operation::STORE, { "push" } },
+            { Operation::LOAD, { "pop", "leave" } },
+            { Operation::FLOAT, { "movss", "movsd", "movaps", "movapd", "movups", "movd", "movdqa", "movdqu", "addss", "addsd", "subss", "subsd",
+                "cvtsi2sd", "cvtsi2ss", "cvttsd2si", "cvttss2si", "cvtss2sd", "cvtsd2ss", "pxor", "xorps", "xorpd",
+                "ucomisd", "ucomiss", "comisd", "comiss" } },
+            { Operation::FLOAT_MULTIPLY, { "mulss", "mulsd" } },
+            { Operation::FLOAT_DIVIDE, { "divss", "divsd", "sqrtss", "sqrtsd" } },
+            { Operation::JUMP, { "jmp" } },
+            { Operation::BRANCH, { "je", "jne", "jg", "jge", "jl", "jle", "ja", "jae", "jb", "jbe", "jz", "jnz", "js", "jns", "loop",
+                "jnb", "jnae", "jna", "jnbe", "jnl", "jnge", "jng", "jnle", "jc", "jnc", "jo", "jno", "jp", "jnp" } },
+            { Operation::CALL, { "call" } },
+            { Operation::RETURN, { "ret" } },
+            { Operation::NOP, { "nop", "endbr64" } },
+            { Operation::SYSTEM, { "int", "syscall", "hlt", "ud2" } },
+            { Operation::PSEUDO, { "global", "len" } }
+        });
+
+        // two-operand arithmetic reads its destination (imul is taken for its two-operand form), mul and div work on rax and rdx
+        static constexpr auto WRITES = writeRules({
+            { Writes::UPDATES, { "add", "addq", "sub", "subq", "inc", "dec", "and", "or", "xor", "not", "neg", "shl", "sal", "shr", "sar",
+                "rol", "ror", "adc", "sbb", "imul", "cmove", "cmovne", "cmovg", "cmovge", "cmovl", "cmovle", "cmova", "cmovae", "cmovb", "cmovbe",
+                "cmovs", "cmovns", "addss", "addsd", "subss", "subsd", "mulss", "mulsd", "divss", "divsd", "pxor", "xorps", "xorpd" } },
+            { Writes::NOTHING, { "cmp", "test", "bt", "mul", "div", "idiv", "ucomisd", "ucomiss", "comisd", "comiss" } }
+        });
+
+        // X86's 16, then xmm0-xmm15 (ymm and zmm share them)
+        static constexpr size_t REGISTERS = 32;
+
+        /**
+          @return The id of a mnemonic, AT&T's size suffix (movl, addq, retq) and the two of its
+          extending moves (movzbl, movslq) taken off when the mnemonic itself isn't one.
+         */
+        static auto lookup(std::string_view mnemonic) -> Instruction {
+            if (Instruction id = MNEMONICS.find(mnemonic); id != Instruction::NONE || mnemonic.size() < 3) { return id; }
+            auto isSuffix = [](char c) { return c == 'b' || c == 'w' || c == 'l' || c == 'q'; };
+            if (mnemonic.size() == 6 && (mnemonic.substr(0, 4) == "movz" || mnemonic.substr(0, 4) == "movs") && isSuffix(mnemonic[4]) &&
+                isSuffix(mnemonic[5])) {
+                return mnemonic[3] == 'z' ? Instruction::MOVZX : Instruction::MOVSX;
+            }
+            return isSuffix(mnemonic.back()) ? MNEMONICS.find(mnemonic.substr(0, mnemonic.size() - 1)) : Instruction::NONE;
+        }
+
+        static auto isRegister(std::string_view operand) -> bool {
+            std::string_view name = withoutPercent(operand);
+            return X86::isRegister(name) || isVector(name);
+        }
+
+        // $1 in AT&T syntax, 1 in Intel syntax
+        static auto isImmediate(std::string_view operand) -> bool {
+            return operand[0] == '$' || isNumber(operand);
+        }
+
+        // -8(%rbp), .LC0(%rip), (%rax,%rdx,4) and DWORD PTR [rbp-8]
+        static auto isMemory(std::string_view operand) -> bool {
+            return (operand.back() == ')' && operand.find('(') != std::string_view::npos) ||
+                (operand.back() == ']' && operand.find('[') != std::string_view::npos);
+        }
+
+        static auto registerId(std::string_view operand) -> uint8_t {
+            std::string_view name = withoutPercent(operand);
+            if (uint8_t id = X86::registerId(name); id != NO_REGISTER) { return id; }
+            return numberedId(name, { "xmm", "ymm", "zmm" }, 16, 16);
+        }
+
+        // AT&T syntax, the only one with %registers, puts the destination last
+        static constexpr auto destinationLast(std::string_view operands) -> bool {
+            return operands.find('%') != std::string_view::npos;
+        }
+
+        static constexpr auto addressOnly(uint16_t id) -> bool {
+            return id == static_cast<uint16_t>(Instruction::LEA);
+        }
+
+    private:
+        static constexpr auto withoutPercent(std::string_view operand) -> std::string_view {
+            return operand.empty() || operand[0] != '%' ? operand : operand.substr(1);
+        }
+
+        static constexpr auto isVector(std::string_view name) -> bool {
+            return isNumbered(name, "xmm", 16) || isNumbered(name, "ymm", 16) || isNumbered(name, "zmm", 16);
+        }
+    };
+
+    /**
+      ARM, A64 (x0, w0, [sp, 16]) and A32 (r0, [fp, #-8]).
+     */
+    class Arm : public Backend<Arm> {
+    public:
+        static constexpr std::string_view NAME = "ARM";
+        static constexpr unsigned INSTRUCTION_BYTES = 4; // A64 and A32, Thumb isn't told apart
+
+        static constexpr MnemonicTable MNEMONICS{ std::to_array<std::string_view>({
+            "mov", "movk", "movz", "mvn", "add", "adds", "sub", "subs", "mul", "madd", "msub", "sdiv", "udiv", "neg",
+            "and", "orr", "eor", "lsl", "lsr", "asr", "cmp", "cmn", "tst", "csel", "cset",
+            "ldr", "ldrb", "ldrh", "ldrsw", "ldp", "ldnp", "ldur", "str", "strb", "strh", "stp", "stnp", "stur",
+            "adrp", "adr", "sxtw", "uxtw", "b", "bl", "blr", "br", "bx", "ret", "cbz", "cbnz", "tbz", "tbnz",
+            "b.eq", "b.ne", "b.lt", "b.le", "b.gt", "b.ge", "b.hi", "b.ls", "b.cs", "b.cc", "b.mi", "b.pl",
+            "beq", "bne", "blt", "ble", "bgt", "bge", "push", "pop", "nop", "svc",
+            "fmov", "fadd", "fsub", "fmul", "fdiv", "scvtf", "fcvtzs"
+        }) };
+
+        static constexpr auto OPERATIONS = operations({
+            { Operation::ALU, { "mov", "movk", "movz", "mvn", "add", "adds", "sub", "subs", "neg", "and", "orr", "eor", "lsl", "lsr", "asr",
+                "cmp", "cmn", "tst", "csel", "cset", "adrp", "adr", "sxtw", "uxtw" } },
+            { Operation::MULTIPLY, { "mul", "madd", "msub" } },
+            { Operation::DIVIDE, { "sdiv", "udiv" } },
+            { Operation::LOAD, { "ldr", "ldrb", "ldrh", "ldrsw", "ldur" } },
+            { Operation::LOAD_PAIR, { "ldp", "ldnp", "pop" } },
+            { Operation::STORE, { "str", "strb", "strh", "stur" } },
+            { Operation::STORE_PAIR, { "stp", "stnp", "push" } },
+            { Operation::FLOAT, { "fmov", "fadd", "fsub", "scvtf", "fcvtzs" } },
+            { Operation::FLOAT_MULTIPLY, { "fmul" } },
+            { Operation::FLOAT_DIVIDE, { "fdiv" } },
+            { Operation::JUMP, { "b", "br", "bx" } },
+            { Operation::BRANCH, { "cbz", "cbnz", "tbz", "tbnz", "b.eq", "b.ne", "b.lt", "b.le", "b.gt", "b.ge", "b.hi", "b.ls", "b.cs", "b.cc",
+                "b.mi", "b.pl", "beq", "bne", "blt", "ble", "bgt", "bge" } },
+            { Operation::CALL, { "bl", "blr" } },
+            { Operation::RETURN, { "ret" } },
+            { Operation::NOP, { "nop" } },
+            { Operation::SYSTEM, { "svc" } }
+        });
+
+        static constexpr auto WRITES = writeRules({
+            { Writes::UPDATES, { "movk" } },
+            { Writes::NOTHING, { "cmp", "cmn", "tst" } }
+        });
+
+        // x0-x30 (A32's r0-r15 share the numbers), sp, pc, then the 32 vector registers
+        static constexpr size_t REGISTERS = 65;
+
+        static auto isRegister(std::string_view operand) -> bool {
+            constexpr std::array<std::string_view, 8> NAMED = { "sp", "wsp", "lr", "pc", "fp", "ip", "xzr", "wzr" };
+            return std::find(NAMED.begin(), NAMED.end(), operand) != NAMED.end() ||
+                isNumbered(operand, "x", 31) || isNumbered(operand, "w", 31) || isNumbered(operand, "r", 16) ||
+                isNumbered(operand, "v", 32) || isNumbered(operand, "q", 32) || isNumbered(operand, "d", 32) || isNumbered(operand, "s", 32);
+        }
+
+        // #16, 16, -16 and relocations (:lo12:.LC0)
+        static auto isImmediate(std::string_view operand) -> bool {
+            return operand[0] == '#' || operand[0] == ':' || isNumber(operand);
+        }
+
+        // [sp, 16], [x0], [sp, -16]!
+        static auto isMemory(std::string_view operand) -> bool {
+            return operand[0] == '[';
+        }
+
+        // the shift or extension of a register operand: x2, lsl 3 / w1, uxtw / r1, lsl #2
+        static auto isModifier(std::string_view operand) -> bool {
+            constexpr std::array<std::string_view, 13> MODIFIERS = {
+                "lsl", "lsr", "asr", "ror", "msl", "uxtb", "uxth", "uxtw", "uxtx", "sxtb", "sxth", "sxtw", "sxtx"
+            };
+            std::string_view name = operand.substr(0, operand.find(' '));
+            return std::find(MODIFIERS.begin(), MODIFIERS.end(), name) != MODIFIERS.end();
+        }
+
+        static auto registerId(std::string_view operand) -> uint8_t {
+            if (operand == "sp" || operand == "wsp") { return 31; }
+            if (operand == "fp") { return 29; }
+            if (operand == "lr") { return 30; }
+            if (operand == "ip") { return 12; }
+            if (operand == "pc") { return 32; }
+            if (uint8_t id = numberedId(operand, { "x", "w" }, 31, 0); id != NO_REGISTER) { return id; }
+            if (uint8_t id = numberedId(operand, { "r" }, 16, 0); id != NO_REGISTER) { return id; }
+            return numberedId(operand, { "v", "q", "d", "s" }, 32, 33); // xzr and wzr read as zero
+        }
+    };
+
+    /**
+      MIPS, registers with a dollar sign ($sp, $2) and offset(base) memory operands.
+     */
+    class Mips : public Backend<Mips> {
+    public:
+        static constexpr std::string_view NAME = "MIPS";
+        static constexpr unsigned INSTRUCTION_BYTES = 4;
+        static constexpr bool DELAY_SLOTS = true;
+
+        static constexpr MnemonicTable MNEMONICS{ std::to_array<std::string_view>({
+            "move", "li", "la", "lui", "add", "addu", "addiu", "sub", "subu", "daddiu", "daddu",
+            "mul", "mult", "multu", "div", "divu", "mflo", "mfhi", "neg", "negu", "not",
+            "and", "andi", "or", "ori", "xor", "xori", "nor", "sll", "srl", "sra", "slt", "slti", "sltu", "sltiu",
+            "lw", "lb", "lbu", "lh", "lhu", "ld", "sw", "sb", "sh", "sd", "lwc1", "swc1",
+            "b", "j", "jal", "jalr", "jr", "beq", "bne", "beqz", "bnez", "bltz", "bgez", "blez", "bgtz",
+            "nop", "syscall"
+        }) };
+
+        static constexpr auto OPERATIONS = operations({
+            { Operation::ALU, { "move", "li", "la", "lui", "add", "addu", "addiu", "sub", "subu", "daddiu", "daddu", "mflo", "mfhi",
+                "neg", "negu", "not", "and", "andi", "or", "ori", "xor", "xori", "nor", "sll", "srl", "sra", "slt", "slti", "sltu", "sltiu" } },
+            { Operation::MULTIPLY, { "mul", "mult", "multu" } },
+            { Operation::DIVIDE, { "div", "divu" } },
+            { Operation::LOAD, { "lw", "lb", "lbu", "lh", "lhu", "ld", "lwc1" } },
+            { Operation::STORE, { "sw", "sb", "sh", "sd", "swc1" } },
+            { Operation::JUMP, { "b", "j", "jr" } },
+            { Operation::BRANCH, { "beq", "bne", "beqz", "bnez", "bltz", "bgez", "blez", "bgtz" } },
+            { Operation::CALL, { "jal", "jalr" } },
+            { Operation::NOP, { "nop" } },
+            { Operation::SYSTEM, { "syscall" } }
+        });
+
+        // the two operand forms write hi and lo, which aren't tracked
+        static constexpr auto WRITES = writeRules({
+            { Writes::NOTHING, { "mult", "multu", "div", "divu" } }
+        });
+
+        // $1-$31 ($0 reads as zero), then $f0-$f31
+        static constexpr size_t REGISTERS = 64;
+
+        // $sp, $31, $f0 (labels are $L2, $LC0)
+        static auto isRegister(std::string_view operand) -> bool {
+            return operand.size() > 1 && operand[0] == '$' &&
+                std::all_of(operand.begin() + 1, operand.end(), [](char c) { return isDigit(c) || (c >= 'a' && c <= 'z'); });
+        }
+
+        // numbers and relocations (%hi($LC0))
+        static auto isImmediate(std::string_view operand) -> bool {
+            return operand[0] == '%' || isNumber(operand);
+        }
+
+        // 28($sp), %lo($LC0)($2)
+        static auto isMemory(std::string_view operand) -> bool {
+            return isRegister(baseOf(operand));
+        }
+
+        static auto registerId(std::string_view operand) -> uint8_t {
+            if (operand.size() < 2 || operand[0] != '$') { return NO_REGISTER; }
+            std::string_view name = operand.substr(1);
+            constexpr std::array<std::string_view, 32> ABI_NAMES = {
+                "zero", "at", "v0", "v1", "a0", "a1", "a2", "a3", "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+                "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7", "t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra"
+            };
+            unsigned number = isDigit(name[0]) ? numbered(operand, "$", 32) : NO_NUMBER;
+            if (number == NO_NUMBER) {
+                auto found = std::find(ABI_NAMES.begin(), ABI_NAMES.end(), name);
+                number = found != ABI_NAMES.end() ? static_cast<unsigned>(found - ABI_NAMES.begin()) : name == "s8" ? 30 : NO_NUMBER;
+            }
+            if (number != NO_NUMBER) { return number == 0 ? NO_REGISTER : static_cast<uint8_t>(number); }
+            return numberedId(operand, { "$f" }, 32, 32);
+        }
+    };
+
+    /**
+      PowerPC, which GCC writes with bare register numbers (stw 31,28(1)): those can't be told from
+      immediates, only r0/%r0 style names are registers.
+     */
+    class PowerPc : public Backend<PowerPc> {
+    public:
+        static constexpr std::string_view NAME = "PowerPC";
+        static constexpr unsigned INSTRUCTION_BYTES = 4;
+
+        static constexpr MnemonicTable MNEMONICS{ std::to_array<std::string_view>({
+            "li", "lis", "la", "mr", "addi", "addis", "add", "subf", "subfic", "neg",
+            "mullw", "mulld", "mulli", "divw", "divwu", "divd", "and", "or", "ori", "xor", "xori", "nor",
+            "slwi", "srwi", "sldi", "srdi", "sraw", "srawi", "extsw", "rlwinm",
+            "lwz", "lbz", "lhz", "lha", "lwa", "ld", "lfd", "lfs",
+            "stw", "stb", "sth", "std", "stwu", "stdu", "stfd", "stfs", "mflr", "mtlr", "mtctr",
+            "cmpw", "cmpwi", "cmplw", "cmplwi", "cmpd", "cmpdi",
+            "b", "bl", "blr", "bctr", "bctrl", "beq", "bne", "blt", "bgt", "ble", "bge", "nop", "sc"
+        }) };
+
+        static constexpr auto OPERATIONS = operations({
+            { Operation::ALU, { "li", "lis", "la", "mr", "addi", "addis", "add", "subf", "subfic", "neg", "and", "or", "ori", "xor", "xori", "nor",
+                "slwi", "srwi", "sldi", "srdi", "sraw", "srawi", "extsw", "rlwinm", "mflr", "mtlr", "mtctr",
+                "cmpw", "cmpwi", "cmplw", "cmplwi", "cmpd", "cmpdi" } },
+            { Operation::MULTIPLY, { "mullw", "mulld", "mulli" } },
+            { Operation::DIVIDE, { "divw", "divwu", "divd" } },
+            { Operation::LOAD, { "lwz", "lbz", "lhz", "lha", "lwa", "ld", "lfd", "lfs" } },
+            { Operation::STORE, { "stw", "stb", "sth", "std", "stwu", "stdu", "stfd", "stfs" } },
+            { Operation::JUMP, { "b", "bctr" } },
+            { Operation::BRANCH, { "beq", "bne", "blt", "bgt", "ble", "bge" } },
+            { Operation::CALL, { "bl", "bctrl" } },
+            { Operation::RETURN, { "blr" } },
+            { Operation::NOP, { "nop" } },
+            { Operation::SYSTEM, { "sc" } }
+        });
+
+        // compares write a condition register field given as a number, mtlr and mtctr write registers that aren't operands
+        static constexpr auto WRITES = writeRules({
+            { Writes::NOTHING, { "cmpw", "cmpwi", "cmplw", "cmplwi", "cmpd", "cmpdi", "mtlr", "mtctr" } }
+        });
+
+        // r0-r31, f0-f31, v0-v31, cr0-cr7, lr, ctr, xer
+        static constexpr size_t REGISTERS = 107;
+
+        static auto isRegister(std::string_view operand) -> bool {
+            std::string_view name = operand[0] == '%' ? operand.substr(1) : operand;
+            constexpr std::array<std::string_view, 3> NAMED = { "lr", "ctr", "xer" };
+            return std::find(NAMED.begin(), NAMED.end(), name) != NAMED.end() ||
+                isNumbered(name, "r", 32) || isNumbered(name, "f", 32) || isNumbered(name, "v", 32) || isNumbered(name, "cr", 8);
+        }
+
+        static auto isImmediate(std::string_view operand) -> bool {
+            return isNumber(operand);
+        }
+
+        // 8(1), -16(%r31)
+        static auto isMemory(std::string_view operand) -> bool {
+            std::string_view base = baseOf(operand);
+            return !base.empty() && (isRegister(base) || std::all_of(base.begin(), base.end(), isDigit));
+        }
+
+        // only named registers: bare numbers aren't registers to the tokenizer either
+        static auto registerId(std::string_view operand) -> uint8_t {
+            std::string_view name = !operand.empty() && operand[0] == '%' ? operand.substr(1) : operand;
+            if (name == "lr") { return 104; }
+            if (name == "ctr") { return 105; }
+            if (name == "xer") { return 106; }
+            if (uint8_t id = numberedId(name, { "r" }, 32, 0); id != NO_REGISTER) { return id; }
+            if (uint8_t id = numberedId(name, { "f" }, 32, 32); id != NO_REGISTER) { return id; }
+            if (uint8_t id = numberedId(name, { "v" }, 32, 64); id != NO_REGISTER) { return id; }
+            return numberedId(name, { "cr" }, 8, 96);
+        }
+    };
+
+    /**
+      RISC-V, with ABI register names (a0, sp) and offset(base) memory operands.
+     */
+    class RiscV : public Backend<RiscV> {
+    public:
+        static constexpr std::string_view NAME = "RISC-V";
+
+        static constexpr MnemonicTable MNEMONICS{ std::to_array<std::string_view>({
+            "li", "la", "lui", "auipc", "mv", "add", "addi", "addw", "addiw", "sub", "subw", "neg", "negw",
+            "mul", "mulw", "div", "divu", "divw", "rem", "remu", "remw", "and", "andi", "or", "ori", "xor", "xori", "not",
+            "sll", "slli", "sllw", "srl", "srli", "srlw", "sra", "srai", "sraw", "slt", "slti", "sltu", "sltiu",
+            "seqz", "snez", "sext.w", "lb", "lbu", "lh", "lhu", "lw", "lwu", "ld", "sb", "sh", "sw", "sd",
+            "flw", "fld", "fsw", "fsd", "fmv.s", "fmv.d", "fadd.d", "fsub.d", "fmul.d", "fdiv.d", "fcvt.d.w",
+            "j", "jal", "jalr", "jr", "call", "tail", "ret",
+            "beq", "bne", "blt", "bge", "bltu", "bgeu", "bgt", "ble", "bgtu", "bleu",
+            "beqz", "bnez", "bltz", "bgez", "blez", "bgtz", "nop", "ecall", "ebreak"
+        }) };
+
+        static constexpr auto OPERATIONS = operations({
+            { Operation::ALU, { "li", "la", "lui", "auipc", "mv", "add", "addi", "addw", "addiw", "sub", "subw", "neg", "negw",
+                "and", "andi", "or", "ori", "xor", "xori", "not", "sll", "slli", "sllw", "srl", "srli", "srlw", "sra", "srai", "sraw",
+                "slt", "slti", "sltu", "sltiu", "seqz", "snez", "sext.w" } },
+            { Operation::MULTIPLY, { "mul", "mulw" } },
+            { Operation::DIVIDE, { "div", "divu", "divw", "rem", "remu", "remw" } },
+            { Operation::LOAD, { "lb", "lbu", "lh", "lhu", "lw", "lwu", "ld", "flw", "fld" } },
+            { Operation::STORE, { "sb", "sh", "sw", "sd", "fsw", "fsd" } },
+            { Operation::FLOAT, { "fmv.s", "fmv.d", "fadd.d", "fsub.d", "fcvt.d.w" } },
+            { Operation::FLOAT_MULTIPLY, { "fmul.d" } },
+            { Operation::FLOAT_DIVIDE, { "fdiv.d" } },
+            { Operation::JUMP, { "j", "jr", "tail" } },
+            { Operation::BRANCH, { "beq", "bne", "blt", "bge", "bltu", "bgeu", "bgt", "ble", "bgtu", "bleu",
+                "beqz", "bnez", "bltz", "bgez", "blez", "bgtz" } },
+            { Operation::CALL, { "jal", "jalr", "call" } },
+            { Operation::RETURN, { "ret" } },
+            { Operation::NOP, { "nop" } },
+            { Operation::SYSTEM, { "ecall", "ebreak" } }
+        });
+
+        // x1-x31 (x0 reads as zero), then f0-f31
+        static constexpr size_t REGISTERS = 64;
+
+        static auto isRegister(std::string_view operand) -> bool {
+            constexpr std::array<std::string_view, 6> NAMED = { "zero", "ra", "sp", "gp", "tp", "fp" };
+            return std::find(NAMED.begin(), NAMED.end(), operand) != NAMED.end() ||
+                isNumbered(operand, "a", 8) || isNumbered(operand, "s", 12) || isNumbered(operand, "t", 7) ||
+                isNumbered(operand, "x", 32) || isNumbered(operand, "f", 32) ||
+                isNumbered(operand, "fa", 8) || isNumbered(operand, "fs", 12) || isNumbered(operand, "ft", 12);
+        }
+
+        // numbers and relocations (%hi(.LC0))
+        static auto isImmediate(std::string_view operand) -> bool {
+            return operand[0] == '%' || isNumber(operand);
+        }
+
+        // 8(sp), %lo(.LC0)(a5)
+        static auto isMemory(std::string_view operand) -> bool {
+            return isRegister(baseOf(operand));
+        }
+
+        // ABI names share the numbers of the x and f names they stand for
+        static auto registerId(std::string_view operand) -> uint8_t {
+            constexpr std::array<std::string_view, 6> NAMED = { "zero", "ra", "sp", "gp", "tp", "fp" };
+            if (auto found = std::find(NAMED.begin(), NAMED.end(), operand); found != NAMED.end()) {
+                auto index = static_cast<uint8_t>(found - NAMED.begin());
+                return index == 0 ? NO_REGISTER : index == 5 ? 8 : index;
+            }
+            if (unsigned n = numbered(operand, "a", 8); n != NO_NUMBER) { return static_cast<uint8_t>(10 + n); }
+            if (unsigned n = numbered(operand, "s", 12); n != NO_NUMBER) { return static_cast<uint8_t>(n < 2 ? 8 + n : 16 + n); }
+            if (unsigned n = numbered(operand, "t", 7); n != NO_NUMBER) { return static_cast<uint8_t>(n < 3 ? 5 + n : 25 + n); }
+            if (unsigned n = numbered(operand, "x", 32); n != NO_NUMBER) { return n == 0 ? NO_REGISTER : static_cast<uint8_t>(n); }
+            if (unsigned n = numbered(operand, "fa", 8); n != NO_NUMBER) { return static_cast<uint8_t>(42 + n); }
+            if (unsigned n = numbered(operand, "fs", 12); n != NO_NUMBER) { return static_cast<uint8_t>(n < 2 ? 40 + n : 48 + n); }
+            if (unsigned n = numbered(operand, "ft", 12); n != NO_NUMBER) { return static_cast<uint8_t>(n < 8 ? 32 + n : 52 + n); }
+            return numberedId(operand, { "f" }, 32, 32);
+        }
+    };
+
+    /**
+      SPARC, where the destination comes last (add %i0, %i1, %o0) and memory is [%fp-20].
+     */
+    class Sparc : public Backend<Sparc> {
+    public:
+        static constexpr std::string_view NAME = "SPARC";
+        static constexpr unsigned INSTRUCTION_BYTES = 4;
+        static constexpr bool DELAY_SLOTS = true;
+        static constexpr bool DESTINATION_LAST = true;
+
+        static constexpr MnemonicTable MNEMONICS{ std::to_array<std::string_view>({
+            "save", "restore", "ret", "retl", "mov", "set", "sethi", "clr", "add", "sub", "smul", "umul", "sdiv", "udiv",
+            "and", "or", "xor", "sll", "srl", "sra", "neg", "not", "inc", "dec", "cmp", "tst",
+            "ld", "ldub", "lduh", "ldsb", "ldsh", "ldx", "st", "stb", "sth", "stx",
+            "ba", "b", "be", "bne", "bg", "bl", "bge", "ble", "bgu", "bleu", "bcs", "bcc",
+            "call", "jmp", "jmpl", "nop", "ta"
+        }) };
+
+        static constexpr auto OPERATIONS = operations({
+            { Operation::ALU, { "save", "restore", "mov", "set", "sethi", "clr", "add", "sub", "and", "or", "xor", "sll", "srl", "sra",
+                "neg", "not", "inc", "dec", "cmp", "tst" } },
+            { Operation::MULTIPLY, { "smul", "umul" } },
+            { Operation::DIVIDE, { "sdiv", "udiv" } },
+            { Operation::LOAD, { "ld", "ldub", "lduh", "ldsb", "ldsh", "ldx" } },
+            { Operation::STORE, { "st", "stb", "sth", "stx" } },
+            { Operation::JUMP, { "ba", "b", "jmp" } },
+            { Operation::BRANCH, { "be", "bne", "bg", "bl", "bge", "ble", "bgu", "bleu", "bcs", "bcc" } },
+            { Operation::CALL, { "call", "jmpl" } },
+            { Operation::RETURN, { "ret", "retl" } },
+            { Operation::NOP, { "nop" } },
+            { Operation::SYSTEM, { "ta" } }
+        });
+
+        static constexpr auto WRITES = writeRules({
+            { Writes::UPDATES, { "inc", "dec" } },
+            { Writes::NOTHING, { "cmp", "tst" } }
+        });
+
+        // %g1-%g7 (%g0 reads as zero), %o0-%o7, %l0-%l7, %i0-%i7, %f0-%f63, %y
+        static constexpr size_t REGISTERS = 97;
+
+        static auto isRegister(std::string_view operand) -> bool {
+            constexpr std::array<std::string_view, 3> NAMED = { "%fp", "%sp", "%y" };
+            return std::find(NAMED.begin(), NAMED.end(), operand) != NAMED.end() ||
+                isNumbered(operand, "%g", 8) || isNumbered(operand, "%o", 8) || isNumbered(operand, "%l", 8) ||
+                isNumbered(operand, "%i", 8) || isNumbered(operand, "%f", 64);
+        }
+
+        // numbers and relocations (%hi(.LLC0))
+        static auto isImmediate(std::string_view operand) -> bool {
+            return operand[0] == '%' || isNumber(operand);
+        }
+
+        static auto isMemory(std::string_view operand) -> bool {
+            return operand[0] == '[';
+        }
+
+        // %sp and %fp are %o6 and %i6
+        static auto registerId(std::string_view operand) -> uint8_t {
+            if (operand == "%sp") { return 14; }
+            if (operand == "%fp") { return 30; }
+            if (operand == "%y") { return 96; }
+            if (unsigned n = numbered(operand, "%g", 8); n != NO_NUMBER) { return n == 0 ? NO_REGISTER : static_cast<uint8_t>(n); }
+            if (uint8_t id = numberedId(operand, { "%o" }, 8, 8); id != NO_REGISTER) { return id; }
+            if (uint8_t id = numberedId(operand, { "%l" }, 8, 16); id != NO_REGISTER) { return id; }
+            if (uint8_t id = numberedId(operand, { "%i" }, 8, 24); id != NO_REGISTER) { return id; }
+            return numberedId(operand, { "%f" }, 64, 32);
+        }
+    };
+
+    /**
+      Most registers a backend numbers.
+     */
+    constexpr size_t MAX_REGISTERS = 128;
+
+    static_assert(std::max({ X86::REGISTERS, X86Analysis::REGISTERS, Arm::REGISTERS, Mips::REGISTERS, PowerPc::REGISTERS, RiscV::REGISTERS, Sparc::REGISTERS }) <= MAX_REGISTERS,
+        "register ids have to fit a register set");
+
+    static_assert(X86::MNEMONICS.valid() && X86Analysis::MNEMONICS.valid() && Arm::MNEMONICS.valid() && Mips::MNEMONICS.valid() &&
+        PowerPc::MNEMONICS.valid() && RiscV::MNEMONICS.valid() && Sparc::MNEMONICS.valid(), "every mnemonic needs an id in opcodes.hpp");
+    static_assert(X86::MNEMONICS.covered(X86::OPERATIONS) && X86Analysis::MNEMONICS.covered(X86Analysis::OPERATIONS) &&
+        Arm::MNEMONICS.covered(Arm::OPERATIONS) && Mips::MNEMONICS.covered(Mips::OPERATIONS) && PowerPc::MNEMONICS.covered(PowerPc::OPERATIONS) &&
+        RiscV::MNEMONICS.covered(RiscV::OPERATIONS) && Sparc::MNEMONICS.covered(Sparc::OPERATIONS),
+        "every mnemonic needs an operation");
+    static_assert(std::find(ArchDetector::NAMES.begin(), ArchDetector::NAMES.end(), Arm::NAME) != ArchDetector::NAMES.end() &&
+        std::find(ArchDetector::NAMES.begin(), ArchDetector::NAMES.end(), Mips::NAME) != ArchDetector::NAMES.end() &&
+        std::find(ArchDetector::NAMES.begin(), ArchDetector::NAMES.end(), PowerPc::NAME) != ArchDetector::NAMES.end() &&
+        std::find(ArchDetector::NAMES.begin(), ArchDetector::NAMES.end(), RiscV::NAME) != ArchDetector::NAMES.end() &&
+        std::find(ArchDetector::NAMES.begin(), ArchDetector::NAMES.end(), Sparc::NAME) != ArchDetector::NAMES.end(),
+        "backends are picked by ArchDetector's names");
+
+    /**
+      Calls `f` with the backend of an architecture (an empty tag object, f takes it as `auto`).
+     *
+      @param architecture One of ArchDetector's names, x86 and anything unknown go to the x86 backend.
+      @param f Instantiated once per backend.
+      @return What `f` returns.
+     */
+    template <typename F>
+    auto dispatch(std::string_view architecture, F&& f) -> decltype(auto) {
+        if (architecture == Arm::NAME) { return f(Arm{}); }
+        if (architecture == Mips::NAME) { return f(Mips{}); }
+        if (architecture == PowerPc::NAME) { return f(PowerPc{}); }
+        if (architecture == RiscV::NAME) { return f(RiscV{}); }
+        if (architecture == Sparc::NAME) { return f(Sparc{}); }
+        return f(X86{});
+    }
+}
\ No newline at end of file
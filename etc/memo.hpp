@@ -0,0 +1,223 @@
+#pragma once
+
+#include "ir.hpp"
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+  Lines analyzed before, with everything the tokenizer and the annotation made of them.
+
+  Compiler output repeats itself: the same prologues, spills, returns and alignment directives
+  come back thousands of times in a file. What a line tokenizes to and the comment it gets depend
+  on its bytes alone (spans are relative to the start of the line), so a line seen before skips
+  tokenizing, classifying and annotating and is copied from here. Lines are keyed by their exact
+  text, leading whitespace included: normalizing it away would move the spans.
+
+  Every worker thread has its own table, so lookups take no lock. A table holds a fixed number of
+  lines, each in a record of its own (no pointers to chase on a hit), and reclaims records with the
+  CLOCK algorithm: a hit sets the record's reference bit, the hand clears bits as it sweeps and
+  takes the first record without one, so lines that keep coming back outlive the others. A line
+  is only admitted the second time it's missed, so the many that never repeat (labels, jumps to
+  distinct targets) don't cost a copy or push anything out.
+
+  A line costs a 256 byte record, and a hit about as much as tokenizing a line of x86, which is why
+  the memo is off by default: --stats reports its hit rate on a given corpus.
+ */
+namespace memo {
+    /**
+      Hashes a line. Lines are short, so this is a multiply per 8 bytes rather than xxhash's
+      setup and finalization, which cost as much as a lookup.
+     */
+    inline auto hash(std::string_view text) -> uint64_t {
+        constexpr uint64_t MULTIPLIER = 0x9E3779B185EBCA87ULL;
+        const char* p = text.data();
+        size_t left = text.size();
+        uint64_t h = left * MULTIPLIER;
+        for (; left >= 8; left -= 8, p += 8) {
+            uint64_t word = 0;
+            std::memcpy(&word, p, 8);
+            h = (h ^ word) * MULTIPLIER;
+            h ^= h >> 29;
+        }
+        if (left != 0) {
+            uint64_t word = 0;
+            std::memcpy(&word, p, left);
+            h = (h ^ word) * MULTIPLIER;
+        }
+        return h ^ (h >> 32);
+    }
+
+    /**
+      A remembered line: its fields and operands as the block has them, then its text and its
+      comment back to back. Lines that don't fit aren't remembered.
+     */
+    struct Entry {
+        static constexpr size_t MAX_OPERANDS = 4;
+
+        uint64_t hash = 0;
+        ir::Line fields;
+        uint16_t textLength = 0;
+        uint16_t commentLength = 0;
+        uint8_t operandCount = 0;
+        ir::Span operands[MAX_OPERANDS];
+        records::OperandKind operandKinds[MAX_OPERANDS] = {};
+        char bytes[172];
+
+        [[nodiscard]] auto text() const -> std::string_view { return { bytes, textLength }; }
+        [[nodiscard]] auto comment() const -> std::string_view { return { bytes + textLength, commentLength }; }
+
+        /**
+          Appends the line to a block, as tokenizing it would have.
+         *
+          @param line The line, a view of the block's text.
+         */
+        void addTo(ir::Block& block, std::string_view line) const {
+            block.add(line, fields);
+            for (size_t i = 0; i < operandCount; ++i) { block.addOperand(operands[i], operandKinds[i]); }
+        }
+    };
+    static_assert(sizeof(Entry) == 256, "entries are meant to fill whole cache lines");
+
+    class Table {
+    public:
+        /**
+          Empties the table and sets how many lines it holds (0 turns it off).
+         */
+        void resize(size_t lines) {
+            entries.clear();
+            entries.resize(lines);
+            // open addressing at most half full, a power of two so the hash is masked into it
+            size_t size = 1;
+            while (size < lines * 2) { size *= 2; }
+            buckets.assign(lines == 0 ? 0 : size, Bucket{});
+            missed.assign(lines == 0 ? 0 : size, 0);
+            referenced.assign(lines, 0);
+            mask = size - 1;
+            used = 0;
+            hand = 0;
+        }
+
+        [[nodiscard]] auto capacity() const -> size_t { return entries.size(); }
+        [[nodiscard]] auto full() const -> bool { return used == entries.size(); }
+
+        /**
+          Looks a line up.
+         *
+          @param text The line.
+          @param hash Its hash (memo::hash).
+          @return The entry, or null when the line isn't in the table.
+         */
+        auto find(std::string_view text, uint64_t hash) -> const Entry* {
+            auto low = static_cast<uint32_t>(hash);
+            for (size_t at = low & mask; buckets[at].slot != EMPTY; at = (at + 1) & mask) {
+                if (buckets[at].low != low) { continue; }
+                const Entry& entry = entries[buckets[at].slot];
+                if (entry.hash == hash && entry.text() == text) {
+                    referenced[buckets[at].slot] = 1;
+                    return &entry;
+                }
+            }
+            return nullptr;
+        }
+
+        /**
+          @return Whether a line that wasn't found is worth remembering: it was missed before (as
+          far as a hash per position tells).
+         */
+        auto admit(uint64_t hash) -> bool {
+            auto tag = static_cast<uint32_t>(hash >> 32) | 1;
+            uint32_t& seen = missed[(hash >> 16) & mask];
+            if (seen == tag) { return true; }
+            seen = tag;
+            return false;
+        }
+
+        /**
+          Remembers a line that wasn't found, if it fits, evicting another one if the table is full.
+         *
+          @param block The block the line was just tokenized into.
+          @param line Its index in the block.
+          @param hash Its hash (memo::hash).
+          @param comment The comment it got.
+          @param evicted Set when a line had to go.
+         */
+        void insert(const ir::Block& block, size_t line, uint64_t hash, std::string_view comment, bool& evicted) {
+            evicted = false;
+            std::string_view text = block.line(line);
+            size_t operandCount = block.operandCount(line);
+            if (text.size() + comment.size() > sizeof(Entry::bytes) || operandCount > Entry::MAX_OPERANDS) { return; }
+
+            size_t slot = used;
+            evicted = used == entries.size();
+            if (evicted) {
+                // second chance: referenced entries lose their bit and are passed over once
+                while (referenced[hand] != 0) {
+                    referenced[hand] = 0;
+                    hand = (hand + 1) % entries.size();
+                }
+                slot = hand;
+                hand = (hand + 1) % entries.size();
+                unlink(slot);
+            } else {
+                ++used;
+            }
+
+            Entry& entry = entries[slot];
+            entry.hash = hash;
+            entry.fields = { block.kind[line], block.opcode[line], block.name[line], block.operands[line], block.lineOperand[line],
+                block.split[line] };
+            entry.textLength = static_cast<uint16_t>(text.size());
+            entry.commentLength = static_cast<uint16_t>(comment.size());
+            entry.operandCount = static_cast<uint8_t>(operandCount);
+            referenced[slot] = 0;
+            for (size_t i = 0; i < operandCount; ++i) {
+                entry.operands[i] = block.operand[block.firstOperand[line] + i];
+                entry.operandKinds[i] = block.operandKind[block.firstOperand[line] + i];
+            }
+            std::memcpy(entry.bytes, text.data(), text.size());
+            std::memcpy(entry.bytes + text.size(), comment.data(), comment.size());
+
+            size_t at = hash & mask;
+            while (buckets[at].slot != EMPTY) { at = (at + 1) & mask; }
+            buckets[at] = { static_cast<uint32_t>(hash), static_cast<uint32_t>(slot) };
+        }
+
+    private:
+        static constexpr uint32_t EMPTY = UINT32_MAX;
+
+        /**
+          Where an entry is, with the low half of its hash: it skips most other entries without
+          touching them, and tells where the bucket belongs (at most 2^32 buckets).
+         */
+        struct Bucket {
+            uint32_t low = 0;
+            uint32_t slot = EMPTY;
+        };
+
+        std::vector<Entry> entries;
+        std::vector<uint8_t> referenced; // CLOCK bits, apart so the hand sweeps without touching entries
+        std::vector<Bucket> buckets;
+        std::vector<uint32_t> missed; // hash bits of the last line missed per position, 0 for none
+        size_t mask = 0;
+        size_t used = 0;
+        size_t hand = 0;
+
+        // removes a slot's bucket, moving back the ones after it that would no longer be reached
+        void unlink(size_t slot) {
+            size_t at = entries[slot].hash & mask;
+            while (buckets[at].slot != slot) { at = (at + 1) & mask; }
+            for (size_t next = (at + 1) & mask; buckets[next].slot != EMPTY; next = (next + 1) & mask) {
+                size_t home = buckets[next].low & mask;
+                // `next` may fill the hole unless its home lies cyclically in (at, next]
+                if (((next - home) & mask) >= ((next - at) & mask)) {
+                    buckets[at] = buckets[next];
+                    at = next;
+                }
+            }
+            buckets[at] = Bucket{};
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <string_view>
+#include <utility>
+#include <string>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#endif
+
+/**
+  A read-only memory mapping of a whole file.
+
+  The mapping lives as long as the object, every std::string_view handed out by view() points
+  straight into it, so nothing gets copied.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    auto operator=(const MappedFile&) -> MappedFile& = delete;
+
+    MappedFile(MappedFile&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    auto operator=(MappedFile&& other) noexcept -> MappedFile& {
+        if (this != &other) {
+            close();
+            data = other.data;
+            length = other.length;
+            other.data = nullptr;
+            other.length = 0;
+        }
+        return *this;
+    }
+
+    ~MappedFile() {
+        close();
+    }
+
+    /**
+      Maps a file into memory.
+     *
+      @param filename The file to map.
+      @param error Receives the reason when mapping fails.
+      @return Whether the file is mapped (an empty file counts as mapped, with an empty view).
+     */
+    auto open(const std::string& filename, std::string& error) -> bool {
+        close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            error = "File not found!";
+            return false;
+        }
+        LARGE_INTEGER size{};
+        if (GetFileSizeEx(file, &size) == 0) {
+            CloseHandle(file);
+            error = "Cannot get the size of " + filename;
+            return false;
+        }
+        if (size.QuadPart == 0) {
+            CloseHandle(file);
+            return true;
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr) {
+            error = "Cannot map " + filename;
+            return false;
+        }
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (view == nullptr) {
+            error = "Cannot map " + filename;
+            return false;
+        }
+        data = static_cast<const char*>(view);
+        length = static_cast<size_t>(size.QuadPart);
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            error = "File not found!";
+            return false;
+        }
+        struct stat st {};
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            error = filename + " is not a regular file";
+            return false;
+        }
+        if (st.st_size == 0) {
+            ::close(fd);
+            return true;
+        }
+        void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) {
+            error = "Cannot map " + filename + ": " + std::strerror(errno);
+            return false;
+        }
+        // we read front to back exactly once
+        madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        data = static_cast<const char*>(view);
+        length = static_cast<size_t>(st.st_size);
+#endif
+        return true;
+    }
+
+    /**
+      Unmaps the file (also done by the destructor).
+     */
+    void close() {
+        if (data == nullptr) { return; }
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(const_cast<char*>(data), length);
+#endif
+        data = nullptr;
+        length = 0;
+    }
+
+    /**
+      @return The mapped bytes.
+     */
+    [[nodiscard]] auto view() const -> std::string_view {
+        return { data, length };
+    }
+
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+};
\ No newline at end of file
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "phf.hpp"
+
+/**
+  Recognized instruction mnemonics, X(id, mnemonic). Append new ones anywhere (the original x86
+  ones stay first so ids in existing record files keep their meaning), ids are dense and the lookup
+  table is regenerated at compile time. A spelling is listed once even when several instruction
+  sets use it: which ones an architecture accepts, and what they mean there, is up to its backend
+  (isa.hpp).
+ */
+#define ASM_INSTRUCTIONS(X) \
+    X(INT, "int") X(PUSH, "push") X(POP, "pop") X(MOV, "mov") X(MOVQ, "movq") \
+    X(ADD, "add") X(ADDQ, "addq") X(SUB, "sub") X(SUBQ, "subq") \
+    X(JMP, "jmp") X(CALL, "call") X(RET, "ret") X(CMP, "cmp") X(JE, "je") X(JNE, "jne") \
+    X(INC, "inc") X(DEC, "dec") X(MUL, "mul") X(DIV, "div") \
+    X(GLOBAL, "global") X(LEN, "len") X(NOP, "nop") \
+    ASM_ARM_INSTRUCTIONS(X) ASM_MIPS_INSTRUCTIONS(X) ASM_RISCV_INSTRUCTIONS(X) \
+    ASM_POWERPC_INSTRUCTIONS(X) ASM_SPARC_INSTRUCTIONS(X) ASM_X86_BRANCH_INSTRUCTIONS(X) ASM_X86_INSTRUCTIONS(X)
+
+// first needed by ARM (A64 and A32)
+#define ASM_ARM_INSTRUCTIONS(X) \
+    X(MOVK, "movk") X(MOVZ, "movz") X(MVN, "mvn") X(ADDS, "adds") X(SUBS, "subs") \
+    X(MADD, "madd") X(MSUB, "msub") X(SDIV, "sdiv") X(UDIV, "udiv") X(NEG, "neg") \
+    X(AND, "and") X(ORR, "orr") X(EOR, "eor") X(LSL, "lsl") X(LSR, "lsr") X(ASR, "asr") \
+    X(CMN, "cmn") X(TST, "tst") X(CSEL, "csel") X(CSET, "cset") \
+    X(LDR, "ldr") X(LDRB, "ldrb") X(LDRH, "ldrh") X(LDRSW, "ldrsw") X(LDP, "ldp") X(LDNP, "ldnp") X(LDUR, "ldur") \
+    X(STR, "str") X(STRB, "strb") X(STRH, "strh") X(STP, "stp") X(STNP, "stnp") X(STUR, "stur") \
+    X(ADRP, "adrp") X(ADR, "adr") X(SXTW, "sxtw") X(UXTW, "uxtw") \
+    X(B, "b") X(BL, "bl") X(BLR, "blr") X(BR, "br") X(BX, "bx") \
+    X(CBZ, "cbz") X(CBNZ, "cbnz") X(TBZ, "tbz") X(TBNZ, "tbnz") \
+    X(B_EQ, "b.eq") X(B_NE, "b.ne") X(B_LT, "b.lt") X(B_LE, "b.le") X(B_GT, "b.gt") X(B_GE, "b.ge") \
+    X(B_HI, "b.hi") X(B_LS, "b.ls") X(B_CS, "b.cs") X(B_CC, "b.cc") X(B_MI, "b.mi") X(B_PL, "b.pl") \
+    X(BEQ, "beq") X(BNE, "bne") X(BLT, "blt") X(BLE, "ble") X(BGT, "bgt") X(BGE, "bge") \
+    X(SVC, "svc") X(FMOV, "fmov") X(FADD, "fadd") X(FSUB, "fsub") X(FMUL, "fmul") X(FDIV, "fdiv") \
+    X(SCVTF, "scvtf") X(FCVTZS, "fcvtzs")
+
+// first needed by MIPS
+#define ASM_MIPS_INSTRUCTIONS(X) \
+    X(MOVE, "move") X(LI, "li") X(LA, "la") X(LUI, "lui") X(ADDIU, "addiu") X(ADDU, "addu") \
+    X(SUBU, "subu") X(DADDIU, "daddiu") X(DADDU, "daddu") X(MULT, "mult") X(MULTU, "multu") \
+    X(DIVU, "divu") X(MFLO, "mflo") X(MFHI, "mfhi") X(NEGU, "negu") X(NOT, "not") \
+    X(ANDI, "andi") X(OR, "or") X(ORI, "ori") X(XOR, "xor") X(XORI, "xori") X(NOR, "nor") \
+    X(SLL, "sll") X(SRL, "srl") X(SRA, "sra") X(SLT, "slt") X(SLTI, "slti") X(SLTU, "sltu") X(SLTIU, "sltiu") \
+    X(LW, "lw") X(LB, "lb") X(LBU, "lbu") X(LH, "lh") X(LHU, "lhu") X(LD, "ld") \
+    X(SW, "sw") X(SB, "sb") X(SH, "sh") X(SD, "sd") X(LWC1, "lwc1") X(SWC1, "swc1") \
+    X(J, "j") X(JAL, "jal") X(JALR, "jalr") X(JR, "jr") \
+    X(BEQZ, "beqz") X(BNEZ, "bnez") X(BLTZ, "bltz") X(BGEZ, "bgez") X(BLEZ, "blez") X(BGTZ, "bgtz") \
+    X(SYSCALL, "syscall")
+
+// first needed by RISC-V
+#define ASM_RISCV_INSTRUCTIONS(X) \
+    X(ADDI, "addi") X(ADDW, "addw") X(ADDIW, "addiw") X(SUBW, "subw") X(MULW, "mulw") X(DIVW, "divw") \
+    X(REM, "rem") X(REMU, "remu") X(REMW, "remw") X(SLLI, "slli") X(SRLI, "srli") X(SRAI, "srai") \
+    X(SLLW, "sllw") X(SRLW, "srlw") X(SRAW, "sraw") X(SEQZ, "seqz") X(SNEZ, "snez") X(NEGW, "negw") \
+    X(MV, "mv") X(AUIPC, "auipc") X(LWU, "lwu") X(SEXT_W, "sext.w") \
+    X(FLW, "flw") X(FLD, "fld") X(FSW, "fsw") X(FSD, "fsd") X(FMV_S, "fmv.s") X(FMV_D, "fmv.d") \
+    X(FADD_D, "fadd.d") X(FSUB_D, "fsub.d") X(FMUL_D, "fmul.d") X(FDIV_D, "fdiv.d") X(FCVT_D_W, "fcvt.d.w") \
+    X(TAIL, "tail") X(BLTU, "bltu") X(BGEU, "bgeu") X(BGTU, "bgtu") X(BLEU, "bleu") \
+    X(ECALL, "ecall") X(EBREAK, "ebreak")
+
+// first needed by PowerPC
+#define ASM_POWERPC_INSTRUCTIONS(X) \
+    X(LIS, "lis") X(MR, "mr") X(ADDIS, "addis") X(SUBF, "subf") X(SUBFIC, "subfic") \
+    X(MULLW, "mullw") X(MULLD, "mulld") X(MULLI, "mulli") X(DIVWU, "divwu") X(DIVD, "divd") \
+    X(SLWI, "slwi") X(SRWI, "srwi") X(SLDI, "sldi") X(SRDI, "srdi") X(SRAWI, "srawi") \
+    X(EXTSW, "extsw") X(RLWINM, "rlwinm") \
+    X(LWZ, "lwz") X(LBZ, "lbz") X(LHZ, "lhz") X(LHA, "lha") X(LWA, "lwa") X(LFD, "lfd") X(LFS, "lfs") \
+    X(STW, "stw") X(STB, "stb") X(STH, "sth") X(STD, "std") X(STWU, "stwu") X(STDU, "stdu") \
+    X(STFD, "stfd") X(STFS, "stfs") X(MFLR, "mflr") X(MTLR, "mtlr") X(MTCTR, "mtctr") \
+    X(CMPW, "cmpw") X(CMPWI, "cmpwi") X(CMPLW, "cmplw") X(CMPLWI, "cmplwi") X(CMPD, "cmpd") X(CMPDI, "cmpdi") \
+    X(BCTR, "bctr") X(BCTRL, "bctrl") X(SC, "sc")
+
+// first needed by SPARC
+#define ASM_SPARC_INSTRUCTIONS(X) \
+    X(SAVE, "save") X(RESTORE, "restore") X(RETL, "retl") X(SET, "set") X(SETHI, "sethi") \
+    X(SMUL, "smul") X(UMUL, "umul") X(LDUB, "ldub") X(LDUH, "lduh") X(LDSB, "ldsb") X(LDSH, "ldsh") \
+    X(LDX, "ldx") X(ST, "st") X(STX, "stx") X(CLR, "clr") \
+    X(BA, "ba") X(BE, "be") X(BG, "bg") X(BGU, "bgu") X(BCS, "bcs") X(BCC, "bcc") \
+    X(JMPL, "jmpl") X(TA, "ta")
+
+// the x86 conditional jumps, for control flow
+#define ASM_X86_BRANCH_INSTRUCTIONS(X) \
+    X(JG, "jg") X(JGE, "jge") X(JL, "jl") X(JLE, "jle") X(JA, "ja") X(JAE, "jae") X(JB, "jb") X(JBE, "jbe") \
+    X(JZ, "jz") X(JNZ, "jnz") X(JS, "js") X(JNS, "jns") X(LOOP, "loop")
+
+// the rest of x86 as compilers write it, for the analysis passes (the annotations don't know them)
+#define ASM_X86_INSTRUCTIONS(X) \
+    X(JNB, "jnb") X(JNAE, "jnae") X(JNA, "jna") X(JNBE, "jnbe") X(JNL, "jnl") X(JNGE, "jnge") X(JNG, "jng") X(JNLE, "jnle") \
+    X(JC, "jc") X(JNC, "jnc") X(JO, "jo") X(JNO, "jno") X(JP, "jp") X(JNP, "jnp") \
+    X(LEA, "lea") X(TEST, "test") X(IMUL, "imul") X(IDIV, "idiv") X(SHL, "shl") X(SAL, "sal") X(SHR, "shr") X(SAR, "sar") \
+    X(ROL, "rol") X(ROR, "ror") X(ADC, "adc") X(SBB, "sbb") X(XCHG, "xchg") X(BT, "bt") \
+    X(MOVZX, "movzx") X(MOVSX, "movsx") X(MOVSXD, "movsxd") X(MOVABS, "movabs") \
+    X(CLTQ, "cltq") X(CLTD, "cltd") X(CQTO, "cqto") X(CDQ, "cdq") X(CQO, "cqo") X(CDQE, "cdqe") \
+    X(LEAVE, "leave") X(ENDBR64, "endbr64") X(HLT, "hlt") X(UD2, "ud2") \
+    X(SETE, "sete") X(SETNE, "setne") X(SETG, "setg") X(SETGE, "setge") X(SETL, "setl") X(SETLE, "setle") \
+    X(SETA, "seta") X(SETAE, "setae") X(SETB, "setb") X(SETBE, "setbe") \
+    X(CMOVE, "cmove") X(CMOVNE, "cmovne") X(CMOVG, "cmovg") X(CMOVGE, "cmovge") X(CMOVL, "cmovl") X(CMOVLE, "cmovle") \
+    X(CMOVA, "cmova") X(CMOVAE, "cmovae") X(CMOVB, "cmovb") X(CMOVBE, "cmovbe") X(CMOVS, "cmovs") X(CMOVNS, "cmovns") \
+    X(MOVSS, "movss") X(MOVSD, "movsd") X(MOVAPS, "movaps") X(MOVAPD, "movapd") X(MOVUPS, "movups") X(MOVD, "movd") \
+    X(MOVDQA, "movdqa") X(MOVDQU, "movdqu") X(ADDSS, "addss") X(ADDSD, "addsd") X(SUBSS, "subss") X(SUBSD, "subsd") \
+    X(MULSS, "mulss") X(MULSD, "mulsd") X(DIVSS, "divss") X(DIVSD, "divsd") X(SQRTSS, "sqrtss") X(SQRTSD, "sqrtsd") \
+    X(CVTSI2SD, "cvtsi2sd") X(CVTSI2SS, "cvtsi2ss") X(CVTTSD2SI, "cvttsd2si") X(CVTTSS2SI, "cvttss2si") \
+    X(CVTSS2SD, "cvtss2sd") X(CVTSD2SS, "cvtsd2ss") X(PXOR, "pxor") X(XORPS, "xorps") X(XORPD, "xorpd") \
+    X(UCOMISD, "ucomisd") X(UCOMISS, "ucomiss") X(COMISD, "comisd") X(COMISS, "comiss")
+
+/**
+  Recognized assembler directives, X(id, directive).
+ */
+#define ASM_DIRECTIVES(X) \
+    X(STRING, ".string") X(DATA, ".data") X(BSS, ".bss") X(TEXT, ".text") \
+    X(GLOBL, ".globl") X(GLOBAL, ".global") X(ALIGN, ".align") \
+    X(BYTE, ".byte") X(WORD, ".word") X(DWORD, ".dword") X(QUAD, ".quad") \
+    X(SECTION, ".section") X(EQU, ".equ") X(SET, ".set") X(ORG, ".org") \
+    X(RESERVE, ".reserve") X(SPACE, ".space") X(FILE, ".file") X(COMM, ".comm") \
+    X(END, ".end") X(INCBIN, ".incbin") X(INCLUDE, ".include") X(NASM_INCLUDE, "%include")
+
+#define ASM_ENUM_ID(id, text) id,
+#define ASM_ENUM_TEXT(id, text) text,
+
+/**
+  Dense instruction ids, NONE doubles as the count.
+ */
+enum class Instruction : uint16_t {
+    ASM_INSTRUCTIONS(ASM_ENUM_ID)
+    NONE
+};
+
+/**
+  Dense directive ids, NONE doubles as the count.
+ */
+enum class Directive : uint16_t {
+    ASM_DIRECTIVES(ASM_ENUM_ID)
+    NONE
+};
+
+constexpr size_t INSTRUCTION_COUNT = static_cast<size_t>(Instruction::NONE);
+constexpr size_t DIRECTIVE_COUNT = static_cast<size_t>(Directive::NONE);
+
+constexpr std::array<std::string_view, INSTRUCTION_COUNT> INSTRUCTION_NAMES = { ASM_INSTRUCTIONS(ASM_ENUM_TEXT) };
+constexpr std::array<std::string_view, DIRECTIVE_COUNT> DIRECTIVE_NAMES = { ASM_DIRECTIVES(ASM_ENUM_TEXT) };
+
+#undef ASM_ENUM_ID
+#undef ASM_ENUM_TEXT
+
+inline constexpr PerfectHash<INSTRUCTION_COUNT> INSTRUCTION_HASH(INSTRUCTION_NAMES);
+inline constexpr PerfectHash<DIRECTIVE_COUNT> DIRECTIVE_HASH(DIRECTIVE_NAMES);
+
+// every name has to hash back to its own id
+static_assert([] {
+    for (size_t i = 0; i < INSTRUCTION_COUNT; ++i) {
+        if (INSTRUCTION_HASH.find(INSTRUCTION_NAMES[i]) != i) { return false; }
+    }
+    for (size_t i = 0; i < DIRECTIVE_COUNT; ++i) {
+        if (DIRECTIVE_HASH.find(DIRECTIVE_NAMES[i]) != i) { return false; }
+    }
+    return INSTRUCTION_HASH.find("movl") == INSTRUCTION_HASH.NOT_FOUND && DIRECTIVE_HASH.find(".strin") == DIRECTIVE_HASH.NOT_FOUND;
+}());
+
+/**
+  Maps a mnemonic to its id, whatever the instruction set (a backend's own lookup only knows its
+  mnemonics).
+ *
+  @param mnemonic The mnemonic (case sensitive).
+  @return Its id, or Instruction::NONE.
+ */
+constexpr auto lookupInstruction(std::string_view mnemonic) -> Instruction {
+    return static_cast<Instruction>(INSTRUCTION_HASH.find(mnemonic));
+}
+
+/**
+  Maps a directive (including the leading dot, or NASM's percent sign) to its id.
+ *
+  @param directive The directive.
+  @return Its id, or Directive::NONE.
+ */
+constexpr auto lookupDirective(std::string_view directive) -> Directive {
+    return static_cast<Directive>(DIRECTIVE_HASH.find(directive));
+}
\ No newline at end of file
@@ -0,0 +1,544 @@
+#pragma once
+
+#include "records.hpp"
+#include "compression.hpp"
+#include "cost.hpp"
+#include "profile.hpp"
+#include <string_view>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+#include <cstdint>
+#include <climits>
+#include <cerrno>
+
+/**
+  How runs over many files read their inputs and write their outputs.
+ */
+enum class IoEngine : uint8_t { AUTO, URING, THREADS };
+
+/**
+  What the xref subcommand looks up in the symbol indexes.
+ */
+enum class XrefQuery : uint8_t { NONE, CALLERS, USES, UNUSED, UNDEFINED };
+
+/**
+  Command line options of asm-analyze.
+ */
+struct Options {
+    /**
+      Files and/or directories to analyze.
+     */
+    std::vector<std::string> paths;
+    /**
+      Number of worker threads (0 means one per hardware thread).
+     */
+    unsigned jobs = 0;
+    /**
+      Whether directories are walked recursively.
+     */
+    bool recursive = true;
+    /**
+      Whether input files are memory-mapped (otherwise they're read line by line).
+     */
+    bool mmap = true;
+    /**
+      Files of at least twice this size are split into chunks of about this size that are
+      analyzed in parallel (0 disables that).
+     */
+    size_t chunkSize = size_t{ 8 } << 20;
+    /**
+      I/O of multi-file runs: io_uring (AUTO uses it where the kernel has it) or blocking calls on
+      the worker threads.
+     */
+    IoEngine io = IoEngine::AUTO;
+    /**
+      Files io_uring keeps in flight at once.
+     */
+    unsigned queueDepth = 128;
+    /**
+      Lines every worker remembers the analysis of, to copy it when they come back (0 for none).
+     */
+    size_t memoLines = 0;
+    /**
+      Directory of the result cache (empty when caching is off).
+     */
+    std::string cacheDir;
+    /**
+      Capacity of the result cache in bytes.
+     */
+    uint64_t cacheSize = uint64_t{ 1024 } << 20;
+    /**
+      Structured output written next to every annotated copy (NONE for none).
+     */
+    records::Format records = records::Format::NONE;
+    /**
+      What annotated copies are compressed with (NONE writes them plain).
+     */
+    compression::Codec compress = compression::Codec::NONE;
+    /**
+      Whether only the comments are written, to a sidecar next to the source (<name>.<ext>.ann),
+      instead of an annotated copy.
+     */
+    bool sidecar = false;
+    /**
+      Whether an index of every symbol's definitions and uses is also written
+      (<name>_analyzed.<ext>.xref).
+     */
+    bool xref = false;
+    /**
+      Whether basic blocks and loops are summarized, with cost estimates, in the annotated copy.
+     */
+    bool cfg = false;
+    /**
+      Whether the files pulled in by .include and %include are found and what they define
+      summarized in the annotated copy.
+     */
+    bool includes = false;
+    /**
+      Directories included files are also looked for in (-I).
+     */
+    std::vector<std::string> includeDirs;
+    /**
+      Profiles (perf script or perf annotate output, address,count CSVs, nm symbol tables) whose
+      samples are shown next to the lines they were taken on.
+     */
+    std::vector<std::string> profiles;
+    /**
+      The samples of `profiles`, loaded once before the files are analyzed (null for none).
+     */
+    std::shared_ptr<const profile::Profile> profile;
+    /**
+      Processor model of the estimates (empty for the default one of each file's instruction set).
+     */
+    std::string cpu;
+    /**
+      Whether per-phase timings and opcode counts are reported at the end.
+     */
+    bool stats = false;
+    /**
+      File the statistics are also written to as JSON (empty for none).
+     */
+    std::string statsJson;
+    /**
+      Whether the output starts with the information header (library callers may leave it out, it
+      holds the time of the analysis).
+     */
+    bool header = true;
+    /**
+      One of ArchDetector's names to use instead of detecting it (library callers annotating a
+      part of a file whose architecture they already know).
+     */
+    std::string_view architecture;
+    /**
+      Whether per-file progress messages are printed.
+     */
+    bool quiet = false;
+    /**
+      Set when the input is "-": stdin is annotated to stdout instead of analyzing files.
+     */
+    bool filter = false;
+    /**
+      Set by the view subcommand: the source in `paths` is printed merged with its sidecar.
+     */
+    bool view = false;
+    /**
+      Set by the xref subcommand: the symbol indexes of the files in `paths` are queried.
+     */
+    bool lookup = false;
+    /**
+      What the xref subcommand looks up, and the symbol for the queries about one.
+     */
+    XrefQuery query = XrefQuery::NONE;
+    std::string symbol;
+    /**
+      Set by the daemon subcommand: `paths` are watched and queries answered over a socket.
+     */
+    bool daemon = false;
+    /**
+      Unix socket the daemon listens on (empty for the default one).
+     */
+    std::string socketPath;
+    /**
+      First and last line (1-based, inclusive) the view subcommand prints.
+     */
+    uint64_t firstLine = 1;
+    uint64_t lastLine = UINT64_MAX;
+    /**
+      Set when --help was requested.
+     */
+    bool help = false;
+    /**
+      Set when --version was requested.
+     */
+    bool version = false;
+    /**
+      Set when the arguments couldn't be parsed, holds the reason.
+     */
+    std::string error;
+
+    /**
+      Parses the command line.
+     *
+      @param argc Argument count (as passed to main).
+      @param argv Argument vector (as passed to main).
+      @return The parsed options, check `error` before using them.
+     */
+    static auto parse(int argc, char** argv) -> Options {
+        Options options;
+        std::vector<std::string> args(argv + 1, argv + argc);
+
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+
+            if (i == 0 && arg == "view") {
+                options.view = true;
+            } else if (i == 0 && arg == "daemon") {
+                options.daemon = true;
+            } else if (i == 0 && arg == "xref") {
+                options.lookup = true;
+            } else if (arg == "--socket") {
+                if (i + 1 == args.size()) {
+                    options.error = arg + " needs a value";
+                    break;
+                }
+                options.socketPath = args[++i];
+            } else if (arg == "-h" || arg == "--help") {
+                options.help = true;
+            } else if (arg == "-V" || arg == "--version") {
+                options.version = true;
+            } else if (arg == "-q" || arg == "--quiet") {
+                options.quiet = true;
+            } else if (arg == "--no-mmap") {
+                options.mmap = false;
+            } else if (arg == "--chunk-size") {
+                if (i + 1 == args.size()) {
+                    options.error = arg + " needs a value";
+                    break;
+                }
+                options.chunkSize = size_t{ parseCount(args[++i], options.error) } << 20;
+            } else if (arg == "--io") {
+                if (i + 1 == args.size()) {
+                    options.error = arg + " needs a value";
+                    break;
+                }
+                const std::string& engine = args[++i];
+                if (engine == "auto") {
+                    options.io = IoEngine::AUTO;
+                } else if (engine == "uring") {
+                    options.io = IoEngine::URING;
+                } else if (engine == "threads") {
+                    options.io = IoEngine::THREADS;
+                } else {
+                    options.error = "Unknown I/O engine " + engine;
+                }
+            } else if (arg == "--queue-depth") {
+                if (i + 1 == args.size()) {
+                    options.error = arg + " needs a value";
+                    break;
+                }
+                options.queueDepth = parseCount(args[++i], options.error);
+                if (options.error.empty() && (options.queueDepth == 0 || options.queueDepth > 4096)) {
+                    options.error = "--queue-depth must be between 1 and 4096";
+                }
+            } else if (arg == "--memo") {
+                if (i + 1 == args.size()) {
+                    options.error = arg + " needs a value";
+                    break;
+                }
+                options.memoLines = parseCount(args[++i], options.error);
+                if (options.error.empty() && options.memoLines > (size_t{ 1 } << 24)) {
+                    options.error = "--memo must be at most 16777216 lines";
+                }
+            } else if (arg == "--cache" || arg == "--cache-size") {
+                if (i + 1 == args.size()) {
+                    options.error = arg + " needs a value";
+                    break;
+                }
+                if (arg == "--cache") {
+                    options.cacheDir = args[++i];
+                } else {
+                    options.cacheSize = uint64_t{ parseCount(args[++i], options.error) } << 20;
+                }
+            } else if (arg == "--records") {
+                if (i + 1 == args.size()) {
+                    options.error = arg + " needs a value";
+                    break;
+                }
+                options.records = records::parseFormat(args[++i]);
+                if (options.records == records::Format::NONE) { options.error = "Unknown record format " + args[i]; }
+            } else if (arg == "--compress") {
+                if (i + 1 == args.size()) {
+                    options.error = arg + " needs a value";
+                    break;
+                }
+                options.compress = compression::parse(args[++i]);
+                if (options.compress == compression::Codec::NONE) {
+                    options.error = "Unknown compression " + args[i];
+                } else if (!compression::compiled(options.compress)) {
+                    options.error = "This build can't write " + std::string(compression::name(options.compress)) + " files";
+                }
+            } else if (arg == "--sidecar") {
+                options.sidecar = true;
+            } else if (arg == "--xref") {
+                options.xref = true;
+            } else if (arg == "--callers" || arg == "--uses") {
+                if (i + 1 == args.size()) {
+                    options.error = arg + " needs a value";
+                    break;
+                }
+                options.query = arg == "--callers" ? XrefQuery::CALLERS : XrefQuery::USES;
+                options.symbol = args[++i];
+            } else if (arg == "--unused") {
+                options.query = XrefQuery::UNUSED;
+            } else if (arg == "--undefined") {
+                options.query = XrefQuery::UNDEFINED;
+            } else if (arg == "--lines") {
+                if (i + 1 == args.size()) {
+                    options.error = arg + " needs a value";
+                    break;
+                }
+                // <from>, <from>- or <from>-<to>
+                const std::string& range = args[++i];
+                size_t dash = range.find('-');
+                options.firstLine = parseCount(range.substr(0, dash), options.error);
+                if (dash == std::string::npos) {
+                    options.lastLine = options.firstLine;
+                } else if (dash + 1 < range.size()) {
+                    options.lastLine = parseCount(range.substr(dash + 1), options.error);
+                }
+                if (options.error.empty() && (options.firstLine == 0 || options.lastLine < options.firstLine)) {
+                    options.error = "Invalid line range " + range;
+                }
+            } else if (arg == "--includes") {
+                options.includes = true;
+            } else if (arg == "-I" || arg == "--include-dir") {
+                if (i + 1 == args.size()) {
+                    options.error = arg + " needs a value";
+                    break;
+                }
+                options.includes = true;
+                options.includeDirs.push_back(args[++i]);
+            } else if (arg.rfind("-I", 0) == 0 && arg.size() > 2) {
+                options.includes = true;
+                options.includeDirs.push_back(arg.substr(2));
+            } else if (arg == "--profile") {
+                if (i + 1 == args.size()) {
+                    options.error = arg + " needs a value";
+                    break;
+                }
+                options.profiles.push_back(args[++i]);
+            } else if (arg == "--cfg") {
+                options.cfg = true;
+            } else if (arg == "--cpu") {
+                if (i + 1 == args.size()) {
+                    options.error = arg + " needs a value";
+                    break;
+                }
+                options.cfg = true;
+                options.cpu = args[++i];
+                if (cost::find(options.cpu) == nullptr) { options.error = "Unknown processor model " + options.cpu; }
+            } else if (arg == "--stats") {
+                options.stats = true;
+            } else if (arg == "--stats-json") {
+                if (i + 1 == args.size()) {
+                    options.error = arg + " needs a value";
+                    break;
+                }
+                options.stats = true;
+                options.statsJson = args[++i];
+            } else if (arg == "--no-recursive") {
+                options.recursive = false;
+            } else if (arg == "-j" || arg == "--jobs") {
+                if (i + 1 == args.size()) {
+                    options.error = arg + " needs a value";
+                    break;
+                }
+                options.jobs = parseCount(args[++i], options.error);
+            } else if (arg.rfind("-j", 0) == 0 && arg.size() > 2 && arg[2] != '-') {
+                options.jobs = parseCount(arg.substr(2), options.error);
+            } else if (arg.rfind("--jobs=", 0) == 0) {
+                options.jobs = parseCount(arg.substr(7), options.error);
+            } else if (arg == "--") {
+                options.paths.insert(options.paths.end(), args.begin() + static_cast<std::ptrdiff_t>(i) + 1, args.end());
+                break;
+            } else if (arg == "-") {
+                options.filter = true;
+            } else if (arg.size() > 1 && arg[0] == '-') {
+                options.error = "Unknown option " + arg;
+            } else {
+                options.paths.push_back(arg);
+            }
+
+            if (!options.error.empty()) { break; }
+        }
+
+        if (options.error.empty() && options.filter && !options.paths.empty()) {
+            options.error = "- can't be combined with other paths";
+        }
+        if (options.error.empty() && options.filter && options.records != records::Format::NONE) {
+            options.error = "--records needs files, it can't be used with -";
+        }
+        if (options.error.empty() && options.filter && options.sidecar) {
+            options.error = "--sidecar needs files, it can't be used with -";
+        }
+        if (options.error.empty() && options.compress != compression::Codec::NONE && (options.filter || options.sidecar || options.daemon)) {
+            options.error = "--compress only applies to annotated copies written to files";
+        }
+        if (options.error.empty() && options.view && options.paths.size() != 1) {
+            options.error = "view needs exactly one file";
+        }
+        if (options.error.empty() && options.daemon && (options.paths.empty() || options.filter)) {
+            options.error = "daemon needs the files or directories to watch";
+        }
+        if (options.error.empty() && options.daemon && (options.records != records::Format::NONE || options.sidecar || options.xref)) {
+            options.error = "daemon keeps its results in memory, --records, --sidecar and --xref don't apply";
+        }
+        if (options.error.empty() && options.filter && options.xref) {
+            options.error = "--xref needs files, it can't be used with -";
+        }
+        if (options.error.empty() && options.lookup && (options.paths.empty() || options.filter)) {
+            options.error = "xref needs the files to look in";
+        }
+        if (options.error.empty() && options.lookup && options.query == XrefQuery::NONE) {
+            options.error = "xref needs one of --callers, --uses, --unused or --undefined";
+        }
+        if (options.error.empty() && !options.lookup && options.query != XrefQuery::NONE) {
+            options.error = "--callers, --uses, --unused and --undefined only go with xref";
+        }
+        if (options.error.empty() && !options.daemon && !options.socketPath.empty()) {
+            options.error = "--socket only goes with daemon";
+        }
+        if (options.error.empty() && !options.view && (options.firstLine != 1 || options.lastLine != UINT64_MAX)) {
+            options.error = "--lines only goes with view";
+        }
+        if (options.error.empty() && options.filter && options.cfg) {
+            options.error = "--cfg needs the whole text, it can't be used with -";
+        }
+        if (options.error.empty() && options.includes && (options.filter || options.daemon)) {
+            options.error = options.filter ? "--includes needs files, it can't be used with -" : "daemon doesn't follow includes, --includes doesn't apply";
+        }
+        if (options.error.empty() && !options.profiles.empty() && (options.daemon || options.view || options.lookup)) {
+            options.error = "--profile only applies to annotated copies";
+        }
+        if (options.error.empty() && options.jobs > 1024) {
+            options.error = "--jobs must be at most 1024";
+        }
+        if (options.error.empty() && options.paths.empty() && !options.filter && !options.help && !options.version) {
+            options.error = "No files given (- reads stdin)";
+        }
+
+        return options;
+    }
+
+    /**
+      @return The --help text.
+     */
+    static auto usage() -> std::string {
+        return
+            "Usage: asm-analyze [options] <file|directory>...\n"
+            "       asm-analyze [options] -\n"
+            "       asm-analyze view [--lines <from>[-<to>]] <file>\n"
+            "       asm-analyze xref <--callers <symbol>|--uses <symbol>|--unused|--undefined> <file>...\n"
+            "       asm-analyze daemon [--socket <path>] [options] <file|directory>...\n"
+            "\n"
+            "Analyzes every given assembly file and writes a commented copy next to it (<name>_analyzed.<ext>).\n"
+            "Directories are searched for files with a supported extension.\n"
+            "Files compressed with gzip or zstd (<name>.<ext>.gz or .zst) are analyzed as they're\n"
+            "decompressed, into <name>_analyzed.<ext>.\n"
+            "With - the input is read from stdin and the commented copy is written to stdout as lines\n"
+            "arrive (messages go to stderr).\n"
+            "view prints a file analyzed with --sidecar merged with its comments, as the annotated copy\n"
+            "would have shown it (only the lines asked for are read).\n"
+            "xref looks symbols up in the indexes --xref wrote: who calls one (--callers), where one is\n"
+            "defined and used (--uses), labels nothing uses (--unused) or jump and call targets nothing\n"
+            "defines (--undefined).\n"
+            "daemon stays resident (Linux): it watches the given files and directories, re-analyzes what\n"
+            "changes (only the changed lines where it can) and answers over a Unix socket, one request\n"
+            "per line: get <file>, lines <from> <to> <file>, files, status or stop.\n"
+            "\n"
+            "Options:\n"
+            "  -j, --jobs <n>     number of worker threads (default: one per core)\n"
+            "      --no-recursive only analyze the top level of given directories\n"
+            "      --no-mmap      read input through a stream instead of mapping it\n"
+            "      --io <auto|uring|threads>\n"
+            "                     how files are read and written: uring keeps many opens, reads and writes\n"
+            "                     in flight while the workers analyze (Linux 5.6+), threads has every\n"
+            "                     worker block on its own (default: auto, uring where available)\n"
+            "      --queue-depth <n>\n"
+            "                     files uring keeps in flight (default: 128)\n"
+            "      --chunk-size <MiB>\n"
+            "                     split files of twice this size into chunks analyzed in parallel\n"
+            "                     (default: 8, 0 disables)\n"
+            "      --records <jsonl|bin>\n"
+            "                     also write one record per line (line, offset, opcode id, operand kinds)\n"
+            "                     to <name>_analyzed.<ext>.jsonl or .rec (a mappable binary file)\n"
+            "      --compress <gz|zst>\n"
+            "                     compress the annotated copies (<name>_analyzed.<ext>.gz or .zst)\n"
+            "      --sidecar      write only the comments, to <name>.<ext>.ann with an index by line,\n"
+            "                     instead of a full annotated copy (see view)\n"
+            "      --xref         also index where every symbol is defined and used, in\n"
+            "                     <name>_analyzed.<ext>.xref (see xref)\n"
+            "      --cfg          split code into basic blocks, find loops and estimate their throughput,\n"
+            "                     summarized in comment lines before every block and loop\n"
+            "      --cpu <model>  processor the estimates are for (implies --cfg): skylake, zen3,\n"
+            "                     cortex-a72, neoverse-n1, mips-24k, power9, sifive-u74, ultrasparc-t2\n"
+            "                     (default: the first one of each file's instruction set)\n"
+            "      --includes     find the files .include and %include pull in (next to the including file,\n"
+            "                     then in the -I directories) and summarize what they define in a comment\n"
+            "                     line before the directive; every file is parsed once per run\n"
+            "  -I, --include-dir <dir>\n"
+            "                     also look for included files in a directory (implies --includes)\n"
+            "      --profile <file>\n"
+            "                     show each function's and instruction's share of a profile's samples:\n"
+            "                     perf script or perf annotate --stdio output (run with --no-demangle so\n"
+            "                     names match the labels), a CSV of hex address,count, or nm output that\n"
+            "                     gives a CSV its functions; repeat it for several files (their addresses\n"
+            "                     have to agree). Instructions are matched by position after their\n"
+            "                     function's label, on x86 and RISC-V only with perf annotate output\n"
+            "      --memo <lines> lines every worker remembers the analysis of, repeated ones are copied\n"
+            "                     instead of analyzed again, e.g. 8192 (256 bytes each; default: 0, off)\n"
+            "      --cache <dir>  reuse the output of files analyzed before, keyed by their content\n"
+            "      --cache-size <MiB>\n"
+            "                     evict the least recently used cache entries beyond this size\n"
+            "                     (default: 1024)\n"
+            "      --socket <path>\n"
+            "                     socket daemon listens on (default: $XDG_RUNTIME_DIR/asm-analyze.sock,\n"
+            "                     or /tmp/asm-analyze-<uid>.sock)\n"
+            "      --lines <from>[-<to>]\n"
+            "                     lines view prints (default: all of them)\n"
+            "      --callers <symbol>, --uses <symbol>, --unused, --undefined\n"
+            "                     what xref looks up\n"
+            "      --stats        report time per phase and counts per opcode at the end\n"
+            "      --stats-json <file>\n"
+            "                     also write the statistics to a file as JSON (implies --stats)\n"
+            "  -q, --quiet        only print errors and the final summary\n"
+            "  -V, --version      print the version and exit\n"
+            "  -h, --help         print this help and exit\n";
+    }
+
+private:
+    /**
+      @return The number a value holds, 0 (with `error` set) when it isn't a number of digits or
+      doesn't fit an unsigned (strtoul would take "-1" for its largest value).
+     */
+    static auto parseCount(const std::string& value, std::string& error) -> unsigned {
+        if (value.empty() || value[0] < '0' || value[0] > '9') {
+            error = "Invalid number " + value;
+            return 0;
+        }
+        char* end = nullptr;
+        errno = 0;
+        unsigned long long count = std::strtoull(value.c_str(), &end, 10);
+        if (*end != '\0') {
+            error = "Invalid number " + value;
+            return 0;
+        }
+        if (errno == ERANGE || count > UINT_MAX) {
+            error = "Number too large: " + value;
+            return 0;
+        }
+        return static_cast<unsigned>(count);
+    }
+};
\ No newline at end of file
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <string_view>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+/**
+  A growable bump buffer that annotations are formatted straight into.
+
+  Appending is a bounds check and a memcpy. Memory is only allocated when the buffer has to grow,
+  and since one buffer is reused for everything a thread writes, that stops happening after the
+  first few lines. The interface mirrors the bits of std::string the analyzer uses.
+ */
+class OutputBuffer {
+public:
+    explicit OutputBuffer(size_t capacity = 0) {
+        reserve(capacity);
+    }
+
+    auto append(std::string_view text) -> OutputBuffer& {
+        if (length + text.size() > capacity) { grow(length + text.size()); }
+        if (!text.empty()) { std::memcpy(buffer.get() + length, text.data(), text.size()); }
+        length += text.size();
+        return *this;
+    }
+
+    auto push_back(char c) -> void {
+        if (length == capacity) { grow(length + 1); }
+        buffer[length++] = c;
+    }
+
+    /**
+      Makes room for at least `size` bytes in total.
+     */
+    void reserve(size_t size) {
+        if (size > capacity) { grow(size); }
+    }
+
+    /**
+      Shrinks the content to its first `size` bytes (rolls back appends).
+     */
+    void resize(size_t size) {
+        length = std::min(length, size);
+    }
+
+    void clear() {
+        length = 0;
+    }
+
+    [[nodiscard]] auto size() const -> size_t { return length; }
+    [[nodiscard]] auto empty() const -> bool { return length == 0; }
+    [[nodiscard]] auto data() const -> const char* { return buffer.get(); }
+    [[nodiscard]] auto view() const -> std::string_view { return { buffer.get(), length }; }
+
+private:
+    std::unique_ptr<char[]> buffer;
+    size_t length = 0;
+    size_t capacity = 0;
+
+    void grow(size_t needed) {
+        size_t next = std::max<size_t>({ needed, capacity * 2, 4096 });
+        std::unique_ptr<char[]> bigger(new char[next]);
+        if (length != 0) { std::memcpy(bigger.get(), buffer.get(), length); }
+        buffer = std::move(bigger);
+        capacity = next;
+    }
+};
+
+/**
+  An output file written with plain (large) write calls, bypassing iostreams.
+ */
+class OutputFile {
+public:
+    OutputFile() = default;
+    OutputFile(const OutputFile&) = delete;
+    auto operator=(const OutputFile&) -> OutputFile& = delete;
+
+    ~OutputFile() {
+        close();
+    }
+
+    /**
+      Creates (or truncates) a file.
+     *
+      @param filename The file to write.
+      @return Whether the file is open.
+     */
+    auto open(const std::string& filename) -> bool {
+        close();
+#ifdef _WIN32
+        fd = _open(filename.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+        owned = true;
+        failed = fd < 0;
+        total = 0;
+        return !failed;
+    }
+
+    /**
+      Writes to a descriptor that is already open (e.g. stdout), close() leaves it open.
+     *
+      @param descriptor The descriptor to write to.
+     */
+    void attach(int descriptor) {
+        close();
+        fd = descriptor;
+        owned = false;
+        failed = fd < 0;
+        total = 0;
+    }
+
+    /**
+      Appends bytes to the file, retrying short writes.
+     */
+    auto write(std::string_view data) -> bool {
+        while (!data.empty() && !failed) {
+#ifdef _WIN32
+            int written = _write(fd, data.data(), static_cast<unsigned>(std::min<size_t>(data.size(), 1U << 30)));
+#else
+            ssize_t written = ::write(fd, data.data(), data.size());
+            if (written < 0 && errno == EINTR) { continue; }
+#endif
+            if (written <= 0) {
+                failed = true;
+                break;
+            }
+            data.remove_prefix(static_cast<size_t>(written));
+            total += static_cast<uint64_t>(written);
+        }
+        return !failed;
+    }
+
+    /**
+      Overwrites bytes at an absolute offset without moving the append position.
+     */
+    auto writeAt(uint64_t offset, std::string_view data) -> bool {
+        if (failed) { return false; }
+#ifdef _WIN32
+        __int64 end = _lseeki64(fd, 0, SEEK_END);
+        failed = _lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) < 0 || !write(data) || _lseeki64(fd, end, SEEK_SET) < 0;
+#else
+        while (!data.empty()) {
+            ssize_t written = ::pwrite(fd, data.data(), data.size(), static_cast<off_t>(offset));
+            if (written < 0 && errno == EINTR) { continue; }
+            if (written <= 0) {
+                failed = true;
+                break;
+            }
+            data.remove_prefix(static_cast<size_t>(written));
+            offset += static_cast<uint64_t>(written);
+        }
+#endif
+        return !failed;
+    }
+
+    /**
+      Closes the file.
+     *
+      @return Whether every write (and the close) succeeded.
+     */
+    auto close() -> bool {
+        if (fd >= 0 && owned) {
+#ifdef _WIN32
+            failed = _close(fd) != 0 || failed;
+#else
+            failed = ::close(fd) != 0 || failed;
+#endif
+        }
+        fd = -1;
+        return !failed;
+    }
+
+    [[nodiscard]] auto good() const -> bool { return !failed; }
+    /**
+      @return Bytes appended by write() so far.
+     */
+    [[nodiscard]] auto written() const -> uint64_t { return total; }
+
+private:
+    int fd = -1;
+    bool owned = true;
+    bool failed = false;
+    uint64_t total = 0;
+};
+
+/**
+  Collects in memory what would have gone to an OutputFile (same interface), for analyzing buffers.
+ */
+class MemoryOutput {
+public:
+    auto write(std::string_view data) -> bool {
+        bytes.append(data);
+        return true;
+    }
+
+    /**
+      Overwrites bytes that were written before.
+     */
+    auto writeAt(uint64_t offset, std::string_view data) -> bool {
+        if (offset > bytes.size() || data.size() > bytes.size() - offset) { return false; }
+        bytes.replace(static_cast<size_t>(offset), data.size(), data);
+        return true;
+    }
+
+    auto close() -> bool { return true; }
+    [[nodiscard]] auto good() const -> bool { return true; }
+    [[nodiscard]] auto written() const -> uint64_t { return bytes.size(); }
+
+    /**
+      @return Everything written, leaving this empty.
+     */
+    auto take() -> std::string { return std::move(bytes); }
+
+private:
+    std::string bytes;
+};
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <string_view>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <array>
+#include <bit>
+
+/**
+  A perfect hash over a fixed set of strings, built entirely at compile time.
+
+  Hash-and-displace (CHD): keys are hashed once, the high bits pick a bucket and every bucket stores
+  a displacement that was searched at compile time so that all keys of all buckets land in distinct
+  slots. A lookup is one hash of the key, two table reads and one string compare, whatever the
+  number of keys.
+ */
+template <size_t N>
+class PerfectHash {
+public:
+    /**
+      Returned by find() for strings that aren't keys.
+     */
+    static constexpr size_t NOT_FOUND = N;
+
+    /**
+      Builds the table (meant to run at compile time). Keys have to be unique.
+     *
+      @param keys The keys, find() returns their index in this array.
+     */
+    constexpr explicit PerfectHash(const std::array<std::string_view, N>& keys) : keys(keys) {
+        std::array<uint64_t, N> hashes{};
+        std::array<Index, BUCKETS + 1> start{};
+        for (size_t i = 0; i < N; ++i) {
+            hashes[i] = hash(keys[i]);
+            ++start[bucketOf(hashes[i]) + 1];
+        }
+
+        // counting sort of the keys by bucket
+        size_t largest = 0;
+        for (size_t b = 0; b < BUCKETS; ++b) {
+            largest = std::max<size_t>(largest, start[b + 1]);
+            start[b + 1] += start[b];
+        }
+        std::array<Index, N> members{};
+        std::array<Index, BUCKETS> fill{};
+        for (size_t i = 0; i < N; ++i) {
+            size_t b = bucketOf(hashes[i]);
+            members[start[b] + fill[b]++] = static_cast<Index>(i);
+        }
+
+        slots.fill(EMPTY);
+        displacement.fill(0);
+
+        // biggest buckets first, they are the hardest to place
+        for (size_t size = largest; size > 0; --size) {
+            for (size_t b = 0; b < BUCKETS; ++b) {
+                if (static_cast<size_t>(start[b + 1] - start[b]) != size) { continue; }
+
+                for (uint32_t d = 0;; ++d) {
+                    if (d == MAX_DISPLACEMENT) {
+                        throw "PerfectHash: no displacement found (duplicate key?)";
+                    }
+                    size_t placed = 0;
+                    for (; placed < size; ++placed) {
+                        Index key = members[start[b] + placed];
+                        size_t slot = slotOf(hashes[key], d);
+                        if (slots[slot] != EMPTY) { break; }
+                        slots[slot] = key;
+                    }
+                    if (placed == size) {
+                        displacement[b] = d;
+                        break;
+                    }
+                    // roll back the keys of this bucket that were placed with this displacement
+                    while (placed-- > 0) {
+                        slots[slotOf(hashes[members[start[b] + placed]], d)] = EMPTY;
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+      Looks a string up.
+     *
+      @param key The string to look up.
+      @return Its index in the key array, or NOT_FOUND.
+     */
+    [[nodiscard]] constexpr auto find(std::string_view key) const -> size_t {
+        uint64_t h = hash(key);
+        Index index = slots[slotOf(h, displacement[bucketOf(h)])];
+        return index != EMPTY && keys[index] == key ? index : NOT_FOUND;
+    }
+
+    /**
+      FNV-1a, good enough for short mnemonics and cheap to evaluate at compile time.
+     */
+    static constexpr auto hash(std::string_view key) -> uint64_t {
+        uint64_t h = 0xCBF29CE484222325ULL;
+        for (char c : key) {
+            h = (h ^ static_cast<unsigned char>(c)) * 0x100000001B3ULL;
+        }
+        return h;
+    }
+
+private:
+    using Index = std::conditional_t<(N < 0xFFFF), uint16_t, uint32_t>;
+
+    static constexpr Index EMPTY = static_cast<Index>(~Index{ 0 });
+    static constexpr size_t SLOTS = std::bit_ceil(N * 2 + 1);    // load factor <= 0.5
+    static constexpr size_t BUCKETS = std::bit_ceil(N / 4 + 1);  // ~4 keys per bucket
+    static constexpr uint32_t MAX_DISPLACEMENT = 1U << 20;
+
+    static constexpr auto bucketOf(uint64_t h) -> size_t {
+        return static_cast<size_t>(h >> 40) & (BUCKETS - 1);
+    }
+
+    static constexpr auto slotOf(uint64_t h, uint32_t d) -> size_t {
+        // splitmix64 finalizer over the hash displaced by d
+        uint64_t x = h + (d + 1) * 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return static_cast<size_t>(x ^ (x >> 31)) & (SLOTS - 1);
+    }
+
+    std::array<std::string_view, N> keys;
+    std::array<Index, SLOTS> slots{};
+    std::array<uint32_t, BUCKETS> displacement{};
+};
\ No newline at end of file
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <deque>
+#include <mutex>
+
+/**
+  A work-stealing thread pool.
+
+  Every worker owns a deque: it pushes and pops its own tasks at the back (LIFO, cache friendly)
+  and steals from the front of the other deques when it runs dry. Tasks submitted from outside the
+  pool are spread round-robin over the workers.
+ */
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    /**
+      Starts the pool.
+     *
+      @param threads Number of worker threads (0 means one per hardware thread).
+     */
+    explicit ThreadPool(unsigned threads = 0) {
+        if (threads == 0) {
+            threads = std::max(1U, std::thread::hardware_concurrency());
+        }
+        queues.reserve(threads);
+        for (unsigned i = 0; i < threads; ++i) {
+            queues.push_back(std::make_unique<Queue>());
+        }
+        workers.reserve(threads);
+        for (unsigned i = 0; i < threads; ++i) {
+            workers.emplace_back([this, i] { run(i); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+    auto operator=(ThreadPool&&) -> ThreadPool& = delete;
+
+    ~ThreadPool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        sleepCv.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    /**
+      Queues a task. Called from a worker, the task lands in that worker's own deque.
+     *
+      @param task The task to run.
+     */
+    void submit(Task task) {
+        size_t index = current != nullptr && current->pool == this
+            ? current->index
+            : next.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        pending.fetch_add(1, std::memory_order_acq_rel);
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            ++version;
+        }
+        sleepCv.notify_one();
+    }
+
+    /**
+      Blocks until every submitted task (including tasks submitted by tasks) has finished.
+     */
+    void wait() {
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        doneCv.wait(lock, [this] { return pending.load(std::memory_order_acquire) == 0; });
+    }
+
+    /**
+      @return The number of worker threads.
+     */
+    [[nodiscard]] auto size() const -> size_t {
+        return workers.size();
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    struct Worker {
+        ThreadPool* pool;
+        size_t index;
+    };
+
+    inline static thread_local Worker* current = nullptr;
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> next{ 0 };
+    std::atomic<size_t> pending{ 0 };
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCv;
+    std::condition_variable doneCv;
+    uint64_t version = 0;
+    bool stopping = false;
+
+    auto popLocal(size_t index, Task& task) -> bool {
+        Queue& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) { return false; }
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    auto steal(size_t thief, Task& task) -> bool {
+        for (size_t offset = 1; offset < queues.size(); ++offset) {
+            Queue& queue = *queues[(thief + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(size_t index) {
+        Worker self{ this, index };
+        current = &self;
+
+        Task task;
+        while (true) {
+            uint64_t seen = 0;
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                seen = version;
+            }
+
+            if (popLocal(index, task) || steal(index, task)) {
+                task();
+                task = nullptr;
+                if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    std::lock_guard<std::mutex> lock(sleepMutex);
+                    doneCv.notify_all();
+                }
+                continue;
+            }
+
+            // nothing to do: sleep until something new is submitted
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepCv.wait(lock, [&] { return stopping || version != seen; });
+            if (stopping) { break; }
+        }
+
+        current = nullptr;
+    }
+};
\ No newline at end of file
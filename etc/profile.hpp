@@ -0,0 +1,398 @@
+#pragma once
+
+#include "mmap.hpp"
+#include <unordered_map>
+#include <system_error>
+#include <string_view>
+#include <filesystem>
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+
+/**
+  Samples of a profile, by function and address, to show next to the lines they were taken on.
+
+  Profiles are read as text: what `perf script` prints (a sample per line, the address of its leaf
+  frame and that frame's symbol+offset), what `perf annotate --stdio` prints (every instruction of
+  a function with its address and share of the function's samples), a CSV of address,count, and
+  the symbol table `nm` prints, which gives such a CSV its functions. Every function is an interval
+  of addresses, from its start to the next function's; the intervals are sorted once and every
+  sample placed with a binary search, and each function keeps its sampled addresses sorted with
+  running totals, so the samples on an instruction's bytes are two more binary searches.
+
+  Assembly has no addresses, so lines are matched by position: the n-th instruction after a
+  function's label is the n-th instruction of the function. perf annotate lists the instructions,
+  otherwise their addresses are only known when they all have the same size (ARM, MIPS, PowerPC,
+  SPARC); on x86 and RISC-V (compressed instructions) a function's samples are only known as a
+  whole then.
+ */
+namespace profile {
+    /**
+      How a profile file is written, told from its first lines.
+     */
+    enum class Format : uint8_t { SCRIPT, ANNOTATE, CSV, SYMBOLS };
+
+    /**
+      A function of the profile and the samples taken in it.
+     */
+    struct Function {
+        std::string name;
+        uint64_t start = 0;
+        uint64_t end = UINT64_MAX;          // past its last byte: the next function's start when the profile doesn't tell
+        uint64_t samples = 0;
+        std::vector<uint64_t> instructions; // addresses perf annotate listed, in order
+        std::vector<bool> padding;          // per instruction: a nop, maybe alignment the assembly only has as a directive
+        std::vector<uint64_t> addresses;    // sampled addresses, sorted
+        std::vector<uint64_t> totals;       // samples before each of `addresses`, then all of them
+
+        /**
+          @return Whether the samples of single instructions are known, for instructions of `width`
+          bytes (0 when their size varies).
+         */
+        [[nodiscard]] auto byLine(unsigned width) const -> bool { return !instructions.empty() || width != 0; }
+
+        /**
+          @return The samples at addresses in [from, to).
+         */
+        [[nodiscard]] auto between(uint64_t from, uint64_t to) const -> uint64_t {
+            auto first = std::lower_bound(addresses.begin(), addresses.end(), from) - addresses.begin();
+            auto last = std::lower_bound(addresses.begin(), addresses.end(), to) - addresses.begin();
+            return totals[static_cast<size_t>(last)] - totals[static_cast<size_t>(first)];
+        }
+
+        /**
+          Gets the samples of the function's next instruction.
+         *
+          @param next Instructions of the function passed so far, moved past this one (and the
+          padding before it).
+          @param nop Whether the instruction is a nop itself, padding isn't skipped for one.
+          @param width Size of every instruction in bytes, 0 when it varies.
+          @return The samples, 0 when they aren't known by instruction.
+         */
+        auto step(size_t& next, bool nop, unsigned width) const -> uint64_t {
+            if (!instructions.empty()) {
+                while (!nop && next < instructions.size() && padding[next]) { ++next; }
+                if (next >= instructions.size()) { return 0; }
+                uint64_t from = instructions[next++];
+                return between(from, next < instructions.size() ? instructions[next] : end);
+            }
+            if (width == 0) { return 0; }
+            uint64_t from = start + next++ * width;
+            return between(from, from + width);
+        }
+    };
+
+    class Profile {
+    public:
+        /**
+          Reads a profile file, in any of the formats.
+         *
+          @param path The file.
+          @param error Receives the reason it couldn't be read.
+          @return Whether it could.
+         */
+        auto load(const std::string& path, std::string& error) -> bool {
+            MappedFile mapped;
+            std::error_code ec;
+            if (std::filesystem::file_size(path, ec) == 0 && !ec) { return true; }
+            if (!mapped.open(path, error)) { return false; }
+            add(mapped.view());
+            return true;
+        }
+
+        /**
+          Adds the samples and functions of a profile's text.
+         */
+        void add(std::string_view text) {
+            switch (detect(text)) {
+            case Format::ANNOTATE: addAnnotate(text); break;
+            case Format::CSV: addCsv(text); break;
+            case Format::SYMBOLS: addSymbols(text); break;
+            case Format::SCRIPT: addScript(text); break;
+            }
+        }
+
+        /**
+          Places every sample in its function, once every file was added.
+         */
+        void finish() {
+            std::vector<uint32_t> order(functions.size());
+            for (size_t i = 0; i < order.size(); ++i) {
+                order[i] = static_cast<uint32_t>(i);
+                Function& function = functions[i];
+                // the last instruction perf annotate listed is at most 16 bytes long
+                if (function.end == UINT64_MAX && !function.instructions.empty()) { function.end = function.instructions.back() + 16; }
+            }
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return functions[a].start < functions[b].start; });
+            std::vector<uint64_t> starts(order.size());
+            for (size_t i = 0; i < order.size(); ++i) {
+                Function& function = functions[order[i]];
+                starts[i] = function.start;
+                if (i + 1 < order.size() && functions[order[i + 1]].start > function.start) {
+                    function.end = std::min(function.end, functions[order[i + 1]].start);
+                }
+            }
+
+            // sorted samples come out in address order for every function
+            std::sort(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) { return a.address < b.address; });
+            for (const Sample& sample : samples) {
+                total_ += sample.count;
+                auto after = std::upper_bound(starts.begin(), starts.end(), sample.address);
+                Function* function = after == starts.begin() ? nullptr : &functions[order[static_cast<size_t>(after - starts.begin()) - 1]];
+                if (function == nullptr || sample.address >= function->end) {
+                    unmapped_ += sample.count;
+                    continue;
+                }
+                if (function->addresses.empty() || function->addresses.back() != sample.address) {
+                    function->addresses.push_back(sample.address);
+                    function->totals.push_back(0);
+                }
+                function->totals.back() += sample.count;
+            }
+            samples.clear();
+            samples.shrink_to_fit();
+
+            // counts to running totals
+            for (Function& function : functions) {
+                uint64_t sum = 0;
+                for (uint64_t& count : function.totals) {
+                    uint64_t here = count;
+                    count = sum;
+                    sum += here;
+                }
+                function.totals.push_back(sum);
+                function.samples = sum;
+            }
+        }
+
+        /**
+          @return The function of a label, null if the profile doesn't have it.
+         */
+        [[nodiscard]] auto find(std::string_view name) const -> const Function* {
+            auto found = byName.find(std::string(name));
+            return found == byName.end() ? nullptr : &functions[found->second];
+        }
+
+        [[nodiscard]] auto total() const -> uint64_t { return total_; }
+        [[nodiscard]] auto unmapped() const -> uint64_t { return unmapped_; }
+        [[nodiscard]] auto size() const -> size_t { return functions.size(); }
+
+    private:
+        struct Sample {
+            uint64_t address = 0;
+            uint64_t count = 0;
+        };
+
+        std::vector<Function> functions;
+        std::unordered_map<std::string, size_t> byName;
+        std::vector<Sample> samples; // until finish()
+        uint64_t total_ = 0;
+        uint64_t unmapped_ = 0;
+
+        static auto trim(std::string_view text) -> std::string_view {
+            size_t first = text.find_first_not_of(" \t\r");
+            if (first == std::string_view::npos) { return {}; }
+            return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+        }
+
+        // calls f with every line
+        template <typename F>
+        static void forEachLine(std::string_view text, F&& f) {
+            while (!text.empty()) {
+                size_t end = text.find('\n');
+                f(text.substr(0, end));
+                text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+            }
+        }
+
+        // splits a line at spaces and tabs
+        static auto words(std::string_view line) -> std::vector<std::string_view> {
+            std::vector<std::string_view> result;
+            for (size_t i = 0; i < line.size();) {
+                size_t begin = line.find_first_not_of(" \t\r", i);
+                if (begin == std::string_view::npos) { break; }
+                size_t end = std::min(line.find_first_of(" \t\r", begin), line.size());
+                result.push_back(line.substr(begin, end - begin));
+                i = end;
+            }
+            return result;
+        }
+
+        // a hexadecimal number, with or without 0x, and nothing else
+        static auto parseHex(std::string_view text, uint64_t& value) -> bool {
+            if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) { text.remove_prefix(2); }
+            if (text.empty() || text.size() > 16) { return false; }
+            value = 0;
+            for (char c : text) {
+                int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+                if (digit < 0) { return false; }
+                value = value << 4 | static_cast<uint64_t>(digit);
+            }
+            return true;
+        }
+
+        // the function of a name, added with its start when it's new
+        auto function(std::string_view name, uint64_t start) -> size_t {
+            auto [found, added] = byName.try_emplace(std::string(name), functions.size());
+            if (added) {
+                functions.emplace_back();
+                functions.back().name = std::string(name);
+                functions.back().start = start;
+            }
+            return found->second;
+        }
+
+        static auto detect(std::string_view text) -> Format {
+            Format format = Format::SCRIPT;
+            bool first = true;
+            size_t seen = 0;
+            forEachLine(text, [&](std::string_view line) {
+                line = trim(line);
+                if (line.empty() || line[0] == '#' || seen++ >= 64) { return; }
+                if (line.find("Disassembly of") != std::string_view::npos || line.find("Percent |") != std::string_view::npos) {
+                    format = Format::ANNOTATE;
+                } else if (first) {
+                    std::vector<std::string_view> parts = words(line);
+                    uint64_t value = 0;
+                    if (line.find(',') != std::string_view::npos) {
+                        format = Format::CSV;
+                    } else if ((parts.size() == 3 || parts.size() == 4) && parts[parts.size() - 2].size() == 1 && parseHex(parts[0], value)) {
+                        format = Format::SYMBOLS;
+                    }
+                }
+                first = false;
+            });
+            return format;
+        }
+
+        /**
+          perf script: a sample per line, `comm pid time: period event: ip symbol+0xoffset (dso)`,
+          or with call chains a header line and a frame per line up to a blank line, the first
+          frame being where the sample was taken.
+         */
+        void addScript(std::string_view text) {
+            bool chain = false;
+            bool taken = false;
+            forEachLine(text, [&](std::string_view line) {
+                std::vector<std::string_view> parts = words(line);
+                if (parts.empty()) {
+                    chain = false;
+                    return;
+                }
+                if (parts[0][0] == '#') { return; }
+                // the frame is at the end: ip symbol[+0xoffset] [(dso)]
+                size_t end = parts.size();
+                if (parts[end - 1][0] == '(') { --end; }
+                uint64_t ip = 0;
+                bool frame = end >= 2 && parts[end - 1].back() != ':' && parseHex(parts[end - 2], ip);
+                if (!frame) {
+                    chain = true;
+                    taken = false;
+                    return;
+                }
+                if (chain && taken) { return; }
+                taken = true;
+                std::string_view symbol = parts[end - 1];
+                if (symbol == "[unknown]") {
+                    // perf knows it's in none of the functions, even past the last one
+                    ++total_;
+                    ++unmapped_;
+                    return;
+                }
+                samples.push_back({ ip, 1 });
+                size_t plus = symbol.rfind("+0x");
+                uint64_t offset = 0;
+                if (plus != std::string_view::npos && parseHex(symbol.substr(plus + 1), offset) && offset <= ip) { function(symbol.substr(0, plus), ip - offset); }
+            });
+        }
+
+        /**
+          perf annotate --stdio: for every function a header with its sample count, `Percent |
+          Source code & Disassembly of ... (3072 samples, ...)`, its start, `0000000000001139
+          <main>:`, and a line per instruction, `33.33 :   1141:   addl $0x1,-0x4(%rbp)`. Without
+          a sample count the shares are counted in hundredths of a percent.
+         */
+        void addAnnotate(std::string_view text) {
+            uint64_t count = 0;
+            size_t current = SIZE_MAX;
+            forEachLine(text, [&](std::string_view line) {
+                if (line.find("Percent") != std::string_view::npos) {
+                    size_t at = line.find(" samples");
+                    size_t open = line.rfind('(', at);
+                    count = 0;
+                    if (at != std::string_view::npos && open != std::string_view::npos) { std::from_chars(line.data() + open + 1, line.data() + at, count); }
+                    return;
+                }
+                size_t colon = line.find(':');
+                if (colon == std::string_view::npos) { return; }
+                std::string_view share = trim(line.substr(0, colon));
+                std::string_view rest = trim(line.substr(colon + 1));
+                if (rest.empty()) {
+                    // a start without the share column
+                    share = {};
+                    rest = trim(line);
+                }
+                size_t hexEnd = rest.find_first_not_of("0123456789abcdefABCDEF");
+                uint64_t address = 0;
+                if (hexEnd == 0 || hexEnd == std::string_view::npos || !parseHex(rest.substr(0, hexEnd), address)) { return; }
+
+                if (rest.substr(hexEnd, 2) == " <" && rest.back() == ':' && rest.size() > hexEnd + 4) {
+                    // 0000000000001139 <main>:
+                    current = function(rest.substr(hexEnd + 2, rest.size() - hexEnd - 4), address);
+                    return;
+                }
+                if (rest[hexEnd] != ':' || share.empty() || current == SIZE_MAX) { return; }
+                char* end = nullptr;
+                std::string percent(share);
+                double value = std::strtod(percent.c_str(), &end);
+                if (end == percent.c_str()) { return; }
+
+                Function& into = functions[current];
+                std::string_view instruction = rest.substr(hexEnd + 1);
+                bool nop = false;
+                for (std::string_view word : words(instruction)) { nop = nop || word.substr(0, 3) == "nop"; }
+                into.instructions.push_back(address);
+                into.padding.push_back(nop || instruction.find("%ax,%ax") != std::string_view::npos);
+                auto weight = static_cast<uint64_t>(std::llround(count != 0 ? value * static_cast<double>(count) / 100 : value * 100));
+                if (weight != 0) { samples.push_back({ address, weight }); }
+            });
+        }
+
+        /**
+          address,count per line (a header line is skipped, the count is 1 when there's none).
+         */
+        void addCsv(std::string_view text) {
+            forEachLine(text, [&](std::string_view line) {
+                size_t comma = line.find(',');
+                uint64_t address = 0;
+                if (!parseHex(trim(line.substr(0, comma)), address)) { return; }
+                uint64_t count = 1;
+                if (comma != std::string_view::npos) {
+                    std::string_view field = trim(line.substr(comma + 1, line.find(',', comma + 1) - comma - 1));
+                    if (std::from_chars(field.data(), field.data() + field.size(), count).ec != std::errc()) { return; }
+                }
+                samples.push_back({ address, count });
+            });
+        }
+
+        /**
+          nm, with or without -S: `address [size] type name`, for the functions (types T, t, W, w).
+         */
+        void addSymbols(std::string_view text) {
+            forEachLine(text, [&](std::string_view line) {
+                std::vector<std::string_view> parts = words(line);
+                if (parts.size() != 3 && parts.size() != 4) { return; }
+                std::string_view type = parts[parts.size() - 2];
+                uint64_t address = 0;
+                if (type.size() != 1 || std::string_view("TtWw").find(type[0]) == std::string_view::npos || !parseHex(parts[0], address)) { return; }
+                size_t id = function(parts.back(), address);
+                if (uint64_t size = 0; parts.size() == 4 && parseHex(parts[1], size) && functions[id].start == address) { functions[id].end = address + size; }
+            });
+        }
+    };
+}
\ No newline at end of file
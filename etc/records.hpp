@@ -0,0 +1,169 @@
+#pragma once
+
+#include "output.hpp"
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include <array>
+
+/**
+  Structured per-line output, for tools that would otherwise have to parse the comments back.
+
+  Every source line gets one record, either as a JSON object per line (JSON Lines) or as a fixed
+  size struct in a binary file meant to be mapped: after the header, record i describes line i + 1.
+ */
+namespace records {
+    /**
+      What a line holds.
+     */
+    enum class LineKind : uint8_t { BLANK, LABEL, INSTRUCTION, DIRECTIVE, UNKNOWN };
+
+    /**
+      What an operand is (as analyzeOperand reports it).
+     */
+    enum class OperandKind : uint8_t { NONE, REGISTER, IMMEDIATE, MEMORY, LABEL, MODIFIER };
+
+    constexpr std::array<std::string_view, 5> LINE_KIND_NAMES = { "blank", "label", "instruction", "directive", "unknown" };
+    constexpr std::array<std::string_view, 6> OPERAND_KIND_NAMES = { "none", "register", "immediate", "memory", "label", "modifier" };
+
+    /**
+      Output formats.
+     */
+    enum class Format : uint8_t { NONE, JSONL, BINARY };
+
+    /**
+      Value of Record::opcode for lines without a known instruction or directive.
+     */
+    constexpr uint16_t NO_OPCODE = 0xFFFF;
+
+    /**
+      Operand kinds kept per record, Record::operandCount still counts all of them.
+     */
+    constexpr size_t MAX_OPERANDS = 4;
+
+    /**
+      One line, as stored in the binary format (native byte order).
+     */
+    struct Record {
+        uint64_t offset = 0;        // of the first byte of the line
+        uint32_t line = 0;          // 1-based
+        uint32_t length = 0;        // without the newline
+        uint16_t opcode = NO_OPCODE; // Instruction or Directive (depending on kind) from opcodes.hpp
+        LineKind kind = LineKind::BLANK;
+        uint8_t operandCount = 0;
+        std::array<OperandKind, MAX_OPERANDS> operands{};
+    };
+    static_assert(sizeof(Record) == 24, "the binary format depends on this layout");
+
+    /**
+      Start of a binary record file.
+     */
+    struct Header {
+        char magic[8] = { 'a', 's', 'm', 'r', 'e', 'c', 'o', 'r' };
+        uint32_t version = 1;
+        uint32_t recordSize = sizeof(Record);
+        uint64_t count = 0;         // written once the whole file has been analyzed
+    };
+    static_assert(sizeof(Header) == 24, "the binary format depends on this layout");
+
+    /**
+      Offset of Header::count, to patch it in at the end.
+     */
+    constexpr size_t COUNT_OFFSET = offsetof(Header, count);
+
+    /**
+      @return The format called `name` on the command line, or NONE.
+     */
+    inline auto parseFormat(std::string_view name) -> Format {
+        if (name == "jsonl") { return Format::JSONL; }
+        if (name == "bin") { return Format::BINARY; }
+        return Format::NONE;
+    }
+
+    /**
+      @return What gets appended to the name of the annotated copy.
+     */
+    inline auto extension(Format format) -> std::string_view {
+        return format == Format::JSONL ? ".jsonl" : ".rec";
+    }
+
+    /**
+      Starts a file (binary files need the header, JSON Lines don't).
+     */
+    inline void begin(Format format, OutputBuffer& out) {
+        if (format == Format::BINARY) {
+            Header header;
+            out.append({ reinterpret_cast<const char*>(&header), sizeof(header) });
+        }
+    }
+
+    // JSON string contents, escaping what JSON requires
+    inline void appendEscaped(std::string_view text, OutputBuffer& out) {
+        constexpr std::string_view HEX = "0123456789abcdef";
+        for (char c : text) {
+            auto byte = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\') {
+                out.push_back('\\');
+                out.push_back(c);
+            } else if (byte < 0x20) {
+                out.append("\\u00");
+                out.push_back(HEX[byte >> 4]);
+                out.push_back(HEX[byte & 15]);
+            } else {
+                out.push_back(c);
+            }
+        }
+    }
+
+    inline void appendNumber(uint64_t value, OutputBuffer& out) {
+        std::array<char, 20> digits{};
+        size_t count = 0;
+        do {
+            digits[digits.size() - ++count] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        out.append({ digits.data() + digits.size() - count, count });
+    }
+
+    /**
+      Appends a record.
+     *
+      @param format JSONL or BINARY.
+      @param record The record.
+      @param name The mnemonic, directive or label (only written to JSON Lines).
+      @param out Receives the record.
+     */
+    inline void append(Format format, const Record& record, std::string_view name, OutputBuffer& out) {
+        if (format == Format::BINARY) {
+            out.append({ reinterpret_cast<const char*>(&record), sizeof(record) });
+            return;
+        }
+
+        out.append("{\"line\":");
+        appendNumber(record.line, out);
+        out.append(",\"offset\":");
+        appendNumber(record.offset, out);
+        out.append(",\"kind\":\"").append(LINE_KIND_NAMES[static_cast<size_t>(record.kind)]).push_back('"');
+        if (record.kind == LineKind::BLANK) {
+            out.append("}\n");
+            return;
+        }
+        out.append(",\"name\":\"");
+        appendEscaped(name, out);
+        out.push_back('"');
+        if (record.opcode != NO_OPCODE) {
+            out.append(",\"opcode\":");
+            appendNumber(record.opcode, out);
+        }
+        if (record.kind != LineKind::LABEL) {
+            out.append(",\"operands\":[");
+            for (size_t i = 0; i < record.operandCount && i < MAX_OPERANDS; ++i) {
+                if (i != 0) { out.push_back(','); }
+                out.push_back('"');
+                out.append(OPERAND_KIND_NAMES[static_cast<size_t>(record.operands[i])]).push_back('"');
+            }
+            out.push_back(']');
+        }
+        out.append("}\n");
+    }
+}
\ No newline at end of file
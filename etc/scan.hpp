@@ -0,0 +1,402 @@
+#pragma once
+
+#include <string_view>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <array>
+#include <bit>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define ASM_ANALYZE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define ASM_ANALYZE_TARGET(isa)
+#else
+#define ASM_ANALYZE_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+/**
+  Byte classification kernels for line splitting and tokenizing.
+
+  Text is classified 64 bytes at a time into one bitmask per character class (bit i set when byte
+  i belongs to the class); findAny skims text for the next of a few characters. There are SSE2 and AVX2 versions and a scalar fallback. The best one the
+  CPU supports is picked once at startup; set ASM_ANALYZE_SIMD=scalar|sse2|avx2 to force one.
+ */
+namespace scan {
+    /**
+      Character classes tracked per byte.
+     */
+    enum Class : std::uint8_t {
+        /**
+          ' ' (what trim and the operand splitting go by).
+         */
+        SPACE,
+        /**
+          ' ', '\t' and '\r'.
+         */
+        BLANK,
+        /**
+          ','.
+         */
+        COMMA,
+        /**
+          '[' and '('.
+         */
+        OPEN,
+        /**
+          ']' and ')'.
+         */
+        CLOSE,
+        /**
+          '$' (AT&T immediates).
+         */
+        DOLLAR,
+        /**
+          '%' (AT&T registers).
+         */
+        PERCENT,
+        /**
+          '\n'.
+         */
+        NEWLINE,
+        CLASS_COUNT
+    };
+
+    /**
+      Masks of one 64 byte block.
+     */
+    using Block = std::array<uint64_t, CLASS_COUNT>;
+
+    /**
+      Classifies exactly 64 readable bytes.
+     */
+    using ClassifyFn = void (*)(const char* data, Block& block);
+
+    /**
+      Characters looked for at once by a FindAnyFn (repeat one to look for fewer).
+     */
+    using CharSet = std::array<char, 8>;
+
+    /**
+      Returns the first position >= from whose byte is in the set, or npos.
+     */
+    using FindAnyFn = size_t (*)(std::string_view text, size_t from, const CharSet& set);
+
+    inline void classifyScalar(const char* data, Block& block) {
+        block.fill(0);
+        for (unsigned i = 0; i < 64; ++i) {
+            uint64_t bit = uint64_t{ 1 } << i;
+            switch (data[i]) {
+            case ' ': block[SPACE] |= bit; block[BLANK] |= bit; break;
+            case '\t': case '\r': block[BLANK] |= bit; break;
+            case ',': block[COMMA] |= bit; break;
+            case '[': case '(': block[OPEN] |= bit; break;
+            case ']': case ')': block[CLOSE] |= bit; break;
+            case '$': block[DOLLAR] |= bit; break;
+            case '%': block[PERCENT] |= bit; break;
+            case '\n': block[NEWLINE] |= bit; break;
+            default: break;
+            }
+        }
+    }
+
+    inline auto findAnyScalar(std::string_view text, size_t from, const CharSet& set) -> size_t {
+        for (; from < text.size(); ++from) {
+            for (char c : set) {
+                if (text[from] == c) { return from; }
+            }
+        }
+        return std::string_view::npos;
+    }
+
+#ifdef ASM_ANALYZE_X86
+    ASM_ANALYZE_TARGET("sse2") inline auto maskSse2(__m128i v, char c) -> uint32_t {
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c))));
+    }
+
+    ASM_ANALYZE_TARGET("sse2") inline void classifySse2(const char* data, Block& block) {
+        block.fill(0);
+        for (unsigned part = 0; part < 4; ++part) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + part * 16));
+            unsigned shift = part * 16;
+            uint64_t space = maskSse2(v, ' ');
+            block[SPACE] |= space << shift;
+            block[BLANK] |= (space | maskSse2(v, '\t') | maskSse2(v, '\r')) << shift;
+            block[COMMA] |= uint64_t{ maskSse2(v, ',') } << shift;
+            block[OPEN] |= uint64_t{ maskSse2(v, '[') | maskSse2(v, '(') } << shift;
+            block[CLOSE] |= uint64_t{ maskSse2(v, ']') | maskSse2(v, ')') } << shift;
+            block[DOLLAR] |= uint64_t{ maskSse2(v, '$') } << shift;
+            block[PERCENT] |= uint64_t{ maskSse2(v, '%') } << shift;
+            block[NEWLINE] |= uint64_t{ maskSse2(v, '\n') } << shift;
+        }
+    }
+
+    ASM_ANALYZE_TARGET("sse2") inline auto findAnySse2(std::string_view text, size_t from, const CharSet& set) -> size_t {
+        for (; from + 16 <= text.size(); from += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + from));
+            uint32_t mask = 0;
+            for (char c : set) { mask |= maskSse2(v, c); }
+            if (mask != 0) { return from + static_cast<size_t>(std::countr_zero(mask)); }
+        }
+        return findAnyScalar(text, from, set);
+    }
+
+    ASM_ANALYZE_TARGET("avx2") inline auto maskAvx2(__m256i v, char c) -> uint32_t {
+        return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))));
+    }
+
+    ASM_ANALYZE_TARGET("avx2") inline void classifyAvx2(const char* data, Block& block) {
+        block.fill(0);
+        for (unsigned part = 0; part < 2; ++part) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + part * 32));
+            unsigned shift = part * 32;
+            uint64_t space = maskAvx2(v, ' ');
+            block[SPACE] |= space << shift;
+            block[BLANK] |= (space | maskAvx2(v, '\t') | maskAvx2(v, '\r')) << shift;
+            block[COMMA] |= uint64_t{ maskAvx2(v, ',') } << shift;
+            block[OPEN] |= uint64_t{ maskAvx2(v, '[') | maskAvx2(v, '(') } << shift;
+            block[CLOSE] |= uint64_t{ maskAvx2(v, ']') | maskAvx2(v, ')') } << shift;
+            block[DOLLAR] |= uint64_t{ maskAvx2(v, '$') } << shift;
+            block[PERCENT] |= uint64_t{ maskAvx2(v, '%') } << shift;
+            block[NEWLINE] |= uint64_t{ maskAvx2(v, '\n') } << shift;
+        }
+    }
+
+    ASM_ANALYZE_TARGET("avx2") inline auto findAnyAvx2(std::string_view text, size_t from, const CharSet& set) -> size_t {
+        for (; from + 32 <= text.size(); from += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + from));
+            uint32_t mask = 0;
+            for (char c : set) { mask |= maskAvx2(v, c); }
+            if (mask != 0) { return from + static_cast<size_t>(std::countr_zero(mask)); }
+        }
+        return findAnySse2(text, from, set);
+    }
+
+    inline auto hasAvx2() -> bool {
+#ifdef _MSC_VER
+        std::array<int, 4> regs{};
+        __cpuid(regs.data(), 0);
+        if (regs[0] < 7) { return false; }
+        __cpuid(regs.data(), 1);
+        bool osxsave = (regs[2] & (1 << 27)) != 0;
+        if (!osxsave || (_xgetbv(0) & 6) != 6) { return false; }
+        __cpuidex(regs.data(), 7, 0);
+        return (regs[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    }
+#endif
+
+    /**
+      The kernels in use.
+     */
+    struct Kernels {
+        ClassifyFn classify = classifyScalar;
+        FindAnyFn findAny = findAnyScalar;
+        const char* name = "scalar";
+    };
+
+    /**
+      @return The kernels picked for this CPU (decided on first use).
+     */
+    inline auto kernels() -> const Kernels& {
+        static const Kernels selected = [] {
+            Kernels k;
+            const char* forced = std::getenv("ASM_ANALYZE_SIMD");
+            std::string_view wanted = forced == nullptr ? "" : forced;
+            if (wanted == "scalar") { return k; }
+#ifdef ASM_ANALYZE_X86
+            k = { classifySse2, findAnySse2, "sse2" };
+            if (wanted != "sse2" && hasAvx2()) {
+                k = { classifyAvx2, findAnyAvx2, "avx2" };
+            }
+#endif
+            return k;
+        }();
+        return selected;
+    }
+
+    /**
+      The class bitmaps of a stretch of text, built 64 bytes at a time.
+     */
+    class TextMap {
+    public:
+        static constexpr size_t npos = std::string_view::npos;
+
+        /**
+          Classifies a stretch of text. Only allocates when it's bigger than any before.
+         *
+          @param text The text (must stay alive while the map is queried).
+         */
+        void build(std::string_view text) {
+            length = text.size();
+            size_t count = (length + 63) / 64;
+            if (blocks.size() < count) { blocks.resize(count); }
+
+            ClassifyFn classify = kernels().classify;
+            size_t full = length / 64;
+            for (size_t b = 0; b < full; ++b) {
+                classify(text.data() + b * 64, blocks[b]);
+            }
+            if (size_t rest = length % 64; rest != 0) {
+                // the kernels read 64 bytes, don't let them run off the end of the mapping
+                std::array<char, 64> tail{};
+                std::memcpy(tail.data(), text.data() + full * 64, rest);
+                classify(tail.data(), blocks[full]);
+                uint64_t valid = (uint64_t{ 1 } << rest) - 1;
+                for (uint64_t& mask : blocks[full]) { mask &= valid; }
+            }
+        }
+
+        /**
+          @return The first position in [from, to) whose byte is in the class (or isn't, with
+                  invert), or npos.
+         */
+        [[nodiscard]] auto find(Class cls, size_t from, size_t to, bool invert = false) const -> size_t {
+            if (from >= to) { return npos; }
+            uint64_t flip = invert ? ~uint64_t{ 0 } : 0;
+            size_t b = from / 64;
+            size_t lastBlock = (to - 1) / 64;
+            uint64_t bits = (blocks[b][cls] ^ flip) & (~uint64_t{ 0 } << (from % 64));
+            for (; b < lastBlock; bits = blocks[++b][cls] ^ flip) {
+                if (bits != 0) { return b * 64 + static_cast<size_t>(std::countr_zero(bits)); }
+            }
+            bits &= ~uint64_t{ 0 } >> (63 - (to - 1) % 64);
+            return bits == 0 ? npos : b * 64 + static_cast<size_t>(std::countr_zero(bits));
+        }
+
+        /**
+          @return The last position in [from, to) whose byte isn't in the class, or npos.
+         */
+        [[nodiscard]] auto findLastNot(Class cls, size_t from, size_t to) const -> size_t {
+            if (from >= to) { return npos; }
+            size_t b = (to - 1) / 64;
+            size_t firstBlock = from / 64;
+            uint64_t bits = ~blocks[b][cls] & (~uint64_t{ 0 } >> (63 - (to - 1) % 64));
+            for (; b > firstBlock; bits = ~blocks[--b][cls]) {
+                if (bits != 0) { return b * 64 + 63 - static_cast<size_t>(std::countl_zero(bits)); }
+            }
+            bits &= ~uint64_t{ 0 } << (from % 64);
+            return bits == 0 ? npos : b * 64 + 63 - static_cast<size_t>(std::countl_zero(bits));
+        }
+
+        [[nodiscard]] auto size() const -> size_t { return length; }
+
+    private:
+        std::vector<Block> blocks;
+        size_t length = 0;
+    };
+
+    /**
+      The token-boundary bitmap of one line: a window onto a TextMap, positions are relative to
+      the start of the line.
+     */
+    class LineMap {
+    public:
+        static constexpr size_t npos = std::string_view::npos;
+
+        LineMap() = default;
+        LineMap(const TextMap& map, std::string_view line, size_t offset) : map(&map), line(line), offset(offset) {}
+
+        /**
+          @return The line itself.
+         */
+        [[nodiscard]] auto text() const -> std::string_view { return line; }
+
+        /**
+          @return The first position >= from whose byte is in the class, or npos.
+         */
+        [[nodiscard]] auto find(Class cls, size_t from = 0) const -> size_t {
+            return relative(map->find(cls, offset + from, offset + line.size()));
+        }
+
+        /**
+          @return The first position >= from whose byte isn't in the class, or npos.
+         */
+        [[nodiscard]] auto findNot(Class cls, size_t from = 0) const -> size_t {
+            return relative(map->find(cls, offset + from, offset + line.size(), true));
+        }
+
+        /**
+          @return The last position whose byte isn't in the class, or npos.
+         */
+        [[nodiscard]] auto findLastNot(Class cls) const -> size_t {
+            return relative(map->findLastNot(cls, offset, offset + line.size()));
+        }
+
+    private:
+        const TextMap* map = nullptr;
+        std::string_view line;
+        size_t offset = 0;
+
+        [[nodiscard]] auto relative(size_t pos) const -> size_t {
+            return pos == npos ? npos : pos - offset;
+        }
+    };
+
+    /**
+      Splits text into lines, classifying it a window (16 KiB by default) at a time so every byte
+      goes through the kernel exactly once and each line comes with its bitmap.
+     */
+    class LineScanner {
+    public:
+        explicit LineScanner(std::string_view text, size_t window = size_t{ 16 } << 10) : rest(text), windowSize(window) {}
+
+        /**
+          Moves to the next line.
+         *
+          @param line Receives the line and its bitmap (valid until the next call).
+          @return false once the text is exhausted.
+         */
+        auto next(LineMap& line) -> bool {
+            while (true) {
+                if (pos < current.size()) {
+                    size_t eol = map.find(NEWLINE, pos, current.size());
+                    if (eol != npos || final) {
+                        size_t end = eol == npos ? current.size() : eol;
+                        size_t length = end - pos;
+#ifdef _WIN32
+                        // match what a text mode stream would have handed us
+                        if (length != 0 && current[end - 1] == '\r') { --length; }
+#endif
+                        line = LineMap(map, current.substr(pos, length), pos);
+                        pos = end + 1;
+                        return true;
+                    }
+                } else if (final) {
+                    return false;
+                }
+                refill();
+            }
+        }
+
+    private:
+        static constexpr size_t npos = std::string_view::npos;
+
+        std::string_view rest;
+        std::string_view current;
+        TextMap map;
+        size_t windowSize;
+        size_t pos = 0;
+        bool final = false;
+
+        // classifies the next window, starting at the first line that isn't done yet
+        void refill() {
+            rest.remove_prefix(std::min(pos, current.size()));
+            size_t size = std::min(rest.size(), windowSize);
+            // a line longer than the window: grow until it fits
+            while (size < rest.size() && rest.substr(0, size).find('\n') == npos) {
+                size = std::min(rest.size(), size * 2);
+            }
+            current = rest.substr(0, size);
+            final = size == rest.size();
+            map.build(current);
+            pos = 0;
+        }
+    };
+}
\ No newline at end of file
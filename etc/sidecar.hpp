@@ -0,0 +1,297 @@
+#pragma once
+
+#include "output.hpp"
+#include "xxhash.hpp"
+#include <unordered_map>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+  Annotations kept apart from the source they describe, instead of a full annotated copy.
+
+  A sidecar holds what the annotated copy adds to the source and nothing else: the comment of
+  every line, as a 32 bit id into a table of distinct comments (most lines say the same things),
+  and the summary lines that go before some lines. Every GROUP_LINES lines the index records where
+  the group starts in the source and a hash of its bytes, so a viewer can seek to any line with one
+  lookup and a short scan, then merge source and comments lazily, checking only the groups it shows
+  against a source that may have changed since. The file is meant to be mapped (native byte order):
+
+    Header | uint32_t per line | Prefix[prefixCount] | Group[groups] | uint64_t[stringCount + 1] | string bytes
+ */
+namespace sidecar {
+    /**
+      Appended to the name of the source (the annotated copy isn't written).
+     */
+    constexpr std::string_view EXTENSION = ".ann";
+
+    /**
+      Lines per entry of the seek index.
+     */
+    constexpr uint32_t GROUP_LINES = 64;
+
+    /**
+      Id of a line without a comment.
+     */
+    constexpr uint32_t NO_STRING = 0;
+
+    /**
+      Start of a sidecar file.
+     */
+    struct Header {
+        char magic[8] = { 'a', 's', 'm', 'a', 'n', 'n', 'o', 't' };
+        uint32_t version = 1;
+        uint32_t groupLines = GROUP_LINES;
+        uint64_t lines = 0;
+        uint64_t sourceBytes = 0;
+        uint64_t prefixOffset = 0;
+        uint64_t prefixCount = 0;
+        uint64_t groupOffset = 0;
+        uint64_t stringOffset = 0;
+        uint64_t stringCount = 0;
+        uint32_t header = NO_STRING; // the information header of the annotated copy
+        uint32_t reserved = 0;
+    };
+    static_assert(sizeof(Header) == 80, "the sidecar format depends on this layout");
+
+    /**
+      Lines written before a source line (the --cfg summaries).
+     */
+    struct Prefix {
+        uint32_t line = 0;          // 1-based
+        uint32_t string = NO_STRING;
+    };
+
+    /**
+      One entry of the seek index, for lines [g * groupLines + 1, (g + 1) * groupLines].
+     */
+    struct Group {
+        uint64_t offset = 0;        // of the first line of the group in the source
+        uint64_t prefix = 0;        // index of the first prefix at or after that line
+        uint64_t hash = 0;          // xxhash64 of the group's bytes in the source
+    };
+
+    /**
+      Builds a sidecar while lines are annotated in order; only the line ids are streamed, the
+      rest (a small fraction) is kept until finish().
+     */
+    class Writer {
+    public:
+        /**
+          Starts a sidecar.
+         *
+          @param out Receives the header placeholder.
+         */
+        void begin(OutputBuffer& out) {
+            *this = Writer();
+            Header header;
+            out.append({ reinterpret_cast<const char*>(&header), sizeof(header) });
+        }
+
+        /**
+          Sets the information header shown before the first line.
+         */
+        void setHeader(std::string_view text) {
+            header = intern(text);
+        }
+
+        /**
+          Adds the next line.
+         *
+          @param offset Where the line starts in the source.
+          @param comment The comment after it (empty for none).
+          @param prefix The lines that go before it (empty for none).
+          @param out Receives the line's id.
+         */
+        void add(uint64_t offset, std::string_view comment, std::string_view prefix, OutputBuffer& out) {
+            if (lines % GROUP_LINES == 0) { groups.push_back({ offset, prefixes.size(), 0 }); }
+            ++lines;
+            // summaries name their lines, so they're hardly ever repeated and not worth looking up
+            if (!prefix.empty()) { prefixes.push_back({ static_cast<uint32_t>(lines), store(prefix) }); }
+            uint32_t id = comment.empty() ? NO_STRING : intern(comment);
+            out.append({ reinterpret_cast<const char*>(&id), sizeof(id) });
+        }
+
+        /**
+          Appends the tables and fills the header in.
+         *
+          @param source The whole source the lines came from.
+          @param out Receives the tables (the header isn't in it, see finalHeader()).
+         */
+        void finish(std::string_view source, OutputBuffer& out) {
+            uint64_t at = sizeof(Header) + lines * sizeof(uint32_t);
+            // keeps the 64 bit tables aligned in a mapped file
+            static constexpr char PADDING[8] = {};
+            out.append({ PADDING, static_cast<size_t>(-at & 7) });
+            at = (at + 7) & ~uint64_t{ 7 };
+
+            for (size_t i = 0; i < groups.size(); ++i) {
+                uint64_t end = i + 1 < groups.size() ? groups[i + 1].offset : source.size();
+                groups[i].hash = xxhash::hash64(source.substr(groups[i].offset, end - groups[i].offset));
+            }
+            done.lines = lines;
+            done.sourceBytes = source.size();
+            done.header = header;
+            done.prefixOffset = at;
+            done.prefixCount = prefixes.size();
+            out.append({ reinterpret_cast<const char*>(prefixes.data()), prefixes.size() * sizeof(Prefix) });
+            at += prefixes.size() * sizeof(Prefix);
+            done.groupOffset = at;
+            out.append({ reinterpret_cast<const char*>(groups.data()), groups.size() * sizeof(Group) });
+            at += groups.size() * sizeof(Group);
+            done.stringOffset = at;
+            done.stringCount = offsets.size();
+            offsets.push_back(bytes.size());
+            out.append({ reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t) });
+            out.append(bytes);
+        }
+
+        /**
+          @return The header to write at offset 0 once finish() ran.
+         */
+        [[nodiscard]] auto finalHeader() const -> std::string_view {
+            return { reinterpret_cast<const char*>(&done), sizeof(done) };
+        }
+
+    private:
+        uint64_t lines = 0;
+        uint32_t header = NO_STRING;
+        std::vector<Prefix> prefixes;
+        std::vector<Group> groups;
+        std::string bytes;                  // the distinct strings, back to back
+        std::vector<uint64_t> offsets;      // where each starts in bytes
+        std::unordered_map<std::string, uint32_t> ids;
+        std::string key;
+        Header done;
+
+        auto store(std::string_view text) -> uint32_t {
+            offsets.push_back(bytes.size());
+            bytes.append(text);
+            return static_cast<uint32_t>(offsets.size());
+        }
+
+        auto intern(std::string_view text) -> uint32_t {
+            key.assign(text);
+            auto [it, added] = ids.try_emplace(key, static_cast<uint32_t>(offsets.size() + 1));
+            if (added) { store(text); }
+            return it->second;
+        }
+    };
+
+    /**
+      Reads a sidecar that is mapped (or otherwise whole in memory).
+     */
+    class Reader {
+    public:
+        /**
+          Checks the layout.
+         *
+          @param data The whole sidecar, must outlive the reader.
+          @param error Receives what is wrong with it.
+          @return Whether it can be read.
+         */
+        auto open(std::string_view data, std::string& error) -> bool {
+            if (data.size() < sizeof(Header)) {
+                error = "is not a sidecar";
+                return false;
+            }
+            std::memcpy(&header, data.data(), sizeof(header));
+            if (std::memcmp(header.magic, Header().magic, sizeof(header.magic)) != 0 || header.version != 1 || header.groupLines == 0) {
+                error = "is not a sidecar of this version";
+                return false;
+            }
+            // every table has to lie inside the file, in the order they were written
+            auto fits = [&](uint64_t offset, uint64_t count, uint64_t size) {
+                return offset <= data.size() && count <= (data.size() - offset) / size;
+            };
+            if (!fits(sizeof(Header), header.lines, sizeof(uint32_t)) || !fits(header.prefixOffset, header.prefixCount, sizeof(Prefix)) ||
+                !fits(header.groupOffset, groupCount(), sizeof(Group)) || header.stringCount == UINT64_MAX ||
+                !fits(header.stringOffset, header.stringCount + 1, sizeof(uint64_t)) || header.prefixOffset % 8 != 0) {
+                error = "is truncated";
+                return false;
+            }
+            ids = reinterpret_cast<const uint32_t*>(data.data() + sizeof(Header));
+            prefixes = reinterpret_cast<const Prefix*>(data.data() + header.prefixOffset);
+            groups = reinterpret_cast<const Group*>(data.data() + header.groupOffset);
+            offsets = reinterpret_cast<const uint64_t*>(data.data() + header.stringOffset);
+            strings = data.substr(header.stringOffset + (header.stringCount + 1) * sizeof(uint64_t));
+            if (offsets[header.stringCount] > strings.size()) {
+                error = "is truncated";
+                return false;
+            }
+            return true;
+        }
+
+        [[nodiscard]] auto info() const -> const Header& { return header; }
+
+        /**
+          @return The comment of a line (1-based), empty for none.
+         */
+        [[nodiscard]] auto comment(uint64_t line) const -> std::string_view {
+            return string(ids[line - 1]);
+        }
+
+        /**
+          @return The index entry of the group holding a line (1-based).
+         */
+        [[nodiscard]] auto group(uint64_t line) const -> const Group& {
+            return groups[(line - 1) / header.groupLines];
+        }
+
+        /**
+          @return Whether the group holding a line (1-based) still has the bytes it was annotated for.
+         */
+        [[nodiscard]] auto matches(std::string_view source, uint64_t line) const -> bool {
+            uint64_t index = (line - 1) / header.groupLines;
+            uint64_t begin = groups[index].offset;
+            uint64_t end = index + 1 < groupCount() ? groups[index + 1].offset : header.sourceBytes;
+            return source.size() == header.sourceBytes && begin <= end && end <= source.size() &&
+                xxhash::hash64(source.substr(begin, end - begin)) == groups[index].hash;
+        }
+
+        /**
+          Appends a line the way the annotated copy has it: the summaries that go before it, then
+          the line and its comment.
+         *
+          @param line The line number (1-based).
+          @param text The line in the source (without its newline).
+          @param prefix Index of the next summary to look at, moved past the ones up to this line.
+          @param out Receives the line.
+         */
+        void merge(uint64_t line, std::string_view text, uint64_t& prefix, OutputBuffer& out) const {
+            for (; prefix < header.prefixCount && prefixes[prefix].line <= line; ++prefix) {
+                if (prefixes[prefix].line == line) { out.append(string(prefixes[prefix].string)); }
+            }
+            out.append(text);
+            std::string_view after = comment(line);
+            if (!after.empty()) { out.append("\t\t; ").append(after); }
+            out.push_back('\n');
+        }
+
+        /**
+          @return The string with an id (empty for NO_STRING or ids that are out of range).
+         */
+        [[nodiscard]] auto string(uint32_t id) const -> std::string_view {
+            if (id == NO_STRING || id > header.stringCount) { return {}; }
+            uint64_t begin = offsets[id - 1];
+            uint64_t end = offsets[id];
+            if (begin > end || end > strings.size()) { return {}; }
+            return strings.substr(begin, end - begin);
+        }
+
+    private:
+        Header header;
+        const uint32_t* ids = nullptr;
+        const Prefix* prefixes = nullptr;
+        const Group* groups = nullptr;
+        const uint64_t* offsets = nullptr;
+        std::string_view strings;
+
+        [[nodiscard]] auto groupCount() const -> uint64_t {
+            return (header.lines + header.groupLines - 1) / header.groupLines;
+        }
+    };
+}
\ No newline at end of file
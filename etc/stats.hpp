@@ -0,0 +1,300 @@
+#pragma once
+
+#include "opcodes.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <array>
+#include <mutex>
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define ASM_ANALYZE_TSC 1
+#endif
+
+// 0 compiles the instrumentation out entirely
+#ifndef ASM_ANALYZE_STATS
+#define ASM_ANALYZE_STATS 1
+#endif
+
+/**
+  Hot path instrumentation behind --stats.
+
+  Every thread keeps its own counters, so recording is a few adds without any synchronization.
+  Time is measured as laps: mark(phase) charges the time since the previous mark of the thread to
+  that phase, so marks only go at the ends of phases. When --stats is off each call is one
+  predictable branch, and building with ASM_ANALYZE_STATS=0 removes even that.
+ */
+namespace stats {
+    constexpr bool COMPILED = ASM_ANALYZE_STATS != 0;
+
+    /**
+      Pipeline phases timed.
+     */
+    enum Phase : uint8_t { READ, DETECT, TOKENIZE, CLASSIFY, CFG, FORMAT, WRITE, PHASE_COUNT };
+
+    /**
+      Plain counters.
+     */
+    enum Counter : uint8_t {
+        FILES, BLANK_LINES, LABELS, UNKNOWN_INSTRUCTIONS, OTHER_DIRECTIVES, BYTES_IN, BYTES_OUT, MEMO_HITS, MEMO_MISSES, MEMO_EVICTIONS, MEMO_SKIPPED,
+        INCLUDES_PARSED, INCLUDES_REUSED, INCLUDES_MISSING, COUNTER_COUNT
+    };
+
+    constexpr std::array<std::string_view, PHASE_COUNT> PHASE_NAMES = { "read", "detect", "tokenize", "classify", "cfg", "format", "write" };
+    constexpr std::array<std::string_view, COUNTER_COUNT> COUNTER_NAMES = {
+        "files", "blank_lines", "labels", "unknown_instructions", "other_directives", "bytes_in", "bytes_out", "memo_hits", "memo_misses",
+        "memo_evictions", "memo_skipped", "includes_parsed", "includes_reused", "includes_missing"
+    };
+
+    /**
+      Everything recorded by one thread (or the sum over threads).
+     */
+    struct Counters {
+        std::array<uint64_t, PHASE_COUNT> ticks{};
+        std::array<uint64_t, COUNTER_COUNT> counts{};
+        std::array<uint64_t, INSTRUCTION_COUNT> instructions{};
+        std::array<uint64_t, DIRECTIVE_COUNT> directives{};
+
+        void merge(const Counters& other) {
+            auto add = [](auto& into, const auto& from) {
+                for (size_t i = 0; i < into.size(); ++i) { into[i] += from[i]; }
+            };
+            add(ticks, other.ticks);
+            add(counts, other.counts);
+            add(instructions, other.instructions);
+            add(directives, other.directives);
+        }
+
+        /**
+          @return The number of lines seen.
+         */
+        [[nodiscard]] auto lines() const -> uint64_t {
+            uint64_t total = counts[BLANK_LINES] + counts[LABELS] + counts[UNKNOWN_INSTRUCTIONS] + counts[OTHER_DIRECTIVES];
+            for (uint64_t count : instructions) { total += count; }
+            for (uint64_t count : directives) { total += count; }
+            return total;
+        }
+    };
+
+    /**
+      Whether --stats is on (set once, before any worker starts).
+     */
+    inline bool enabled = false;
+
+    inline auto now() -> uint64_t {
+#ifdef ASM_ANALYZE_TSC
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    /**
+      Counters of finished threads and the registry of running ones.
+     */
+    class Registry {
+    public:
+        static auto get() -> Registry& {
+            static Registry registry;
+            return registry;
+        }
+
+        void add(Counters* counters) {
+            std::lock_guard<std::mutex> lock(mutex);
+            live.push_back(counters);
+        }
+
+        void retire(Counters* counters) {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.merge(*counters);
+            live.erase(std::remove(live.begin(), live.end(), counters), live.end());
+        }
+
+        /**
+          @return The sum over all threads (call it while workers are idle).
+         */
+        auto total() -> Counters {
+            std::lock_guard<std::mutex> lock(mutex);
+            Counters sum = finished;
+            for (const Counters* counters : live) { sum.merge(*counters); }
+            return sum;
+        }
+
+        uint64_t startTicks = 0;
+        std::chrono::steady_clock::time_point startTime;
+
+    private:
+        std::mutex mutex;
+        Counters finished;
+        std::vector<Counters*> live;
+    };
+
+    /**
+      The counters of the calling thread, folded into the totals when the thread ends.
+     */
+    struct Local {
+        Counters counters;
+        uint64_t last = now();
+
+        Local() { Registry::get().add(&counters); }
+        ~Local() { Registry::get().retire(&counters); }
+        Local(const Local&) = delete;
+        auto operator=(const Local&) -> Local& = delete;
+
+        static auto get() -> Local& {
+            thread_local Local local;
+            return local;
+        }
+    };
+
+    /**
+      Turns recording on (call before starting any work).
+     */
+    inline void enable() {
+        if constexpr (!COMPILED) { return; }
+        enabled = true;
+        Registry::get().startTicks = now();
+        Registry::get().startTime = std::chrono::steady_clock::now();
+    }
+
+    /**
+      Starts timing on this thread: the time since the last mark (e.g. spent idle in the thread
+      pool) isn't charged to any phase.
+     */
+    inline void start() {
+        if constexpr (COMPILED) {
+            if (enabled) { Local::get().last = now(); }
+        }
+    }
+
+    /**
+      Charges the time since the last mark (or start) of this thread to a phase.
+     */
+    inline void mark(Phase phase) {
+        if constexpr (COMPILED) {
+            if (enabled) {
+                Local& local = Local::get();
+                uint64_t tick = now();
+                local.counters.ticks[phase] += tick - local.last;
+                local.last = tick;
+            }
+        }
+    }
+
+    inline void count(Counter counter, uint64_t amount = 1) {
+        if constexpr (COMPILED) {
+            if (enabled) { Local::get().counters.counts[counter] += amount; }
+        }
+    }
+
+    inline void count(Instruction id) {
+        if constexpr (COMPILED) {
+            if (enabled) { ++Local::get().counters.instructions[static_cast<size_t>(id)]; }
+        }
+    }
+
+    inline void count(Directive id) {
+        if constexpr (COMPILED) {
+            if (enabled) {
+                if (id == Directive::NONE) {
+                    ++Local::get().counters.counts[OTHER_DIRECTIVES];
+                } else {
+                    ++Local::get().counters.directives[static_cast<size_t>(id)];
+                }
+            }
+        }
+    }
+
+    /**
+      @return Ticks per second of now(), measured over the run so far.
+     */
+    inline auto tickRate() -> double {
+        Registry& registry = Registry::get();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - registry.startTime).count();
+        uint64_t ticks = now() - registry.startTicks;
+        return seconds > 0 && ticks > 0 ? static_cast<double>(ticks) / seconds : 1e9;
+    }
+
+    /**
+      Formats a human readable report.
+     *
+      @param totals The counters to report.
+      @return The report (several lines).
+     */
+    inline auto report(const Counters& totals) -> std::string {
+        double rate = tickRate();
+        uint64_t timed = 0;
+        for (uint64_t ticks : totals.ticks) { timed += ticks; }
+
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(3) << "Statistics (thread time per phase):\n";
+        for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+            double share = timed == 0 ? 0.0 : 100.0 * static_cast<double>(totals.ticks[phase]) / static_cast<double>(timed);
+            out << "  " << std::left << std::setw(10) << PHASE_NAMES[phase] << std::right << std::setw(10)
+                << static_cast<double>(totals.ticks[phase]) / rate << "s " << std::setw(6) << std::setprecision(1) << share << "%\n"
+                << std::setprecision(3);
+        }
+        out << "  lines " << totals.lines() << ", " << totals.counts[FILES] << " file(s), "
+            << totals.counts[BYTES_IN] << " bytes in, " << totals.counts[BYTES_OUT] << " bytes out\n"
+            << "  " << totals.counts[LABELS] << " labels, " << totals.counts[BLANK_LINES] << " blank, "
+            << totals.counts[UNKNOWN_INSTRUCTIONS] << " unknown instructions, " << totals.counts[OTHER_DIRECTIVES] << " other directives\n";
+        if (uint64_t lookups = totals.counts[MEMO_HITS] + totals.counts[MEMO_MISSES]; lookups != 0) {
+            out << "  memo " << totals.counts[MEMO_HITS] << " hits, " << totals.counts[MEMO_MISSES] << " misses (" << std::setprecision(1)
+                << 100.0 * static_cast<double>(totals.counts[MEMO_HITS]) / static_cast<double>(lookups) << "% hit), "
+                << totals.counts[MEMO_EVICTIONS] << " evictions, " << totals.counts[MEMO_SKIPPED] << " lines skipped it (too few hits)\n"
+                << std::setprecision(3);
+        }
+        if (totals.counts[INCLUDES_PARSED] + totals.counts[INCLUDES_REUSED] + totals.counts[INCLUDES_MISSING] != 0) {
+            out << "  includes " << totals.counts[INCLUDES_PARSED] << " parsed, " << totals.counts[INCLUDES_REUSED] << " reused, "
+                << totals.counts[INCLUDES_MISSING] << " not found\n";
+        }
+
+        // most frequent first
+        std::vector<std::pair<uint64_t, std::string_view>> seen;
+        for (size_t i = 0; i < INSTRUCTION_COUNT; ++i) {
+            if (totals.instructions[i] != 0) { seen.emplace_back(totals.instructions[i], INSTRUCTION_NAMES[i]); }
+        }
+        for (size_t i = 0; i < DIRECTIVE_COUNT; ++i) {
+            if (totals.directives[i] != 0) { seen.emplace_back(totals.directives[i], DIRECTIVE_NAMES[i]); }
+        }
+        std::sort(seen.begin(), seen.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+        out << "  opcodes:";
+        for (const auto& [count, name] : seen) { out << ' ' << name << '=' << count; }
+        if (seen.empty()) { out << " none"; }
+        return out.str();
+    }
+
+    /**
+      Formats the same as one JSON object.
+     */
+    inline auto json(const Counters& totals) -> std::string {
+        double rate = tickRate();
+        std::ostringstream out;
+        out << std::setprecision(6) << "{\"phases\":{";
+        for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+            out << (phase == 0 ? "" : ",") << '"' << PHASE_NAMES[phase] << "\":" << static_cast<double>(totals.ticks[phase]) / rate;
+        }
+        out << "},\"counters\":{\"lines\":" << totals.lines();
+        for (size_t counter = 0; counter < COUNTER_COUNT; ++counter) {
+            out << ",\"" << COUNTER_NAMES[counter] << "\":" << totals.counts[counter];
+        }
+        out << "},\"instructions\":{";
+        for (size_t i = 0; i < INSTRUCTION_COUNT; ++i) {
+            out << (i == 0 ? "" : ",") << '"' << INSTRUCTION_NAMES[i] << "\":" << totals.instructions[i];
+        }
+        out << "},\"directives\":{";
+        for (size_t i = 0; i < DIRECTIVE_COUNT; ++i) {
+            out << (i == 0 ? "" : ",") << '"' << DIRECTIVE_NAMES[i] << "\":" << totals.directives[i];
+        }
+        out << "}}\n";
+        return out.str();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,436 @@
+#pragma once
+
+#include "output.hpp"
+#include "xxhash.hpp"
+#include <string_view>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <array>
+
+/**
+  Every symbol of a file, where it's defined and where it's used.
+
+  Names are interned as they're met into a table of dense ids: one arena holds the names back to
+  back and an open addressing table, at most half full, maps a name's hash to its id, so a lookup
+  is a hash and about one probe however many symbols there are. Definitions and uses are recorded
+  by id during the pass that annotates the lines, and written out grouped by symbol in an index
+  meant to be mapped (native byte order):
+
+    Header | Symbol[symbolCount + 1] | Bucket[bucketCount] | uint32_t[definitionCount] | Use[useCount] | name bytes
+
+  A symbol's definitions (their lines) and uses run from where its own start to where the next
+  symbol's do, the last Symbol only marks where the last ranges end.
+
+  The buckets are the table itself, so a reader looks names up as soon as the file is mapped,
+  without building anything.
+ */
+namespace symbols {
+    /**
+      Appended to the name of the annotated copy.
+     */
+    constexpr std::string_view EXTENSION = ".xref";
+
+    /**
+      Id of no symbol (an empty bucket, a use outside of any function).
+     */
+    constexpr uint32_t NONE = UINT32_MAX;
+
+    /**
+      What a symbol is, or-ed together.
+     */
+    enum Flags : uint32_t {
+        LABEL = 1,          // defined by a label
+        CONSTANT = 2,       // defined by .equ, .set or NASM's equ
+        COMMON = 4,         // defined by .comm
+        INCLUDED = 8,       // defined by an included file (--includes)
+        GLOBAL = 16,        // declared by .globl, .global, .weak or global
+        EXTERNAL = 32,      // declared by .extern or extern
+        DEFINED = LABEL | CONSTANT | COMMON | INCLUDED
+    };
+
+    /**
+      How a symbol is used.
+     */
+    enum class UseKind : uint32_t { CALL, JUMP, BRANCH, REFERENCE };
+
+    constexpr std::array<std::string_view, 4> USE_KIND_NAMES = { "call", "jump", "branch", "reference" };
+
+    /**
+      Start of an index file.
+     */
+    struct Header {
+        char magic[8] = { 'a', 's', 'm', 'x', 'r', 'e', 'f', 's' };
+        uint32_t version = 1;
+        uint32_t reserved = 0;
+        uint64_t sourceBytes = 0;
+        uint64_t sourceHash = 0;    // xxhash64 of the source
+        uint64_t symbolCount = 0;
+        uint64_t bucketCount = 0;   // a power of two
+        uint64_t definitionCount = 0;
+        uint64_t useCount = 0;
+        uint64_t nameBytes = 0;
+    };
+    static_assert(sizeof(Header) == 72, "the index format depends on this layout");
+
+    /**
+      A symbol, with where its definitions and uses start in the tables that follow.
+     */
+    struct Symbol {
+        uint32_t name = 0;          // offset in the name bytes
+        uint32_t length = 0;
+        uint32_t flags = 0;
+        uint32_t firstDefinition = 0;
+        uint32_t firstUse = 0;
+    };
+
+    /**
+      Where a symbol is, with the low half of its hash: most other symbols are skipped without
+      comparing names.
+     */
+    struct Bucket {
+        uint32_t low = 0;
+        uint32_t id = NONE;
+    };
+
+    /**
+      Where a symbol is used: the line (1-based) with the kind in its top two bits, and the
+      function (the last label that isn't local) it's in.
+     */
+    struct Use {
+        static constexpr uint32_t LINE_BITS = 30;
+
+        uint32_t at = 0;
+        uint32_t from = NONE;
+
+        Use() = default;
+        Use(uint32_t line, uint32_t function, UseKind kind) : at(line | static_cast<uint32_t>(kind) << LINE_BITS), from(function) {}
+
+        [[nodiscard]] auto line() const -> uint32_t { return at & ((uint32_t{ 1 } << LINE_BITS) - 1); }
+        [[nodiscard]] auto kind() const -> UseKind { return static_cast<UseKind>(at >> LINE_BITS); }
+    };
+
+    /**
+      @return The hash a name is looked up by.
+     */
+    inline auto hash(std::string_view name) -> uint64_t {
+        return xxhash::hash64(name);
+    }
+
+    /**
+      @return Whether a label only matters in the function it's in (.L3, 1), rather than naming one.
+     */
+    inline auto isLocal(std::string_view name) -> bool {
+        return name.empty() || name[0] == '.' || (name[0] >= '0' && name[0] <= '9');
+    }
+
+    /**
+      @return Whether a label is one of those compilers put around functions and scopes for the
+      unwind and debug tables (.LFB0, .LFE0, .LCOLDB3, .LVL12), which the assembler refers to
+      without naming them.
+     */
+    inline auto isMarker(std::string_view name) -> bool {
+        static constexpr std::array<std::string_view, 12> PREFIXES = { ".LFB", ".LFE", ".LFSB", ".LCOLDB", ".LCOLDE", ".LHOTB", ".LHOTE", ".LVL",
+            ".LBB", ".LBE", ".LBI", ".LVU" };
+        return std::any_of(PREFIXES.begin(), PREFIXES.end(), [&](std::string_view prefix) {
+            return name.size() > prefix.size() && name.substr(0, prefix.size()) == prefix && name[prefix.size()] >= '0' && name[prefix.size()] <= '9';
+        });
+    }
+
+    /**
+      Interned names.
+     */
+    class Table {
+    public:
+        /**
+          @return The id of a name, given one if it had none.
+         */
+        auto intern(std::string_view name) -> uint32_t {
+            uint64_t h = hash(name);
+            if ((hashes.size() + 1) * 2 > buckets.size()) { grow(); }
+            size_t at = h & mask;
+            for (; buckets[at].id != NONE; at = (at + 1) & mask) {
+                if (buckets[at].low == static_cast<uint32_t>(h) && this->name(buckets[at].id) == name) { return buckets[at].id; }
+            }
+            auto id = static_cast<uint32_t>(hashes.size());
+            buckets[at] = { static_cast<uint32_t>(h), id };
+            hashes.push_back(h);
+            names.append(name);
+            starts.push_back(static_cast<uint32_t>(names.size()));
+            return id;
+        }
+
+        /**
+          @return The id of a name, NONE if it has none.
+         */
+        [[nodiscard]] auto find(std::string_view name) const -> uint32_t {
+            if (buckets.empty()) { return NONE; }
+            uint64_t h = hash(name);
+            for (size_t at = h & mask; buckets[at].id != NONE; at = (at + 1) & mask) {
+                if (buckets[at].low == static_cast<uint32_t>(h) && this->name(buckets[at].id) == name) { return buckets[at].id; }
+            }
+            return NONE;
+        }
+
+        [[nodiscard]] auto name(uint32_t id) const -> std::string_view {
+            return std::string_view(names).substr(starts[id], starts[id + 1] - starts[id]);
+        }
+
+        [[nodiscard]] auto size() const -> size_t { return hashes.size(); }
+
+        [[nodiscard]] auto table() const -> const std::vector<Bucket>& { return buckets; }
+        [[nodiscard]] auto bytes() const -> std::string_view { return names; }
+        [[nodiscard]] auto start(uint32_t id) const -> uint32_t { return starts[id]; }
+
+    private:
+        std::string names;                      // back to back, by id
+        std::vector<uint32_t> starts{ 0 };      // where each name starts, then where the last one ends
+        std::vector<uint64_t> hashes;           // by id, so growing doesn't hash the names again
+        std::vector<Bucket> buckets;
+        size_t mask = 0;
+
+        void grow() {
+            size_t size = std::max<size_t>(buckets.size() * 2, 64);
+            buckets.assign(size, Bucket{});
+            mask = size - 1;
+            for (size_t id = 0; id < hashes.size(); ++id) {
+                size_t at = hashes[id] & mask;
+                while (buckets[at].id != NONE) { at = (at + 1) & mask; }
+                buckets[at] = { static_cast<uint32_t>(hashes[id]), static_cast<uint32_t>(id) };
+            }
+        }
+    };
+
+    /**
+      Collects the definitions and uses of a file's symbols while its lines are annotated in
+      order, and writes them out as an index.
+     */
+    class Index {
+    public:
+        /**
+          Records a definition.
+         *
+          @param name The symbol.
+          @param flag What defines it (LABEL, CONSTANT, COMMON or INCLUDED).
+          @param line Where (1-based), 0 for a definition outside of the file.
+          @return The symbol's id.
+         */
+        auto define(std::string_view name, uint32_t flag, uint32_t line) -> uint32_t {
+            uint32_t id = declare(name, flag);
+            if (line != 0) { definitions.push_back({ id, line }); }
+            return id;
+        }
+
+        /**
+          Records what a symbol is declared as (GLOBAL, EXTERNAL), or that it's defined elsewhere.
+         *
+          @return The symbol's id.
+         */
+        auto declare(std::string_view name, uint32_t flag) -> uint32_t {
+            uint32_t id = names.intern(name);
+            if (id == flags.size()) {
+                flags.push_back(flag);
+            } else if (flag != 0) {
+                flags[id] |= flag; // uses don't touch the flags
+            }
+            return id;
+        }
+
+        /**
+          Records a use.
+         *
+          @param name The symbol.
+          @param use Where and how.
+         */
+        void use(std::string_view name, Use use) {
+            uses.push_back({ declare(name, 0), use });
+        }
+
+        /**
+          Remembers the source the index describes, to tell when it changed.
+         */
+        void finish(std::string_view source) {
+            sourceBytes = source.size();
+            sourceHash = xxhash::hash64(source);
+        }
+
+        /**
+          Writes the index, definitions and uses grouped by symbol in the order they were met.
+         *
+          @param out Receives the whole file.
+         */
+        void write(OutputBuffer& out) const {
+            size_t count = names.size();
+            std::vector<Symbol> table(count + 1);
+            for (size_t id = 0; id < count; ++id) {
+                table[id].name = names.start(static_cast<uint32_t>(id));
+                table[id].length = static_cast<uint32_t>(names.name(static_cast<uint32_t>(id)).size());
+                table[id].flags = flags[id];
+            }
+            // counting sort by symbol, which keeps every symbol's entries in line order: counted
+            // one slot ahead, summed, then every entry goes where its symbol's next one is
+            for (const auto& definition : definitions) { ++table[definition.id + 1].firstDefinition; }
+            for (const auto& use : uses) { ++table[use.id + 1].firstUse; }
+            for (size_t id = 1; id <= count; ++id) {
+                table[id].firstDefinition += table[id - 1].firstDefinition;
+                table[id].firstUse += table[id - 1].firstUse;
+            }
+            std::vector<uint32_t> lines(definitions.size());
+            std::vector<Use> used(uses.size());
+            std::vector<uint32_t> next(count);
+            for (size_t id = 0; id < count; ++id) { next[id] = table[id].firstDefinition; }
+            for (const auto& definition : definitions) { lines[next[definition.id]++] = definition.line; }
+            for (size_t id = 0; id < count; ++id) { next[id] = table[id].firstUse; }
+            for (const auto& use : uses) { used[next[use.id]++] = use.use; }
+
+            Header header;
+            header.sourceBytes = sourceBytes;
+            header.sourceHash = sourceHash;
+            header.symbolCount = count;
+            header.bucketCount = names.table().size();
+            header.definitionCount = lines.size();
+            header.useCount = used.size();
+            header.nameBytes = names.bytes().size();
+            auto append = [&](const void* data, size_t size) { out.append({ static_cast<const char*>(data), size }); };
+            append(&header, sizeof(header));
+            append(table.data(), table.size() * sizeof(Symbol));
+            append(names.table().data(), names.table().size() * sizeof(Bucket));
+            append(lines.data(), lines.size() * sizeof(uint32_t));
+            append(used.data(), used.size() * sizeof(Use));
+            out.append(names.bytes());
+        }
+
+    private:
+        struct Definition {
+            uint32_t id;
+            uint32_t line;
+        };
+        struct PendingUse {
+            uint32_t id;
+            Use use;
+        };
+
+        Table names;
+        std::vector<uint32_t> flags; // by id
+        std::vector<Definition> definitions;
+        std::vector<PendingUse> uses;
+        uint64_t sourceBytes = 0;
+        uint64_t sourceHash = 0;
+    };
+
+    /**
+      Reads an index that is mapped (or otherwise whole in memory).
+     */
+    class Reader {
+    public:
+        /**
+          Checks the layout.
+         *
+          @param data The whole index, must outlive the reader.
+          @param error Receives what is wrong with it.
+          @return Whether it can be read.
+         */
+        auto open(std::string_view data, std::string& error) -> bool {
+            if (data.size() < sizeof(Header)) {
+                error = "is not a symbol index";
+                return false;
+            }
+            std::memcpy(&header, data.data(), sizeof(header));
+            if (std::memcmp(header.magic, Header().magic, sizeof(header.magic)) != 0 || header.version != 1 ||
+                (header.bucketCount & (header.bucketCount - 1)) != 0 || header.symbolCount * 2 > header.bucketCount) {
+                error = "is not a symbol index of this version";
+                return false;
+            }
+            // the tables follow each other, every one has to fit
+            uint64_t at = sizeof(Header);
+            auto take = [&](uint64_t count, uint64_t size) {
+                if (at > data.size() || count > (data.size() - at) / size) { return false; }
+                at += count * size;
+                return true;
+            };
+            if (header.symbolCount == UINT64_MAX || !take(header.symbolCount + 1, sizeof(Symbol)) || !take(header.bucketCount, sizeof(Bucket)) ||
+                !take(header.definitionCount, sizeof(uint32_t)) || !take(header.useCount, sizeof(Use)) || !take(header.nameBytes, 1)) {
+                error = "is truncated";
+                return false;
+            }
+            const char* base = data.data() + sizeof(Header);
+            symbols = reinterpret_cast<const Symbol*>(base);
+            buckets = reinterpret_cast<const Bucket*>(symbols + header.symbolCount + 1);
+            lines = reinterpret_cast<const uint32_t*>(buckets + header.bucketCount);
+            uses = reinterpret_cast<const Use*>(lines + header.definitionCount);
+            names = std::string_view(reinterpret_cast<const char*>(uses + header.useCount), header.nameBytes);
+            return true;
+        }
+
+        [[nodiscard]] auto info() const -> const Header& { return header; }
+
+        /**
+          @return The id of a name, NONE if the file has no such symbol.
+         */
+        [[nodiscard]] auto find(std::string_view name) const -> uint32_t {
+            if (header.bucketCount == 0) { return NONE; }
+            uint64_t h = hash(name);
+            uint64_t mask = header.bucketCount - 1;
+            for (uint64_t at = h & mask, probes = 0; buckets[at].id != NONE && probes < header.bucketCount; at = (at + 1) & mask, ++probes) {
+                if (buckets[at].low == static_cast<uint32_t>(h) && buckets[at].id < header.symbolCount && this->name(buckets[at].id) == name) {
+                    return buckets[at].id;
+                }
+            }
+            return NONE;
+        }
+
+        [[nodiscard]] auto symbol(uint32_t id) const -> const Symbol& { return symbols[id]; }
+
+        /**
+          @return The name of a symbol (empty when it's out of range).
+         */
+        [[nodiscard]] auto name(uint32_t id) const -> std::string_view {
+            const Symbol& symbol = symbols[id];
+            if (symbol.name > names.size() || symbol.length > names.size() - symbol.name) { return {}; }
+            return names.substr(symbol.name, symbol.length);
+        }
+
+        /**
+          @return How many definitions of a symbol there are (0 when they're out of range).
+         */
+        [[nodiscard]] auto definitions(uint32_t id) const -> uint32_t {
+            uint32_t first = symbols[id].firstDefinition;
+            uint32_t end = symbols[id + 1].firstDefinition;
+            return first <= end && end <= header.definitionCount ? end - first : 0;
+        }
+
+        /**
+          @return The line of one of a symbol's definitions, in line order.
+         */
+        [[nodiscard]] auto definition(uint32_t id, uint32_t index) const -> uint32_t {
+            return lines[symbols[id].firstDefinition + index];
+        }
+
+        /**
+          @return How many uses of a symbol there are (0 when they're out of range).
+         */
+        [[nodiscard]] auto useCount(uint32_t id) const -> uint32_t {
+            uint32_t first = symbols[id].firstUse;
+            uint32_t end = symbols[id + 1].firstUse;
+            return first <= end && end <= header.useCount ? end - first : 0;
+        }
+
+        /**
+          @return One of a symbol's uses, in line order.
+         */
+        [[nodiscard]] auto use(uint32_t id, uint32_t index) const -> const Use& {
+            return uses[symbols[id].firstUse + index];
+        }
+
+    private:
+        Header header;
+        const Symbol* symbols = nullptr;
+        const Bucket* buckets = nullptr;
+        const uint32_t* lines = nullptr;
+        const Use* uses = nullptr;
+        std::string_view names;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// 0 leaves io_uring out, multi-file runs then always use blocking reads on the workers
+#ifndef ASM_ANALYZE_URING
+#define ASM_ANALYZE_URING 1
+#endif
+
+#if ASM_ANALYZE_URING && defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+
+// IORING_FEAT_RW_CUR_POS came with the 5.6 headers, the first to have every opcode used here
+#ifdef IORING_FEAT_RW_CUR_POS
+#define ASM_ANALYZE_HAS_URING 1
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+#else
+#define ASM_ANALYZE_HAS_URING 0
+#endif
+
+/**
+  A minimal io_uring (Linux 5.6 and later), through the raw system calls.
+
+  Requests are queued in a submission ring shared with the kernel and handed over in batches by
+  one io_uring_enter call; their results come back in a completion ring, tagged with the 64 bits
+  of user data they were queued with. Many opens, reads, writes and closes can be in flight at
+  once without a thread blocking on each of them. The rings aren't synchronized: one thread reaps
+  completions, queuing (and submit) must be serialized by the caller.
+ */
+namespace uring {
+    /**
+      Whether this build can use io_uring at all (the kernel may still refuse it).
+     */
+    constexpr bool COMPILED = ASM_ANALYZE_HAS_URING != 0;
+
+#if ASM_ANALYZE_HAS_URING
+    class Ring {
+    public:
+        Ring() = default;
+        Ring(const Ring&) = delete;
+        auto operator=(const Ring&) -> Ring& = delete;
+
+        ~Ring() {
+            close();
+        }
+
+        /**
+          Sets up the rings.
+         *
+          @param entries Submission queue size (the kernel rounds it up to a power of two, the
+          completion queue gets twice as many).
+          @param error Receives the reason the kernel refused.
+          @return Whether the ring is usable: set up, and every opcode used here supported.
+         */
+        auto open(unsigned entries, std::string& error) -> bool {
+            close();
+            io_uring_params params{};
+            fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+            if (fd < 0) {
+                error = std::string("io_uring_setup failed: ") + std::strerror(errno);
+                return false;
+            }
+
+            sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single) { sqSize = cqSize = std::max(sqSize, cqSize); }
+            sqRing = ::mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            cqRing = single ? sqRing : ::mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            void* sqesMap = ::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqesMap == MAP_FAILED) {
+                error = std::string("Cannot map the io_uring rings: ") + std::strerror(errno);
+                if (sqRing == MAP_FAILED) { sqRing = nullptr; }
+                if (cqRing == MAP_FAILED) { cqRing = nullptr; }
+                if (sqesMap != MAP_FAILED) { ::munmap(sqesMap, sqesSize); }
+                close();
+                return false;
+            }
+
+            auto* sq = static_cast<char*>(sqRing);
+            auto* cq = static_cast<char*>(cqRing);
+            sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+            sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            sqEntries = params.sq_entries;
+            sqes = static_cast<io_uring_sqe*>(sqesMap);
+            cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            queued = 0;
+
+            if (!supported(error)) {
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        void close() {
+            if (sqes != nullptr) { ::munmap(sqes, sqesSize); }
+            if (cqRing != nullptr && cqRing != sqRing) { ::munmap(cqRing, cqSize); }
+            if (sqRing != nullptr) { ::munmap(sqRing, sqSize); }
+            if (fd >= 0) { ::close(fd); }
+            sqes = nullptr;
+            sqRing = cqRing = nullptr;
+            fd = -1;
+        }
+
+        /**
+          Queues an openat(AT_FDCWD, path, flags, mode), the result is the descriptor.
+         *
+          @param path Must stay valid until the request is submitted.
+         */
+        void openAt(const char* path, int flags, unsigned mode, uint64_t data) {
+            io_uring_sqe& sqe = next(IORING_OP_OPENAT, AT_FDCWD, data);
+            sqe.addr = reinterpret_cast<uintptr_t>(path);
+            sqe.open_flags = static_cast<uint32_t>(flags);
+            sqe.len = mode;
+        }
+
+        /**
+          Queues a pread, the result is the number of bytes read.
+         */
+        void read(int file, char* buffer, uint32_t length, uint64_t offset, uint64_t data) {
+            io_uring_sqe& sqe = next(IORING_OP_READ, file, data);
+            sqe.addr = reinterpret_cast<uintptr_t>(buffer);
+            sqe.len = length;
+            sqe.off = offset;
+        }
+
+        /**
+          Queues a pwrite, the result is the number of bytes written.
+         */
+        void write(int file, const char* buffer, uint32_t length, uint64_t offset, uint64_t data) {
+            io_uring_sqe& sqe = next(IORING_OP_WRITE, file, data);
+            sqe.addr = reinterpret_cast<uintptr_t>(buffer);
+            sqe.len = length;
+            sqe.off = offset;
+        }
+
+        /**
+          Queues a close of a descriptor.
+         */
+        void closeFile(int file, uint64_t data) {
+            next(IORING_OP_CLOSE, file, data);
+        }
+
+        /**
+          Queues a request that does nothing but complete (to wake the thread reaping completions).
+         */
+        void nop(uint64_t data) {
+            next(IORING_OP_NOP, -1, data);
+        }
+
+        /**
+          Hands the queued requests to the kernel.
+         *
+          @return Whether the kernel took them.
+         */
+        auto submit() -> bool {
+            return enter(0);
+        }
+
+        /**
+          Blocks until at least one completion is waiting (doesn't submit anything, so it may run
+          alongside submit() on another thread).
+         */
+        auto wait() -> bool {
+            while (std::atomic_ref<unsigned>(*cqHead).load(std::memory_order_relaxed) == std::atomic_ref<unsigned>(*cqTail).load(std::memory_order_acquire)) {
+                if (::syscall(__NR_io_uring_enter, fd, 0U, 1U, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) { return false; }
+            }
+            return true;
+        }
+
+        /**
+          Calls f(data, result) for every waiting completion (result is negative errno on failure).
+         *
+          @return How many there were.
+         */
+        template <typename F>
+        auto reap(F&& f) -> size_t {
+            std::atomic_ref<unsigned> head(*cqHead);
+            unsigned at = head.load(std::memory_order_relaxed);
+            unsigned end = std::atomic_ref<unsigned>(*cqTail).load(std::memory_order_acquire);
+            size_t count = 0;
+            for (; at != end; ++at, ++count) {
+                const io_uring_cqe& cqe = cqes[at & cqMask];
+                uint64_t data = cqe.user_data;
+                int32_t result = cqe.res;
+                // the slot is the kernel's again once the head moves past it
+                head.store(at + 1, std::memory_order_release);
+                f(data, result);
+            }
+            return count;
+        }
+
+    private:
+        int fd = -1;
+        void* sqRing = nullptr;
+        void* cqRing = nullptr;
+        size_t sqSize = 0;
+        size_t cqSize = 0;
+        size_t sqesSize = 0;
+        unsigned* sqHead = nullptr;
+        unsigned* sqTail = nullptr;
+        unsigned* sqArray = nullptr;
+        unsigned sqMask = 0;
+        unsigned sqEntries = 0;
+        io_uring_sqe* sqes = nullptr;
+        unsigned* cqHead = nullptr;
+        unsigned* cqTail = nullptr;
+        unsigned cqMask = 0;
+        io_uring_cqe* cqes = nullptr;
+        unsigned queued = 0; // queued since the last submit
+
+        // a cleared submission entry, submitting what's queued first when the ring is full
+        auto next(uint8_t opcode, int file, uint64_t data) -> io_uring_sqe& {
+            unsigned tail = *sqTail;
+            while (tail - std::atomic_ref<unsigned>(*sqHead).load(std::memory_order_acquire) >= sqEntries) { enter(0); }
+            unsigned index = tail & sqMask;
+            io_uring_sqe& sqe = sqes[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = opcode;
+            sqe.fd = file;
+            sqe.user_data = data;
+            sqArray[index] = index;
+            std::atomic_ref<unsigned>(*sqTail).store(tail + 1, std::memory_order_release);
+            ++queued;
+            return sqe;
+        }
+
+        auto enter(unsigned wait) -> bool {
+            while (queued != 0 || wait != 0) {
+                long taken = ::syscall(__NR_io_uring_enter, fd, queued, wait, wait != 0 ? IORING_ENTER_GETEVENTS : 0U, nullptr, 0);
+                if (taken < 0) {
+                    if (errno == EINTR) { continue; }
+                    // the completion queue is full: its reaper has to catch up, which it does on its own thread
+                    if (errno == EBUSY || errno == EAGAIN) { return true; }
+                    return false;
+                }
+                queued -= static_cast<unsigned>(taken);
+                wait = 0;
+            }
+            return true;
+        }
+
+        // 5.1 to 5.5 kernels have the ring but not open, read, write or close requests
+        auto supported(std::string& error) -> bool {
+            std::vector<char> storage(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+            auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+            if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+                error = std::string("io_uring can't be probed: ") + std::strerror(errno);
+                return false;
+            }
+            for (uint8_t opcode : { IORING_OP_NOP, IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE }) {
+                if (opcode > probe->last_op || (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) == 0) {
+                    error = "io_uring lacks file requests (a kernel before 5.6)";
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string_view>
+#include <cstdint>
+#include <bit>
+
+/**
+  XXH64, a fast non-cryptographic hash (https://github.com/Cyan4973/xxHash).
+
+  Used to key cached results by file content, it hashes at several GB/s so checking the cache costs
+  a fraction of analyzing the file again.
+ */
+namespace xxhash {
+    constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+    constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+    // little endian loads, compilers turn these into a single (unaligned) load
+    inline auto read64(const char* data) -> uint64_t {
+        uint64_t value = 0;
+        for (unsigned i = 0; i < 8; ++i) { value |= uint64_t{ static_cast<unsigned char>(data[i]) } << (i * 8); }
+        return value;
+    }
+
+    inline auto read32(const char* data) -> uint64_t {
+        uint64_t value = 0;
+        for (unsigned i = 0; i < 4; ++i) { value |= uint64_t{ static_cast<unsigned char>(data[i]) } << (i * 8); }
+        return value;
+    }
+
+    inline auto round(uint64_t acc, uint64_t input) -> uint64_t {
+        acc += input * PRIME2;
+        return std::rotl(acc, 31) * PRIME1;
+    }
+
+    inline auto merge(uint64_t acc, uint64_t value) -> uint64_t {
+        acc ^= round(0, value);
+        return acc * PRIME1 + PRIME4;
+    }
+
+    /**
+      Hashes a block of memory.
+     *
+      @param data The bytes to hash.
+      @param seed Seed, different seeds give unrelated hashes.
+      @return The 64 bit hash.
+     */
+    inline auto hash64(std::string_view data, uint64_t seed = 0) -> uint64_t {
+        const char* p = data.data();
+        const char* end = p + data.size();
+        uint64_t h = 0;
+
+        if (data.size() >= 32) {
+            uint64_t v1 = seed + PRIME1 + PRIME2;
+            uint64_t v2 = seed + PRIME2;
+            uint64_t v3 = seed;
+            uint64_t v4 = seed - PRIME1;
+            for (; end - p >= 32; p += 32) {
+                v1 = round(v1, read64(p));
+                v2 = round(v2, read64(p + 8));
+                v3 = round(v3, read64(p + 16));
+                v4 = round(v4, read64(p + 24));
+            }
+            h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+            h = merge(h, v1);
+            h = merge(h, v2);
+            h = merge(h, v3);
+            h = merge(h, v4);
+        } else {
+            h = seed + PRIME5;
+        }
+        h += data.size();
+
+        for (; end - p >= 8; p += 8) {
+            h ^= round(0, read64(p));
+            h = std::rotl(h, 27) * PRIME1 + PRIME4;
+        }
+        if (end - p >= 4) {
+            h ^= read32(p) * PRIME1;
+            h = std::rotl(h, 23) * PRIME2 + PRIME3;
+            p += 4;
+        }
+        for (; p < end; ++p) {
+            h ^= static_cast<unsigned char>(*p) * PRIME5;
+            h = std::rotl(h, 11) * PRIME1;
+        }
+
+        h ^= h >> 33;
+        h *= PRIME2;
+        h ^= h >> 29;
+        h *= PRIME3;
+        h ^= h >> 32;
+        return h;
+    }
+}
\ No newline at end of file
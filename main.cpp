@@ -10,11 +10,7 @@ const static std::unordered_set<std::string> supportedExtensions = { // no .lst
     "asm", "s", "hla", "inc", "palx", "mid"
 };
 
-const static std::string VERSION = "0.1.0"; // it's better to store this as a string, rather than a double
-const static std::string filename;
-constexpr static int EIGHT = 8;
-
-auto main() -> int {
+auto main(int argc, char** argv) -> int {
 #ifdef _WIN32
     // prepare console
     HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
@@ -23,381 +19,297 @@ auto main() -> int {
     dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
     SetConsoleMode(hConsole, dwMode);
 #endif
-    std::cout << "Enter assembly file/directory (e.g. file.asm or /path/to/file.asm): ";
-    std::string filename;
-    std::getline(std::cin, filename);
-    if (filename.empty() || filename.find_first_not_of(" \t\r\f\v") == std::string::npos) {
-        dbg::Misc::fexit("You can't do that :3");
+    Options options = Options::parse(argc, argv);
+    if (!options.error.empty()) {
+        dbg::Macros::error(options.error);
+        std::cerr << Options::usage();
+        return 2;
     }
-
-    // Convert to uppercase for path checking
-    std::string ufilename = filename;
-    std::transform(ufilename.begin(), ufilename.end(), ufilename.begin(), ::toupper);
-
-    size_t pos = 0;
-    while ((pos = ufilename.find('/')) != std::string::npos) {
-        std::string part = ufilename.substr(0, pos);
-        if (forbidden.count(part) > 0) {
-            dbg::Misc::fexit("You can't do that :3");
-        }
-        ufilename.erase(0, pos + 1);
+    if (options.help) {
+        std::cout << Options::usage();
+        return 0;
     }
-
-    // Remove the file extension & check whether file type is supported or not
-    size_t dotPos = filename.find_last_of('.');
-    std::string extension;
-    if (dotPos != std::string::npos) {
-        extension = filename.substr(dotPos + 1);
-        for (char& c : extension) {
-            c = static_cast<char>(tolower(c));
-        }
-        if (supportedExtensions.count(extension) == 0U) {
-            dbg::Misc::fexit("You can't do that :3");
-        }
-        ufilename.erase(dotPos);
+    if (options.version) {
+        std::cout << "asm-analyze " << VERSION << '\n';
+        return 0;
     }
 
-    // Check the remaining part of the file name
-    if (forbidden.count(ufilename) > 0) {
-        dbg::Misc::fexit("You can't do that :3");
+    if (options.stats) {
+        if (!stats::COMPILED) { dbg::Macros::warn("--stats is unavailable, this build has ASM_ANALYZE_STATS=0"); }
+        stats::enable();
     }
 
-    auto begin = std::chrono::high_resolution_clock::now();
-
-    std::ifstream originalFile(filename);
-    if (!originalFile) {
-        dbg::Misc::fexit("File not found!");
+    if (options.daemon) {
+        return runDaemon(options);
     }
 
-    std::string nfilename = filename;
-    if (dotPos != std::string::npos) {
-        nfilename.insert(dotPos, "_analyzed");
-    }
-    else {
-        nfilename += "_analyzed";
-    }
-    std::ofstream newFile(nfilename);
-    if (!newFile) {
-        dbg::Misc::fexit("Cannot open " + nfilename + ", exiting.");
+    if (options.view) {
+        // stdout carries the merged text
+        dbg::Debugger::redirect(std::cerr);
+        OutputFile output;
+        output.attach(1);
+        FileResult result = viewFile(options.paths.front(), options, output);
+        if (!result.ok) {
+            dbg::Macros::error(options.paths.front() + ": " + result.error);
+            return 1;
+        }
+        return 0;
     }
 
-    std::string architecture = getArchitecture(filename);
-
-    newFile << "; INFORMATION:" << '\n';
-    newFile << "; \tAssembly Analyzer Version: " << VERSION << '\n';
-    auto now = std::chrono::system_clock::now();
-    std::time_t currentTime = std::chrono::system_clock::to_time_t(now);
-    struct tm localTime {};
-#ifdef _WIN32
-    localtime_s(&localTime, &currentTime);
-#else
-    localtime_r(&currentTime, &localTime);
-#endif
-    newFile << "; \tAnalyzed on: " << std::put_time(&localTime, "%Y-%m-%d %H:%M:%S") << '\n';
-    newFile << "; \tInstruction Set Architecture: " << architecture << '\n' << '\n';
-
-    std::string line;
-    while (getline(originalFile, line)) {
-        std::string comment = analyzeLine(line);
-        newFile << line << (comment.empty() ? "\n" : "\t\t; " + comment + "\n");
+    if (options.lookup) {
+        // stdout carries the matches, one per line
+        dbg::Debugger::redirect(std::cerr);
+        OutputFile output;
+        output.attach(1);
+        size_t matches = 0;
+        size_t failed = 0;
+        for (const std::string& path : options.paths) {
+            FileResult result = queryXref(path, options, output);
+            if (!result.ok) {
+                dbg::Macros::error(path + ": " + result.error);
+                ++failed;
+            }
+            matches += result.lines;
+        }
+        if (!options.quiet) { dbg::Macros::info(std::to_string(matches) + " match(es) in " + std::to_string(options.paths.size()) + " file(s)"); }
+        return failed == 0 ? 0 : 1;
     }
 
-    originalFile.close();
-    newFile.close();
-
-    auto delta = std::chrono::high_resolution_clock::now() - begin;
-    dbg::Macros::info("Successfully analyzed " + filename + " in " + std::to_string(std::chrono::duration<double>(delta).count()) + "s");
-    dbg::Misc::prefexit();
-
-    return 0;
-}
-
-auto isDirective(const std::string& opcode) -> bool {
-    return !opcode.empty() && opcode[0] == '.';
-}
-
-auto isMemoryAddressingMode(const std::string& operand) -> bool {
-    return !operand.empty() && operand[0] == '[' && operand.back() == ']' && operand.find('%') != std::string::npos;
-}
-
-auto getOperand(const std::string& line) -> std::string {
-    size_t wPos = line.find(' ');
-    if (wPos == std::string::npos) {
-        return "";
+    if (options.filter) {
+        // stdout carries the annotated text
+        dbg::Debugger::redirect(std::cerr);
+        if (!loadProfiles(options)) { return 1; }
+        OutputFile output;
+        output.attach(1);
+        FileResult result = analyzeStream(0, options, output);
+        if (!result.ok) {
+            dbg::Macros::error("-: " + result.error);
+            return 1;
+        }
+        if (!options.quiet) {
+            dbg::Macros::info("Analyzed " + std::to_string(result.lines) + " lines from stdin in " + std::to_string(result.seconds) + "s");
+        }
+        reportStats(options);
+        return 0;
     }
 
-    std::string operand = line.substr(wPos + 1);
-    size_t trailingWPos = operand.find_last_not_of(' ');
-    if (trailingWPos != std::string::npos) {
-        operand = operand.substr(0, trailingWPos + 1);
+    if (!loadProfiles(options)) { return 1; }
+    auto begin = std::chrono::steady_clock::now();
+
+    size_t failed = 0;
+    std::vector<std::filesystem::path> files = collectFiles(options, failed);
+
+    ResultCache cache;
+    if (!options.cacheDir.empty() && (options.records != records::Format::NONE || options.sidecar || options.includes || options.xref || options.profile)) {
+        // the cache only holds the annotated copies, keyed by their source alone
+        std::string option = options.sidecar ? "--sidecar" : options.includes ? "--includes" : options.xref ? "--xref" : options.profile ? "--profile" : "--records";
+        dbg::Macros::warn("--cache is ignored with " + option);
+    } else if (!options.cacheDir.empty()) {
+        std::string error;
+        if (!cache.open(options.cacheDir, options.cacheSize, error)) {
+            dbg::Macros::warn(error + ", not caching");
+        }
     }
 
-    return operand;
-}
-
-auto analyzeDirective(const std::string& opcode, const std::string& operand) -> std::string {
-    if (opcode == ".string") {
-        std::string lineValue = trim(operand).substr(EIGHT);
-        return "string constant " + lineValue + " declared";
-    } if (opcode == ".data") {
-        return "Data section declared";
-    } if (opcode == ".bss") {
-        return "BSS (uninitialized data) section declared";
-    } if (opcode == ".text") {
-        return "Text (code) section declared";
-    } if (opcode == ".globl" || opcode == ".global") {
-        return "Global symbol " + operand + " declared";
-    } if (opcode == ".align") {
-        return "Align to " + operand + " bytes";
-    } if (opcode == ".byte") {
-        return "Byte value " + operand + " declared";
-    } if (opcode == ".word") {
-        return "Word value " + operand + " declared";
-    } if (opcode == ".dword") {
-        return "Double word value " + operand + " declared";
-    } if (opcode == ".quad") {
-        return "Quad word (64-bit) value " + operand + " declared";
-    } if (opcode == ".section") {
-        return "Section " + operand + " declared";
-    } if (opcode == ".equ" || opcode == ".set") {
-        return "Constant " + operand + " defined";
-    } if (opcode == ".org") {
-        return "Set origin to address " + operand;
-    } if (opcode == ".reserve" || opcode == ".space") {
-        return "Reserve " + operand + " bytes";
-    } if (opcode == ".file") {
-        return "File name set to " + operand;
-    } if (opcode == ".comm") {
-        return "Common block " + operand + " declared";
-    } if (opcode == ".end") {
-        return "End of assembly";
-    } if (opcode == ".incbin") {
-        return "Include binary file " + operand;
+    std::vector<FileResult> results;
+    {
+        ThreadPool pool(options.jobs);
+        results = analyzeFiles(files, options, pool, cache, [&](size_t i, const FileResult& result) {
+            if (!result.ok) {
+                dbg::Macros::error(files[i].string() + ": " + result.error);
+            } else if (!options.quiet) {
+                std::string how = result.cached ? "Reused cached analysis of " : "Successfully analyzed ";
+                dbg::Macros::info(how + files[i].string() + " in " + std::to_string(result.seconds) + "s");
+            }
+        });
     }
-
-    return "Unknown directive: " + opcode;
-}
-
-auto analyzeLine(const std::string& line) -> std::string {
-    if (line.find_first_not_of(" \t\r\n") == std::string::npos) {
-        return "";
+    if (!cache.save()) {
+        dbg::Macros::warn("Cannot write the cache index in " + options.cacheDir);
     }
 
-    std::string trimmedLine = trim(line);
-
-    if (!trimmedLine.empty() && trimmedLine[trimmedLine.size() - 1] == ':') {
-        return "Label: " + trimmedLine.substr(0, trimmedLine.size() - 1);
+    uintmax_t bytes = 0;
+    size_t lines = 0;
+    size_t analyzed = 0;
+    for (const FileResult& result : results) {
+        if (!result.ok) {
+            ++failed;
+            continue;
+        }
+        bytes += result.bytes;
+        lines += result.lines;
+        ++analyzed;
     }
 
-    size_t spacePos = trimmedLine.find(' ');
-    std::string opcode = trimmedLine.substr(0, spacePos);
-
-    if (isInstruction(opcode)) {
-        std::string operands = trimmedLine.substr(spacePos + 1);
-        return analyzeInstruction(opcode, operands, line);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    double mib = static_cast<double>(bytes) / (1024.0 * 1024.0);
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(3)
+        << "Analyzed " << analyzed << " file(s), "
+        << lines << " lines, " << mib << " MiB in " << seconds << "s ("
+        << std::setprecision(0) << (seconds > 0 ? static_cast<double>(lines) / seconds : 0.0) << " lines/s, "
+        << std::setprecision(2) << (seconds > 0 ? mib / seconds : 0.0) << " MiB/s)";
+    if (failed != 0) {
+        summary << ", " << failed << " failed";
     }
-
-    if (isDirective(opcode)) {
-        std::string operand = getOperand(line);
-        return analyzeDirective(opcode, operand);
+    if (cache.enabled()) {
+        summary << std::setprecision(3) << ", cache: " << cache.hits() << " hit(s), " << cache.misses() << " miss(es), ~" << cache.saved() << "s saved";
     }
-
-    return "Unknown instruction";
+    dbg::Macros::info(summary.str());
+    reportStats(options);
+    return failed == 0 ? 0 : 1;
 }
 
-auto analyzeInstruction(const std::string& opcode, const std::string& operands, const std::string& line) -> std::string {
-    if (opcode == "global") {
-        return "Declare global symbol " + operands;
-    } if (opcode == "len") {
-        return "Calculate length of " + operands;
-    } if (opcode == "int") {
-        size_t spacePos = operands.find(' ');
-        std::string operand = operands.substr(0, spacePos);
-
-        if (operand.find("0x") == 0) {
-            return std::string("Instruction: int ") + std::string("| Interrupt: ") + operand;
-        }
-    } if (opcode == "push") {
-        std::string operand = getOperand(line);
-        return "push instruction: pushed " + operand + " into stack";
-    } if (opcode == "mov" || opcode == "movq" || opcode == "add" || opcode == "addq" || opcode == "sub" || opcode == "subq") {
-        size_t commaPos = operands.find(',');
-        if (commaPos != std::string::npos) {
-            std::string destination = operands.substr(0, commaPos);
-            std::string source = operands.substr(commaPos + 1);
-            return "Instruction: " + opcode + " | Destination: " + analyzeOperand(destination, true) + " | Source:" + analyzeOperand(source, true);
-        }
-    } if (opcode == "jmp") {
-        std::string operand = getOperand(line);
-        return "jmp instruction: jumped to " + operand;
-    } if (opcode == "call") {
-        std::string operand = getOperand(line);
-        return "call instruction: called " + operand;
-    } if (opcode == "ret") {
-        return "ret instruction: returned from function";
-    } if (opcode == "nop") {
-        return "no operation";
-    } if (opcode == "cmp") {
-        size_t spacePos = operands.find(' ');
-        std::string destOperand = operands.substr(0, spacePos);
-        std::string srcOperand = operands.substr(spacePos + 1);
-
-        std::string dest = analyzeOperand(destOperand, true);
-        std::string src = analyzeOperand(srcOperand, true);
-
-        return "Instruction: cmp | Destination: " + dest + " | Source: " + src;
-    } if (opcode == "je") {
-        std::string operand = getOperand(line);
-        return "je instruction: jumped to " + operand + " if equal";
-    } if (opcode == "jne") {
-        std::string operand = getOperand(line);
-        return "jne instruction: jumped to " + operand + " if not equal";
-    } if (opcode == "inc") {
-        std::string operand = getOperand(line);
-        return "inc instruction: incremented " + operand;
-    } if (opcode == "dec") {
-        std::string operand = getOperand(line);
-        return "dec instruction: decremented " + operand;
-    } if (opcode == "mul") {
-        size_t spacePos = operands.find(' ');
-        std::string destOperand = operands.substr(0, spacePos);
-        std::string srcOperand = operands.substr(spacePos + 1);
-
-        std::string dest = analyzeOperand(destOperand, true);
-        std::string src = analyzeOperand(srcOperand, true);
+auto reportStats(const Options& options) -> void {
+    if (!stats::COMPILED || !options.stats) { return; }
 
-        return "Instruction: mul | Destination: " + dest + " | Source: " + src;
-    } if (opcode == "div") {
-        size_t spacePos = operands.find(' ');
-        std::string destOperand = operands.substr(0, spacePos);
-        std::string srcOperand = operands.substr(spacePos + 1);
+    // the workers are gone by now, their counters have been folded in
+    stats::Counters totals = stats::Registry::get().total();
+    dbg::Macros::info(stats::report(totals));
+    if (!options.statsJson.empty()) {
+        std::ofstream file(options.statsJson, std::ios::binary | std::ios::trunc);
+        file << stats::json(totals);
+        if (!file) { dbg::Macros::warn("Cannot write " + options.statsJson); }
+    }
+}
 
-        std::string dest = analyzeOperand(destOperand, true);
-        std::string src = analyzeOperand(srcOperand, true);
+auto loadProfiles(Options& options) -> bool {
+    if (options.profiles.empty()) { return true; }
 
-        return "Instruction: div | Destination: " + dest + " | Source: " + src;
+    auto samples = std::make_shared<profile::Profile>();
+    for (const std::string& path : options.profiles) {
+        std::string error;
+        if (!samples->load(path, error)) {
+            dbg::Macros::error(path + ": " + error);
+            return false;
+        }
+    }
+    samples->finish();
+    if (samples->total() == 0) {
+        dbg::Macros::warn("The profile has no samples");
+    } else if (!options.quiet) {
+        std::string summary = "Profile: " + std::to_string(samples->total()) + " sample(s) in " + std::to_string(samples->size()) + " function(s)";
+        if (samples->unmapped() != 0) { summary += ", " + std::to_string(samples->unmapped()) + " outside of them"; }
+        dbg::Macros::info(summary);
     }
-    return "Unknown instruction: " + opcode;
+    options.profile = std::move(samples);
+    return true;
 }
 
-auto analyzeOperands(std::string& operands) -> std::string {
-    std::string operandComment;
-    size_t pos = 0;
-    while ((pos = operands.find(' ')) != std::string::npos) {
-        std::string operand = operands.substr(0, pos);
-        operandComment += analyzeOperand(operand) + " ";
-        operands.erase(0, pos + 1);
+auto isForbiddenPath(const std::filesystem::path& path) -> bool {
+    for (const std::filesystem::path& part : path) {
+        // Convert to uppercase for path checking
+        std::string name = part.stem().string();
+        std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+        if (forbidden.count(name) > 0) {
+            return true;
+        }
     }
-
-    operandComment += analyzeOperand(operands);
-    return operandComment;
+    return false;
 }
 
-auto analyzeOperand(const std::string& operand, bool appendType) -> std::string {
-    if (operand.empty()) { return "Empty operand"; }
-
-    // Recognized registers
-    static const std::unordered_set<std::string> registers = {
-        "eax", "ebx", "ecx", "edx", "esi", "edi", "esp", "ebp",
-        "rax", "rbx", "rcx", "rdx", "rsi", "rdi", "rsp", "rbp",
-        "ah", "bh", "ch", "dh", "al", "bl", "cl", "dl",
-        "spl", "bpl", "sil", "dil",
-        "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15",
-        "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d",
-        "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w",
-        "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"
-    };
-
-    // Check if the operand is a register
-    if (registers.count(operand) != 0U) {
-        return appendType ? operand + " (Register)" : "Register: " + operand;
+auto isSupportedFile(const std::filesystem::path& path) -> bool {
+    // a compressed file goes by the extension under the compression's
+    compression::Codec codec = compression::codecOf(path);
+    if (codec != compression::Codec::NONE) {
+        return compression::compiled(codec) && isSupportedFile(path.stem());
     }
-
-    // Check for immediate values (numeric literals)
-    if (operand[0] == '$' || (std::isdigit(operand[0]) != 0) || operand == "0") {
-        std::string immediate = operand[0] == '$' ? operand.substr(1) : operand;
-        return appendType ? immediate + " (Immediate)" : "Immediate: " + immediate;
+    std::string extension = path.extension().string();
+    if (extension.empty()) {
+        return false;
     }
-
-    // Check for memory addressing mode
-    if (isMemoryAddressingMode(operand)) {
-        std::string labelName = operand.substr(1, operand.size() - 2);
-        return appendType ? labelName + " (Memory Address)" : "Memory Address: " + labelName;
+    extension.erase(0, 1);
+    for (char& c : extension) {
+        c = static_cast<char>(tolower(c));
     }
-
-    // Assume other operands are labels or identifiers
-    return appendType ? operand + " (Label/Identifier)" : "Label/Identifier: " + operand;
+    return supportedExtensions.count(extension) != 0U;
 }
 
-auto trim(const std::string& str) -> std::string {
-    size_t first = str.find_first_not_of(' ');
-    if (std::string::npos == first) { return str; }
-
-    size_t last = str.find_last_not_of(' ');
-    return str.substr(first, (last - first + 1));
+auto isInputFile(const std::filesystem::path& path) -> bool {
+    std::string stem = compression::uncompressedPath(path).stem().string();
+    // skip our own output, it would get analyzed again on every run
+    bool analyzed = stem.size() >= 9 && stem.compare(stem.size() - 9, 9, "_analyzed") == 0;
+    return !analyzed && isSupportedFile(path) && !isForbiddenPath(path);
 }
 
-auto isInstruction(std::string& opcode) -> bool {
-    // Recognized instructions
-    const static std::vector<std::string> instructions = {
-        "int", "push", "pop", "mov", "movq", "add", "addq", "sub", "subq",
-        "jmp", "call", "ret", "cmp", "je", "jne", "inc", "dec", "mul", "div",
-        "global", "len", "nop"
-    };
-    return find(instructions.begin(), instructions.end(), opcode) != instructions.end();
-}
+auto collectFiles(const Options& options, size_t& failed) -> std::vector<std::filesystem::path> {
+    std::vector<std::filesystem::path> files;
 
-auto getArchitecture(const std::string& filename) -> std::string {
-    std::ifstream file(filename);
-    if (!file) {
-        dbg::Macros::fatal("Error opening/reading " + filename + " file (is " + filename + " closed?)");
-    }
-
-    std::string architecture = "Unknown"; // default value is Unknown
-    std::string line;
+    for (const std::string& argument : options.paths) {
+        std::filesystem::path path(argument);
+        std::error_code ec;
 
-    while (getline(file, line)) {
-        line = trim(line);
-
-        // x86-64
-        if (line.find(".code64") != std::string::npos || line.find(".x64") != std::string::npos ||
-            line.find(".quad") != std::string::npos || line.find("BITS 64") != std::string::npos ||
-            line.find("__x86_64__") != std::string::npos || line.find("__amd64__") != std::string::npos ||
-            line.find("__aarch64__") != std::string::npos) {
-            architecture = "x86-64";
-        }
-        // x86
-        else if (line.find(".code32") != std::string::npos || line.find(".x86") != std::string::npos ||
-            line.find("BITS 32") != std::string::npos || line.find("__i386__") != std::string::npos) {
-            architecture = "x86";
+        if (isForbiddenPath(path)) {
+            dbg::Macros::error(argument + ": You can't do that :3");
+            ++failed;
+            continue;
         }
-        // ARM
-        else if (line.find(".arm") != std::string::npos || line.find(".thumb") != std::string::npos ||
-            line.find("__ARM_ARCH") != std::string::npos || line.find("__arm__") != std::string::npos) {
-            architecture = "ARM";
-        }
-        // MIPS
-        else if (line.find(".mips") != std::string::npos || line.find(".mips64") != std::string::npos ||
-            line.find("__mips__") != std::string::npos) {
-            architecture = "MIPS";
-        }
-        // PowerPC
-        else if (line.find(".ppc") != std::string::npos || line.find("__powerpc__") != std::string::npos ||
-            line.find("__ppc__") != std::string::npos) {
-            architecture = "PowerPC";
+
+        if (std::filesystem::is_directory(path, ec)) {
+            auto consider = [&](const std::filesystem::directory_entry& entry) {
+                if (entry.is_regular_file(ec) && isInputFile(entry.path())) {
+                    files.push_back(entry.path());
+                }
+            };
+
+            auto dirOptions = std::filesystem::directory_options::skip_permission_denied;
+            if (options.recursive) {
+                for (auto it = std::filesystem::recursive_directory_iterator(path, dirOptions, ec);
+                     !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+                    consider(*it);
+                }
+            } else {
+                for (auto it = std::filesystem::directory_iterator(path, dirOptions, ec);
+                     !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+                    consider(*it);
+                }
+            }
+            if (ec) {
+                dbg::Macros::error(argument + ": " + ec.message());
+                ++failed;
+            }
+            continue;
         }
-        // RISC-V
-        else if (line.find(".riscv") != std::string::npos || line.find("__riscv") != std::string::npos) {
-            architecture = "RISC-V";
+
+        compression::Codec codec = compression::codecOf(path);
+        if (!compression::compiled(codec)) {
+            dbg::Macros::error(argument + ": This build can't read " + std::string(compression::name(codec)) + " files");
+            ++failed;
+            continue;
         }
-        // SPARC
-        else if (line.find(".sparc") != std::string::npos || line.find("__sparc__") != std::string::npos) {
-            architecture = "SPARC";
+
+        // explicitly named files may have no extension, but a wrong one is refused
+        if (path.has_extension() && !isSupportedFile(path)) {
+            dbg::Macros::error(argument + ": You can't do that :3");
+            ++failed;
+            continue;
         }
+        files.push_back(path);
+    }
 
-        if (architecture != "Unknown") { break; }
+    // foo.s and foo.s.gz have the same copy, which must not be written twice at once: the plain file wins
+    std::unordered_set<std::string> copies;
+    for (const std::filesystem::path& file : files) {
+        if (compression::codecOf(file) == compression::Codec::NONE) { copies.insert(getAnalyzedPath(file).string()); }
+    }
+    files.erase(std::remove_if(files.begin(), files.end(), [&](const std::filesystem::path& file) {
+        if (compression::codecOf(file) == compression::Codec::NONE || copies.insert(getAnalyzedPath(file).string()).second) { return false; }
+        dbg::Macros::warn(file.string() + ": skipped, " + getAnalyzedPath(file).string() + " is written from another file");
+        return true;
+    }), files.end());
+
+    // biggest files first so a large file doesn't end up alone at the tail of the run
+    std::vector<std::pair<uintmax_t, std::filesystem::path>> sized;
+    sized.reserve(files.size());
+    for (std::filesystem::path& file : files) {
+        std::error_code ec;
+        uintmax_t size = std::filesystem::file_size(file, ec);
+        sized.emplace_back(ec ? 0 : size, std::move(file));
+    }
+    std::stable_sort(sized.begin(), sized.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    files.clear();
+    for (auto& entry : sized) {
+        files.push_back(std::move(entry.second));
     }
 
-    file.close();
-    return architecture;
+    return files;
 }
\ No newline at end of file
@@ -0,0 +1,149 @@
+/*
+  Drives the C interface of the shared library: a buffer has to come out as the command line tool
+  writes it, options of an older header's size get the defaults, and bad arguments come back as a
+  status and a message.
+
+    capi-test <input> <expected plain output> <expected --cfg output>
+ */
+
+#include "asmanalyze.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+static int failures = 0;
+
+static void fail(const char* what, const char* detail) {
+    fprintf(stderr, "FAILED: %s%s%s\n", what, detail[0] != '\0' ? ": " : "", detail);
+    ++failures;
+}
+
+/* a whole file, NULL when it can't be read */
+static char* readFile(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) { return NULL; }
+    char* data = NULL;
+    size_t used = 0;
+    size_t capacity = 0;
+    for (;;) {
+        if (used == capacity) {
+            capacity = capacity == 0 ? 4096 : capacity * 2;
+            char* grown = realloc(data, capacity);
+            if (grown == NULL) {
+                free(data);
+                fclose(file);
+                return NULL;
+            }
+            data = grown;
+        }
+        size_t read = fread(data + used, 1, capacity - used, file);
+        used += read;
+        if (read == 0) { break; }
+    }
+    fclose(file);
+    *size = used;
+    return data;
+}
+
+/* text without the "Analyzed on" line of the header, which changes every run (in place) */
+static size_t withoutDate(char* text, size_t size) {
+    static const char DATE[] = "; \tAnalyzed on: ";
+    for (size_t at = 0; at + sizeof(DATE) - 1 <= size; ++at) {
+        if ((at == 0 || text[at - 1] == '\n') && memcmp(text + at, DATE, sizeof(DATE) - 1) == 0) {
+            size_t end = at;
+            while (end < size && text[end] != '\n') { ++end; }
+            if (end < size) { ++end; }
+            memmove(text + at, text + end, size - end);
+            return size - (end - at);
+        }
+    }
+    return size;
+}
+
+/* analyzes the input and compares the annotated copy with an expected file */
+static void expectOutput(const char* what, const char* input, size_t inputSize, const asm_analyze_options* options, const char* expectedPath) {
+    size_t expectedSize = 0;
+    char* expected = readFile(expectedPath, &expectedSize);
+    if (expected == NULL) {
+        fail(what, expectedPath);
+        return;
+    }
+    asm_analyze_result* result = NULL;
+    asm_analyze_status status = asm_analyze_buffer(input, inputSize, options, &result);
+    if (status != ASM_ANALYZE_OK) {
+        fail(what, asm_analyze_result_error(result));
+    } else {
+        size_t size = 0;
+        const char* output = asm_analyze_result_output(result, &size);
+        char* copy = malloc(size + 1);
+        if (copy == NULL) {
+            fail(what, "out of memory");
+        } else {
+            memcpy(copy, output, size);
+            size = withoutDate(copy, size);
+            expectedSize = withoutDate(expected, expectedSize);
+            if (size != expectedSize || memcmp(copy, expected, size) != 0) { fail(what, "the output differs from the expected file"); }
+            free(copy);
+        }
+        if (asm_analyze_result_bytes(result) != inputSize) { fail(what, "bytes"); }
+        if (asm_analyze_result_error(result)[0] != '\0') { fail(what, "an error came with the output"); }
+    }
+    asm_analyze_result_free(result);
+    free(expected);
+}
+
+/* a call that has to fail with a status and a message */
+static void expectError(const char* what, asm_analyze_status wanted, asm_analyze_status status, asm_analyze_result* result) {
+    if (status != wanted) {
+        fail(what, asm_analyze_status_string(status));
+    } else if (result == NULL || asm_analyze_result_error(result)[0] == '\0') {
+        fail(what, "no message");
+    }
+    asm_analyze_result_free(result);
+}
+
+int main(int argc, char** argv) {
+    if (argc != 4) {
+        fprintf(stderr, "usage: capi-test <input> <expected plain output> <expected --cfg output>\n");
+        return 2;
+    }
+    size_t size = 0;
+    char* input = readFile(argv[1], &size);
+    if (input == NULL) {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 2;
+    }
+
+    asm_analyze_options options;
+    asm_analyze_options_init(&options);
+    expectOutput("defaults", input, size, NULL, argv[2]);
+    expectOutput("initialized options", input, size, &options, argv[2]);
+    options.cfg = 1;
+    expectOutput("cfg", input, size, &options, argv[3]);
+
+    /* a caller built before cfg and cpu existed: what lies past its size is never read */
+    options.size = (uint32_t)offsetof(asm_analyze_options, cfg);
+    options.cpu = "not a processor";
+    expectOutput("options of an older size", input, size, &options, argv[2]);
+
+    asm_analyze_result* result = NULL;
+    asm_analyze_options_init(&options);
+    options.size = (uint32_t)sizeof(options.size);
+    asm_analyze_status status = asm_analyze_buffer(input, size, &options, &result);
+    expectError("options smaller than the first version", ASM_ANALYZE_INVALID_ARGUMENT, status, result);
+    asm_analyze_options_init(&options);
+    options.cpu = "not a processor";
+    status = asm_analyze_buffer(input, size, &options, &result);
+    expectError("unknown processor", ASM_ANALYZE_INVALID_ARGUMENT, status, result);
+    status = asm_analyze_buffer(NULL, 1, NULL, &result);
+    expectError("no data", ASM_ANALYZE_INVALID_ARGUMENT, status, result);
+    status = asm_analyze_file("does-not-exist.s", NULL, &result);
+    expectError("missing file", ASM_ANALYZE_IO_ERROR, status, result);
+    if (asm_analyze_buffer(input, size, NULL, NULL) != ASM_ANALYZE_INVALID_ARGUMENT) { fail("no result", ""); }
+
+    free(input);
+    if (failures != 0) { return 1; }
+    printf("C API of %s: all checks passed\n", asm_analyze_version());
+    return 0;
+}
\ No newline at end of file
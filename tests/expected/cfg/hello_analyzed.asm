@@ -0,0 +1,29 @@
+; INFORMATION:
+; 	Assembly Analyzer Version: 0.1.0
+; 	Instruction Set Architecture: Unknown
+
+; Block 1: 4 instructions (4 unknown, costed as simple ones), 4 uops, critical path unknown, throughput 1.00 cycles (bound by the issue width), next: 2
+global _start		; Declare global symbol _start
+extern puts		; Unknown instruction
+section .data		; Unknown instruction
+msg db "hi", 0		; Unknown instruction
+len equ $ - msg		; Calculate length of equ $ - msg
+section .text		; Unknown instruction
+; Block 2: 3 instructions, 5 uops, critical path 3 cycles, throughput 1.50 cycles (bound by p6), up to 2 registers live, next: 3
+_start:		; Label: _start
+    mov rdi, msg		; Instruction: mov | Destination: rdi (Register) | Source: msg (Label/Identifier)
+    call puts		; call instruction: called    call puts
+    mov ecx, 4		; Instruction: mov | Destination: ecx (Register) | Source: 4 (Label/Identifier)
+; Loop at .next, lines 11-14 (depth 1, 1 block): 3 instructions, 1.00 cycles per iteration on skylake (bound by p0), carried: ecx, up to 2 registers live
+; Block 3 (loop depth 1): 3 instructions, 3 uops, critical path 1 cycle, throughput 1.00 cycles (bound by p0), up to 2 registers live, next: 4, 3
+.next:		; Label: .next
+    dec ecx		; dec instruction: decremented    dec ecx
+    cmp ecx 0		; Instruction: cmp | Destination: ecx (Register) | Source: 0 (Immediate)
+    jne .next		; jne instruction: jumped to    jne .next if not equal
+; Block 4: 3 instructions, 3 uops, critical path 100 cycles, throughput 0.75 cycles (bound by the issue width), up to 1 register live, next: 5
+    mov eax, 60		; Instruction: mov | Destination: eax (Register) | Source: 60 (Label/Identifier)
+    xor edi, edi		; Unknown instruction
+    int 0x80		; Instruction: int | Interrupt: 0x80
+; Block 5: 1 instruction, 2 uops, critical path 2 cycles, throughput 1.00 cycles (bound by p2), up to 0 registers live, next: none
+unused:		; Label: unused
+    ret		; ret instruction: returned from function
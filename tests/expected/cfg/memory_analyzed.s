@@ -0,0 +1,28 @@
+; INFORMATION:
+; 	Assembly Analyzer Version: 0.1.0
+; 	Instruction Set Architecture: Unknown
+
+; Block 1: 3 instructions, 4 uops, critical path 2 cycles (2 instructions, lines 5-6), throughput 1.50 cycles (bound by p6), up to 2 registers live, next: none
+	.text		; Unknown instruction
+	.globl	f		; Unknown instruction
+	.type	f, @function		; Unknown instruction
+f:		; Label: f
+	leaq	(%rdi,%rsi,4), %rcx		; Unknown instruction
+	leaq	(%rcx,%rcx,2), %rax		; Unknown instruction
+	ret		; Unknown instruction
+	.globl	g		; Unknown instruction
+	.type	g, @function		; Unknown instruction
+; Block 2: 5 instructions, 14 uops, critical path 2 cycles, throughput 4.00 cycles (bound by p4), up to 2 registers live, next: none
+g:		; Label: g
+	movl	%eax, 4(%rdi)		; Unknown instruction
+	movl	%eax, 8(%rdi)		; Unknown instruction
+	movl	%eax, 12(%rdi)		; Unknown instruction
+	movl	%eax, 16(%rdi)		; Unknown instruction
+	ret		; Unknown instruction
+	.globl	h		; Unknown instruction
+	.type	h, @function		; Unknown instruction
+; Block 3: 3 instructions, 8 uops, critical path 6 cycles, throughput 2.00 cycles (bound by the issue width), up to 3 registers live, next: none
+h:		; Label: h
+	addl	$1, (%rdi)		; Unknown instruction
+	addl	(%rsi), %eax		; Unknown instruction
+	ret		; Unknown instruction
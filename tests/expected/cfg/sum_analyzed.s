@@ -0,0 +1,70 @@
+; INFORMATION:
+; 	Assembly Analyzer Version: 0.1.0
+; 	Instruction Set Architecture: Unknown
+
+; Block 1: 2 instructions, 2 uops, critical path 1 cycle, throughput 0.75 cycles (bound by p0), up to 3 registers live, next: 2, 5
+	.file	"sum.c"		; Unknown instruction
+	.text		; Unknown instruction
+	.p2align 4		; Unknown instruction
+	.globl	sum		; Unknown instruction
+	.type	sum, @function		; Unknown instruction
+sum:		; Label: sum
+	testl	%esi, %esi		; Unknown instruction
+	jle	.L4		; Unknown instruction
+; Block 2: 3 instructions, 3 uops, critical path 2 cycles (2 instructions, lines 9-11), throughput 0.75 cycles (bound by the issue width), up to 3 registers live, next: 3
+	movslq	%esi, %rsi		; Unknown instruction
+	xorl	%edx, %edx		; Unknown instruction
+	leaq	(%rdi,%rsi,4), %rcx		; Unknown instruction
+	.p2align 4,,10		; Unknown instruction
+	.p2align 3		; Unknown instruction
+; Loop at .L3, lines 14-21 (depth 1, 1 block): 7 instructions, 2.00 cycles per iteration on skylake (bound by the issue width), carried: %edx %rdi, up to 4 registers live
+; Block 3 (loop depth 1): 7 instructions, 8 uops, critical path 8 cycles (3 instructions, lines 15-19), throughput 2.00 cycles (bound by the issue width), up to 4 registers live, next: 4, 3
+.L3:		; Label: .L3
+	movl	(%rdi), %eax		; Unknown instruction
+	addq	$4, %rdi		; Unknown instruction
+	leal	(%rax,%rax,2), %eax		; Unknown instruction
+	cltq		; Unknown instruction
+	addq	%rax, %rdx		; Unknown instruction
+	cmpq	%rdi, %rcx		; Unknown instruction
+	jne	.L3		; Unknown instruction
+; Block 4: 2 instructions, 3 uops, critical path 2 cycles, throughput 1.25 cycles (bound by p6), up to 1 register live, next: none
+	movq	%rdx, %rax		; Unknown instruction
+	ret		; Unknown instruction
+	.p2align 4,,10		; Unknown instruction
+	.p2align 3		; Unknown instruction
+; Block 5: 3 instructions, 4 uops, critical path 2 cycles (2 instructions, lines 27-28), throughput 1.50 cycles (bound by p6), up to 1 register live, next: none
+.L4:		; Label: .L4
+	xorl	%edx, %edx		; Unknown instruction
+	movq	%rdx, %rax		; Unknown instruction
+	ret		; Unknown instruction
+	.size	sum, .-sum		; Unknown instruction
+	.section	.rodata.str1.1,"aMS",@progbits,1		; Unknown instruction
+; Block 6: 11 instructions, 18 uops, critical path 3 cycles, throughput 5.00 cycles (bound by p6), up to 2 registers live, next: none
+.LC0:		; Label: .LC0
+	.string	"%ld\n"		; Unknown instruction
+	.section	.text.startup,"ax",@progbits		; Unknown instruction
+	.p2align 4		; Unknown instruction
+	.globl	main		; Unknown instruction
+	.type	main, @function		; Unknown instruction
+main:		; Label: main
+	subq	$8, %rsp		; Unknown instruction
+	movl	$2, %edi		; Unknown instruction
+	call	scale@PLT		; Unknown instruction
+	movl	$30, %esi		; Unknown instruction
+	leaq	.LC0(%rip), %rdi		; Unknown instruction
+	movl	%eax, counter(%rip)		; Unknown instruction
+	xorl	%eax, %eax		; Unknown instruction
+	call	printf@PLT		; Unknown instruction
+	xorl	%eax, %eax		; Unknown instruction
+	addq	$8, %rsp		; Unknown instruction
+	ret		; Unknown instruction
+	.size	main, .-main		; Unknown instruction
+	.globl	counter		; Unknown instruction
+	.bss		; Unknown instruction
+	.align 4		; Unknown instruction
+	.type	counter, @object		; Unknown instruction
+	.size	counter, 4		; Unknown instruction
+counter:		; Label: counter
+	.zero	4		; Unknown instruction
+	.ident	"GCC"		; Unknown instruction
+	.section	.note.GNU-stack,"",@progbits		; Unknown instruction
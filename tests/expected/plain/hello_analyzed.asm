@@ -0,0 +1,23 @@
+; INFORMATION:
+; 	Assembly Analyzer Version: 0.1.0
+; 	Instruction Set Architecture: Unknown
+
+global _start		; Declare global symbol _start
+extern puts		; Unknown instruction
+section .data		; Unknown instruction
+msg db "hi", 0		; Unknown instruction
+len equ $ - msg		; Calculate length of equ $ - msg
+section .text		; Unknown instruction
+_start:		; Label: _start
+    mov rdi, msg		; Instruction: mov | Destination: rdi (Register) | Source: msg (Label/Identifier)
+    call puts		; call instruction: called    call puts
+    mov ecx, 4		; Instruction: mov | Destination: ecx (Register) | Source: 4 (Label/Identifier)
+.next:		; Label: .next
+    dec ecx		; dec instruction: decremented    dec ecx
+    cmp ecx 0		; Instruction: cmp | Destination: ecx (Register) | Source: 0 (Immediate)
+    jne .next		; jne instruction: jumped to    jne .next if not equal
+    mov eax, 60		; Instruction: mov | Destination: eax (Register) | Source: 60 (Label/Identifier)
+    xor edi, edi		; Unknown instruction
+    int 0x80		; Instruction: int | Interrupt: 0x80
+unused:		; Label: unused
+    ret		; ret instruction: returned from function
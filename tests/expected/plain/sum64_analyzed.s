@@ -0,0 +1,47 @@
+; INFORMATION:
+; 	Assembly Analyzer Version: 0.1.0
+; 	Instruction Set Architecture: ARM
+
+	.arch armv8-a		; Unknown directive: .arch
+	.file	"sum.c"		; File name set to "sum.c"
+	.text		; Text (code) section declared
+	.align	2		; Align to 2 bytes
+	.global	sum		; Global symbol sum declared
+	.type	sum, %function		; Unknown directive: .type
+sum:		; Label: sum
+	cmp	w1, 0		; Instruction: cmp | Compared: w1 (Register), 0 (Immediate)
+	ble	.L4		; ble instruction: jumped to .L4 if less or equal
+	mov	x2, 0		; Instruction: mov | Destination: x2 (Register) | Source: 0 (Immediate)
+	mov	x3, 0		; Instruction: mov | Destination: x3 (Register) | Source: 0 (Immediate)
+.L3:		; Label: .L3
+	ldr	w4, [x0, x2, lsl 2]		; Instruction: ldr | Destination: w4 (Register) | Source: x0, x2, lsl 2 (Memory Address)
+	add	x2, x2, 1		; Instruction: add | Destination: x2 (Register) | Sources: x2 (Register), 1 (Immediate)
+	add	w4, w4, w4, lsl 1		; Instruction: add | Destination: w4 (Register) | Sources: w4 (Register), w4 (Register), lsl 1 (Shift/Extend)
+	cmp	w1, w2		; Instruction: cmp | Compared: w1 (Register), w2 (Register)
+	add	x3, x3, w4, sxtw		; Instruction: add | Destination: x3 (Register) | Sources: x3 (Register), w4 (Register), sxtw (Shift/Extend)
+	bgt	.L3		; bgt instruction: jumped to .L3 if greater
+	mov	x0, x3		; Instruction: mov | Destination: x0 (Register) | Source: x3 (Register)
+	ret		; ret instruction: returned from function
+.L4:		; Label: .L4
+	mov	x0, 0		; Instruction: mov | Destination: x0 (Register) | Source: 0 (Immediate)
+	ret		; ret instruction: returned from function
+	.size	sum, .-sum		; Unknown directive: .size
+	.global	main		; Global symbol main declared
+	.type	main, %function		; Unknown directive: .type
+main:		; Label: main
+	stp	x29, x30, [sp, -32]!		; Instruction: stp | Sources: x29 (Register), x30 (Register) | Destination: [sp, -32]! (Memory Address)
+	mov	x29, sp		; Instruction: mov | Destination: x29 (Register) | Source: sp (Register)
+	ldr	w1, [x0, w1, uxtw 2]		; Instruction: ldr | Destination: w1 (Register) | Source: x0, w1, uxtw 2 (Memory Address)
+	bl	scale		; bl instruction: called scale
+	adrp	x1, counter		; Instruction: adrp | Destination: x1 (Register) | Source: counter (Label/Identifier)
+	str	w0, [x1, #:lo12:counter]		; Instruction: str | Source: w0 (Register) | Destination: x1, #:lo12:counter (Memory Address)
+	ldp	x29, x30, [sp], 32		; Instruction: ldp | Destinations: x29 (Register), x30 (Register) | Sources: sp (Memory Address), 32 (Immediate)
+	ret		; ret instruction: returned from function
+	.size	main, .-main		; Unknown directive: .size
+	.global	counter		; Global symbol counter declared
+	.bss		; BSS (uninitialized data) section declared
+	.align	2		; Align to 2 bytes
+	.type	counter, %object		; Unknown directive: .type
+	.size	counter, 4		; Unknown directive: .size
+counter:		; Label: counter
+	.zero	4		; Unknown directive: .zero
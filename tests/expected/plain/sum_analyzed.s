@@ -0,0 +1,63 @@
+; INFORMATION:
+; 	Assembly Analyzer Version: 0.1.0
+; 	Instruction Set Architecture: Unknown
+
+	.file	"sum.c"		; Unknown instruction
+	.text		; Unknown instruction
+	.p2align 4		; Unknown instruction
+	.globl	sum		; Unknown instruction
+	.type	sum, @function		; Unknown instruction
+sum:		; Label: sum
+	testl	%esi, %esi		; Unknown instruction
+	jle	.L4		; Unknown instruction
+	movslq	%esi, %rsi		; Unknown instruction
+	xorl	%edx, %edx		; Unknown instruction
+	leaq	(%rdi,%rsi,4), %rcx		; Unknown instruction
+	.p2align 4,,10		; Unknown instruction
+	.p2align 3		; Unknown instruction
+.L3:		; Label: .L3
+	movl	(%rdi), %eax		; Unknown instruction
+	addq	$4, %rdi		; Unknown instruction
+	leal	(%rax,%rax,2), %eax		; Unknown instruction
+	cltq		; Unknown instruction
+	addq	%rax, %rdx		; Unknown instruction
+	cmpq	%rdi, %rcx		; Unknown instruction
+	jne	.L3		; Unknown instruction
+	movq	%rdx, %rax		; Unknown instruction
+	ret		; Unknown instruction
+	.p2align 4,,10		; Unknown instruction
+	.p2align 3		; Unknown instruction
+.L4:		; Label: .L4
+	xorl	%edx, %edx		; Unknown instruction
+	movq	%rdx, %rax		; Unknown instruction
+	ret		; Unknown instruction
+	.size	sum, .-sum		; Unknown instruction
+	.section	.rodata.str1.1,"aMS",@progbits,1		; Unknown instruction
+.LC0:		; Label: .LC0
+	.string	"%ld\n"		; Unknown instruction
+	.section	.text.startup,"ax",@progbits		; Unknown instruction
+	.p2align 4		; Unknown instruction
+	.globl	main		; Unknown instruction
+	.type	main, @function		; Unknown instruction
+main:		; Label: main
+	subq	$8, %rsp		; Unknown instruction
+	movl	$2, %edi		; Unknown instruction
+	call	scale@PLT		; Unknown instruction
+	movl	$30, %esi		; Unknown instruction
+	leaq	.LC0(%rip), %rdi		; Unknown instruction
+	movl	%eax, counter(%rip)		; Unknown instruction
+	xorl	%eax, %eax		; Unknown instruction
+	call	printf@PLT		; Unknown instruction
+	xorl	%eax, %eax		; Unknown instruction
+	addq	$8, %rsp		; Unknown instruction
+	ret		; Unknown instruction
+	.size	main, .-main		; Unknown instruction
+	.globl	counter		; Unknown instruction
+	.bss		; Unknown instruction
+	.align 4		; Unknown instruction
+	.type	counter, @object		; Unknown instruction
+	.size	counter, 4		; Unknown instruction
+counter:		; Label: counter
+	.zero	4		; Unknown instruction
+	.ident	"GCC"		; Unknown instruction
+	.section	.note.GNU-stack,"",@progbits		; Unknown instruction
@@ -0,0 +1,143 @@
+# Runs asm-analyze on copies of the inputs and compares what it writes with the expected files,
+# leaving out the "Analyzed on" line of the header. Lists are passed separated by |.
+#
+#   cmake -DBIN=<asm-analyze> -DWORK=<scratch directory> -DINPUTS=<file|...> [-DARGS=<arg|...>]
+#         [-DSIMD=<scalar|sse2|avx2>] [mode] -P golden.cmake
+#
+# Modes:
+#   -DEXPECTED=<dir> [-DSUFFIX=<suffix>]
+#       every <stem>_analyzed<ext><suffix> has to match the same file in <dir>
+#   -DEXPECTED=<dir> -DSTDIN=ON
+#       the same, for the one input piped through "asm-analyze -"
+#   -DEXPECTED=<dir> -DQUERY=<--unused|--undefined>
+#       after the run (ARGS has --xref), "asm-analyze xref <query> <input>" has to print
+#       <stem><ext>.<query>.txt of <dir>
+#   -DEXPECTED=<dir> -DVIEW=ON [-DLINES=<from>-<to>]
+#       after the run (ARGS has --sidecar), "asm-analyze view <input>" has to print the same as
+#       <stem>_analyzed<ext> of <dir>, "view --lines" <stem><ext>.lines-<from>-<to>.txt
+#   -DREPEAT=<MiB> -DOTHER_ARGS=<arg|...>
+#       the first input is repeated into a file of at least that size, which ARGS and OTHER_ARGS
+#       have to annotate the same way
+#
+# -DUPDATE=ON writes the expected files instead of comparing with them.
+
+foreach(var BIN WORK INPUTS)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "${var} is not set")
+    endif()
+endforeach()
+string(REPLACE "|" ";" INPUTS "${INPUTS}")
+string(REPLACE "|" ";" ARGS "${ARGS}")
+string(REPLACE "|" ";" OTHER_ARGS "${OTHER_ARGS}")
+set(RUN "${BIN}")
+if(SIMD)
+    set(RUN "${CMAKE_COMMAND}" -E env "ASM_ANALYZE_SIMD=${SIMD}" "${BIN}")
+endif()
+
+file(REMOVE_RECURSE "${WORK}")
+file(MAKE_DIRECTORY "${WORK}")
+set(NAMES "")
+foreach(input ${INPUTS})
+    get_filename_component(name "${input}" NAME)
+    configure_file("${input}" "${WORK}/${name}" COPYONLY)
+    list(APPEND NAMES "${name}")
+endforeach()
+
+# the annotated copy of a name, as asm-analyze names it
+function(analyzed_name name out)
+    get_filename_component(stem "${name}" NAME_WE)
+    get_filename_component(ext "${name}" EXT)
+    set(${out} "${stem}_analyzed${ext}" PARENT_SCOPE)
+endfunction()
+
+# the contents of a file without the date in its header (and on Windows without carriage returns)
+function(read_output path out)
+    if(NOT EXISTS "${path}")
+        message(FATAL_ERROR "${path} was not written")
+    endif()
+    file(READ "${path}" text)
+    string(REGEX REPLACE "; \tAnalyzed on: [^\n]*\n" "" text "${text}")
+    if(WIN32)
+        string(REPLACE "\r\n" "\n" text "${text}")
+    endif()
+    set(${out} "${text}" PARENT_SCOPE)
+endfunction()
+
+function(run)
+    execute_process(COMMAND ${RUN} ${ARGN} WORKING_DIRECTORY "${WORK}" RESULT_VARIABLE result ERROR_VARIABLE error)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "asm-analyze ${ARGN} failed (${result}):\n${error}")
+    endif()
+endfunction()
+
+# compares a file written to the work directory with the expected one of the same name
+function(check name)
+    read_output("${WORK}/${name}" actual)
+    if(UPDATE)
+        file(WRITE "${EXPECTED}/${name}" "${actual}")
+        return()
+    endif()
+    read_output("${EXPECTED}/${name}" expected)
+    if(NOT actual STREQUAL expected)
+        message(FATAL_ERROR "${WORK}/${name} differs from ${EXPECTED}/${name}")
+    endif()
+endfunction()
+
+if(REPEAT)
+    list(GET NAMES 0 name)
+    file(READ "${WORK}/${name}" text)
+    string(LENGTH "${text}" length)
+    math(EXPR target "${REPEAT} * 1024 * 1024")
+    while(length LESS target)
+        set(text "${text}${text}")
+        math(EXPR length "${length} * 2")
+    endwhile()
+    get_filename_component(ext "${name}" EXT)
+    file(WRITE "${WORK}/big${ext}" "${text}")
+    run(-q ${ARGS} "big${ext}")
+    read_output("${WORK}/big_analyzed${ext}" expected)
+    file(REMOVE "${WORK}/big_analyzed${ext}")
+    run(-q ${OTHER_ARGS} "big${ext}")
+    read_output("${WORK}/big_analyzed${ext}" actual)
+    if(NOT actual STREQUAL expected)
+        message(FATAL_ERROR "asm-analyze ${OTHER_ARGS} annotated ${WORK}/big${ext} differently than asm-analyze ${ARGS}")
+    endif()
+elseif(STDIN)
+    list(GET NAMES 0 name)
+    analyzed_name("${name}" analyzed)
+    execute_process(COMMAND ${RUN} -q ${ARGS} - WORKING_DIRECTORY "${WORK}" INPUT_FILE "${WORK}/${name}"
+        OUTPUT_FILE "${WORK}/${analyzed}" RESULT_VARIABLE result ERROR_VARIABLE error)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "asm-analyze ${ARGS} - < ${name} failed (${result}):\n${error}")
+    endif()
+    check("${analyzed}")
+else()
+    run(-q ${ARGS} ${NAMES})
+    foreach(name ${NAMES})
+        analyzed_name("${name}" analyzed)
+        if(QUERY)
+            string(REGEX REPLACE "^-+" "" query "${QUERY}")
+            execute_process(COMMAND ${RUN} xref ${QUERY} "${name}" WORKING_DIRECTORY "${WORK}"
+                OUTPUT_FILE "${WORK}/${name}.${query}.txt" RESULT_VARIABLE result ERROR_VARIABLE error)
+            if(NOT result EQUAL 0)
+                message(FATAL_ERROR "asm-analyze xref ${QUERY} ${name} failed (${result}):\n${error}")
+            endif()
+            check("${name}.${query}.txt")
+        elseif(VIEW)
+            set(view "${analyzed}")
+            set(range "")
+            if(LINES)
+                set(view "${name}.lines-${LINES}.txt")
+                set(range --lines "${LINES}")
+            endif()
+            execute_process(COMMAND ${RUN} view ${range} "${name}" WORKING_DIRECTORY "${WORK}"
+                OUTPUT_FILE "${WORK}/${view}" RESULT_VARIABLE result ERROR_VARIABLE error)
+            if(NOT result EQUAL 0)
+                message(FATAL_ERROR "asm-analyze view ${range} ${name} failed (${result}):\n${error}")
+            endif()
+            check("${view}")
+        else()
+            check("${analyzed}${SUFFIX}")
+        endif()
+    endforeach()
+endif()
\ No newline at end of file
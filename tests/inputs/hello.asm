@@ -0,0 +1,19 @@
+global _start
+extern puts
+section .data
+msg db "hi", 0
+len equ $ - msg
+section .text
+_start:
+    mov rdi, msg
+    call puts
+    mov ecx, 4
+.next:
+    dec ecx
+    cmp ecx 0
+    jne .next
+    mov eax, 60
+    xor edi, edi
+    int 0x80
+unused:
+    ret
@@ -0,0 +1,21 @@
+	.text
+	.globl	f
+	.type	f, @function
+f:
+	leaq	(%rdi,%rsi,4), %rcx
+	leaq	(%rcx,%rcx,2), %rax
+	ret
+	.globl	g
+	.type	g, @function
+g:
+	movl	%eax, 4(%rdi)
+	movl	%eax, 8(%rdi)
+	movl	%eax, 12(%rdi)
+	movl	%eax, 16(%rdi)
+	ret
+	.globl	h
+	.type	h, @function
+h:
+	addl	$1, (%rdi)
+	addl	(%rsi), %eax
+	ret
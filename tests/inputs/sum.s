@@ -0,0 +1,59 @@
+	.file	"sum.c"
+	.text
+	.p2align 4
+	.globl	sum
+	.type	sum, @function
+sum:
+	testl	%esi, %esi
+	jle	.L4
+	movslq	%esi, %rsi
+	xorl	%edx, %edx
+	leaq	(%rdi,%rsi,4), %rcx
+	.p2align 4,,10
+	.p2align 3
+.L3:
+	movl	(%rdi), %eax
+	addq	$4, %rdi
+	leal	(%rax,%rax,2), %eax
+	cltq
+	addq	%rax, %rdx
+	cmpq	%rdi, %rcx
+	jne	.L3
+	movq	%rdx, %rax
+	ret
+	.p2align 4,,10
+	.p2align 3
+.L4:
+	xorl	%edx, %edx
+	movq	%rdx, %rax
+	ret
+	.size	sum, .-sum
+	.section	.rodata.str1.1,"aMS",@progbits,1
+.LC0:
+	.string	"%ld\n"
+	.section	.text.startup,"ax",@progbits
+	.p2align 4
+	.globl	main
+	.type	main, @function
+main:
+	subq	$8, %rsp
+	movl	$2, %edi
+	call	scale@PLT
+	movl	$30, %esi
+	leaq	.LC0(%rip), %rdi
+	movl	%eax, counter(%rip)
+	xorl	%eax, %eax
+	call	printf@PLT
+	xorl	%eax, %eax
+	addq	$8, %rsp
+	ret
+	.size	main, .-main
+	.globl	counter
+	.bss
+	.align 4
+	.type	counter, @object
+	.size	counter, 4
+counter:
+	.zero	4
+	.ident	"GCC"
+	.section	.note.GNU-stack,"",@progbits
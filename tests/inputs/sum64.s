@@ -0,0 +1,43 @@
+	.arch armv8-a
+	.file	"sum.c"
+	.text
+	.align	2
+	.global	sum
+	.type	sum, %function
+sum:
+	cmp	w1, 0
+	ble	.L4
+	mov	x2, 0
+	mov	x3, 0
+.L3:
+	ldr	w4, [x0, x2, lsl 2]
+	add	x2, x2, 1
+	add	w4, w4, w4, lsl 1
+	cmp	w1, w2
+	add	x3, x3, w4, sxtw
+	bgt	.L3
+	mov	x0, x3
+	ret
+.L4:
+	mov	x0, 0
+	ret
+	.size	sum, .-sum
+	.global	main
+	.type	main, %function
+main:
+	stp	x29, x30, [sp, -32]!
+	mov	x29, sp
+	ldr	w1, [x0, w1, uxtw 2]
+	bl	scale
+	adrp	x1, counter
+	str	w0, [x1, #:lo12:counter]
+	ldp	x29, x30, [sp], 32
+	ret
+	.size	main, .-main
+	.global	counter
+	.bss
+	.align	2
+	.type	counter, %object
+	.size	counter, 4
+counter:
+	.zero	4